@@ -0,0 +1,250 @@
+/*
+ * Copyright (C) 2003-2015 FreeIPMI Core Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#if STDC_HEADERS
+#include <string.h>
+#endif /* STDC_HEADERS */
+#if HAVE_STRINGS_H
+#include <strings.h>
+#endif /* HAVE_STRINGS_H */
+#if HAVE_ARGP_H
+#include <argp.h>
+#else /* !HAVE_ARGP_H */
+#include "freeipmi-argp.h"
+#endif /* !HAVE_ARGP_H */
+#include <limits.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "bmc-simulator.h"
+#include "bmc-simulator-argp.h"
+
+#include "freeipmi-portability.h"
+#include "error.h"
+
+const char *argp_program_version =
+  "bmc-simulator - " PACKAGE_VERSION "\n"
+  "Copyright (C) 2003-2015 FreeIPMI Core Team\n"
+  "This program is free software; you may redistribute it under the terms of\n"
+  "the GNU General Public License.  This program has absolutely no warranty.";
+
+const char *argp_program_bug_address =
+  "<" PACKAGE_BUGREPORT ">";
+
+static char cmdline_doc[] =
+  "bmc-simulator - simulate IPMI BMCs on the network for testing";
+
+static char cmdline_args_doc[] = "";
+
+static struct argp_option cmdline_options[] =
+  {
+    { "address", BMC_SIMULATOR_ADDRESS_KEY, "IPADDRESS", 0,
+      "Specify the IPv4 address to listen on.", 1},
+    { "port", BMC_SIMULATOR_PORT_KEY, "PORT", 0,
+      "Specify the UDP port to listen on.", 2},
+    { "count", BMC_SIMULATOR_COUNT_KEY, "COUNT", 0,
+      "Specify the number of BMCs to simulate, listening on consecutive ports.", 3},
+    { "consecutive-addresses", BMC_SIMULATOR_CONSECUTIVE_ADDRESSES_KEY, 0, 0,
+      "Listen on consecutive IPv4 addresses instead of consecutive ports.", 4},
+    { "password", BMC_SIMULATOR_PASSWORD_KEY, "PASSWORD", 0,
+      "Specify the password required for straight password key and IPMI 2.0 authentication.", 5},
+    { "latency", BMC_SIMULATOR_LATENCY_KEY, "MILLISECONDS", 0,
+      "Specify the delay before responses are sent.", 6},
+    { "latency-jitter", BMC_SIMULATOR_LATENCY_JITTER_KEY, "MILLISECONDS", 0,
+      "Specify a random additional delay of up to MILLISECONDS before responses are sent.", 7},
+    { "loss", BMC_SIMULATOR_LOSS_KEY, "PERCENT", 0,
+      "Specify the percentage of requests to drop.", 8},
+    { "power-on-delay", BMC_SIMULATOR_POWER_ON_DELAY_KEY, "MILLISECONDS", 0,
+      "Specify how long machines take to power on after a power control command.", 9},
+    { "power-off-delay", BMC_SIMULATOR_POWER_OFF_DELAY_KEY, "MILLISECONDS", 0,
+      "Specify how long machines take to power off after a power control command.", 10},
+    { "quirks", BMC_SIMULATOR_QUIRKS_KEY, "QUIRKS", 0,
+      "Specify a comma separated list of BMC quirks to simulate.", 11},
+    { "sel-entries", BMC_SIMULATOR_SEL_ENTRIES_KEY, "COUNT", 0,
+      "Specify the number of SEL entries each BMC starts with.", 12},
+    { "debug", BMC_SIMULATOR_DEBUG_KEY, 0, 0,
+      "Output each packet received and sent.", 13},
+    { NULL, 0, NULL, 0, NULL, 0}
+  };
+
+static error_t cmdline_parse (int key, char *arg, struct argp_state *state);
+
+static struct argp cmdline_argp = { cmdline_options,
+                                    cmdline_parse,
+                                    cmdline_args_doc,
+                                    cmdline_doc };
+
+static unsigned int
+_parse_unsigned_int (const char *arg, const char *str, unsigned int max)
+{
+  char *endptr;
+  long tmp;
+
+  assert (arg);
+  assert (str);
+
+  errno = 0;
+  tmp = strtol (arg, &endptr, 10);
+  if (errno
+      || endptr[0] != '\0'
+      || tmp < 0
+      || tmp > max)
+    err_exit ("invalid %s", str);
+
+  return (tmp);
+}
+
+static unsigned int
+_parse_quirks (const char *arg)
+{
+  char *buf, *tok, *saveptr = NULL;
+  unsigned int quirks = 0;
+
+  assert (arg);
+
+  if (!(buf = strdup (arg)))
+    err_exit ("strdup: %s", strerror (errno));
+
+  tok = strtok_r (buf, ",", &saveptr);
+  while (tok)
+    {
+      if (!strcasecmp (tok, BMC_SIMULATOR_QUIRK_SESSION_ID_ZERO_STR))
+        quirks |= BMC_SIMULATOR_QUIRK_SESSION_ID_ZERO;
+      else if (!strcasecmp (tok, BMC_SIMULATOR_QUIRK_BIG_ENDIAN_SEQUENCE_NUMBER_STR))
+        quirks |= BMC_SIMULATOR_QUIRK_BIG_ENDIAN_SEQUENCE_NUMBER;
+      else if (!strcasecmp (tok, BMC_SIMULATOR_QUIRK_NO_AUTH_CODE_STR))
+        quirks |= BMC_SIMULATOR_QUIRK_NO_AUTH_CODE;
+      else if (!strcasecmp (tok, BMC_SIMULATOR_QUIRK_BUSY_STR))
+        quirks |= BMC_SIMULATOR_QUIRK_BUSY;
+      else
+        err_exit ("invalid quirk: %s", tok);
+
+      tok = strtok_r (NULL, ",", &saveptr);
+    }
+
+  free (buf);
+  return (quirks);
+}
+
+static error_t
+cmdline_parse (int key, char *arg, struct argp_state *state)
+{
+  struct bmc_simulator_arguments *cmd_args;
+
+  assert (state);
+
+  cmd_args = state->input;
+
+  switch (key)
+    {
+    case BMC_SIMULATOR_ADDRESS_KEY:
+      if (!(cmd_args->address = strdup (arg)))
+        err_exit ("strdup: %s", strerror (errno));
+      break;
+    case BMC_SIMULATOR_PORT_KEY:
+      cmd_args->port = _parse_unsigned_int (arg, "port", 65535);
+      break;
+    case BMC_SIMULATOR_COUNT_KEY:
+      cmd_args->count = _parse_unsigned_int (arg, "count", BMC_SIMULATOR_COUNT_MAX);
+      if (!cmd_args->count)
+        err_exit ("invalid count");
+      break;
+    case BMC_SIMULATOR_CONSECUTIVE_ADDRESSES_KEY:
+      cmd_args->consecutive_addresses++;
+      break;
+    case BMC_SIMULATOR_PASSWORD_KEY:
+      if (strlen (arg) > IPMI_1_5_MAX_PASSWORD_LENGTH)
+        err_exit ("password too long");
+      if (!(cmd_args->password = strdup (arg)))
+        err_exit ("strdup: %s", strerror (errno));
+      break;
+    case BMC_SIMULATOR_LATENCY_KEY:
+      cmd_args->latency = _parse_unsigned_int (arg, "latency", INT_MAX);
+      break;
+    case BMC_SIMULATOR_LATENCY_JITTER_KEY:
+      cmd_args->latency_jitter = _parse_unsigned_int (arg, "latency jitter", INT_MAX);
+      break;
+    case BMC_SIMULATOR_LOSS_KEY:
+      cmd_args->loss = _parse_unsigned_int (arg, "loss", BMC_SIMULATOR_PERCENT_MAX);
+      break;
+    case BMC_SIMULATOR_POWER_ON_DELAY_KEY:
+      cmd_args->power_on_delay = _parse_unsigned_int (arg, "power on delay", INT_MAX);
+      break;
+    case BMC_SIMULATOR_POWER_OFF_DELAY_KEY:
+      cmd_args->power_off_delay = _parse_unsigned_int (arg, "power off delay", INT_MAX);
+      break;
+    case BMC_SIMULATOR_QUIRKS_KEY:
+      cmd_args->quirks = _parse_quirks (arg);
+      break;
+    case BMC_SIMULATOR_SEL_ENTRIES_KEY:
+      cmd_args->sel_entries = _parse_unsigned_int (arg, "sel entries", BMC_SIMULATOR_SEL_ENTRIES_MAX);
+      break;
+    case BMC_SIMULATOR_DEBUG_KEY:
+      cmd_args->debug++;
+      break;
+    case ARGP_KEY_ARG:
+      /* Too many arguments. */
+      argp_usage (state);
+      break;
+    case ARGP_KEY_END:
+      break;
+    default:
+      return (ARGP_ERR_UNKNOWN);
+    }
+
+  return (0);
+}
+
+void
+bmc_simulator_argp_parse (int argc, char **argv, struct bmc_simulator_arguments *cmd_args)
+{
+  assert (argc >= 0);
+  assert (argv);
+  assert (cmd_args);
+
+  cmd_args->address = NULL;
+  cmd_args->port = RMCP_PRIMARY_RMCP_PORT;
+  cmd_args->count = BMC_SIMULATOR_COUNT_DEFAULT;
+  cmd_args->consecutive_addresses = 0;
+  cmd_args->password = NULL;
+  cmd_args->latency = 0;
+  cmd_args->latency_jitter = 0;
+  cmd_args->loss = 0;
+  cmd_args->power_on_delay = 0;
+  cmd_args->power_off_delay = 0;
+  cmd_args->quirks = 0;
+  cmd_args->sel_entries = BMC_SIMULATOR_SEL_ENTRIES_DEFAULT;
+  cmd_args->debug = 0;
+
+  argp_parse (&cmdline_argp,
+              argc,
+              argv,
+              ARGP_IN_ORDER,
+              NULL,
+              cmd_args);
+
+  if (!cmd_args->consecutive_addresses
+      && cmd_args->port + cmd_args->count - 1 > 65535)
+    err_exit ("port range too large");
+}
@@ -0,0 +1,2648 @@
+/*
+ * Copyright (C) 2003-2015 FreeIPMI Core Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#if STDC_HEADERS
+#include <string.h>
+#endif /* STDC_HEADERS */
+#include <stdint.h>
+#include <stdarg.h>
+#include <assert.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#ifdef WITH_ENCRYPTION
+#if HAVE_GCRYPT_H
+#include <gcrypt.h>
+#endif /* HAVE_GCRYPT_H */
+#endif /* WITH_ENCRYPTION */
+
+#include <freeipmi/freeipmi.h>
+
+#include "bmc-simulator.h"
+#include "bmc-simulator-ipmi.h"
+#include "bmc-simulator-repository.h"
+
+#include "freeipmi-portability.h"
+#include "error.h"
+#include "timeval.h"
+
+extern struct bmc_simulator_arguments cmd_args;
+
+/* RMCP header + authentication type + session sequence number +
+ * session id + authentication code + message length
+ */
+#define BMC_SIMULATOR_SESSION_HDR_LEN_MAX  (4 + 1 + 4 + 4 + IPMI_1_5_MAX_PASSWORD_LENGTH + 1)
+
+/* rq/rs address + net_fn/lun + checksum1 + rq/rs address +
+ * rq_seq/lun + checksum2
+ */
+#define BMC_SIMULATOR_MSG_HDR_TRLR_LEN     6
+
+/* rq/rs address + net_fn/lun + checksum1 + rq/rs address + rq_seq/lun */
+#define BMC_SIMULATOR_MSG_HDR_LEN          5
+
+/* RMCP header + authentication type + payload type + session id +
+ * session sequence number + payload length
+ */
+#define BMC_SIMULATOR_RMCPPLUS_HDR_LEN     (4 + 1 + 1 + 4 + 4 + 2)
+
+#define BMC_SIMULATOR_RMCPPLUS_PAYLOAD_TYPE_MASK        0x3F
+#define BMC_SIMULATOR_RMCPPLUS_PAYLOAD_AUTHENTICATED    0x40
+#define BMC_SIMULATOR_RMCPPLUS_PAYLOAD_ENCRYPTED        0x80
+
+/* SOL character data per packet, in both directions */
+#define BMC_SIMULATOR_SOL_CHARACTER_DATA_MAX 128
+
+/* SOL payload header: sequence number, ack/nack sequence number,
+ * accepted character count, operation/status
+ */
+#define BMC_SIMULATOR_SOL_HDR_LEN          4
+
+/* Request fields from an IPMI 1.5 LAN packet or an IPMI 2.0 IPMI
+ * payload.  The packet is parsed by hand rather than through the lan
+ * interface templates so that malformed and quirky packets can be
+ * handled the way a BMC would.
+ */
+struct bmc_simulator_rq
+{
+  uint8_t authentication_type;
+  uint32_t session_sequence_number;
+  uint32_t session_id;
+  uint8_t authentication_code[IPMI_1_5_MAX_PASSWORD_LENGTH];
+  uint8_t rs_addr;
+  uint8_t net_fn;
+  uint8_t rs_lun;
+  uint8_t rq_addr;
+  uint8_t rq_seq;
+  uint8_t rq_lun;
+  uint8_t cmd;
+  /* command data, starting with the command byte */
+  const uint8_t *data;
+  unsigned int data_len;
+};
+
+static uint16_t
+_get_le16 (const uint8_t *buf)
+{
+  assert (buf);
+
+  return ((uint16_t)buf[0] | ((uint16_t)buf[1] << 8));
+}
+
+static uint32_t
+_get_le32 (const uint8_t *buf)
+{
+  assert (buf);
+
+  return ((uint32_t)buf[0]
+          | ((uint32_t)buf[1] << 8)
+          | ((uint32_t)buf[2] << 16)
+          | ((uint32_t)buf[3] << 24));
+}
+
+static void
+_set_le16 (uint8_t *buf, uint16_t val)
+{
+  assert (buf);
+
+  buf[0] = (val & 0x00FF);
+  buf[1] = (val & 0xFF00) >> 8;
+}
+
+static void
+_set_le32 (uint8_t *buf, uint32_t val)
+{
+  assert (buf);
+
+  buf[0] = (val & 0x000000FF);
+  buf[1] = (val & 0x0000FF00) >> 8;
+  buf[2] = (val & 0x00FF0000) >> 16;
+  buf[3] = (val & 0xFF000000) >> 24;
+}
+
+static void
+_set_be32 (uint8_t *buf, uint32_t val)
+{
+  assert (buf);
+
+  buf[0] = (val & 0xFF000000) >> 24;
+  buf[1] = (val & 0x00FF0000) >> 16;
+  buf[2] = (val & 0x0000FF00) >> 8;
+  buf[3] = (val & 0x000000FF);
+}
+
+static uint32_t
+_random_nonzero32 (void)
+{
+  uint32_t val = 0;
+
+  while (!val)
+    {
+      if (ipmi_get_random (&val, sizeof (val)) < 0)
+        err_exit ("ipmi_get_random: %s", strerror (errno));
+    }
+
+  return (val);
+}
+
+/* create an object with all fields set to zero, so only the fields
+ * of interest need to be set before the object is assembled
+ */
+static fiid_obj_t
+_obj_create (fiid_template_t tmpl)
+{
+  uint8_t buf[BMC_SIMULATOR_PACKET_BUFLEN];
+  fiid_obj_t obj;
+  int len;
+
+  if (!(obj = fiid_obj_create (tmpl)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+
+  if ((len = fiid_template_len_bytes (tmpl)) < 0)
+    err_exit ("fiid_template_len_bytes: %s", strerror (errno));
+
+  assert (len <= sizeof (buf));
+
+  memset (buf, '\0', len);
+  if (fiid_obj_set_all (obj, buf, len) < 0)
+    err_exit ("fiid_obj_set_all: %s", fiid_obj_errormsg (obj));
+
+  return (obj);
+}
+
+static void
+_obj_set (fiid_obj_t obj, const char *field, uint64_t val)
+{
+  assert (obj);
+  assert (field);
+
+  if (fiid_obj_set (obj, field, val) < 0)
+    err_exit ("fiid_obj_set: '%s': %s", field, fiid_obj_errormsg (obj));
+}
+
+static void
+_obj_set_data (fiid_obj_t obj, const char *field, const void *data, unsigned int data_len)
+{
+  assert (obj);
+  assert (field);
+  assert (data);
+
+  if (fiid_obj_set_data (obj, field, data, data_len) < 0)
+    err_exit ("fiid_obj_set_data: '%s': %s", field, fiid_obj_errormsg (obj));
+}
+
+/* returns 0 if field could not be read, e.g. the request was too
+ * short, 1 otherwise
+ */
+static int
+_obj_get (fiid_obj_t obj, const char *field, uint64_t *val)
+{
+  assert (obj);
+  assert (field);
+  assert (val);
+
+  if (fiid_obj_get (obj, field, val) <= 0)
+    return (0);
+  return (1);
+}
+
+static fiid_obj_t
+_obj_create_rq (fiid_template_t tmpl, struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj;
+
+  assert (rq);
+
+  if (!(obj = fiid_obj_create (tmpl)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+
+  if (fiid_obj_set_all (obj, rq->data, rq->data_len) < 0)
+    err_exit ("fiid_obj_set_all: %s", fiid_obj_errormsg (obj));
+
+  return (obj);
+}
+
+static fiid_obj_t
+_obj_create_rs (fiid_template_t tmpl, struct bmc_simulator_rq *rq, uint8_t comp_code)
+{
+  fiid_obj_t obj;
+
+  assert (rq);
+
+  obj = _obj_create (tmpl);
+  _obj_set (obj, "cmd", rq->cmd);
+  _obj_set (obj, "comp_code", comp_code);
+  return (obj);
+}
+
+/* responses that only carry a completion code are assembled from
+ * the chassis control template, all such templates are identical
+ */
+static fiid_obj_t
+_obj_create_rs_comp_code (struct bmc_simulator_rq *rq, uint8_t comp_code)
+{
+  return (_obj_create_rs (tmpl_cmd_chassis_control_rs, rq, comp_code));
+}
+
+static void
+_debug (struct bmc_simulator_bmc *bmc, const char *fmt, ...)
+{
+  char buf[BMC_SIMULATOR_PACKET_BUFLEN];
+  char addrbuf[INET_ADDRSTRLEN];
+  va_list ap;
+
+  assert (bmc);
+  assert (fmt);
+
+  if (!cmd_args.debug)
+    return;
+
+  if (!inet_ntop (AF_INET, &bmc->addr.sin_addr, addrbuf, INET_ADDRSTRLEN))
+    snprintf (addrbuf, INET_ADDRSTRLEN, "unknown");
+
+  va_start (ap, fmt);
+  vsnprintf (buf, BMC_SIMULATOR_PACKET_BUFLEN, fmt, ap);
+  va_end (ap);
+
+  fprintf (stderr, "%s:%u: %s\n", addrbuf, ntohs (bmc->addr.sin_port), buf);
+}
+
+static unsigned int
+_process_asf (struct bmc_simulator_bmc *bmc,
+              const uint8_t *rq,
+              unsigned int rq_len,
+              uint8_t *rs,
+              unsigned int rs_buflen)
+{
+  fiid_obj_t obj_rmcp_hdr = NULL;
+  fiid_obj_t obj_ping = NULL;
+  fiid_obj_t obj_pong = NULL;
+  uint64_t message_type, message_tag;
+  unsigned int rv = 0;
+  int len;
+
+  assert (bmc);
+  assert (rq);
+  assert (rs);
+
+  if (!(obj_rmcp_hdr = fiid_obj_create (tmpl_rmcp_hdr)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+  if (!(obj_ping = fiid_obj_create (tmpl_cmd_asf_presence_ping)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+
+  if (unassemble_rmcp_pkt (rq,
+                           rq_len,
+                           obj_rmcp_hdr,
+                           obj_ping,
+                           IPMI_INTERFACE_FLAGS_DEFAULT) <= 0)
+    goto cleanup;
+
+  if (!_obj_get (obj_ping, "message_type", &message_type)
+      || !_obj_get (obj_ping, "message_tag", &message_tag))
+    goto cleanup;
+
+  if (message_type != RMCP_ASF_MESSAGE_TYPE_PRESENCE_PING)
+    goto cleanup;
+
+  _debug (bmc, "presence ping: message tag = %u", (unsigned int)message_tag);
+
+  if (fiid_obj_clear (obj_rmcp_hdr) < 0)
+    err_exit ("fiid_obj_clear: %s", fiid_obj_errormsg (obj_rmcp_hdr));
+
+  if (fill_rmcp_hdr_asf (obj_rmcp_hdr) < 0)
+    err_exit ("fill_rmcp_hdr_asf: %s", strerror (errno));
+
+  obj_pong = _obj_create (tmpl_cmd_asf_presence_pong);
+  _obj_set (obj_pong, "iana_enterprise_number", htonl (RMCP_ASF_IANA_ENTERPRISE_NUM));
+  _obj_set (obj_pong, "message_type", RMCP_ASF_MESSAGE_TYPE_PRESENCE_PONG);
+  _obj_set (obj_pong, "message_tag", message_tag);
+  _obj_set (obj_pong, "data_length", 0x10);
+  _obj_set (obj_pong, "oem_iana_enterprise_number", 0);
+  _obj_set (obj_pong, "supported_entities.version", 1);
+  _obj_set (obj_pong, "supported_entities.ipmi_supported", 1);
+
+  if ((len = assemble_rmcp_pkt (obj_rmcp_hdr,
+                                obj_pong,
+                                rs,
+                                rs_buflen,
+                                IPMI_INTERFACE_FLAGS_DEFAULT)) < 0)
+    err_exit ("assemble_rmcp_pkt: %s", strerror (errno));
+
+  rv = len;
+ cleanup:
+  fiid_obj_destroy (obj_rmcp_hdr);
+  fiid_obj_destroy (obj_ping);
+  fiid_obj_destroy (obj_pong);
+  return (rv);
+}
+
+/* returns 1 if the IPMI message is well formed, 0 if not */
+static int
+_parse_msg (struct bmc_simulator_bmc *bmc,
+            const uint8_t *msg,
+            unsigned int msg_len,
+            struct bmc_simulator_rq *rq)
+{
+  assert (bmc);
+  assert (msg);
+  assert (rq);
+
+  if (msg_len <= BMC_SIMULATOR_MSG_HDR_TRLR_LEN)
+    return (0);
+
+  if (ipmi_checksum (msg, 2) != msg[2]
+      || ipmi_checksum (&msg[3], msg_len - 4) != msg[msg_len - 1])
+    {
+      _debug (bmc, "invalid checksum");
+      return (0);
+    }
+
+  rq->rs_addr = msg[0];
+  rq->net_fn = msg[1] >> 2;
+  rq->rs_lun = msg[1] & 0x03;
+  rq->rq_addr = msg[3];
+  rq->rq_seq = msg[4] >> 2;
+  rq->rq_lun = msg[4] & 0x03;
+  rq->cmd = msg[5];
+  rq->data = &msg[5];
+  rq->data_len = msg_len - BMC_SIMULATOR_MSG_HDR_TRLR_LEN;
+  return (1);
+}
+
+/* returns 1 if the packet is a well formed IPMI 1.5 request, 0 if not */
+static int
+_parse_rq (struct bmc_simulator_bmc *bmc,
+           const uint8_t *pkt,
+           unsigned int pkt_len,
+           struct bmc_simulator_rq *rq)
+{
+  unsigned int index = 4;
+  uint8_t msg_len;
+
+  assert (bmc);
+  assert (pkt);
+  assert (rq);
+
+  memset (rq, '\0', sizeof (struct bmc_simulator_rq));
+
+  if (pkt_len < index + 1)
+    return (0);
+
+  rq->authentication_type = pkt[index++];
+
+  if (pkt_len < index + 8)
+    return (0);
+
+  rq->session_sequence_number = _get_le32 (&pkt[index]);
+  index += 4;
+  rq->session_id = _get_le32 (&pkt[index]);
+  index += 4;
+
+  if (rq->authentication_type != IPMI_AUTHENTICATION_TYPE_NONE)
+    {
+      if (pkt_len < index + IPMI_1_5_MAX_PASSWORD_LENGTH)
+        return (0);
+      memcpy (rq->authentication_code, &pkt[index], IPMI_1_5_MAX_PASSWORD_LENGTH);
+      index += IPMI_1_5_MAX_PASSWORD_LENGTH;
+    }
+
+  if (pkt_len < index + 1)
+    return (0);
+
+  msg_len = pkt[index++];
+
+  if (pkt_len < index + msg_len)
+    return (0);
+
+  return (_parse_msg (bmc, &pkt[index], msg_len, rq));
+}
+
+/* write the BMC_SIMULATOR_MSG_HDR_LEN byte IPMI message header of
+ * the response to rq
+ */
+static void
+_msg_hdr_rs (struct bmc_simulator_rq *rq, uint8_t *msg)
+{
+  assert (rq);
+  assert (msg);
+
+  msg[0] = rq->rq_addr;
+  msg[1] = ((rq->net_fn + 1) << 2) | rq->rq_lun;
+  msg[2] = ipmi_checksum (msg, 2);
+  msg[3] = IPMI_SLAVE_ADDRESS_BMC;
+  msg[4] = (rq->rq_seq << 2) | rq->rs_lun;
+}
+
+static unsigned int
+_assemble_rs (struct bmc_simulator_bmc *bmc,
+              struct bmc_simulator_rq *rq,
+              uint8_t authentication_type,
+              uint32_t session_sequence_number,
+              uint32_t session_id,
+              fiid_obj_t obj_cmd_rs,
+              uint8_t *rs,
+              unsigned int rs_buflen)
+{
+  uint8_t cmd_buf[BMC_SIMULATOR_PACKET_BUFLEN];
+  fiid_obj_t obj_rmcp_hdr;
+  unsigned int index;
+  uint8_t *msg;
+  int len, cmd_len;
+
+  assert (bmc);
+  assert (rq);
+  assert (obj_cmd_rs);
+  assert (rs);
+  assert (rs_buflen >= BMC_SIMULATOR_SESSION_HDR_LEN_MAX);
+
+  if (!(obj_rmcp_hdr = fiid_obj_create (tmpl_rmcp_hdr)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+
+  if (fill_rmcp_hdr_ipmi (obj_rmcp_hdr) < 0)
+    err_exit ("fill_rmcp_hdr_ipmi: %s", strerror (errno));
+
+  if ((len = fiid_obj_get_all (obj_rmcp_hdr, rs, rs_buflen)) < 0)
+    err_exit ("fiid_obj_get_all: %s", fiid_obj_errormsg (obj_rmcp_hdr));
+
+  fiid_obj_destroy (obj_rmcp_hdr);
+
+  if ((cmd_len = fiid_obj_get_all (obj_cmd_rs, cmd_buf, BMC_SIMULATOR_PACKET_BUFLEN)) < 0)
+    err_exit ("fiid_obj_get_all: %s", fiid_obj_errormsg (obj_cmd_rs));
+
+  index = len;
+
+  rs[index++] = authentication_type;
+
+  if (cmd_args.quirks & BMC_SIMULATOR_QUIRK_BIG_ENDIAN_SEQUENCE_NUMBER)
+    _set_be32 (&rs[index], session_sequence_number);
+  else
+    _set_le32 (&rs[index], session_sequence_number);
+  index += 4;
+
+  if (cmd_args.quirks & BMC_SIMULATOR_QUIRK_SESSION_ID_ZERO)
+    _set_le32 (&rs[index], 0);
+  else
+    _set_le32 (&rs[index], session_id);
+  index += 4;
+
+  if (authentication_type != IPMI_AUTHENTICATION_TYPE_NONE)
+    {
+      memset (&rs[index], '\0', IPMI_1_5_MAX_PASSWORD_LENGTH);
+      if (authentication_type == IPMI_AUTHENTICATION_TYPE_STRAIGHT_PASSWORD_KEY
+          && cmd_args.password
+          && !(cmd_args.quirks & BMC_SIMULATOR_QUIRK_NO_AUTH_CODE))
+        memcpy (&rs[index], cmd_args.password, strlen (cmd_args.password));
+      index += IPMI_1_5_MAX_PASSWORD_LENGTH;
+    }
+
+  if (index + 1 + cmd_len + BMC_SIMULATOR_MSG_HDR_TRLR_LEN > rs_buflen)
+    err_exit ("response buffer too small");
+
+  rs[index++] = cmd_len + BMC_SIMULATOR_MSG_HDR_TRLR_LEN;
+
+  msg = &rs[index];
+  _msg_hdr_rs (rq, msg);
+  memcpy (&msg[5], cmd_buf, cmd_len);
+  msg[5 + cmd_len] = ipmi_checksum (&msg[3], 2 + cmd_len);
+
+  index += cmd_len + BMC_SIMULATOR_MSG_HDR_TRLR_LEN;
+  return (index);
+}
+
+static struct bmc_simulator_session *
+_session_find (struct bmc_simulator_bmc *bmc, uint32_t session_id, int activated)
+{
+  unsigned int i;
+
+  assert (bmc);
+
+  for (i = 0; i < BMC_SIMULATOR_SESSIONS_MAX; i++)
+    {
+      struct bmc_simulator_session *s = &bmc->sessions[i];
+
+      if (!s->in_use || s->activated != activated)
+        continue;
+
+      if ((activated && s->session_id == session_id)
+          || (!activated && s->temp_session_id == session_id))
+        return (s);
+    }
+
+  return (NULL);
+}
+
+static struct bmc_simulator_session *
+_session_new (struct bmc_simulator_bmc *bmc)
+{
+  struct bmc_simulator_session *s = NULL;
+  unsigned int i;
+
+  assert (bmc);
+
+  for (i = 0; i < BMC_SIMULATOR_SESSIONS_MAX; i++)
+    {
+      if (!bmc->sessions[i].in_use)
+        {
+          s = &bmc->sessions[i];
+          break;
+        }
+
+      if (!s || timeval_lt (&bmc->sessions[i].last_used, &s->last_used))
+        s = &bmc->sessions[i];
+    }
+
+  assert (s);
+
+  if (bmc->sol_session == s)
+    bmc->sol_session = NULL;
+
+  memset (s, '\0', sizeof (struct bmc_simulator_session));
+  s->in_use = 1;
+  s->temp_session_id = _random_nonzero32 ();
+  gettimeofday (&s->last_used, NULL);
+  return (s);
+}
+
+static void
+_session_close (struct bmc_simulator_bmc *bmc, struct bmc_simulator_session *s)
+{
+  assert (bmc);
+  assert (s);
+
+  if (bmc->sol_session == s)
+    bmc->sol_session = NULL;
+
+  memset (s, '\0', sizeof (struct bmc_simulator_session));
+}
+
+static void
+_power_update (struct bmc_simulator_bmc *bmc)
+{
+  struct timeval now;
+
+  assert (bmc);
+
+  if (!bmc->power_change_pending)
+    return;
+
+  gettimeofday (&now, NULL);
+  if (timeval_lt (&now, &bmc->power_change_time))
+    return;
+
+  bmc->power_on = bmc->power_change_on;
+  bmc->power_change_pending = 0;
+  _debug (bmc, "power %s", bmc->power_on ? "on" : "off");
+}
+
+static void
+_power_schedule (struct bmc_simulator_bmc *bmc, int on, unsigned int delay)
+{
+  assert (bmc);
+
+  if (!delay)
+    {
+      bmc->power_on = on;
+      bmc->power_change_pending = 0;
+      return;
+    }
+
+  gettimeofday (&bmc->power_change_time, NULL);
+  timeval_add_ms (&bmc->power_change_time, delay, &bmc->power_change_time);
+  bmc->power_change_on = on;
+  bmc->power_change_pending = 1;
+}
+
+static fiid_obj_t
+_cmd_get_channel_authentication_capabilities (struct bmc_simulator_bmc *bmc,
+                                              struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs;
+  uint64_t get_ipmi_v20_extended_data = 0;
+
+  assert (bmc);
+  assert (rq);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_get_channel_authentication_capabilities_rq, rq);
+  _obj_get (obj_cmd_rq, "get_ipmi_v2.0_extended_data", &get_ipmi_v20_extended_data);
+  fiid_obj_destroy (obj_cmd_rq);
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_get_channel_authentication_capabilities_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "channel_number", 1);
+  _obj_set (obj_cmd_rs, "authentication_type.none", 1);
+  _obj_set (obj_cmd_rs, "authentication_type.straight_password_key", 1);
+  _obj_set (obj_cmd_rs, "authentication_status.anonymous_login", 1);
+  _obj_set (obj_cmd_rs, "authentication_status.null_username", 1);
+  _obj_set (obj_cmd_rs, "authentication_status.non_null_username", 1);
+  /* 1 = per-message authentication disabled */
+  _obj_set (obj_cmd_rs, "authentication_status.per_message_authentication", 1);
+  _obj_set (obj_cmd_rs, "channel_supports_ipmi_v1.5_connections", 1);
+#ifdef WITH_ENCRYPTION
+  if (get_ipmi_v20_extended_data)
+    {
+      _obj_set (obj_cmd_rs, "authentication_type.ipmi_v2.0_extended_capabilities_available", 1);
+      _obj_set (obj_cmd_rs, "channel_supports_ipmi_v2.0_connections", 1);
+    }
+#endif /* WITH_ENCRYPTION */
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_get_session_challenge (struct bmc_simulator_bmc *bmc,
+                            struct bmc_simulator_rq *rq)
+{
+  struct bmc_simulator_session *s;
+  uint8_t challenge_string[IPMI_CHALLENGE_STRING_LENGTH];
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs;
+  uint64_t authentication_type;
+
+  assert (bmc);
+  assert (rq);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_get_session_challenge_rq, rq);
+
+  if (!_obj_get (obj_cmd_rq, "authentication_type", &authentication_type))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUEST_DATA_LENGTH_INVALID);
+      goto cleanup;
+    }
+
+  if (authentication_type != IPMI_AUTHENTICATION_TYPE_NONE
+      && authentication_type != IPMI_AUTHENTICATION_TYPE_STRAIGHT_PASSWORD_KEY)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_INVALID_DATA_FIELD_IN_REQUEST);
+      goto cleanup;
+    }
+
+  s = _session_new (bmc);
+
+  if (ipmi_get_random (challenge_string, IPMI_CHALLENGE_STRING_LENGTH) < 0)
+    err_exit ("ipmi_get_random: %s", strerror (errno));
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_get_session_challenge_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "temp_session_id", s->temp_session_id);
+  _obj_set_data (obj_cmd_rs,
+                 "challenge_string",
+                 challenge_string,
+                 IPMI_CHALLENGE_STRING_LENGTH);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  return (obj_cmd_rs);
+}
+
+/* returns NULL if the request should be dropped */
+static fiid_obj_t
+_cmd_activate_session (struct bmc_simulator_bmc *bmc,
+                       struct bmc_simulator_rq *rq,
+                       struct bmc_simulator_session *s)
+{
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs = NULL;
+  uint64_t authentication_type;
+  uint64_t maximum_privilege_level;
+  uint64_t initial_outbound_sequence_number;
+
+  assert (bmc);
+  assert (rq);
+  assert (s);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_activate_session_rq, rq);
+
+  if (!_obj_get (obj_cmd_rq, "authentication_type", &authentication_type)
+      || !_obj_get (obj_cmd_rq, "maximum_privilege_level", &maximum_privilege_level)
+      || !_obj_get (obj_cmd_rq, "initial_outbound_sequence_number", &initial_outbound_sequence_number))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUEST_DATA_LENGTH_INVALID);
+      goto cleanup;
+    }
+
+  if (authentication_type != rq->authentication_type)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_INVALID_DATA_FIELD_IN_REQUEST);
+      goto cleanup;
+    }
+
+  /* Like most BMCs, silently drop packets with a bad password */
+  if (authentication_type == IPMI_AUTHENTICATION_TYPE_STRAIGHT_PASSWORD_KEY
+      && cmd_args.password)
+    {
+      uint8_t authentication_code[IPMI_1_5_MAX_PASSWORD_LENGTH];
+
+      memset (authentication_code, '\0', IPMI_1_5_MAX_PASSWORD_LENGTH);
+      memcpy (authentication_code, cmd_args.password, strlen (cmd_args.password));
+      if (memcmp (authentication_code,
+                  rq->authentication_code,
+                  IPMI_1_5_MAX_PASSWORD_LENGTH))
+        {
+          _debug (bmc, "invalid password");
+          goto cleanup;
+        }
+    }
+
+  s->activated = 1;
+  s->session_id = _random_nonzero32 ();
+  s->authentication_type = authentication_type;
+  s->privilege_level = maximum_privilege_level;
+  s->outbound_sequence_number = initial_outbound_sequence_number;
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_activate_session_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  /* per-message authentication is disabled, so the remainder of
+   * the session uses authentication type none
+   */
+  _obj_set (obj_cmd_rs, "authentication_type", IPMI_AUTHENTICATION_TYPE_NONE);
+  _obj_set (obj_cmd_rs, "session_id", s->session_id);
+  _obj_set (obj_cmd_rs, "initial_inbound_sequence_number", _random_nonzero32 ());
+  _obj_set (obj_cmd_rs, "maximum_privilege_level", maximum_privilege_level);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_set_session_privilege_level (struct bmc_simulator_bmc *bmc,
+                                  struct bmc_simulator_rq *rq,
+                                  struct bmc_simulator_session *s)
+{
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs;
+  uint64_t privilege_level;
+
+  assert (bmc);
+  assert (rq);
+  assert (s);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_set_session_privilege_level_rq, rq);
+
+  if (!_obj_get (obj_cmd_rq, "privilege_level", &privilege_level))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUEST_DATA_LENGTH_INVALID);
+      goto cleanup;
+    }
+
+  if (privilege_level)
+    s->privilege_level = privilege_level;
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_set_session_privilege_level_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "privilege_level", s->privilege_level);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_get_chassis_status (struct bmc_simulator_bmc *bmc,
+                         struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rs;
+
+  assert (bmc);
+  assert (rq);
+
+  _power_update (bmc);
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_get_chassis_status_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "current_power_state.power_is_on", bmc->power_on);
+  _obj_set (obj_cmd_rs, "misc_chassis_state.chassis_identify_state", bmc->chassis_identify_state);
+  _obj_set (obj_cmd_rs, "misc_chassis_state.chassis_identify_command_and_state_info_supported", 1);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_chassis_control (struct bmc_simulator_bmc *bmc,
+                      struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs;
+  uint64_t chassis_control;
+
+  assert (bmc);
+  assert (rq);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_chassis_control_rq, rq);
+
+  if (!_obj_get (obj_cmd_rq, "chassis_control", &chassis_control))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUEST_DATA_LENGTH_INVALID);
+      goto cleanup;
+    }
+
+  if (cmd_args.quirks & BMC_SIMULATOR_QUIRK_BUSY)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_NODE_BUSY);
+      goto cleanup;
+    }
+
+  _power_update (bmc);
+
+  switch (chassis_control)
+    {
+    case IPMI_CHASSIS_CONTROL_POWER_DOWN:
+    case IPMI_CHASSIS_CONTROL_INITIATE_SOFT_SHUTDOWN:
+      if (bmc->power_on)
+        _power_schedule (bmc, 0, cmd_args.power_off_delay);
+      break;
+    case IPMI_CHASSIS_CONTROL_POWER_UP:
+      if (!bmc->power_on)
+        _power_schedule (bmc, 1, cmd_args.power_on_delay);
+      break;
+    case IPMI_CHASSIS_CONTROL_POWER_CYCLE:
+      /* power cycle has no effect on a machine that is off */
+      if (bmc->power_on)
+        {
+          bmc->power_on = 0;
+          _power_schedule (bmc, 1, cmd_args.power_on_delay);
+        }
+      break;
+    case IPMI_CHASSIS_CONTROL_HARD_RESET:
+    case IPMI_CHASSIS_CONTROL_PULSE_DIAGNOSTIC_INTERRUPT:
+      break;
+    default:
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_INVALID_DATA_FIELD_IN_REQUEST);
+      goto cleanup;
+    }
+
+  _debug (bmc, "chassis control: 0x%X", (unsigned int)chassis_control);
+
+  obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_COMMAND_SUCCESS);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_chassis_identify (struct bmc_simulator_bmc *bmc,
+                       struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rq;
+  uint64_t identify_interval, force_identify;
+
+  assert (bmc);
+  assert (rq);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_chassis_identify_rq, rq);
+
+  if (_obj_get (obj_cmd_rq, "force_identify", &force_identify)
+      && force_identify)
+    bmc->chassis_identify_state = IPMI_CHASSIS_IDENTIFY_STATE_INDEFINITE_ON;
+  else if (_obj_get (obj_cmd_rq, "identify_interval", &identify_interval)
+           && !identify_interval)
+    bmc->chassis_identify_state = IPMI_CHASSIS_IDENTIFY_STATE_OFF;
+  else
+    bmc->chassis_identify_state = IPMI_CHASSIS_IDENTIFY_STATE_TEMPORARY_ON;
+
+  fiid_obj_destroy (obj_cmd_rq);
+  return (_obj_create_rs_comp_code (rq, IPMI_COMP_CODE_COMMAND_SUCCESS));
+}
+
+static fiid_obj_t
+_cmd_get_device_id (struct bmc_simulator_bmc *bmc,
+                    struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rs;
+
+  assert (bmc);
+  assert (rq);
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_get_device_id_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "device_id", IPMI_SLAVE_ADDRESS_BMC);
+  _obj_set (obj_cmd_rs, "device_revision.revision", 1);
+  _obj_set (obj_cmd_rs, "device_revision.sdr_support", 1);
+  _obj_set (obj_cmd_rs, "firmware_revision1.major_revision", 1);
+#ifdef WITH_ENCRYPTION
+  _obj_set (obj_cmd_rs, "ipmi_version_major", 2);
+  _obj_set (obj_cmd_rs, "ipmi_version_minor", 0);
+#else /* !WITH_ENCRYPTION */
+  _obj_set (obj_cmd_rs, "ipmi_version_major", 1);
+  _obj_set (obj_cmd_rs, "ipmi_version_minor", 5);
+#endif /* !WITH_ENCRYPTION */
+  _obj_set (obj_cmd_rs, "additional_device_support.sensor_device", 1);
+  _obj_set (obj_cmd_rs, "additional_device_support.sdr_repository_device", 1);
+  _obj_set (obj_cmd_rs, "additional_device_support.sel_device", 1);
+  _obj_set (obj_cmd_rs, "additional_device_support.chassis_device", 1);
+  return (obj_cmd_rs);
+}
+
+/* returns index of record_id in the SEL, -1 if not found */
+static int
+_sel_find (struct bmc_simulator_bmc *bmc, uint16_t record_id)
+{
+  unsigned int i;
+
+  assert (bmc);
+
+  if (!bmc->sel_count)
+    return (-1);
+
+  if (record_id == IPMI_SEL_GET_RECORD_ID_FIRST_ENTRY)
+    return (0);
+
+  if (record_id == IPMI_SEL_GET_RECORD_ID_LAST_ENTRY)
+    return (bmc->sel_count - 1);
+
+  for (i = 0; i < bmc->sel_count; i++)
+    {
+      if (_get_le16 (bmc->sel + i * IPMI_SEL_RECORD_MAX_RECORD_LENGTH) == record_id)
+        return (i);
+    }
+
+  return (-1);
+}
+
+/* reservation ids are never 0 */
+static uint16_t
+_reservation_next (uint16_t reservation_id)
+{
+  if (!++reservation_id)
+    reservation_id++;
+  return (reservation_id);
+}
+
+static fiid_obj_t
+_cmd_get_sel_info (struct bmc_simulator_bmc *bmc,
+                   struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rs;
+  unsigned int free_space;
+
+  assert (bmc);
+  assert (rq);
+
+  free_space = (BMC_SIMULATOR_SEL_ENTRIES_MAX - bmc->sel_count) * IPMI_SEL_RECORD_MAX_RECORD_LENGTH;
+  /* FFFFh is reserved */
+  if (free_space > 0xFFFE)
+    free_space = 0xFFFE;
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_get_sel_info_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "sel_version_major", 1);
+  _obj_set (obj_cmd_rs, "sel_version_minor", 5);
+  _obj_set (obj_cmd_rs, "entries", bmc->sel_count);
+  _obj_set (obj_cmd_rs, "free_space", free_space);
+  _obj_set (obj_cmd_rs, "most_recent_addition_timestamp", bmc->sel_addition_timestamp);
+  _obj_set (obj_cmd_rs, "most_recent_erase_timestamp", bmc->sel_erase_timestamp);
+  _obj_set (obj_cmd_rs, "reserve_sel_command_supported", 1);
+  _obj_set (obj_cmd_rs, "delete_sel_command_supported", 1);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_reserve_sel (struct bmc_simulator_bmc *bmc,
+                  struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rs;
+
+  assert (bmc);
+  assert (rq);
+
+  bmc->sel_reservation_id = _reservation_next (bmc->sel_reservation_id);
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_reserve_sel_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "reservation_id", bmc->sel_reservation_id);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_get_sel_entry (struct bmc_simulator_bmc *bmc,
+                    struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs;
+  uint64_t reservation_id, record_id, offset_into_record, bytes_to_read;
+  uint16_t next_record_id;
+  uint8_t *record;
+  int index;
+
+  assert (bmc);
+  assert (rq);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_get_sel_entry_rq, rq);
+
+  if (!_obj_get (obj_cmd_rq, "reservation_id", &reservation_id)
+      || !_obj_get (obj_cmd_rq, "record_id", &record_id)
+      || !_obj_get (obj_cmd_rq, "offset_into_record", &offset_into_record)
+      || !_obj_get (obj_cmd_rq, "bytes_to_read", &bytes_to_read))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUEST_DATA_LENGTH_INVALID);
+      goto cleanup;
+    }
+
+  /* a reservation is only required for partial reads */
+  if (offset_into_record
+      && reservation_id != bmc->sel_reservation_id)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_RESERVATION_CANCELLED);
+      goto cleanup;
+    }
+
+  if ((index = _sel_find (bmc, record_id)) < 0)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUESTED_SENSOR_DATA_OR_RECORD_NOT_PRESENT);
+      goto cleanup;
+    }
+
+  if (offset_into_record >= IPMI_SEL_RECORD_MAX_RECORD_LENGTH)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_PARAMETER_OUT_OF_RANGE);
+      goto cleanup;
+    }
+
+  if (bytes_to_read == IPMI_SEL_READ_ENTIRE_RECORD_BYTES_TO_READ
+      || offset_into_record + bytes_to_read > IPMI_SEL_RECORD_MAX_RECORD_LENGTH)
+    bytes_to_read = IPMI_SEL_RECORD_MAX_RECORD_LENGTH - offset_into_record;
+
+  if ((unsigned int)index + 1 < bmc->sel_count)
+    next_record_id = _get_le16 (bmc->sel + (index + 1) * IPMI_SEL_RECORD_MAX_RECORD_LENGTH);
+  else
+    next_record_id = IPMI_SEL_GET_RECORD_ID_LAST_ENTRY;
+
+  record = bmc->sel + index * IPMI_SEL_RECORD_MAX_RECORD_LENGTH;
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_get_sel_entry_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "next_record_id", next_record_id);
+  _obj_set_data (obj_cmd_rs,
+                 "record_data",
+                 record + offset_into_record,
+                 bytes_to_read);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_clear_sel (struct bmc_simulator_bmc *bmc,
+                struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs;
+  uint64_t reservation_id, c, l, r, operation;
+
+  assert (bmc);
+  assert (rq);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_clear_sel_rq, rq);
+
+  if (!_obj_get (obj_cmd_rq, "reservation_id", &reservation_id)
+      || !_obj_get (obj_cmd_rq, "C", &c)
+      || !_obj_get (obj_cmd_rq, "L", &l)
+      || !_obj_get (obj_cmd_rq, "R", &r)
+      || !_obj_get (obj_cmd_rq, "operation", &operation))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUEST_DATA_LENGTH_INVALID);
+      goto cleanup;
+    }
+
+  if (c != 'C' || l != 'L' || r != 'R'
+      || (operation != IPMI_SEL_CLEAR_OPERATION_INITIATE_ERASE
+          && operation != IPMI_SEL_CLEAR_OPERATION_GET_ERASURE_STATUS))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_INVALID_DATA_FIELD_IN_REQUEST);
+      goto cleanup;
+    }
+
+  if (reservation_id != bmc->sel_reservation_id)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_RESERVATION_CANCELLED);
+      goto cleanup;
+    }
+
+  /* erasure completes immediately */
+  if (operation == IPMI_SEL_CLEAR_OPERATION_INITIATE_ERASE)
+    {
+      struct timeval now;
+
+      gettimeofday (&now, NULL);
+      bmc->sel_count = 0;
+      bmc->sel_erase_timestamp = now.tv_sec;
+      _debug (bmc, "SEL cleared");
+    }
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_clear_sel_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "erasure_progress", IPMI_SEL_CLEAR_ERASE_COMPLETED);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_delete_sel_entry (struct bmc_simulator_bmc *bmc,
+                       struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs;
+  uint64_t reservation_id, record_id;
+  uint8_t *record;
+  struct timeval now;
+  int index;
+
+  assert (bmc);
+  assert (rq);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_delete_sel_entry_rq, rq);
+
+  if (!_obj_get (obj_cmd_rq, "reservation_id", &reservation_id)
+      || !_obj_get (obj_cmd_rq, "record_id", &record_id))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUEST_DATA_LENGTH_INVALID);
+      goto cleanup;
+    }
+
+  if (reservation_id != bmc->sel_reservation_id)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_RESERVATION_CANCELLED);
+      goto cleanup;
+    }
+
+  if ((index = _sel_find (bmc, record_id)) < 0)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUESTED_SENSOR_DATA_OR_RECORD_NOT_PRESENT);
+      goto cleanup;
+    }
+
+  record = bmc->sel + index * IPMI_SEL_RECORD_MAX_RECORD_LENGTH;
+  record_id = _get_le16 (record);
+
+  memmove (record,
+           record + IPMI_SEL_RECORD_MAX_RECORD_LENGTH,
+           (bmc->sel_count - index - 1) * IPMI_SEL_RECORD_MAX_RECORD_LENGTH);
+  bmc->sel_count--;
+
+  gettimeofday (&now, NULL);
+  bmc->sel_erase_timestamp = now.tv_sec;
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_delete_sel_entry_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "record_id", record_id);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_get_sel_time (struct bmc_simulator_bmc *bmc,
+                   struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rs;
+  struct timeval now;
+
+  assert (bmc);
+  assert (rq);
+
+  gettimeofday (&now, NULL);
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_get_sel_time_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "time", now.tv_sec);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_get_sdr_repository_info (struct bmc_simulator_bmc *bmc,
+                              struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rs;
+
+  assert (bmc);
+  assert (rq);
+
+  /* The SDR never changes, so it has never been added to or
+   * erased.  SDR caches remain valid across simulator restarts.
+   */
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_get_sdr_repository_info_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "sdr_version_major", 1);
+  _obj_set (obj_cmd_rs, "sdr_version_minor", 5);
+  _obj_set (obj_cmd_rs, "record_count", bmc_simulator_sdr_count ());
+  _obj_set (obj_cmd_rs, "most_recent_addition_timestamp", BMC_SIMULATOR_TIMESTAMP_NONE);
+  _obj_set (obj_cmd_rs, "most_recent_erase_timestamp", BMC_SIMULATOR_TIMESTAMP_NONE);
+  _obj_set (obj_cmd_rs, "reserve_sdr_repository_command_supported", 1);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_reserve_sdr_repository (struct bmc_simulator_bmc *bmc,
+                             struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rs;
+
+  assert (bmc);
+  assert (rq);
+
+  bmc->sdr_reservation_id = _reservation_next (bmc->sdr_reservation_id);
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_reserve_sdr_repository_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "reservation_id", bmc->sdr_reservation_id);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_get_sdr (struct bmc_simulator_bmc *bmc,
+              struct bmc_simulator_rq *rq)
+{
+  uint8_t record[IPMI_SDR_MAX_RECORD_LENGTH];
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs;
+  uint64_t reservation_id, record_id, offset_into_record, bytes_to_read;
+  unsigned int record_len, count;
+
+  assert (bmc);
+  assert (rq);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_get_sdr_rq, rq);
+
+  if (!_obj_get (obj_cmd_rq, "reservation_id", &reservation_id)
+      || !_obj_get (obj_cmd_rq, "record_id", &record_id)
+      || !_obj_get (obj_cmd_rq, "offset_into_record", &offset_into_record)
+      || !_obj_get (obj_cmd_rq, "bytes_to_read", &bytes_to_read))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUEST_DATA_LENGTH_INVALID);
+      goto cleanup;
+    }
+
+  if (offset_into_record
+      && reservation_id != bmc->sdr_reservation_id)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_RESERVATION_CANCELLED);
+      goto cleanup;
+    }
+
+  count = bmc_simulator_sdr_count ();
+
+  if (record_id == IPMI_SDR_RECORD_ID_FIRST)
+    record_id = 1;
+  else if (record_id == IPMI_SDR_RECORD_ID_LAST)
+    record_id = count;
+
+  if (!(record_len = bmc_simulator_sdr_record (record_id,
+                                               record,
+                                               IPMI_SDR_MAX_RECORD_LENGTH)))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUESTED_SENSOR_DATA_OR_RECORD_NOT_PRESENT);
+      goto cleanup;
+    }
+
+  if (offset_into_record >= record_len)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_PARAMETER_OUT_OF_RANGE);
+      goto cleanup;
+    }
+
+  if (bytes_to_read == IPMI_SDR_READ_ENTIRE_RECORD_BYTES_TO_READ
+      || offset_into_record + bytes_to_read > record_len)
+    bytes_to_read = record_len - offset_into_record;
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_get_sdr_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs,
+            "next_record_id",
+            record_id < count ? record_id + 1 : IPMI_SDR_RECORD_ID_LAST);
+  _obj_set_data (obj_cmd_rs,
+                 "record_data",
+                 record + offset_into_record,
+                 bytes_to_read);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_get_sensor_reading (struct bmc_simulator_bmc *bmc,
+                         struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs;
+  uint64_t sensor_number;
+  uint8_t reading, event_bitmask;
+
+  assert (bmc);
+  assert (rq);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_get_sensor_reading_rq, rq);
+
+  if (!_obj_get (obj_cmd_rq, "sensor_number", &sensor_number))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUEST_DATA_LENGTH_INVALID);
+      goto cleanup;
+    }
+
+  if (!bmc_simulator_sensor_reading (bmc, sensor_number, &reading, &event_bitmask))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUESTED_SENSOR_DATA_OR_RECORD_NOT_PRESENT);
+      goto cleanup;
+    }
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_get_sensor_reading_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "sensor_reading", reading);
+  _obj_set (obj_cmd_rs, "sensor_scanning", 1);
+  _obj_set (obj_cmd_rs, "all_event_messages", 1);
+  _obj_set (obj_cmd_rs, "sensor_event_bitmask1", event_bitmask);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_activate_payload (struct bmc_simulator_bmc *bmc,
+                       struct bmc_simulator_rq *rq,
+                       struct bmc_simulator_session *s)
+{
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs;
+  uint64_t payload_type, payload_instance;
+
+  assert (bmc);
+  assert (rq);
+  assert (s);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_activate_payload_sol_rq, rq);
+
+  if (!_obj_get (obj_cmd_rq, "payload_type", &payload_type)
+      || !_obj_get (obj_cmd_rq, "payload_instance", &payload_instance))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUEST_DATA_LENGTH_INVALID);
+      goto cleanup;
+    }
+
+  if (payload_type != IPMI_PAYLOAD_TYPE_SOL)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_ACTIVATE_PAYLOAD_PAYLOAD_TYPE_IS_DISABLED);
+      goto cleanup;
+    }
+
+  if (payload_instance != 1)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_INVALID_DATA_FIELD_IN_REQUEST);
+      goto cleanup;
+    }
+
+  if (bmc->sol_session)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_ACTIVATE_PAYLOAD_PAYLOAD_ALREADY_ACTIVE_ON_ANOTHER_SESSION);
+      goto cleanup;
+    }
+
+  bmc->sol_session = s;
+  bmc->sol_outbound_packet_sequence_number = 0;
+  s->sol_inbound_packet_sequence_number = 0;
+
+  _debug (bmc, "SOL activated");
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_activate_payload_sol_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs,
+            "inbound_payload_size",
+            BMC_SIMULATOR_SOL_HDR_LEN + BMC_SIMULATOR_SOL_CHARACTER_DATA_MAX);
+  _obj_set (obj_cmd_rs,
+            "outbound_payload_size",
+            BMC_SIMULATOR_SOL_HDR_LEN + BMC_SIMULATOR_SOL_CHARACTER_DATA_MAX);
+  _obj_set (obj_cmd_rs, "payload_udp_port_number", ntohs (bmc->addr.sin_port));
+  /* FFFFh = no VLAN */
+  _obj_set (obj_cmd_rs, "payload_vlan_number", 0xFFFF);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_deactivate_payload (struct bmc_simulator_bmc *bmc,
+                         struct bmc_simulator_rq *rq,
+                         struct bmc_simulator_session *s)
+{
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs;
+  uint64_t payload_type, payload_instance;
+
+  assert (bmc);
+  assert (rq);
+  assert (s);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_deactivate_payload_rq, rq);
+
+  if (!_obj_get (obj_cmd_rq, "payload_type", &payload_type)
+      || !_obj_get (obj_cmd_rq, "payload_instance", &payload_instance))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUEST_DATA_LENGTH_INVALID);
+      goto cleanup;
+    }
+
+  if (payload_type != IPMI_PAYLOAD_TYPE_SOL
+      || payload_instance != 1
+      || !bmc->sol_session)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_DEACTIVATE_PAYLOAD_PAYLOAD_ALREADY_DEACTIVATED);
+      goto cleanup;
+    }
+
+  /* like most BMCs, any session may deactivate SOL */
+  bmc->sol_session = NULL;
+
+  _debug (bmc, "SOL deactivated");
+
+  obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_COMMAND_SUCCESS);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_get_payload_activation_status (struct bmc_simulator_bmc *bmc,
+                                    struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs;
+  uint64_t payload_type;
+
+  assert (bmc);
+  assert (rq);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_get_payload_activation_status_rq, rq);
+
+  if (!_obj_get (obj_cmd_rq, "payload_type", &payload_type))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUEST_DATA_LENGTH_INVALID);
+      goto cleanup;
+    }
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_get_payload_activation_status_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "instance_capacity", 1);
+  if (payload_type == IPMI_PAYLOAD_TYPE_SOL && bmc->sol_session)
+    _obj_set (obj_cmd_rs, "instance_1", 1);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_get_channel_payload_support (struct bmc_simulator_bmc *bmc,
+                                  struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rs;
+
+  assert (bmc);
+  assert (rq);
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_get_channel_payload_support_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "standard_payload_type_0_supported", 1);
+  _obj_set (obj_cmd_rs, "standard_payload_type_1_supported", 1);
+  _obj_set (obj_cmd_rs, "session_setup_payload_0_supported", 1);
+  _obj_set (obj_cmd_rs, "session_setup_payload_1_supported", 1);
+  _obj_set (obj_cmd_rs, "session_setup_payload_2_supported", 1);
+  _obj_set (obj_cmd_rs, "session_setup_payload_3_supported", 1);
+  _obj_set (obj_cmd_rs, "session_setup_payload_4_supported", 1);
+  _obj_set (obj_cmd_rs, "session_setup_payload_5_supported", 1);
+  return (obj_cmd_rs);
+}
+
+static fiid_obj_t
+_cmd_get_channel_payload_version (struct bmc_simulator_bmc *bmc,
+                                  struct bmc_simulator_rq *rq)
+{
+  fiid_obj_t obj_cmd_rq;
+  fiid_obj_t obj_cmd_rs;
+  uint64_t payload_type;
+
+  assert (bmc);
+  assert (rq);
+
+  obj_cmd_rq = _obj_create_rq (tmpl_cmd_get_channel_payload_version_rq, rq);
+
+  if (!_obj_get (obj_cmd_rq, "payload_type", &payload_type))
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_REQUEST_DATA_LENGTH_INVALID);
+      goto cleanup;
+    }
+
+  if (payload_type != IPMI_PAYLOAD_TYPE_IPMI
+      && payload_type != IPMI_PAYLOAD_TYPE_SOL)
+    {
+      obj_cmd_rs = _obj_create_rs_comp_code (rq, IPMI_COMP_CODE_GET_CHANNEL_PAYLOAD_VERSION_PAYLOAD_TYPE_NOT_AVAILABLE_ON_GIVEN_CHANNEL);
+      goto cleanup;
+    }
+
+  obj_cmd_rs = _obj_create_rs (tmpl_cmd_get_channel_payload_version_rs,
+                               rq,
+                               IPMI_COMP_CODE_COMMAND_SUCCESS);
+  _obj_set (obj_cmd_rs, "major_format_version", 1);
+  _obj_set (obj_cmd_rs, "minor_format_version", 0);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  return (obj_cmd_rs);
+}
+
+/* Commands valid within an activated session, for both IPMI 1.5 and
+ * IPMI 2.0.  close_session is set if the session should be closed
+ * once the response has been assembled.
+ */
+static fiid_obj_t
+_process_session_cmd (struct bmc_simulator_bmc *bmc,
+                      struct bmc_simulator_rq *rq,
+                      struct bmc_simulator_session *s,
+                      int *close_session)
+{
+  assert (bmc);
+  assert (rq);
+  assert (s);
+  assert (close_session);
+
+  *close_session = 0;
+
+  if (rq->net_fn == IPMI_NET_FN_APP_RQ)
+    {
+      switch (rq->cmd)
+        {
+        case IPMI_CMD_SET_SESSION_PRIVILEGE_LEVEL:
+          return (_cmd_set_session_privilege_level (bmc, rq, s));
+        case IPMI_CMD_CLOSE_SESSION:
+          *close_session = 1;
+          return (_obj_create_rs_comp_code (rq, IPMI_COMP_CODE_COMMAND_SUCCESS));
+        case IPMI_CMD_GET_DEVICE_ID:
+          return (_cmd_get_device_id (bmc, rq));
+        case IPMI_CMD_GET_CHANNEL_AUTHENTICATION_CAPABILITIES:
+          return (_cmd_get_channel_authentication_capabilities (bmc, rq));
+        }
+
+      /* payloads other than IPMI require IPMI 2.0 */
+      if (s->rmcpplus)
+        {
+          switch (rq->cmd)
+            {
+            case IPMI_CMD_ACTIVATE_PAYLOAD:
+              return (_cmd_activate_payload (bmc, rq, s));
+            case IPMI_CMD_DEACTIVATE_PAYLOAD:
+              return (_cmd_deactivate_payload (bmc, rq, s));
+            case IPMI_CMD_GET_PAYLOAD_ACTIVATION_STATUS:
+              return (_cmd_get_payload_activation_status (bmc, rq));
+            case IPMI_CMD_GET_CHANNEL_PAYLOAD_SUPPORT:
+              return (_cmd_get_channel_payload_support (bmc, rq));
+            case IPMI_CMD_GET_CHANNEL_PAYLOAD_VERSION:
+              return (_cmd_get_channel_payload_version (bmc, rq));
+            }
+        }
+    }
+  else if (rq->net_fn == IPMI_NET_FN_CHASSIS_RQ)
+    {
+      switch (rq->cmd)
+        {
+        case IPMI_CMD_GET_CHASSIS_STATUS:
+          return (_cmd_get_chassis_status (bmc, rq));
+        case IPMI_CMD_CHASSIS_CONTROL:
+          return (_cmd_chassis_control (bmc, rq));
+        case IPMI_CMD_CHASSIS_IDENTIFY:
+          return (_cmd_chassis_identify (bmc, rq));
+        }
+    }
+  else if (rq->net_fn == IPMI_NET_FN_STORAGE_RQ)
+    {
+      switch (rq->cmd)
+        {
+        case IPMI_CMD_GET_SEL_INFO:
+          return (_cmd_get_sel_info (bmc, rq));
+        case IPMI_CMD_RESERVE_SEL:
+          return (_cmd_reserve_sel (bmc, rq));
+        case IPMI_CMD_GET_SEL_ENTRY:
+          return (_cmd_get_sel_entry (bmc, rq));
+        case IPMI_CMD_CLEAR_SEL:
+          return (_cmd_clear_sel (bmc, rq));
+        case IPMI_CMD_DELETE_SEL_ENTRY:
+          return (_cmd_delete_sel_entry (bmc, rq));
+        case IPMI_CMD_GET_SEL_TIME:
+          return (_cmd_get_sel_time (bmc, rq));
+        case IPMI_CMD_GET_SDR_REPOSITORY_INFO:
+          return (_cmd_get_sdr_repository_info (bmc, rq));
+        case IPMI_CMD_RESERVE_SDR_REPOSITORY:
+          return (_cmd_reserve_sdr_repository (bmc, rq));
+        case IPMI_CMD_GET_SDR:
+          return (_cmd_get_sdr (bmc, rq));
+        }
+    }
+  else if (rq->net_fn == IPMI_NET_FN_SENSOR_EVENT_RQ)
+    {
+      if (rq->cmd == IPMI_CMD_GET_SENSOR_READING)
+        return (_cmd_get_sensor_reading (bmc, rq));
+    }
+
+  return (_obj_create_rs_comp_code (rq, IPMI_COMP_CODE_INVALID_COMMAND));
+}
+
+#ifdef WITH_ENCRYPTION
+static void
+_password (const void **password, unsigned int *password_len)
+{
+  assert (password);
+  assert (password_len);
+
+  if (cmd_args.password && strlen (cmd_args.password))
+    {
+      *password = cmd_args.password;
+      *password_len = strlen (cmd_args.password);
+    }
+  else
+    {
+      *password = NULL;
+      *password_len = 0;
+    }
+}
+
+/* HMAC of the RAKP message 2 key exchange authentication code and
+ * RAKP message 4 integrity check value.  libfreeipmi only calculates
+ * these from the remote console side, so the BMC side is calculated
+ * here.  Returns length of the full digest.
+ */
+static unsigned int
+_hmac (uint8_t authentication_algorithm,
+       const void *key,
+       unsigned int key_len,
+       const void *data,
+       unsigned int data_len,
+       uint8_t *digest,
+       unsigned int digest_buflen)
+{
+  uint8_t keybuf[IPMI_2_0_MAX_PASSWORD_LENGTH];
+  gcry_md_hd_t h;
+  gcry_error_t e;
+  unsigned int digest_len;
+  int algo;
+
+  assert (data);
+  assert (digest);
+
+  if (authentication_algorithm == IPMI_AUTHENTICATION_ALGORITHM_RAKP_HMAC_SHA1)
+    algo = GCRY_MD_SHA1;
+  else if (authentication_algorithm == IPMI_AUTHENTICATION_ALGORITHM_RAKP_HMAC_MD5)
+    algo = GCRY_MD_MD5;
+  else /* IPMI_AUTHENTICATION_ALGORITHM_RAKP_HMAC_SHA256 */
+    algo = GCRY_MD_SHA256;
+
+  digest_len = gcry_md_get_algo_dlen (algo);
+  assert (digest_len <= digest_buflen);
+
+  /* HMAC keys are zero padded, so a missing key is all zeroes */
+  if (!key || !key_len)
+    {
+      memset (keybuf, '\0', IPMI_2_0_MAX_PASSWORD_LENGTH);
+      key = keybuf;
+      key_len = IPMI_2_0_MAX_PASSWORD_LENGTH;
+    }
+
+  if ((e = gcry_md_open (&h, algo, GCRY_MD_FLAG_HMAC)) != GPG_ERR_NO_ERROR)
+    err_exit ("gcry_md_open: %s", gcry_strerror (e));
+
+  if ((e = gcry_md_setkey (h, key, key_len)) != GPG_ERR_NO_ERROR)
+    err_exit ("gcry_md_setkey: %s", gcry_strerror (e));
+
+  gcry_md_write (h, data, data_len);
+  memcpy (digest, gcry_md_read (h, algo), digest_len);
+  gcry_md_close (h);
+
+  return (digest_len);
+}
+
+/* returns 0 if the session setup payload could not be found */
+static int
+_rmcpplus_setup_payload (const uint8_t *pkt,
+                         unsigned int pkt_len,
+                         fiid_template_t tmpl,
+                         fiid_obj_t *obj)
+{
+  uint16_t payload_len;
+
+  assert (pkt);
+  assert (obj);
+
+  if (pkt_len < BMC_SIMULATOR_RMCPPLUS_HDR_LEN)
+    return (0);
+
+  payload_len = _get_le16 (&pkt[BMC_SIMULATOR_RMCPPLUS_HDR_LEN - 2]);
+
+  if (pkt_len < BMC_SIMULATOR_RMCPPLUS_HDR_LEN + payload_len)
+    return (0);
+
+  if (!(*obj = fiid_obj_create (tmpl)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+
+  if (fiid_obj_set_all (*obj, &pkt[BMC_SIMULATOR_RMCPPLUS_HDR_LEN], payload_len) < 0)
+    err_exit ("fiid_obj_set_all: %s", fiid_obj_errormsg (*obj));
+
+  return (1);
+}
+
+/* Session setup payloads are sent outside of a session, with no
+ * authentication, so they are assembled by hand.  libfreeipmi can
+ * only assemble the remote console side of session setup.
+ */
+static unsigned int
+_assemble_rmcpplus_setup (uint8_t payload_type,
+                          fiid_obj_t obj_cmd,
+                          uint8_t *rs,
+                          unsigned int rs_buflen)
+{
+  fiid_obj_t obj_rmcp_hdr;
+  int len, payload_len;
+
+  assert (obj_cmd);
+  assert (rs);
+  assert (rs_buflen >= BMC_SIMULATOR_RMCPPLUS_HDR_LEN);
+
+  if (!(obj_rmcp_hdr = fiid_obj_create (tmpl_rmcp_hdr)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+
+  if (fill_rmcp_hdr_ipmi (obj_rmcp_hdr) < 0)
+    err_exit ("fill_rmcp_hdr_ipmi: %s", strerror (errno));
+
+  if ((len = fiid_obj_get_all (obj_rmcp_hdr, rs, rs_buflen)) < 0)
+    err_exit ("fiid_obj_get_all: %s", fiid_obj_errormsg (obj_rmcp_hdr));
+
+  fiid_obj_destroy (obj_rmcp_hdr);
+
+  rs[len++] = IPMI_AUTHENTICATION_TYPE_RMCPPLUS;
+  rs[len++] = payload_type;
+  _set_le32 (&rs[len], 0);
+  len += 4;
+  _set_le32 (&rs[len], 0);
+  len += 4;
+
+  if ((payload_len = fiid_obj_get_all (obj_cmd, &rs[len + 2], rs_buflen - len - 2)) < 0)
+    err_exit ("fiid_obj_get_all: %s", fiid_obj_errormsg (obj_cmd));
+
+  _set_le16 (&rs[len], payload_len);
+  len += 2;
+
+  return (len + payload_len);
+}
+
+static unsigned int
+_rmcpplus_open_session (struct bmc_simulator_bmc *bmc,
+                        const uint8_t *pkt,
+                        unsigned int pkt_len,
+                        uint8_t *rs,
+                        unsigned int rs_buflen)
+{
+  struct bmc_simulator_session *s;
+  fiid_obj_t obj_cmd_rq = NULL;
+  fiid_obj_t obj_cmd_rs = NULL;
+  uint64_t message_tag, privilege_level, remote_console_session_id;
+  uint64_t authentication_algorithm, integrity_algorithm, confidentiality_algorithm;
+  uint8_t status = RMCPPLUS_STATUS_NO_ERRORS;
+  unsigned int rv = 0;
+
+  assert (bmc);
+  assert (pkt);
+  assert (rs);
+
+  if (!_rmcpplus_setup_payload (pkt, pkt_len, tmpl_rmcpplus_open_session_request, &obj_cmd_rq))
+    goto cleanup;
+
+  if (!_obj_get (obj_cmd_rq, "message_tag", &message_tag)
+      || !_obj_get (obj_cmd_rq, "requested_maximum_privilege_level", &privilege_level)
+      || !_obj_get (obj_cmd_rq, "remote_console_session_id", &remote_console_session_id)
+      || !_obj_get (obj_cmd_rq, "authentication_payload.authentication_algorithm", &authentication_algorithm)
+      || !_obj_get (obj_cmd_rq, "integrity_payload.integrity_algorithm", &integrity_algorithm)
+      || !_obj_get (obj_cmd_rq, "confidentiality_payload.confidentiality_algorithm", &confidentiality_algorithm))
+    goto cleanup;
+
+  _debug (bmc,
+          "open session request: authentication = %u, integrity = %u, confidentiality = %u",
+          (unsigned int)authentication_algorithm,
+          (unsigned int)integrity_algorithm,
+          (unsigned int)confidentiality_algorithm);
+
+  if (!IPMI_AUTHENTICATION_ALGORITHM_SUPPORTED (authentication_algorithm))
+    status = RMCPPLUS_STATUS_INVALID_AUTHENTICATION_ALGORITHM;
+  else if (!IPMI_INTEGRITY_ALGORITHM_SUPPORTED (integrity_algorithm))
+    status = RMCPPLUS_STATUS_INVALID_INTEGRITY_ALGORITHM;
+  else if (!IPMI_CONFIDENTIALITY_ALGORITHM_SUPPORTED (confidentiality_algorithm))
+    status = RMCPPLUS_STATUS_INVALID_CONFIDENTIALITY_ALGORITHM;
+  else if (!IPMI_CIPHER_SUITE_COMBINATION_VALID (authentication_algorithm,
+                                                 integrity_algorithm,
+                                                 confidentiality_algorithm))
+    status = RMCPPLUS_STATUS_NO_CIPHER_SUITE_MATCH_WITH_PROPOSED_SECURITY_ALGORITHMS;
+
+  /* no user database, every user may log in as administrator */
+  if (privilege_level == IPMI_PRIVILEGE_LEVEL_HIGHEST_LEVEL)
+    privilege_level = IPMI_PRIVILEGE_LEVEL_ADMIN;
+
+  obj_cmd_rs = _obj_create (tmpl_rmcpplus_open_session_response);
+  _obj_set (obj_cmd_rs, "message_tag", message_tag);
+  _obj_set (obj_cmd_rs, "rmcpplus_status_code", status);
+  _obj_set (obj_cmd_rs, "remote_console_session_id", remote_console_session_id);
+
+  if (status == RMCPPLUS_STATUS_NO_ERRORS)
+    {
+      s = _session_new (bmc);
+      s->rmcpplus = 1;
+      s->session_id = s->temp_session_id;
+      s->remote_console_session_id = remote_console_session_id;
+      s->authentication_algorithm = authentication_algorithm;
+      s->integrity_algorithm = integrity_algorithm;
+      s->confidentiality_algorithm = confidentiality_algorithm;
+      s->privilege_level = privilege_level;
+
+      _obj_set (obj_cmd_rs, "maximum_privilege_level", privilege_level);
+      _obj_set (obj_cmd_rs, "managed_system_session_id", s->session_id);
+      _obj_set (obj_cmd_rs, "authentication_payload.payload_type", IPMI_AUTHENTICATION_PAYLOAD_TYPE);
+      _obj_set (obj_cmd_rs, "authentication_payload.payload_length", IPMI_AUTHENTICATION_PAYLOAD_LENGTH);
+      _obj_set (obj_cmd_rs, "authentication_payload.authentication_algorithm", authentication_algorithm);
+      _obj_set (obj_cmd_rs, "integrity_payload.payload_type", IPMI_INTEGRITY_PAYLOAD_TYPE);
+      _obj_set (obj_cmd_rs, "integrity_payload.payload_length", IPMI_INTEGRITY_PAYLOAD_LENGTH);
+      _obj_set (obj_cmd_rs, "integrity_payload.integrity_algorithm", integrity_algorithm);
+      _obj_set (obj_cmd_rs, "confidentiality_payload.payload_type", IPMI_CONFIDENTIALITY_PAYLOAD_TYPE);
+      _obj_set (obj_cmd_rs, "confidentiality_payload.payload_length", IPMI_CONFIDENTIALITY_PAYLOAD_LENGTH);
+      _obj_set (obj_cmd_rs, "confidentiality_payload.confidentiality_algorithm", confidentiality_algorithm);
+    }
+
+  rv = _assemble_rmcpplus_setup (IPMI_PAYLOAD_TYPE_RMCPPLUS_OPEN_SESSION_RESPONSE,
+                                 obj_cmd_rs,
+                                 rs,
+                                 rs_buflen);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  fiid_obj_destroy (obj_cmd_rs);
+  return (rv);
+}
+
+static unsigned int
+_rmcpplus_rakp_1 (struct bmc_simulator_bmc *bmc,
+                  const uint8_t *pkt,
+                  unsigned int pkt_len,
+                  uint8_t *rs,
+                  unsigned int rs_buflen)
+{
+  struct bmc_simulator_session *s;
+  uint8_t buf[BMC_SIMULATOR_PACKET_BUFLEN];
+  uint8_t digest[BMC_SIMULATOR_KEY_BUFLEN];
+  fiid_obj_t obj_cmd_rq = NULL;
+  fiid_obj_t obj_cmd_rs = NULL;
+  uint64_t message_tag, managed_system_session_id;
+  uint64_t privilege_level, name_only_lookup, user_name_length;
+  const void *password;
+  unsigned int password_len, index = 0, digest_len;
+  unsigned int rv = 0;
+  int len;
+
+  assert (bmc);
+  assert (pkt);
+  assert (rs);
+
+  if (!_rmcpplus_setup_payload (pkt, pkt_len, tmpl_rmcpplus_rakp_message_1, &obj_cmd_rq))
+    goto cleanup;
+
+  if (!_obj_get (obj_cmd_rq, "message_tag", &message_tag)
+      || !_obj_get (obj_cmd_rq, "managed_system_session_id", &managed_system_session_id)
+      || !_obj_get (obj_cmd_rq, "requested_maximum_privilege_level", &privilege_level)
+      || !_obj_get (obj_cmd_rq, "name_only_lookup", &name_only_lookup)
+      || !_obj_get (obj_cmd_rq, "user_name_length", &user_name_length))
+    goto cleanup;
+
+  obj_cmd_rs = _obj_create (tmpl_rmcpplus_rakp_message_2);
+  _obj_set (obj_cmd_rs, "message_tag", message_tag);
+
+  if (!(s = _session_find (bmc, managed_system_session_id, 0))
+      || !s->rmcpplus)
+    {
+      _debug (bmc, "unknown session id: 0x%X", (unsigned int)managed_system_session_id);
+      _obj_set (obj_cmd_rs, "rmcpplus_status_code", RMCPPLUS_STATUS_INVALID_SESSION_ID);
+      if (fiid_obj_clear_field (obj_cmd_rs, "key_exchange_authentication_code") < 0)
+        err_exit ("fiid_obj_clear_field: %s", fiid_obj_errormsg (obj_cmd_rs));
+      goto assemble;
+    }
+
+  _obj_set (obj_cmd_rs, "remote_console_session_id", s->remote_console_session_id);
+
+  if (user_name_length > IPMI_MAX_USER_NAME_LENGTH)
+    {
+      _obj_set (obj_cmd_rs, "rmcpplus_status_code", RMCPPLUS_STATUS_INVALID_NAME_LENGTH);
+      if (fiid_obj_clear_field (obj_cmd_rs, "key_exchange_authentication_code") < 0)
+        err_exit ("fiid_obj_clear_field: %s", fiid_obj_errormsg (obj_cmd_rs));
+      _session_close (bmc, s);
+      goto assemble;
+    }
+
+  memset (s->user_name, '\0', IPMI_MAX_USER_NAME_LENGTH + 1);
+  if (user_name_length)
+    {
+      if ((len = fiid_obj_get_data (obj_cmd_rq,
+                                    "user_name",
+                                    s->user_name,
+                                    IPMI_MAX_USER_NAME_LENGTH)) < 0)
+        goto cleanup;
+      if (len != user_name_length)
+        goto cleanup;
+    }
+  s->user_name_len = user_name_length;
+
+  if (fiid_obj_get_data (obj_cmd_rq,
+                         "remote_console_random_number",
+                         s->remote_console_random_number,
+                         IPMI_REMOTE_CONSOLE_RANDOM_NUMBER_LENGTH) != IPMI_REMOTE_CONSOLE_RANDOM_NUMBER_LENGTH)
+    goto cleanup;
+
+  if (ipmi_get_random (s->managed_system_random_number, IPMI_MANAGED_SYSTEM_RANDOM_NUMBER_LENGTH) < 0)
+    err_exit ("ipmi_get_random: %s", strerror (errno));
+
+  s->privilege_level = privilege_level;
+  s->name_only_lookup = name_only_lookup;
+  gettimeofday (&s->last_used, NULL);
+
+  _obj_set (obj_cmd_rs, "rmcpplus_status_code", RMCPPLUS_STATUS_NO_ERRORS);
+  _obj_set_data (obj_cmd_rs,
+                 "managed_system_random_number",
+                 s->managed_system_random_number,
+                 IPMI_MANAGED_SYSTEM_RANDOM_NUMBER_LENGTH);
+  _obj_set_data (obj_cmd_rs,
+                 "managed_system_guid",
+                 bmc->guid,
+                 IPMI_MANAGED_SYSTEM_GUID_LENGTH);
+
+  if (s->authentication_algorithm == IPMI_AUTHENTICATION_ALGORITHM_RAKP_NONE)
+    {
+      if (fiid_obj_clear_field (obj_cmd_rs, "key_exchange_authentication_code") < 0)
+        err_exit ("fiid_obj_clear_field: %s", fiid_obj_errormsg (obj_cmd_rs));
+      goto assemble;
+    }
+
+  /* remote console session id, managed system session id, both
+   * random numbers, GUID, requested privilege and user name
+   */
+  _set_le32 (&buf[index], s->remote_console_session_id);
+  index += 4;
+  _set_le32 (&buf[index], s->session_id);
+  index += 4;
+  memcpy (&buf[index], s->remote_console_random_number, IPMI_REMOTE_CONSOLE_RANDOM_NUMBER_LENGTH);
+  index += IPMI_REMOTE_CONSOLE_RANDOM_NUMBER_LENGTH;
+  memcpy (&buf[index], s->managed_system_random_number, IPMI_MANAGED_SYSTEM_RANDOM_NUMBER_LENGTH);
+  index += IPMI_MANAGED_SYSTEM_RANDOM_NUMBER_LENGTH;
+  memcpy (&buf[index], bmc->guid, IPMI_MANAGED_SYSTEM_GUID_LENGTH);
+  index += IPMI_MANAGED_SYSTEM_GUID_LENGTH;
+  buf[index++] = (s->name_only_lookup ? 0x10 : 0) | (s->privilege_level & 0x0F);
+  buf[index++] = s->user_name_len;
+  memcpy (&buf[index], s->user_name, s->user_name_len);
+  index += s->user_name_len;
+
+  _password (&password, &password_len);
+
+  digest_len = _hmac (s->authentication_algorithm,
+                      password,
+                      password_len,
+                      buf,
+                      index,
+                      digest,
+                      BMC_SIMULATOR_KEY_BUFLEN);
+
+  _obj_set_data (obj_cmd_rs, "key_exchange_authentication_code", digest, digest_len);
+
+ assemble:
+  rv = _assemble_rmcpplus_setup (IPMI_PAYLOAD_TYPE_RAKP_MESSAGE_2,
+                                 obj_cmd_rs,
+                                 rs,
+                                 rs_buflen);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  fiid_obj_destroy (obj_cmd_rs);
+  return (rv);
+}
+
+static unsigned int
+_rmcpplus_rakp_3 (struct bmc_simulator_bmc *bmc,
+                  const uint8_t *pkt,
+                  unsigned int pkt_len,
+                  uint8_t *rs,
+                  unsigned int rs_buflen)
+{
+  struct bmc_simulator_session *s;
+  uint8_t buf[BMC_SIMULATOR_PACKET_BUFLEN];
+  uint8_t digest[BMC_SIMULATOR_KEY_BUFLEN];
+  uint8_t key_exchange_authentication_code[BMC_SIMULATOR_KEY_BUFLEN];
+  fiid_obj_t obj_cmd_rq = NULL;
+  fiid_obj_t obj_cmd_rs = NULL;
+  uint64_t message_tag, status_code, managed_system_session_id;
+  const void *password;
+  unsigned int password_len, index = 0, integrity_check_value_len;
+  unsigned int rv = 0;
+  int expected_len, len;
+
+  assert (bmc);
+  assert (pkt);
+  assert (rs);
+
+  if (!_rmcpplus_setup_payload (pkt, pkt_len, tmpl_rmcpplus_rakp_message_3, &obj_cmd_rq))
+    goto cleanup;
+
+  if (!_obj_get (obj_cmd_rq, "message_tag", &message_tag)
+      || !_obj_get (obj_cmd_rq, "rmcpplus_status_code", &status_code)
+      || !_obj_get (obj_cmd_rq, "managed_system_session_id", &managed_system_session_id))
+    goto cleanup;
+
+  if (!(s = _session_find (bmc, managed_system_session_id, 0))
+      || !s->rmcpplus)
+    {
+      _debug (bmc, "unknown session id: 0x%X", (unsigned int)managed_system_session_id);
+      goto cleanup;
+    }
+
+  /* the remote console gave up on the session */
+  if (status_code != RMCPPLUS_STATUS_NO_ERRORS)
+    {
+      _session_close (bmc, s);
+      goto cleanup;
+    }
+
+  obj_cmd_rs = _obj_create (tmpl_rmcpplus_rakp_message_4);
+  _obj_set (obj_cmd_rs, "message_tag", message_tag);
+  _obj_set (obj_cmd_rs, "remote_console_session_id", s->remote_console_session_id);
+
+  _password (&password, &password_len);
+
+  if ((expected_len = ipmi_calculate_rakp_3_key_exchange_authentication_code (s->authentication_algorithm,
+                                                                              password,
+                                                                              password_len,
+                                                                              s->managed_system_random_number,
+                                                                              IPMI_MANAGED_SYSTEM_RANDOM_NUMBER_LENGTH,
+                                                                              s->remote_console_session_id,
+                                                                              s->name_only_lookup,
+                                                                              s->privilege_level,
+                                                                              s->user_name_len ? s->user_name : NULL,
+                                                                              s->user_name_len,
+                                                                              digest,
+                                                                              BMC_SIMULATOR_KEY_BUFLEN)) < 0)
+    err_exit ("ipmi_calculate_rakp_3_key_exchange_authentication_code: %s", strerror (errno));
+
+  if ((len = fiid_obj_get_data (obj_cmd_rq,
+                                "key_exchange_authentication_code",
+                                key_exchange_authentication_code,
+                                BMC_SIMULATOR_KEY_BUFLEN)) < 0)
+    len = 0;
+
+  if (len != expected_len
+      || memcmp (digest, key_exchange_authentication_code, len))
+    {
+      _debug (bmc, "invalid password");
+      _obj_set (obj_cmd_rs, "rmcpplus_status_code", RMCPPLUS_STATUS_INVALID_INTEGRITY_CHECK_VALUE);
+      if (fiid_obj_clear_field (obj_cmd_rs, "integrity_check_value") < 0)
+        err_exit ("fiid_obj_clear_field: %s", fiid_obj_errormsg (obj_cmd_rs));
+      _session_close (bmc, s);
+      goto assemble;
+    }
+
+  s->sik_key_ptr = s->sik_key;
+  s->sik_key_len = BMC_SIMULATOR_KEY_BUFLEN;
+  s->integrity_key_ptr = s->integrity_key;
+  s->integrity_key_len = BMC_SIMULATOR_KEY_BUFLEN;
+  s->confidentiality_key_ptr = s->confidentiality_key;
+  s->confidentiality_key_len = BMC_SIMULATOR_KEY_BUFLEN;
+
+  if (ipmi_calculate_rmcpplus_session_keys (s->authentication_algorithm,
+                                            s->integrity_algorithm,
+                                            s->confidentiality_algorithm,
+                                            password,
+                                            password_len,
+                                            NULL,
+                                            0,
+                                            s->remote_console_random_number,
+                                            IPMI_REMOTE_CONSOLE_RANDOM_NUMBER_LENGTH,
+                                            s->managed_system_random_number,
+                                            IPMI_MANAGED_SYSTEM_RANDOM_NUMBER_LENGTH,
+                                            s->name_only_lookup,
+                                            s->privilege_level,
+                                            s->user_name_len ? s->user_name : NULL,
+                                            s->user_name_len,
+                                            &s->sik_key_ptr,
+                                            &s->sik_key_len,
+                                            &s->integrity_key_ptr,
+                                            &s->integrity_key_len,
+                                            &s->confidentiality_key_ptr,
+                                            &s->confidentiality_key_len) < 0)
+    err_exit ("ipmi_calculate_rmcpplus_session_keys: %s", strerror (errno));
+
+  s->activated = 1;
+  s->outbound_sequence_number = 0;
+  gettimeofday (&s->last_used, NULL);
+
+  _debug (bmc, "session 0x%X activated", s->session_id);
+
+  _obj_set (obj_cmd_rs, "rmcpplus_status_code", RMCPPLUS_STATUS_NO_ERRORS);
+
+  if (s->authentication_algorithm == IPMI_AUTHENTICATION_ALGORITHM_RAKP_NONE)
+    {
+      if (fiid_obj_clear_field (obj_cmd_rs, "integrity_check_value") < 0)
+        err_exit ("fiid_obj_clear_field: %s", fiid_obj_errormsg (obj_cmd_rs));
+      goto assemble;
+    }
+
+  /* remote console random number, managed system session id, GUID */
+  memcpy (&buf[index], s->remote_console_random_number, IPMI_REMOTE_CONSOLE_RANDOM_NUMBER_LENGTH);
+  index += IPMI_REMOTE_CONSOLE_RANDOM_NUMBER_LENGTH;
+  _set_le32 (&buf[index], s->session_id);
+  index += 4;
+  memcpy (&buf[index], bmc->guid, IPMI_MANAGED_SYSTEM_GUID_LENGTH);
+  index += IPMI_MANAGED_SYSTEM_GUID_LENGTH;
+
+  _hmac (s->authentication_algorithm,
+         s->sik_key_ptr,
+         s->sik_key_len,
+         buf,
+         index,
+         digest,
+         BMC_SIMULATOR_KEY_BUFLEN);
+
+  if (s->authentication_algorithm == IPMI_AUTHENTICATION_ALGORITHM_RAKP_HMAC_SHA1)
+    integrity_check_value_len = IPMI_HMAC_SHA1_96_AUTHENTICATION_CODE_LENGTH;
+  else if (s->authentication_algorithm == IPMI_AUTHENTICATION_ALGORITHM_RAKP_HMAC_MD5)
+    integrity_check_value_len = IPMI_HMAC_MD5_DIGEST_LENGTH;
+  else /* IPMI_AUTHENTICATION_ALGORITHM_RAKP_HMAC_SHA256 */
+    integrity_check_value_len = IPMI_HMAC_SHA256_128_AUTHENTICATION_CODE_LENGTH;
+
+  _obj_set_data (obj_cmd_rs, "integrity_check_value", digest, integrity_check_value_len);
+
+ assemble:
+  rv = _assemble_rmcpplus_setup (IPMI_PAYLOAD_TYPE_RAKP_MESSAGE_4,
+                                 obj_cmd_rs,
+                                 rs,
+                                 rs_buflen);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rq);
+  fiid_obj_destroy (obj_cmd_rs);
+  return (rv);
+}
+
+/* Echo SOL character data back to the remote console, as if the
+ * serial port were in loopback.  Returns NULL if no response
+ * should be sent.
+ */
+static fiid_obj_t
+_rmcpplus_sol (struct bmc_simulator_bmc *bmc,
+               struct bmc_simulator_session *s,
+               const uint8_t *payload,
+               unsigned int payload_len)
+{
+  fiid_obj_t obj_sol_payload;
+  uint8_t packet_sequence_number;
+  unsigned int character_data_len;
+
+  assert (bmc);
+  assert (s);
+  assert (payload);
+
+  if (bmc->sol_session != s
+      || payload_len < BMC_SIMULATOR_SOL_HDR_LEN)
+    return (NULL);
+
+  packet_sequence_number = payload[0] & 0x0F;
+
+  /* ACK only packets are not acknowledged */
+  if (!packet_sequence_number)
+    return (NULL);
+
+  character_data_len = payload_len - BMC_SIMULATOR_SOL_HDR_LEN;
+  if (character_data_len > BMC_SIMULATOR_SOL_CHARACTER_DATA_MAX)
+    character_data_len = BMC_SIMULATOR_SOL_CHARACTER_DATA_MAX;
+
+  /* a retransmit is answered with the same echo as before */
+  if (packet_sequence_number != s->sol_inbound_packet_sequence_number)
+    {
+      s->sol_inbound_packet_sequence_number = packet_sequence_number;
+      if (character_data_len)
+        {
+          if (++bmc->sol_outbound_packet_sequence_number > IPMI_SOL_PACKET_SEQUENCE_NUMBER_MAX)
+            bmc->sol_outbound_packet_sequence_number = 1;
+        }
+    }
+
+  if (!(obj_sol_payload = fiid_obj_create (tmpl_sol_payload_data)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+
+  if (fill_sol_payload_data (character_data_len ? bmc->sol_outbound_packet_sequence_number : 0,
+                             packet_sequence_number,
+                             character_data_len,
+                             0,
+                             character_data_len ? &payload[BMC_SIMULATOR_SOL_HDR_LEN] : NULL,
+                             character_data_len,
+                             obj_sol_payload) < 0)
+    err_exit ("fill_sol_payload_data: %s", strerror (errno));
+
+  return (obj_sol_payload);
+}
+
+static unsigned int
+_rmcpplus_session (struct bmc_simulator_bmc *bmc,
+                   const uint8_t *pkt,
+                   unsigned int pkt_len,
+                   uint8_t *rs,
+                   unsigned int rs_buflen)
+{
+  struct bmc_simulator_session *s;
+  struct bmc_simulator_rq rq;
+  uint8_t payload[BMC_SIMULATOR_PACKET_BUFLEN];
+  uint8_t msg_hdr[BMC_SIMULATOR_MSG_HDR_LEN];
+  fiid_obj_t obj_rmcp_hdr = NULL;
+  fiid_obj_t obj_session_hdr = NULL;
+  fiid_obj_t obj_payload = NULL;
+  fiid_obj_t obj_lan_msg_hdr = NULL;
+  fiid_obj_t obj_cmd = NULL;
+  fiid_obj_t obj_lan_msg_trlr = NULL;
+  fiid_obj_t obj_session_trlr = NULL;
+  fiid_obj_t obj_cmd_rs = NULL;
+  fiid_obj_t obj_lan_msg_hdr_rs = NULL;
+  uint8_t payload_type, payload_authenticated, payload_encrypted;
+  uint32_t session_id;
+  const void *password;
+  unsigned int password_len;
+  int close_session = 0;
+  unsigned int rv = 0;
+  int payload_len, len;
+
+  assert (bmc);
+  assert (pkt);
+  assert (rs);
+
+  if (pkt_len < BMC_SIMULATOR_RMCPPLUS_HDR_LEN)
+    return (0);
+
+  payload_type = pkt[5] & BMC_SIMULATOR_RMCPPLUS_PAYLOAD_TYPE_MASK;
+  payload_authenticated = (pkt[5] & BMC_SIMULATOR_RMCPPLUS_PAYLOAD_AUTHENTICATED) ? 1 : 0;
+  payload_encrypted = (pkt[5] & BMC_SIMULATOR_RMCPPLUS_PAYLOAD_ENCRYPTED) ? 1 : 0;
+  session_id = _get_le32 (&pkt[6]);
+
+  if (!(s = _session_find (bmc, session_id, 1))
+      || !s->rmcpplus)
+    {
+      _debug (bmc, "unknown session id: 0x%X", session_id);
+      return (0);
+    }
+
+  if ((s->integrity_algorithm != IPMI_INTEGRITY_ALGORITHM_NONE
+       && !payload_authenticated)
+      || (s->confidentiality_algorithm == IPMI_CONFIDENTIALITY_ALGORITHM_NONE
+          && payload_encrypted))
+    {
+      _debug (bmc, "invalid payload flags");
+      return (0);
+    }
+
+  if (!(obj_rmcp_hdr = fiid_obj_create (tmpl_rmcp_hdr)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+  if (!(obj_session_hdr = fiid_obj_create (tmpl_rmcpplus_session_hdr)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+  if (!(obj_payload = fiid_obj_create (tmpl_rmcpplus_payload)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+  if (!(obj_lan_msg_hdr = fiid_obj_create (tmpl_lan_msg_hdr_rs)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+  if (!(obj_cmd = fiid_obj_create (payload_type == IPMI_PAYLOAD_TYPE_SOL
+                                   ? tmpl_sol_payload_data
+                                   : tmpl_unexpected_data)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+  if (!(obj_lan_msg_trlr = fiid_obj_create (tmpl_lan_msg_trlr)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+  if (!(obj_session_trlr = fiid_obj_create (tmpl_rmcpplus_session_trlr)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+
+  if (payload_type != IPMI_PAYLOAD_TYPE_IPMI
+      && payload_type != IPMI_PAYLOAD_TYPE_SOL)
+    goto cleanup;
+
+  if (unassemble_ipmi_rmcpplus_pkt (s->authentication_algorithm,
+                                    s->integrity_algorithm,
+                                    s->confidentiality_algorithm,
+                                    s->integrity_key_ptr,
+                                    s->integrity_key_len,
+                                    s->confidentiality_key_ptr,
+                                    s->confidentiality_key_len,
+                                    pkt,
+                                    pkt_len,
+                                    obj_rmcp_hdr,
+                                    obj_session_hdr,
+                                    obj_payload,
+                                    obj_lan_msg_hdr,
+                                    obj_cmd,
+                                    obj_lan_msg_trlr,
+                                    obj_session_trlr,
+                                    IPMI_INTERFACE_FLAGS_DEFAULT) <= 0)
+    {
+      _debug (bmc, "malformed IPMI 2.0 packet");
+      goto cleanup;
+    }
+
+  _password (&password, &password_len);
+
+  /* Like most BMCs, silently drop packets failing authentication */
+  if (payload_authenticated
+      && ipmi_rmcpplus_check_packet_session_authentication_code (s->integrity_algorithm,
+                                                                 pkt,
+                                                                 pkt_len,
+                                                                 s->integrity_key_ptr,
+                                                                 s->integrity_key_len,
+                                                                 password,
+                                                                 password_len,
+                                                                 obj_session_trlr) != 1)
+    {
+      _debug (bmc, "invalid authentication code");
+      goto cleanup;
+    }
+
+  /* payload data is the decrypted payload */
+  if ((payload_len = fiid_obj_get_data (obj_payload,
+                                        "payload_data",
+                                        payload,
+                                        BMC_SIMULATOR_PACKET_BUFLEN)) < 0)
+    goto cleanup;
+
+  gettimeofday (&s->last_used, NULL);
+
+  if (payload_type == IPMI_PAYLOAD_TYPE_SOL)
+    {
+      if (!(obj_cmd_rs = _rmcpplus_sol (bmc, s, payload, payload_len)))
+        goto cleanup;
+    }
+  else
+    {
+      memset (&rq, '\0', sizeof (struct bmc_simulator_rq));
+      if (!_parse_msg (bmc, payload, payload_len, &rq))
+        goto cleanup;
+
+      _debug (bmc,
+              "request: net_fn = 0x%X, cmd = 0x%X, session id = 0x%X",
+              rq.net_fn,
+              rq.cmd,
+              session_id);
+
+      obj_cmd_rs = _process_session_cmd (bmc, &rq, s, &close_session);
+
+      /* assemble_ipmi_rmcpplus_pkt only knows the request header
+       * template, the layout of the response header is identical
+       */
+      _msg_hdr_rs (&rq, msg_hdr);
+      if (!(obj_lan_msg_hdr_rs = fiid_obj_create (tmpl_lan_msg_hdr_rq)))
+        err_exit ("fiid_obj_create: %s", strerror (errno));
+      if (fiid_obj_set_all (obj_lan_msg_hdr_rs, msg_hdr, BMC_SIMULATOR_MSG_HDR_LEN) < 0)
+        err_exit ("fiid_obj_set_all: %s", fiid_obj_errormsg (obj_lan_msg_hdr_rs));
+    }
+
+  if (fiid_obj_clear (obj_rmcp_hdr) < 0)
+    err_exit ("fiid_obj_clear: %s", fiid_obj_errormsg (obj_rmcp_hdr));
+
+  if (fill_rmcp_hdr_ipmi (obj_rmcp_hdr) < 0)
+    err_exit ("fill_rmcp_hdr_ipmi: %s", strerror (errno));
+
+  if (fill_rmcpplus_session_hdr (payload_type,
+                                 payload_authenticated,
+                                 payload_encrypted,
+                                 0,
+                                 0,
+                                 s->remote_console_session_id,
+                                 ++s->outbound_sequence_number,
+                                 obj_session_hdr) < 0)
+    err_exit ("fill_rmcpplus_session_hdr: %s", strerror (errno));
+
+  if (fill_rmcpplus_session_trlr (obj_session_trlr) < 0)
+    err_exit ("fill_rmcpplus_session_trlr: %s", strerror (errno));
+
+  if ((len = assemble_ipmi_rmcpplus_pkt (s->authentication_algorithm,
+                                         s->integrity_algorithm,
+                                         s->confidentiality_algorithm,
+                                         s->integrity_key_ptr,
+                                         s->integrity_key_len,
+                                         s->confidentiality_key_ptr,
+                                         s->confidentiality_key_len,
+                                         password,
+                                         password_len,
+                                         obj_rmcp_hdr,
+                                         obj_session_hdr,
+                                         obj_lan_msg_hdr_rs,
+                                         obj_cmd_rs,
+                                         obj_session_trlr,
+                                         rs,
+                                         rs_buflen,
+                                         IPMI_INTERFACE_FLAGS_DEFAULT)) < 0)
+    err_exit ("assemble_ipmi_rmcpplus_pkt: %s", strerror (errno));
+
+  rv = len;
+
+  if (close_session)
+    _session_close (bmc, s);
+
+ cleanup:
+  fiid_obj_destroy (obj_rmcp_hdr);
+  fiid_obj_destroy (obj_session_hdr);
+  fiid_obj_destroy (obj_payload);
+  fiid_obj_destroy (obj_lan_msg_hdr);
+  fiid_obj_destroy (obj_cmd);
+  fiid_obj_destroy (obj_lan_msg_trlr);
+  fiid_obj_destroy (obj_session_trlr);
+  fiid_obj_destroy (obj_cmd_rs);
+  fiid_obj_destroy (obj_lan_msg_hdr_rs);
+  return (rv);
+}
+#endif /* WITH_ENCRYPTION */
+
+static unsigned int
+_process_rmcpplus (struct bmc_simulator_bmc *bmc,
+                   const uint8_t *pkt,
+                   unsigned int pkt_len,
+                   uint8_t *rs,
+                   unsigned int rs_buflen)
+{
+  assert (bmc);
+  assert (pkt);
+  assert (rs);
+
+#ifdef WITH_ENCRYPTION
+  if (pkt_len < BMC_SIMULATOR_RMCPPLUS_HDR_LEN)
+    return (0);
+
+  switch (pkt[5] & BMC_SIMULATOR_RMCPPLUS_PAYLOAD_TYPE_MASK)
+    {
+    case IPMI_PAYLOAD_TYPE_RMCPPLUS_OPEN_SESSION_REQUEST:
+      return (_rmcpplus_open_session (bmc, pkt, pkt_len, rs, rs_buflen));
+    case IPMI_PAYLOAD_TYPE_RAKP_MESSAGE_1:
+      return (_rmcpplus_rakp_1 (bmc, pkt, pkt_len, rs, rs_buflen));
+    case IPMI_PAYLOAD_TYPE_RAKP_MESSAGE_3:
+      return (_rmcpplus_rakp_3 (bmc, pkt, pkt_len, rs, rs_buflen));
+    default:
+      return (_rmcpplus_session (bmc, pkt, pkt_len, rs, rs_buflen));
+    }
+#else /* !WITH_ENCRYPTION */
+  _debug (bmc, "IPMI 2.0 packet not supported");
+  return (0);
+#endif /* !WITH_ENCRYPTION */
+}
+
+static unsigned int
+_process_ipmi (struct bmc_simulator_bmc *bmc,
+               const uint8_t *pkt,
+               unsigned int pkt_len,
+               uint8_t *rs,
+               unsigned int rs_buflen)
+{
+  struct bmc_simulator_rq rq;
+  struct bmc_simulator_session *s = NULL;
+  fiid_obj_t obj_cmd_rs = NULL;
+  uint32_t session_sequence_number = 0;
+  uint32_t session_id = 0;
+  int close_session = 0;
+  unsigned int rv = 0;
+
+  assert (bmc);
+  assert (pkt);
+  assert (rs);
+
+  if (pkt_len > 4 && pkt[4] == IPMI_AUTHENTICATION_TYPE_RMCPPLUS)
+    return (_process_rmcpplus (bmc, pkt, pkt_len, rs, rs_buflen));
+
+  if (!_parse_rq (bmc, pkt, pkt_len, &rq))
+    return (0);
+
+  _debug (bmc,
+          "request: net_fn = 0x%X, cmd = 0x%X, session id = 0x%X, sequence number = %u",
+          rq.net_fn,
+          rq.cmd,
+          rq.session_id,
+          rq.session_sequence_number);
+
+  if (rq.net_fn == IPMI_NET_FN_APP_RQ
+      && rq.cmd == IPMI_CMD_GET_CHANNEL_AUTHENTICATION_CAPABILITIES)
+    obj_cmd_rs = _cmd_get_channel_authentication_capabilities (bmc, &rq);
+  else if (rq.net_fn == IPMI_NET_FN_APP_RQ
+           && rq.cmd == IPMI_CMD_GET_SESSION_CHALLENGE)
+    obj_cmd_rs = _cmd_get_session_challenge (bmc, &rq);
+  else if (rq.net_fn == IPMI_NET_FN_APP_RQ
+           && rq.cmd == IPMI_CMD_ACTIVATE_SESSION)
+    {
+      if (!(s = _session_find (bmc, rq.session_id, 0))
+          || s->rmcpplus)
+        obj_cmd_rs = _obj_create_rs_comp_code (&rq, IPMI_COMP_CODE_ACTIVATE_SESSION_INVALID_SESSION_ID);
+      else if (!(obj_cmd_rs = _cmd_activate_session (bmc, &rq, s)))
+        goto cleanup;
+      else
+        session_sequence_number = s->outbound_sequence_number;
+      session_id = rq.session_id;
+    }
+  else
+    {
+      /* everything else requires an activated session, requests
+       * outside of a session are dropped
+       */
+      if (!(s = _session_find (bmc, rq.session_id, 1))
+          || s->rmcpplus)
+        {
+          _debug (bmc, "unknown session id: 0x%X", rq.session_id);
+          goto cleanup;
+        }
+
+      gettimeofday (&s->last_used, NULL);
+      session_sequence_number = ++s->outbound_sequence_number;
+      session_id = s->session_id;
+
+      obj_cmd_rs = _process_session_cmd (bmc, &rq, s, &close_session);
+    }
+
+  /* The response authentication type mirrors the request, so that
+   * per-message authentication settings on the client are honored.
+   */
+  rv = _assemble_rs (bmc,
+                     &rq,
+                     rq.authentication_type,
+                     session_sequence_number,
+                     session_id,
+                     obj_cmd_rs,
+                     rs,
+                     rs_buflen);
+
+  if (close_session)
+    _session_close (bmc, s);
+
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rs);
+  return (rv);
+}
+
+unsigned int
+bmc_simulator_ipmi_process (struct bmc_simulator_bmc *bmc,
+                            const uint8_t *rq,
+                            unsigned int rq_len,
+                            uint8_t *rs,
+                            unsigned int rs_buflen)
+{
+  assert (bmc);
+  assert (rq);
+  assert (rs);
+
+  /* RMCP header: version, reserved, sequence number, message class */
+  if (rq_len < 4 || rq[0] != RMCP_VERSION_1_0)
+    return (0);
+
+  if (rq[3] == RMCP_HDR_MESSAGE_CLASS_ASF)
+    return (_process_asf (bmc, rq, rq_len, rs, rs_buflen));
+  else if (rq[3] == RMCP_HDR_MESSAGE_CLASS_IPMI)
+    return (_process_ipmi (bmc, rq, rq_len, rs, rs_buflen));
+
+  return (0);
+}
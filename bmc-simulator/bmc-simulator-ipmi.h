@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2003-2015 FreeIPMI Core Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BMC_SIMULATOR_IPMI_H
+#define BMC_SIMULATOR_IPMI_H
+
+#include "bmc-simulator.h"
+
+/* bmc_simulator_ipmi_process
+ * - Process a request received by a virtual BMC
+ * - Returns length of response written to rs, 0 if the request
+ *   should not be responded to.
+ */
+unsigned int bmc_simulator_ipmi_process (struct bmc_simulator_bmc *bmc,
+                                         const uint8_t *rq,
+                                         unsigned int rq_len,
+                                         uint8_t *rs,
+                                         unsigned int rs_buflen);
+
+#endif /* BMC_SIMULATOR_IPMI_H */
@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2003-2015 FreeIPMI Core Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#if STDC_HEADERS
+#include <string.h>
+#endif /* STDC_HEADERS */
+#include <stdint.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <freeipmi/freeipmi.h>
+
+#include "bmc-simulator.h"
+#include "bmc-simulator-repository.h"
+
+#include "freeipmi-portability.h"
+#include "error.h"
+
+extern struct bmc_simulator_arguments cmd_args;
+
+/* seconds between the events logged in the initial SEL */
+#define BMC_SIMULATOR_SEL_EVENT_INTERVAL 60
+
+/* SDR version 1.5 (51h) */
+#define BMC_SIMULATOR_SDR_VERSION_MAJOR 1
+#define BMC_SIMULATOR_SDR_VERSION_MINOR 5
+
+#define BMC_SIMULATOR_THRESHOLD_UPPER_NON_CRITICAL 0x08
+#define BMC_SIMULATOR_THRESHOLD_UPPER_CRITICAL     0x10
+#define BMC_SIMULATOR_THRESHOLD_UPPER_NON_RECOVERABLE 0x20
+
+/* Sensors are kept simple, linear with no offset (B = 0).  Readings
+ * of threshold sensors vary randomly between the nominal reading and
+ * nominal reading + jitter.  The discrete chassis intrusion sensor
+ * always reads with no intrusion.
+ */
+struct bmc_simulator_sensor
+{
+  uint8_t sensor_number;
+  uint8_t entity_id;
+  uint8_t sensor_type;
+  uint8_t event_reading_type_code;
+  uint8_t base_unit;
+  uint8_t m;
+  int8_t r_exponent;
+  uint8_t nominal_reading;
+  uint8_t jitter;
+  uint8_t upper_non_critical_threshold;
+  uint8_t upper_critical_threshold;
+  uint8_t upper_non_recoverable_threshold;
+  const char *id_string;
+};
+
+static struct bmc_simulator_sensor sensors[] =
+  {
+    { 0x30, IPMI_ENTITY_ID_PROCESSOR, IPMI_SENSOR_TYPE_TEMPERATURE,
+      IPMI_EVENT_READING_TYPE_CODE_THRESHOLD, IPMI_SENSOR_UNIT_DEGREES_C,
+      1, 0, 40, 4, 75, 85, 95, "CPU Temp"},
+    { 0x40, IPMI_ENTITY_ID_FAN_COOLING_DEVICE, IPMI_SENSOR_TYPE_FAN,
+      IPMI_EVENT_READING_TYPE_CODE_THRESHOLD, IPMI_SENSOR_UNIT_RPM,
+      50, 0, 60, 6, 200, 220, 240, "System Fan"},
+    { 0x50, IPMI_ENTITY_ID_SYSTEM_BOARD, IPMI_SENSOR_TYPE_VOLTAGE,
+      IPMI_EVENT_READING_TYPE_CODE_THRESHOLD, IPMI_SENSOR_UNIT_VOLTS,
+      10, -2, 119, 2, 130, 135, 140, "12V"},
+    { 0x60, IPMI_ENTITY_ID_SYSTEM_CHASSIS, IPMI_SENSOR_TYPE_PHYSICAL_SECURITY,
+      IPMI_EVENT_READING_TYPE_CODE_SENSOR_SPECIFIC, IPMI_SENSOR_UNIT_UNSPECIFIED,
+      0, 0, 0, 0, 0, 0, 0, "Chassis Intrusion"},
+  };
+
+#define BMC_SIMULATOR_SENSORS_COUNT (sizeof (sensors) / sizeof (sensors[0]))
+
+#define BMC_SIMULATOR_SENSOR_TEMPERATURE 0
+#define BMC_SIMULATOR_SENSOR_INTRUSION   3
+
+static fiid_obj_t
+_obj_create (fiid_template_t tmpl)
+{
+  uint8_t buf[IPMI_SDR_MAX_RECORD_LENGTH];
+  fiid_obj_t obj;
+  int len;
+
+  if (!(obj = fiid_obj_create (tmpl)))
+    err_exit ("fiid_obj_create: %s", strerror (errno));
+
+  if ((len = fiid_template_len_bytes (tmpl)) < 0)
+    err_exit ("fiid_template_len_bytes: %s", strerror (errno));
+
+  assert (len <= sizeof (buf));
+
+  memset (buf, '\0', len);
+  if (fiid_obj_set_all (obj, buf, len) < 0)
+    err_exit ("fiid_obj_set_all: %s", fiid_obj_errormsg (obj));
+
+  return (obj);
+}
+
+static void
+_obj_set (fiid_obj_t obj, const char *field, uint64_t val)
+{
+  assert (obj);
+  assert (field);
+
+  if (fiid_obj_set (obj, field, val) < 0)
+    err_exit ("fiid_obj_set: '%s': %s", field, fiid_obj_errormsg (obj));
+}
+
+static void
+_sel_event (uint8_t *record,
+            uint16_t record_id,
+            uint32_t timestamp,
+            const struct bmc_simulator_sensor *sensor)
+{
+  fiid_obj_t obj;
+
+  assert (record);
+  assert (sensor);
+
+  obj = _obj_create (tmpl_sel_system_event_record);
+  _obj_set (obj, "record_id", record_id);
+  _obj_set (obj, "record_type", IPMI_SEL_RECORD_TYPE_SYSTEM_EVENT_RECORD);
+  _obj_set (obj, "timestamp", timestamp);
+  _obj_set (obj, "generator_id.id_type", IPMI_SDR_SENSOR_OWNER_ID_TYPE_IPMB_SLAVE_ADDRESS);
+  _obj_set (obj, "generator_id.id", IPMI_SLAVE_ADDRESS_BMC >> 1);
+  _obj_set (obj, "event_message_format_version", IPMI_V1_5_EVENT_MESSAGE_FORMAT);
+  _obj_set (obj, "sensor_type", sensor->sensor_type);
+  _obj_set (obj, "sensor_number", sensor->sensor_number);
+  _obj_set (obj, "event_type_code", sensor->event_reading_type_code);
+  _obj_set (obj, "event_dir", IPMI_SEL_RECORD_ASSERTION_EVENT);
+
+  if (sensor->event_reading_type_code == IPMI_EVENT_READING_TYPE_CODE_THRESHOLD)
+    {
+      /* trigger reading in event data 2, trigger threshold in event data 3 */
+      _obj_set (obj,
+                "event_data1",
+                (IPMI_SEL_EVENT_DATA_TRIGGER_READING << 6)
+                | (IPMI_SEL_EVENT_DATA_TRIGGER_THRESHOLD_VALUE << 4)
+                | IPMI_GENERIC_EVENT_READING_TYPE_CODE_THRESHOLD_UPPER_NON_CRITICAL_GOING_HIGH);
+      _obj_set (obj, "event_data2", sensor->upper_non_critical_threshold + 1);
+      _obj_set (obj, "event_data3", sensor->upper_non_critical_threshold);
+    }
+  else
+    {
+      _obj_set (obj,
+                "event_data1",
+                IPMI_SENSOR_TYPE_PHYSICAL_SECURITY_GENERAL_CHASSIS_INTRUSION);
+      _obj_set (obj, "event_data2", 0xFF);
+      _obj_set (obj, "event_data3", 0xFF);
+    }
+
+  if (fiid_obj_get_all (obj, record, IPMI_SEL_RECORD_MAX_RECORD_LENGTH) < 0)
+    err_exit ("fiid_obj_get_all: %s", fiid_obj_errormsg (obj));
+
+  fiid_obj_destroy (obj);
+}
+
+void
+bmc_simulator_sel_setup (struct bmc_simulator_bmc *bmc, uint32_t now)
+{
+  unsigned int i;
+
+  assert (bmc);
+
+  bmc->sel = NULL;
+  bmc->sel_count = 0;
+  bmc->sel_addition_timestamp = BMC_SIMULATOR_TIMESTAMP_NONE;
+  bmc->sel_erase_timestamp = BMC_SIMULATOR_TIMESTAMP_NONE;
+
+  if (!cmd_args.sel_entries)
+    return;
+
+  if (!(bmc->sel = (uint8_t *)malloc (cmd_args.sel_entries * IPMI_SEL_RECORD_MAX_RECORD_LENGTH)))
+    err_exit ("malloc: %s", strerror (errno));
+
+  /* alternate temperature warnings and chassis intrusions */
+  for (i = 0; i < cmd_args.sel_entries; i++)
+    _sel_event (bmc->sel + i * IPMI_SEL_RECORD_MAX_RECORD_LENGTH,
+                i + 1,
+                now - (cmd_args.sel_entries - 1 - i) * BMC_SIMULATOR_SEL_EVENT_INTERVAL,
+                &sensors[(i % 2) ? BMC_SIMULATOR_SENSOR_INTRUSION : BMC_SIMULATOR_SENSOR_TEMPERATURE]);
+
+  bmc->sel_count = cmd_args.sel_entries;
+  bmc->sel_addition_timestamp = now;
+}
+
+unsigned int
+bmc_simulator_sdr_count (void)
+{
+  return (BMC_SIMULATOR_SENSORS_COUNT);
+}
+
+unsigned int
+bmc_simulator_sdr_record (uint16_t record_id,
+                          uint8_t *buf,
+                          unsigned int buflen)
+{
+  const struct bmc_simulator_sensor *sensor;
+  int record_header_length;
+  fiid_obj_t obj;
+  int len;
+
+  assert (buf);
+
+  if (!record_id || record_id > BMC_SIMULATOR_SENSORS_COUNT)
+    return (0);
+
+  sensor = &sensors[record_id - 1];
+
+  obj = _obj_create (tmpl_sdr_full_sensor_record);
+  _obj_set (obj, "record_id", record_id);
+  _obj_set (obj, "sdr_version_major", BMC_SIMULATOR_SDR_VERSION_MAJOR);
+  _obj_set (obj, "sdr_version_minor", BMC_SIMULATOR_SDR_VERSION_MINOR);
+  _obj_set (obj, "record_type", IPMI_SDR_FORMAT_FULL_SENSOR_RECORD);
+  _obj_set (obj, "sensor_owner_id.type", IPMI_SDR_SENSOR_OWNER_ID_TYPE_IPMB_SLAVE_ADDRESS);
+  _obj_set (obj, "sensor_owner_id", IPMI_SLAVE_ADDRESS_BMC >> 1);
+  _obj_set (obj, "sensor_number", sensor->sensor_number);
+  _obj_set (obj, "entity_id", sensor->entity_id);
+  _obj_set (obj, "entity_instance", 1);
+  _obj_set (obj, "entity_instance.type", IPMI_SDR_PHYSICAL_ENTITY);
+  _obj_set (obj, "sensor_initialization.sensor_scanning", 1);
+  _obj_set (obj, "sensor_initialization.event_generation", 1);
+  _obj_set (obj, "sensor_capabilities.auto_re_arm_support", 1);
+  _obj_set (obj, "sensor_type", sensor->sensor_type);
+  _obj_set (obj, "event_reading_type_code", sensor->event_reading_type_code);
+
+  if (sensor->event_reading_type_code == IPMI_EVENT_READING_TYPE_CODE_THRESHOLD)
+    {
+      _obj_set (obj, "sensor_unit1.analog_data_format", IPMI_SDR_ANALOG_DATA_FORMAT_UNSIGNED);
+      _obj_set (obj, "sensor_unit2.base_unit", sensor->base_unit);
+      _obj_set (obj, "linearization", IPMI_SDR_LINEARIZATION_LINEAR);
+      _obj_set (obj, "m_ls", sensor->m);
+      /* 4 bit two's complement */
+      _obj_set (obj, "r_exponent", (uint8_t)sensor->r_exponent & 0x0F);
+      _obj_set (obj, "analog_characteristics_flag.nominal_reading", 1);
+      _obj_set (obj, "nominal_reading", sensor->nominal_reading);
+      _obj_set (obj, "sensor_maximum_reading", 0xFF);
+      _obj_set (obj, "upper_non_recoverable_threshold", sensor->upper_non_recoverable_threshold);
+      _obj_set (obj, "upper_critical_threshold", sensor->upper_critical_threshold);
+      _obj_set (obj, "upper_non_critical_threshold", sensor->upper_non_critical_threshold);
+    }
+  else
+    {
+      _obj_set (obj, "sensor_unit1.analog_data_format", IPMI_SDR_ANALOG_DATA_FORMAT_NOT_ANALOG);
+      /* general chassis intrusion is the only state */
+      _obj_set (obj, "discrete_reading_settable_threshold_readable_threshold_mask", 0x0001);
+    }
+
+  /* 8-bit ASCII + Latin 1 */
+  _obj_set (obj, "id_string_type_length_code", 0xC0 | strlen (sensor->id_string));
+  if (fiid_obj_set_data (obj,
+                         "id_string",
+                         sensor->id_string,
+                         strlen (sensor->id_string)) < 0)
+    err_exit ("fiid_obj_set_data: 'id_string': %s", fiid_obj_errormsg (obj));
+
+  if ((len = fiid_obj_len_bytes (obj)) < 0)
+    err_exit ("fiid_obj_len_bytes: %s", fiid_obj_errormsg (obj));
+
+  if ((record_header_length = fiid_template_len_bytes (tmpl_sdr_record_header)) < 0)
+    err_exit ("fiid_template_len_bytes: %s", strerror (errno));
+
+  _obj_set (obj, "record_length", len - record_header_length);
+
+  if ((len = fiid_obj_get_all (obj, buf, buflen)) < 0)
+    err_exit ("fiid_obj_get_all: %s", fiid_obj_errormsg (obj));
+
+  fiid_obj_destroy (obj);
+  return (len);
+}
+
+int
+bmc_simulator_sensor_reading (struct bmc_simulator_bmc *bmc,
+                              uint8_t sensor_number,
+                              uint8_t *reading,
+                              uint8_t *event_bitmask)
+{
+  const struct bmc_simulator_sensor *sensor = NULL;
+  unsigned int i;
+
+  assert (bmc);
+  assert (reading);
+  assert (event_bitmask);
+
+  for (i = 0; i < BMC_SIMULATOR_SENSORS_COUNT; i++)
+    {
+      if (sensors[i].sensor_number == sensor_number)
+        {
+          sensor = &sensors[i];
+          break;
+        }
+    }
+
+  if (!sensor)
+    return (0);
+
+  *reading = 0;
+  *event_bitmask = 0;
+
+  if (sensor->event_reading_type_code == IPMI_EVENT_READING_TYPE_CODE_THRESHOLD)
+    {
+      *reading = sensor->nominal_reading;
+      if (sensor->jitter)
+        *reading += rand () % (sensor->jitter + 1);
+
+      if (*reading >= sensor->upper_non_critical_threshold)
+        *event_bitmask |= BMC_SIMULATOR_THRESHOLD_UPPER_NON_CRITICAL;
+      if (*reading >= sensor->upper_critical_threshold)
+        *event_bitmask |= BMC_SIMULATOR_THRESHOLD_UPPER_CRITICAL;
+      if (*reading >= sensor->upper_non_recoverable_threshold)
+        *event_bitmask |= BMC_SIMULATOR_THRESHOLD_UPPER_NON_RECOVERABLE;
+    }
+
+  return (1);
+}
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2003-2015 FreeIPMI Core Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BMC_SIMULATOR_REPOSITORY_H
+#define BMC_SIMULATOR_REPOSITORY_H
+
+#include "bmc-simulator.h"
+
+/* SEL and SDR timestamp for "never" */
+#define BMC_SIMULATOR_TIMESTAMP_NONE 0xFFFFFFFF
+
+/* bmc_simulator_sel_setup
+ * - Fill the SEL of a virtual BMC with cmd_args.sel_entries events
+ *   on the simulated sensors, the last one logged at 'now'.
+ */
+void bmc_simulator_sel_setup (struct bmc_simulator_bmc *bmc, uint32_t now);
+
+/* bmc_simulator_sdr_count
+ * - Returns number of SDR records, record ids are 1 through count
+ */
+unsigned int bmc_simulator_sdr_count (void);
+
+/* bmc_simulator_sdr_record
+ * - Copy SDR record with record_id into buf
+ * - Returns length of record, 0 if there is no such record
+ */
+unsigned int bmc_simulator_sdr_record (uint16_t record_id,
+                                       uint8_t *buf,
+                                       unsigned int buflen);
+
+/* bmc_simulator_sensor_reading
+ * - Read a simulated sensor.  The event bitmask holds the threshold
+ *   comparison status or discrete state of the sensor.
+ * - Returns 1 if the sensor exists, 0 if not
+ */
+int bmc_simulator_sensor_reading (struct bmc_simulator_bmc *bmc,
+                                  uint8_t sensor_number,
+                                  uint8_t *reading,
+                                  uint8_t *event_bitmask);
+
+#endif /* BMC_SIMULATOR_REPOSITORY_H */
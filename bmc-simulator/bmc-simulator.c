@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2003-2015 FreeIPMI Core Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#if STDC_HEADERS
+#include <string.h>
+#endif /* STDC_HEADERS */
+#if TIME_WITH_SYS_TIME
+#include <sys/time.h>
+#include <time.h>
+#else  /* !TIME_WITH_SYS_TIME */
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#else /* !HAVE_SYS_TIME_H */
+#include <time.h>
+#endif  /* !HAVE_SYS_TIME_H */
+#endif /* !TIME_WITH_SYS_TIME */
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/poll.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif /* HAVE_FCNTL_H */
+#include <limits.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "bmc-simulator.h"
+#include "bmc-simulator-argp.h"
+#include "bmc-simulator-ipmi.h"
+#include "bmc-simulator-repository.h"
+
+#include "freeipmi-portability.h"
+#include "error.h"
+#include "heap.h"
+#include "timeval.h"
+
+struct bmc_simulator_arguments cmd_args;
+
+static struct bmc_simulator_bmc *bmcs = NULL;
+
+static struct pollfd *pfds = NULL;
+
+/* Responses delayed by --latency/--latency-jitter, ordered by send time */
+static Heap responses = NULL;
+
+struct bmc_simulator_response
+{
+  struct timeval send_time;
+  struct bmc_simulator_bmc *bmc;
+  struct sockaddr_in to;
+  unsigned int len;
+  uint8_t buf[BMC_SIMULATOR_PACKET_BUFLEN];
+};
+
+static int
+_response_timecmp (void *x, void *y)
+{
+  struct bmc_simulator_response *r1, *r2;
+
+  assert (x);
+  assert (y);
+
+  r1 = (struct bmc_simulator_response *)x;
+  r2 = (struct bmc_simulator_response *)y;
+
+  /* min heap, earliest send time on top */
+  if (timeval_lt (&r1->send_time, &r2->send_time))
+    return (1);
+  else if (timeval_gt (&r1->send_time, &r2->send_time))
+    return (-1);
+  return (0);
+}
+
+static void
+_bmcs_setup (void)
+{
+  struct in_addr base;
+  struct timeval now;
+  unsigned int i;
+
+  if (!(bmcs = (struct bmc_simulator_bmc *)calloc (cmd_args.count, sizeof (struct bmc_simulator_bmc))))
+    err_exit ("calloc: %s", strerror (errno));
+
+  if (!(pfds = (struct pollfd *)calloc (cmd_args.count, sizeof (struct pollfd))))
+    err_exit ("calloc: %s", strerror (errno));
+
+  if (inet_pton (AF_INET,
+                 cmd_args.address ? cmd_args.address : "127.0.0.1",
+                 &base) <= 0)
+    err_exit ("invalid address: %s", cmd_args.address);
+
+  gettimeofday (&now, NULL);
+
+  for (i = 0; i < cmd_args.count; i++)
+    {
+      struct bmc_simulator_bmc *bmc = &bmcs[i];
+      int flags;
+
+      bmc->addr.sin_family = AF_INET;
+      if (cmd_args.consecutive_addresses)
+        {
+          bmc->addr.sin_addr.s_addr = htonl (ntohl (base.s_addr) + i);
+          bmc->addr.sin_port = htons (cmd_args.port);
+        }
+      else
+        {
+          bmc->addr.sin_addr = base;
+          bmc->addr.sin_port = htons (cmd_args.port + i);
+        }
+
+      if ((bmc->fd = socket (AF_INET, SOCK_DGRAM, 0)) < 0)
+        err_exit ("socket: %s", strerror (errno));
+
+      if ((flags = fcntl (bmc->fd, F_GETFL, 0)) < 0)
+        err_exit ("fcntl: %s", strerror (errno));
+
+      if (fcntl (bmc->fd, F_SETFL, flags | O_NONBLOCK) < 0)
+        err_exit ("fcntl: %s", strerror (errno));
+
+      if (bind (bmc->fd,
+                (struct sockaddr *)&bmc->addr,
+                sizeof (struct sockaddr_in)) < 0)
+        {
+          char addrbuf[INET_ADDRSTRLEN];
+
+          if (!inet_ntop (AF_INET, &bmc->addr.sin_addr, addrbuf, INET_ADDRSTRLEN))
+            snprintf (addrbuf, INET_ADDRSTRLEN, "unknown");
+
+          err_exit ("bind: %s:%u: %s",
+                    addrbuf,
+                    ntohs (bmc->addr.sin_port),
+                    strerror (errno));
+        }
+
+      /* machines start powered on */
+      bmc->power_on = 1;
+      bmc->chassis_identify_state = IPMI_CHASSIS_IDENTIFY_STATE_OFF;
+
+      if (ipmi_get_random (bmc->guid, IPMI_MANAGED_SYSTEM_GUID_LENGTH) < 0)
+        err_exit ("ipmi_get_random: %s", strerror (errno));
+
+      bmc_simulator_sel_setup (bmc, now.tv_sec);
+
+      pfds[i].fd = bmc->fd;
+      pfds[i].events = POLLIN;
+    }
+
+  if (!(responses = heap_create (cmd_args.count * BMC_SIMULATOR_PENDING_RESPONSES_PER_BMC,
+                                 (HeapCmpF)_response_timecmp,
+                                 (HeapDelF)free)))
+    err_exit ("heap_create: %s", strerror (errno));
+}
+
+static void
+_send_response (struct bmc_simulator_response *r)
+{
+  assert (r);
+
+  if (sendto (r->bmc->fd,
+              r->buf,
+              r->len,
+              0,
+              (struct sockaddr *)&r->to,
+              sizeof (struct sockaddr_in)) < 0)
+    {
+      if (cmd_args.debug)
+        err_output ("sendto: %s", strerror (errno));
+    }
+}
+
+static void
+_receive (struct bmc_simulator_bmc *bmc)
+{
+  uint8_t buf[BMC_SIMULATOR_PACKET_BUFLEN];
+  struct bmc_simulator_response *r;
+  struct sockaddr_in from;
+  socklen_t fromlen;
+  unsigned int delay;
+  ssize_t len;
+
+  assert (bmc);
+
+  while (1)
+    {
+      fromlen = sizeof (struct sockaddr_in);
+      if ((len = recvfrom (bmc->fd,
+                           buf,
+                           BMC_SIMULATOR_PACKET_BUFLEN,
+                           0,
+                           (struct sockaddr *)&from,
+                           &fromlen)) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          if (errno != EAGAIN && errno != EWOULDBLOCK)
+            err_output ("recvfrom: %s", strerror (errno));
+          return;
+        }
+
+      if (cmd_args.loss
+          && (rand () % BMC_SIMULATOR_PERCENT_MAX) < cmd_args.loss)
+        continue;
+
+      if (!(r = (struct bmc_simulator_response *)malloc (sizeof (struct bmc_simulator_response))))
+        err_exit ("malloc: %s", strerror (errno));
+
+      r->bmc = bmc;
+      memcpy (&r->to, &from, sizeof (struct sockaddr_in));
+
+      if (!(r->len = bmc_simulator_ipmi_process (bmc,
+                                                 buf,
+                                                 len,
+                                                 r->buf,
+                                                 BMC_SIMULATOR_PACKET_BUFLEN)))
+        {
+          free (r);
+          continue;
+        }
+
+      delay = cmd_args.latency;
+      if (cmd_args.latency_jitter)
+        delay += rand () % (cmd_args.latency_jitter + 1);
+
+      if (!delay)
+        {
+          _send_response (r);
+          free (r);
+          continue;
+        }
+
+      gettimeofday (&r->send_time, NULL);
+      timeval_add_ms (&r->send_time, delay, &r->send_time);
+
+      /* a BMC that is overwhelmed drops packets too */
+      if (!heap_insert (responses, r))
+        {
+          if (cmd_args.debug)
+            err_output ("heap_insert: %s", strerror (errno));
+          free (r);
+        }
+    }
+}
+
+/* send due responses, returns the poll timeout until the next one */
+static int
+_send_responses (void)
+{
+  struct bmc_simulator_response *r;
+  struct timeval now;
+
+  gettimeofday (&now, NULL);
+
+  while ((r = heap_peek (responses)))
+    {
+      if (timeval_gt (&r->send_time, &now))
+        {
+          struct timeval delta;
+          unsigned int ms;
+
+          timeval_sub (&r->send_time, &now, &delta);
+          timeval_millisecond_calc (&delta, &ms);
+          /* round up, so the response is not polled for too early */
+          return (ms + 1);
+        }
+
+      r = heap_pop (responses);
+      _send_response (r);
+      free (r);
+    }
+
+  return (-1);
+}
+
+static void
+_bmc_simulator_loop (void)
+{
+  unsigned int i;
+  int timeout;
+
+  while (1)
+    {
+      timeout = _send_responses ();
+
+      if (poll (pfds, cmd_args.count, timeout) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          err_exit ("poll: %s", strerror (errno));
+        }
+
+      for (i = 0; i < cmd_args.count; i++)
+        {
+          if (pfds[i].revents & POLLIN)
+            _receive (&bmcs[i]);
+        }
+    }
+}
+
+int
+main (int argc, char **argv)
+{
+  struct timeval now;
+
+  err_init (argv[0]);
+  err_set_flags (ERROR_STDERR);
+
+  bmc_simulator_argp_parse (argc, argv, &cmd_args);
+
+  gettimeofday (&now, NULL);
+  srand (now.tv_sec ^ now.tv_usec);
+
+  if (ipmi_rmcpplus_init () < 0)
+    err_exit ("ipmi_rmcpplus_init: %s", strerror (errno));
+
+  _bmcs_setup ();
+
+  _bmc_simulator_loop ();
+
+  return (0);
+}
@@ -0,0 +1,180 @@
+/*
+ * Copyright (C) 2003-2015 FreeIPMI Core Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef BMC_SIMULATOR_H
+#define BMC_SIMULATOR_H
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdint.h>
+#if TIME_WITH_SYS_TIME
+#include <sys/time.h>
+#include <time.h>
+#else  /* !TIME_WITH_SYS_TIME */
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#else /* !HAVE_SYS_TIME_H */
+#include <time.h>
+#endif  /* !HAVE_SYS_TIME_H */
+#endif /* !TIME_WITH_SYS_TIME */
+#include <netinet/in.h>
+
+#include <freeipmi/freeipmi.h>
+
+#define BMC_SIMULATOR_COUNT_DEFAULT        1
+#define BMC_SIMULATOR_COUNT_MAX            65535
+
+#define BMC_SIMULATOR_PERCENT_MAX          100
+
+/* sessions per virtual BMC, the least recently used session is
+ * replaced when a new one is requested
+ */
+#define BMC_SIMULATOR_SESSIONS_MAX         4
+
+#define BMC_SIMULATOR_PACKET_BUFLEN        1024
+
+/* SEL entries each virtual BMC starts with */
+#define BMC_SIMULATOR_SEL_ENTRIES_DEFAULT  16
+#define BMC_SIMULATOR_SEL_ENTRIES_MAX      4096
+
+/* large enough for the SIK, K1 and K2 of all supported algorithms */
+#define BMC_SIMULATOR_KEY_BUFLEN           64
+
+/* responses delayed by simulated latency, per virtual BMC */
+#define BMC_SIMULATOR_PENDING_RESPONSES_PER_BMC 16
+
+#define BMC_SIMULATOR_QUIRK_SESSION_ID_ZERO             0x00000001
+#define BMC_SIMULATOR_QUIRK_BIG_ENDIAN_SEQUENCE_NUMBER  0x00000002
+#define BMC_SIMULATOR_QUIRK_NO_AUTH_CODE                0x00000004
+#define BMC_SIMULATOR_QUIRK_BUSY                        0x00000008
+
+#define BMC_SIMULATOR_QUIRK_SESSION_ID_ZERO_STR            "sessionidzero"
+#define BMC_SIMULATOR_QUIRK_BIG_ENDIAN_SEQUENCE_NUMBER_STR "bigendiansequencenumber"
+#define BMC_SIMULATOR_QUIRK_NO_AUTH_CODE_STR               "noauthcode"
+#define BMC_SIMULATOR_QUIRK_BUSY_STR                       "busy"
+
+enum bmc_simulator_argp_option_keys
+  {
+    BMC_SIMULATOR_ADDRESS_KEY = 'a',
+    BMC_SIMULATOR_PORT_KEY = 'p',
+    BMC_SIMULATOR_COUNT_KEY = 'n',
+    BMC_SIMULATOR_CONSECUTIVE_ADDRESSES_KEY = 160,
+    BMC_SIMULATOR_PASSWORD_KEY = 'P',
+    BMC_SIMULATOR_LATENCY_KEY = 161,
+    BMC_SIMULATOR_LATENCY_JITTER_KEY = 162,
+    BMC_SIMULATOR_LOSS_KEY = 163,
+    BMC_SIMULATOR_POWER_ON_DELAY_KEY = 164,
+    BMC_SIMULATOR_POWER_OFF_DELAY_KEY = 165,
+    BMC_SIMULATOR_QUIRKS_KEY = 166,
+    BMC_SIMULATOR_SEL_ENTRIES_KEY = 167,
+    BMC_SIMULATOR_DEBUG_KEY = 'D',
+  };
+
+struct bmc_simulator_arguments
+{
+  char *address;
+  unsigned int port;
+  unsigned int count;
+  int consecutive_addresses;
+  char *password;
+  unsigned int latency;
+  unsigned int latency_jitter;
+  unsigned int loss;
+  unsigned int power_on_delay;
+  unsigned int power_off_delay;
+  unsigned int quirks;
+  unsigned int sel_entries;
+  int debug;
+};
+
+/* bmc_simulator_session
+ * - IPMI 1.5 sessions use the authentication type, IPMI 2.0
+ *   sessions (rmcpplus set) the negotiated algorithms and keys.  For
+ *   IPMI 2.0 the temporary session id and session id are both the
+ *   managed system session id.
+ */
+struct bmc_simulator_session
+{
+  int in_use;
+  int activated;
+  uint32_t temp_session_id;
+  uint32_t session_id;
+  uint8_t authentication_type;
+  uint8_t privilege_level;
+  uint32_t outbound_sequence_number;
+  struct timeval last_used;
+
+  int rmcpplus;
+  uint32_t remote_console_session_id;
+  uint8_t authentication_algorithm;
+  uint8_t integrity_algorithm;
+  uint8_t confidentiality_algorithm;
+  uint8_t name_only_lookup;
+  uint8_t remote_console_random_number[IPMI_REMOTE_CONSOLE_RANDOM_NUMBER_LENGTH];
+  uint8_t managed_system_random_number[IPMI_MANAGED_SYSTEM_RANDOM_NUMBER_LENGTH];
+  char user_name[IPMI_MAX_USER_NAME_LENGTH + 1];
+  unsigned int user_name_len;
+  uint8_t sik_key[BMC_SIMULATOR_KEY_BUFLEN];
+  void *sik_key_ptr;
+  unsigned int sik_key_len;
+  uint8_t integrity_key[BMC_SIMULATOR_KEY_BUFLEN];
+  void *integrity_key_ptr;
+  unsigned int integrity_key_len;
+  uint8_t confidentiality_key[BMC_SIMULATOR_KEY_BUFLEN];
+  void *confidentiality_key_ptr;
+  unsigned int confidentiality_key_len;
+
+  /* last SOL packet sequence number received, to detect retransmits */
+  uint8_t sol_inbound_packet_sequence_number;
+};
+
+/* bmc_simulator_bmc
+ * - State of a single virtual BMC
+ */
+struct bmc_simulator_bmc
+{
+  int fd;
+  struct sockaddr_in addr;
+
+  int power_on;
+  int power_change_pending;
+  int power_change_on;
+  struct timeval power_change_time;
+  uint8_t chassis_identify_state;
+
+  uint8_t guid[IPMI_MANAGED_SYSTEM_GUID_LENGTH];
+
+  struct bmc_simulator_session sessions[BMC_SIMULATOR_SESSIONS_MAX];
+
+  /* session the SOL payload is activated on, NULL if not active */
+  struct bmc_simulator_session *sol_session;
+  uint8_t sol_outbound_packet_sequence_number;
+
+  /* SEL records, IPMI_SEL_RECORD_MAX_RECORD_LENGTH bytes each */
+  uint8_t *sel;
+  unsigned int sel_count;
+  uint16_t sel_reservation_id;
+  uint32_t sel_addition_timestamp;
+  uint32_t sel_erase_timestamp;
+
+  uint16_t sdr_reservation_id;
+};
+
+#endif /* BMC_SIMULATOR_H */
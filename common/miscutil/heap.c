@@ -279,6 +279,19 @@ heap_is_empty (Heap h)
   return (n == 0);
 }
 
+int
+heap_count (Heap h)
+{
+  unsigned int n;
+
+  assert (h != NULL);
+  heap_mutex_lock (&h->mutex);
+  assert (h->magic == HEAP_MAGIC);
+  n = h->count;
+  heap_mutex_unlock (&h->mutex);
+  return (n);
+}
+
 int
 heap_is_full (Heap h)
 {
@@ -130,6 +130,11 @@ int heap_is_empty (Heap h);
  *  Returns non-zero if heap [h] is empty; o/w returns zero.
  */
 
+int heap_count (Heap h);
+/*
+ *  Returns the number of items in heap [h].
+ */
+
 int heap_is_full (Heap h);
 /*
  *  Returns non-zero if heap [h] is full; o/w returns zero.
@@ -1208,6 +1208,34 @@ _config_file_ipmiconsole_sol_payload_instance (conffile_t cf,
   return (0);
 }
 
+static int
+_config_file_ipmipower_power_on_group_delimiter (conffile_t cf,
+                                                 struct conffile_data *data,
+                                                 char *optionname,
+                                                 int option_type,
+                                                 void *option_ptr,
+                                                 int option_data,
+                                                 void *app_ptr,
+                                                 int app_data)
+{
+  char *chr;
+
+  assert (data);
+  assert (optionname);
+  assert (option_ptr);
+
+  chr = (char *)option_ptr;
+
+  if (strlen (data->string) != 1)
+    {
+      fprintf (stderr, "Config File Error: invalid value for %s\n", optionname);
+      exit (EXIT_FAILURE);
+    }
+
+  *chr = data->string[0];
+  return (0);
+}
+
 static int
 _config_file_ipmiseld_sensor_types (conffile_t cf,
                                     struct conffile_data *data,
@@ -3458,6 +3486,28 @@ config_file_parse (const char *filename,
         &(ipmi_sel_data.non_abbreviated_units),
         0,
       },
+      {
+        "ipmi-sel-speculative-read",
+        CONFFILE_OPTION_BOOL,
+        -1,
+        _config_file_bool,
+        1,
+        0,
+        &(ipmi_sel_data.speculative_read_count),
+        &(ipmi_sel_data.speculative_read),
+        0,
+      },
+      {
+        "ipmi-sel-mirror",
+        CONFFILE_OPTION_BOOL,
+        -1,
+        _config_file_bool,
+        1,
+        0,
+        &(ipmi_sel_data.mirror_count),
+        &(ipmi_sel_data.mirror),
+        0,
+      },
     };
 
   /*
@@ -3930,6 +3980,39 @@ config_file_parse (const char *filename,
         &(ipmiconsole_data.lock_memory),
         0,
       },
+      {
+        "ipmiconsole-adaptive-retransmission",
+        CONFFILE_OPTION_BOOL,
+        -1,
+        _config_file_bool,
+        1,
+        0,
+        &(ipmiconsole_data.adaptive_retransmission_count),
+        &(ipmiconsole_data.adaptive_retransmission),
+        0,
+      },
+      {
+        "ipmiconsole-coalesce-input",
+        CONFFILE_OPTION_BOOL,
+        -1,
+        _config_file_bool,
+        1,
+        0,
+        &(ipmiconsole_data.coalesce_input_count),
+        &(ipmiconsole_data.coalesce_input),
+        0,
+      },
+      {
+        "ipmiconsole-throughput",
+        CONFFILE_OPTION_BOOL,
+        -1,
+        _config_file_bool,
+        1,
+        0,
+        &(ipmiconsole_data.throughput_count),
+        &(ipmiconsole_data.throughput),
+        0,
+      },
     };
 
   /*
@@ -4048,6 +4131,28 @@ config_file_parse (const char *filename,
         &(ipmipower_data.wait_until_off),
         0
       },
+      {
+        "ipmipower-wait-until",
+        CONFFILE_OPTION_STRING,
+        -1,
+        _config_file_string,
+        1,
+        0,
+        &(ipmipower_data.wait_until_str_count),
+        &(ipmipower_data.wait_until_str),
+        0,
+      },
+      {
+        "ipmipower-wait-until-timeout",
+        CONFFILE_OPTION_INT,
+        -1,
+        _config_file_unsigned_int,
+        1,
+        0,
+        &(ipmipower_data.wait_until_timeout_count),
+        &(ipmipower_data.wait_until_timeout),
+        0
+      },
       {
         "ipmipower-oem-power-type",
         CONFFILE_OPTION_STRING,
@@ -4059,6 +4164,17 @@ config_file_parse (const char *filename,
         &(ipmipower_data.oem_power_type_str),
         0,
       },
+      {
+        "ipmipower-json-output",
+        CONFFILE_OPTION_BOOL,
+        -1,
+        _config_file_bool,
+        1,
+        0,
+        &(ipmipower_data.json_output_count),
+        &(ipmipower_data.json_output),
+        0
+      },
       {
         "ipmipower-retransmission-wait-timeout",
         CONFFILE_OPTION_INT,
@@ -4081,6 +4197,50 @@ config_file_parse (const char *filename,
         &(ipmipower_data.retransmission_backoff_count),
         0
       },
+      {
+        "ipmipower-adaptive-retransmission",
+        CONFFILE_OPTION_BOOL,
+        -1,
+        _config_file_bool,
+        1,
+        0,
+        &(ipmipower_data.adaptive_retransmission_count),
+        &(ipmipower_data.adaptive_retransmission),
+        0
+      },
+      {
+        "ipmipower-session-rate",
+        CONFFILE_OPTION_INT,
+        -1,
+        _config_file_unsigned_int,
+        1,
+        0,
+        &(ipmipower_data.session_rate_count),
+        &(ipmipower_data.session_rate),
+        0
+      },
+      {
+        "ipmipower-power-on-rate",
+        CONFFILE_OPTION_INT,
+        -1,
+        _config_file_unsigned_int,
+        1,
+        0,
+        &(ipmipower_data.power_on_rate_count),
+        &(ipmipower_data.power_on_rate),
+        0
+      },
+      {
+        "ipmipower-power-on-group-delimiter",
+        CONFFILE_OPTION_STRING,
+        -1,
+        _config_file_ipmipower_power_on_group_delimiter,
+        1,
+        0,
+        &(ipmipower_data.power_on_group_delimiter_count),
+        &(ipmipower_data.power_on_group_delimiter),
+        0
+      },
       {
         "ipmipower-ping-interval",
         CONFFILE_OPTION_INT,
@@ -4340,6 +4500,39 @@ config_file_parse (const char *filename,
         &(ipmiseld_data.poll_interval),
         0
       },
+      {
+        "adaptive-poll-interval",
+        CONFFILE_OPTION_BOOL,
+        -1,
+        _config_file_bool,
+        1,
+        0,
+        &(ipmiseld_data.adaptive_poll_interval_count),
+        &(ipmiseld_data.adaptive_poll_interval),
+        0,
+      },
+      {
+        "min-poll-interval",
+        CONFFILE_OPTION_INT,
+        -1,
+        _config_file_positive_unsigned_int,
+        1,
+        0,
+        &(ipmiseld_data.min_poll_interval_count),
+        &(ipmiseld_data.min_poll_interval),
+        0,
+      },
+      {
+        "max-poll-interval",
+        CONFFILE_OPTION_INT,
+        -1,
+        _config_file_positive_unsigned_int,
+        1,
+        0,
+        &(ipmiseld_data.max_poll_interval_count),
+        &(ipmiseld_data.max_poll_interval),
+        0,
+      },
       {
         "log-facility",
         CONFFILE_OPTION_STRING,
@@ -4362,6 +4555,50 @@ config_file_parse (const char *filename,
         &(ipmiseld_data.log_priority_str),
         0,
       },
+      {
+        "log-file",
+        CONFFILE_OPTION_STRING,
+        -1,
+        _config_file_string,
+        1,
+        0,
+        &(ipmiseld_data.log_file_count),
+        &(ipmiseld_data.log_file),
+        0,
+      },
+      {
+        "log-socket",
+        CONFFILE_OPTION_STRING,
+        -1,
+        _config_file_string,
+        1,
+        0,
+        &(ipmiseld_data.log_socket_count),
+        &(ipmiseld_data.log_socket),
+        0,
+      },
+      {
+        "log-queue-length",
+        CONFFILE_OPTION_INT,
+        -1,
+        _config_file_positive_unsigned_int,
+        1,
+        0,
+        &(ipmiseld_data.log_queue_length_count),
+        &(ipmiseld_data.log_queue_length),
+        0,
+      },
+      {
+        "log-queue-overflow",
+        CONFFILE_OPTION_STRING,
+        -1,
+        _config_file_string,
+        1,
+        0,
+        &(ipmiseld_data.log_queue_overflow_str_count),
+        &(ipmiseld_data.log_queue_overflow_str),
+        0,
+      },
       {
         "cache-directory",
         CONFFILE_OPTION_STRING,
@@ -4373,6 +4610,17 @@ config_file_parse (const char *filename,
         &(ipmiseld_data.cache_directory),
         0,
       },
+      {
+        "consolidated-state",
+        CONFFILE_OPTION_BOOL,
+        -1,
+        _config_file_bool,
+        1,
+        0,
+        &(ipmiseld_data.consolidated_state_count),
+        &(ipmiseld_data.consolidated_state),
+        0,
+      },
       {
         "ignore-sdr",
         CONFFILE_OPTION_BOOL,
@@ -4417,6 +4665,50 @@ config_file_parse (const char *filename,
         &(ipmiseld_data.threadpool_count),
         0
       },
+      {
+        "persistent-sessions",
+        CONFFILE_OPTION_BOOL,
+        -1,
+        _config_file_bool,
+        1,
+        0,
+        &(ipmiseld_data.persistent_sessions_count),
+        &(ipmiseld_data.persistent_sessions),
+        0,
+      },
+      {
+        "async-threads",
+        CONFFILE_OPTION_INT,
+        -1,
+        _config_file_unsigned_int,
+        1,
+        0,
+        &(ipmiseld_data.async_threads_count),
+        &(ipmiseld_data.async_threads),
+        0,
+      },
+      {
+        "speculative-read",
+        CONFFILE_OPTION_BOOL,
+        -1,
+        _config_file_bool,
+        1,
+        0,
+        &(ipmiseld_data.speculative_read_count),
+        &(ipmiseld_data.speculative_read),
+        0,
+      },
+      {
+        "stats-interval",
+        CONFFILE_OPTION_INT,
+        -1,
+        _config_file_unsigned_int,
+        1,
+        0,
+        &(ipmiseld_data.stats_interval_count),
+        &(ipmiseld_data.stats_interval),
+        0,
+      },
     };
 
   conffile_t cf = NULL;
@@ -175,6 +175,10 @@ struct config_file_data_ipmi_sel
   int no_header_output_count;
   int non_abbreviated_units;
   int non_abbreviated_units_count;
+  int speculative_read;
+  int speculative_read_count;
+  int mirror;
+  int mirror_count;
 };
 
 struct config_file_data_ipmi_sensors
@@ -241,6 +245,12 @@ struct config_file_data_ipmiconsole
   int deactivate_all_instances_count;
   int lock_memory;
   int lock_memory_count;
+  int adaptive_retransmission;
+  int adaptive_retransmission_count;
+  int coalesce_input;
+  int coalesce_input_count;
+  int throughput;
+  int throughput_count;
 };
 
 struct config_file_data_ipmipower
@@ -252,13 +262,28 @@ struct config_file_data_ipmipower
   int wait_until_off;
   int wait_until_off_count;
   /* Parse string and let ipmipower determine if it is valid */
+  char *wait_until_str;
+  int wait_until_str_count;
+  unsigned int wait_until_timeout;
+  int wait_until_timeout_count;
+  /* Parse string and let ipmipower determine if it is valid */
   char *oem_power_type_str;
   int oem_power_type_str_count;
+  int json_output;
+  int json_output_count;
 
   unsigned int retransmission_wait_timeout;
   int retransmission_wait_timeout_count;
   unsigned int retransmission_backoff_count;
   int retransmission_backoff_count_count;
+  int adaptive_retransmission;
+  int adaptive_retransmission_count;
+  unsigned int session_rate;
+  int session_rate_count;
+  unsigned int power_on_rate;
+  int power_on_rate_count;
+  char power_on_group_delimiter;
+  int power_on_group_delimiter_count;
   unsigned int ping_interval;
   int ping_interval_count;
   unsigned int ping_timeout;
@@ -311,12 +336,28 @@ struct config_file_data_ipmiseld
   int oem_non_timestamped_event_format_str_count;
   unsigned int poll_interval;
   int poll_interval_count;
+  int adaptive_poll_interval;
+  int adaptive_poll_interval_count;
+  unsigned int min_poll_interval;
+  int min_poll_interval_count;
+  unsigned int max_poll_interval;
+  int max_poll_interval_count;
   char *log_facility_str;
   int log_facility_str_count;
   char *log_priority_str;
   int log_priority_str_count;
+  char *log_file;
+  int log_file_count;
+  char *log_socket;
+  int log_socket_count;
+  unsigned int log_queue_length;
+  int log_queue_length_count;
+  char *log_queue_overflow_str;
+  int log_queue_overflow_str_count;
   char *cache_directory;
   int cache_directory_count;
+  int consolidated_state;
+  int consolidated_state_count;
   int ignore_sdr;
   int ignore_sdr_count;
   int re_download_sdr;
@@ -325,6 +366,14 @@ struct config_file_data_ipmiseld
   int clear_sel_count;
   unsigned int threadpool_count;
   int threadpool_count_count;
+  int persistent_sessions;
+  int persistent_sessions_count;
+  unsigned int async_threads;
+  int async_threads_count;
+  int speculative_read;
+  int speculative_read_count;
+  unsigned int stats_interval;
+  int stats_interval_count;
 };
 
 int config_file_parse (const char *filename,
@@ -735,6 +735,66 @@ sdr_cache_flush_cache (pstdout_state_t pstate,
   return (rv);
 }
 
+int
+sdr_cache_get_cache_directory_filename (pstdout_state_t pstate,
+                                        const char *hostname,
+                                        const struct common_cmd_args *common_args,
+                                        const char *prefix,
+                                        char *buf,
+                                        unsigned int buflen)
+{
+  char sdrcachebuf[MAXPATHLEN+1];
+  char hostnamebuf[FREEIPMI_MAXHOSTNAMELEN+1];
+  char *ptr;
+  int ret;
+
+  assert (common_args);
+  assert (prefix);
+  assert (buf);
+  assert (buflen);
+
+  if (_sdr_cache_create_directory (pstate,
+                                   common_args->sdr_cache_directory) < 0)
+    return (-1);
+
+  memset (sdrcachebuf, '\0', MAXPATHLEN+1);
+  if (_sdr_cache_get_cache_directory (pstate,
+                                      common_args->sdr_cache_directory,
+                                      sdrcachebuf,
+                                      MAXPATHLEN) < 0)
+    return (-1);
+
+  memset (hostnamebuf, '\0', FREEIPMI_MAXHOSTNAMELEN+1);
+  if (gethostname (hostnamebuf, FREEIPMI_MAXHOSTNAMELEN) < 0)
+    snprintf (hostnamebuf, FREEIPMI_MAXHOSTNAMELEN, "localhost");
+
+  /* shorten hostname if necessary */
+  if ((ptr = strchr (hostnamebuf, '.')))
+    *ptr = '\0';
+
+  if ((ret = snprintf (buf,
+                       buflen,
+                       "%s/%s-%s.%s",
+                       sdrcachebuf,
+                       prefix,
+                       hostnamebuf,
+                       hostname ? hostname : "localhost")) < 0)
+    {
+      PSTDOUT_PERROR (pstate, "snprintf");
+      return (-1);
+    }
+
+  if (ret >= buflen)
+    {
+      PSTDOUT_FPRINTF (pstate,
+                       stderr,
+                       "snprintf invalid bytes written\n");
+      return (-1);
+    }
+
+  return (0);
+}
+
 int
 ipmi_sdr_cache_search_sensor_wrapper (ipmi_sdr_ctx_t sdr_ctx,
                                       uint8_t sensor_number,
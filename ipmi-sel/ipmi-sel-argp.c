@@ -143,6 +143,10 @@ static struct argp_option cmdline_options[] =
       "Do not output column headers.", 66},
     { "non-abbreviated-units", NON_ABBREVIATED_UNITS_KEY, 0, 0,
       "Output non-abbreviated units (e.g. 'Amps' instead of 'A').", 67},
+    { "speculative-read", SPECULATIVE_READ_KEY, 0, 0,
+      "Read several SEL entries per round trip assuming sequential record ids.", 68},
+    { "mirror", MIRROR_KEY, 0, 0,
+      "Keep a local mirror of the SEL and only read new entries from the BMC.", 69},
     { NULL, 0, NULL, 0, NULL, 0}
   };
 
@@ -629,6 +633,12 @@ cmdline_parse (int key, char *arg, struct argp_state *state)
     case NON_ABBREVIATED_UNITS_KEY:
       cmd_args->non_abbreviated_units = 1;
       break;
+    case SPECULATIVE_READ_KEY:
+      cmd_args->speculative_read = 1;
+      break;
+    case MIRROR_KEY:
+      cmd_args->mirror = 1;
+      break;
     case ARGP_KEY_ARG:
       /* Too many arguments. */
       argp_usage (state);
@@ -716,6 +726,10 @@ _ipmi_sel_config_file_parse (struct ipmi_sel_arguments *cmd_args)
     cmd_args->no_header_output = config_file_data.no_header_output;
   if (config_file_data.non_abbreviated_units_count)
     cmd_args->non_abbreviated_units = config_file_data.non_abbreviated_units;
+  if (config_file_data.speculative_read_count)
+    cmd_args->speculative_read = config_file_data.speculative_read;
+  if (config_file_data.mirror_count)
+    cmd_args->mirror = config_file_data.mirror;
 }
 
 static void
@@ -814,6 +828,8 @@ ipmi_sel_argp_parse (int argc, char **argv, struct ipmi_sel_arguments *cmd_args)
   cmd_args->comma_separated_output = 0;
   cmd_args->no_header_output = 0;
   cmd_args->non_abbreviated_units = 0;
+  cmd_args->speculative_read = 0;
+  cmd_args->mirror = 0;
 
   argp_parse (&cmdline_config_file_argp,
               argc,
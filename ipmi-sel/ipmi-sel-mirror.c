@@ -0,0 +1,644 @@
+/*
+ * Copyright (C) 2003-2015 FreeIPMI Core Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#if STDC_HEADERS
+#include <string.h>
+#endif /* STDC_HEADERS */
+#include <sys/types.h>
+#include <sys/stat.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif /* HAVE_FCNTL_H */
+#include <sys/param.h>          /* MAXPATHLEN */
+#include <limits.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <freeipmi/freeipmi.h>
+
+#include "ipmi-sel_.h"
+#include "ipmi-sel-mirror.h"
+
+#include "freeipmi-portability.h"
+#include "fd.h"
+#include "pstdout.h"
+#include "tool-common.h"
+#include "tool-sdr-cache-common.h"
+
+#ifndef MAXPATHLEN
+#define MAXPATHLEN 4096
+#endif /* MAXPATHLEN */
+
+#define IPMI_SEL_MIRROR_FILENAME_PREFIX  "sel-mirror"
+
+/*
+ * Mirror File Format
+ *
+ * All numbers stored little endian
+ *
+ * uint32_t file_magic
+ * uint32_t file_version
+ * uint16_t entries
+ * uint16_t free_space
+ * uint32_t most_recent_addition_timestamp
+ * uint32_t most_recent_erase_timestamp
+ * uint8_t zerosumchecksum
+ *
+ * Followed by the SEL records as read from the BMC, in SEL order.
+ * Records are only ever appended, the header is rewritten after the
+ * records of each sync are written.
+ */
+
+#define IPMI_SEL_MIRROR_FILE_MAGIC       0x5E1A11C0
+
+#define IPMI_SEL_MIRROR_FILE_VERSION     0x00000001
+
+#define IPMI_SEL_MIRROR_HEADER_LENGTH    (4 + 4 + 2 + 2 + 4 + 4 + 1)
+
+#define IPMI_SEL_MIRROR_RECORD_LENGTH    IPMI_SEL_RECORD_MAX_RECORD_LENGTH
+
+struct ipmi_sel_mirror_info
+{
+  uint16_t entries;
+  uint16_t free_space;
+  uint32_t most_recent_addition_timestamp;
+  uint32_t most_recent_erase_timestamp;
+};
+
+struct ipmi_sel_mirror_read
+{
+  ipmi_sel_state_data_t *state_data;
+  uint8_t *records;
+  unsigned int records_len;
+  unsigned int records_size;
+  /* last record already mirrored, read again to start a sync */
+  uint8_t *last_record;
+  int last_record_seen;
+  int last_record_mismatch;
+};
+
+static int
+_ipmi_sel_mirror_get_sel_info (ipmi_sel_state_data_t *state_data,
+                               struct ipmi_sel_mirror_info *sel_info)
+{
+  fiid_obj_t obj_cmd_rs = NULL;
+  uint64_t val;
+  int rv = -1;
+
+  assert (state_data);
+  assert (sel_info);
+
+  if (!(obj_cmd_rs = fiid_obj_create (tmpl_cmd_get_sel_info_rs)))
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "fiid_obj_create: %s\n",
+                       strerror (errno));
+      goto cleanup;
+    }
+
+  if (ipmi_cmd_get_sel_info (state_data->ipmi_ctx, obj_cmd_rs) < 0)
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "ipmi_cmd_get_sel_info: %s\n",
+                       ipmi_ctx_errormsg (state_data->ipmi_ctx));
+      goto cleanup;
+    }
+
+  if (FIID_OBJ_GET (obj_cmd_rs, "entries", &val) < 0)
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "fiid_obj_get: 'entries': %s\n",
+                       fiid_obj_errormsg (obj_cmd_rs));
+      goto cleanup;
+    }
+  sel_info->entries = val;
+
+  if (FIID_OBJ_GET (obj_cmd_rs, "free_space", &val) < 0)
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "fiid_obj_get: 'free_space': %s\n",
+                       fiid_obj_errormsg (obj_cmd_rs));
+      goto cleanup;
+    }
+  sel_info->free_space = val;
+
+  if (FIID_OBJ_GET (obj_cmd_rs, "most_recent_addition_timestamp", &val) < 0)
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "fiid_obj_get: 'most_recent_addition_timestamp': %s\n",
+                       fiid_obj_errormsg (obj_cmd_rs));
+      goto cleanup;
+    }
+  sel_info->most_recent_addition_timestamp = val;
+
+  if (FIID_OBJ_GET (obj_cmd_rs, "most_recent_erase_timestamp", &val) < 0)
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "fiid_obj_get: 'most_recent_erase_timestamp': %s\n",
+                       fiid_obj_errormsg (obj_cmd_rs));
+      goto cleanup;
+    }
+  sel_info->most_recent_erase_timestamp = val;
+
+  rv = 0;
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rs);
+  return (rv);
+}
+
+static unsigned int
+_unmarshall_uint32 (uint8_t *databuf, uint32_t *value)
+{
+  assert (databuf);
+  assert (value);
+
+  /* stored little endian */
+  (*value) = databuf[0];
+  (*value) |= (databuf[1] << 8);
+  (*value) |= (databuf[2] << 16);
+  (*value) |= ((uint32_t)databuf[3] << 24);
+
+  return (sizeof (uint32_t));
+}
+
+static unsigned int
+_unmarshall_uint16 (uint8_t *databuf, uint16_t *value)
+{
+  assert (databuf);
+  assert (value);
+
+  /* stored little endian */
+  (*value) = databuf[0];
+  (*value) |= (databuf[1] << 8);
+
+  return (sizeof (uint16_t));
+}
+
+static unsigned int
+_marshall_uint32 (uint8_t *databuf, uint32_t value)
+{
+  assert (databuf);
+
+  /* store little endian */
+  databuf[0] = (value & 0x000000FF);
+  databuf[1] = (value & 0x0000FF00) >> 8;
+  databuf[2] = (value & 0x00FF0000) >> 16;
+  databuf[3] = (value & 0xFF000000) >> 24;
+
+  return (sizeof (uint32_t));
+}
+
+static unsigned int
+_marshall_uint16 (uint8_t *databuf, uint16_t value)
+{
+  assert (databuf);
+
+  /* store little endian */
+  databuf[0] = (value & 0x00FF);
+  databuf[1] = (value & 0xFF00) >> 8;
+
+  return (sizeof (uint16_t));
+}
+
+/* returns 0 if header valid, -1 if not */
+static int
+_ipmi_sel_mirror_header_unmarshall (uint8_t *databuf,
+                                    struct ipmi_sel_mirror_info *mirror_info)
+{
+  uint32_t file_magic;
+  uint32_t file_version;
+  uint8_t zerosumchecksum = 0;
+  unsigned int databuf_offset = 0;
+  unsigned int i;
+
+  assert (databuf);
+  assert (mirror_info);
+
+  for (i = 0; i < IPMI_SEL_MIRROR_HEADER_LENGTH; i++)
+    zerosumchecksum += databuf[i];
+
+  if (zerosumchecksum)
+    return (-1);
+
+  databuf_offset += _unmarshall_uint32 (databuf + databuf_offset, &file_magic);
+  if (file_magic != IPMI_SEL_MIRROR_FILE_MAGIC)
+    return (-1);
+
+  databuf_offset += _unmarshall_uint32 (databuf + databuf_offset, &file_version);
+  if (file_version != IPMI_SEL_MIRROR_FILE_VERSION)
+    return (-1);
+
+  databuf_offset += _unmarshall_uint16 (databuf + databuf_offset, &mirror_info->entries);
+  databuf_offset += _unmarshall_uint16 (databuf + databuf_offset, &mirror_info->free_space);
+  databuf_offset += _unmarshall_uint32 (databuf + databuf_offset, &mirror_info->most_recent_addition_timestamp);
+  databuf_offset += _unmarshall_uint32 (databuf + databuf_offset, &mirror_info->most_recent_erase_timestamp);
+
+  return (0);
+}
+
+static void
+_ipmi_sel_mirror_header_marshall (uint8_t *databuf,
+                                  struct ipmi_sel_mirror_info *mirror_info)
+{
+  unsigned int databuf_offset = 0;
+  uint8_t zerosumchecksum = 0;
+  unsigned int i;
+
+  assert (databuf);
+  assert (mirror_info);
+
+  databuf_offset += _marshall_uint32 (databuf + databuf_offset, IPMI_SEL_MIRROR_FILE_MAGIC);
+  databuf_offset += _marshall_uint32 (databuf + databuf_offset, IPMI_SEL_MIRROR_FILE_VERSION);
+  databuf_offset += _marshall_uint16 (databuf + databuf_offset, mirror_info->entries);
+  databuf_offset += _marshall_uint16 (databuf + databuf_offset, mirror_info->free_space);
+  databuf_offset += _marshall_uint32 (databuf + databuf_offset, mirror_info->most_recent_addition_timestamp);
+  databuf_offset += _marshall_uint32 (databuf + databuf_offset, mirror_info->most_recent_erase_timestamp);
+
+  for (i = 0; i < databuf_offset; i++)
+    zerosumchecksum += databuf[i];
+  zerosumchecksum = (~zerosumchecksum) + 1;
+  databuf[databuf_offset] = zerosumchecksum;
+}
+
+static int
+_ipmi_sel_mirror_callback (ipmi_sel_ctx_t ctx, void *callback_data)
+{
+  struct ipmi_sel_mirror_read *mr;
+  uint8_t record[IPMI_SEL_MIRROR_RECORD_LENGTH];
+
+  assert (ctx);
+  assert (callback_data);
+
+  mr = (struct ipmi_sel_mirror_read *)callback_data;
+
+  memset (record, '\0', IPMI_SEL_MIRROR_RECORD_LENGTH);
+  if (ipmi_sel_parse_read_record (ctx,
+                                  record,
+                                  IPMI_SEL_MIRROR_RECORD_LENGTH) < 0)
+    {
+      pstdout_fprintf (mr->state_data->pstate,
+                       stderr,
+                       "ipmi_sel_parse_read_record: %s\n",
+                       ipmi_sel_ctx_errormsg (ctx));
+      return (-1);
+    }
+
+  /* The sync starts at the last record mirrored.  If it changed, the
+   * SEL was cleared without the BMC updating the erase timestamp, no
+   * point reading further.
+   */
+  if (mr->last_record && !mr->last_record_seen)
+    {
+      mr->last_record_seen++;
+      if (memcmp (record, mr->last_record, IPMI_SEL_MIRROR_RECORD_LENGTH))
+        {
+          mr->last_record_mismatch++;
+          return (-1);
+        }
+      return (0);
+    }
+
+  if (mr->records_len + IPMI_SEL_MIRROR_RECORD_LENGTH > mr->records_size)
+    {
+      unsigned int records_size;
+      uint8_t *tmp;
+
+      records_size = mr->records_size ? mr->records_size * 2 : IPMI_SEL_MIRROR_RECORD_LENGTH * 64;
+
+      if (!(tmp = (uint8_t *)realloc (mr->records, records_size)))
+        {
+          pstdout_perror (mr->state_data->pstate, "realloc");
+          return (-1);
+        }
+      mr->records = tmp;
+      mr->records_size = records_size;
+    }
+
+  memcpy (mr->records + mr->records_len, record, IPMI_SEL_MIRROR_RECORD_LENGTH);
+  mr->records_len += IPMI_SEL_MIRROR_RECORD_LENGTH;
+  return (0);
+}
+
+/* returns 1 if mirror loaded, 0 if not available or invalid, -1 on error */
+static int
+_ipmi_sel_mirror_load (ipmi_sel_state_data_t *state_data,
+                       int fd,
+                       const char *filename,
+                       struct ipmi_sel_mirror_info *mirror_info,
+                       struct ipmi_sel_mirror_read *mr)
+{
+  uint8_t header[IPMI_SEL_MIRROR_HEADER_LENGTH];
+  struct stat statbuf;
+  unsigned int records_len;
+  ssize_t n;
+
+  assert (state_data);
+  assert (fd >= 0);
+  assert (filename);
+  assert (mirror_info);
+  assert (mr);
+
+  if (fstat (fd, &statbuf) < 0)
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "fstat: %s: %s\n",
+                       filename,
+                       strerror (errno));
+      return (-1);
+    }
+
+  if (statbuf.st_size < IPMI_SEL_MIRROR_HEADER_LENGTH)
+    return (0);
+
+  records_len = statbuf.st_size - IPMI_SEL_MIRROR_HEADER_LENGTH;
+
+  /* A partial record means a sync was interrupted */
+  if (records_len % IPMI_SEL_MIRROR_RECORD_LENGTH
+      || (records_len / IPMI_SEL_MIRROR_RECORD_LENGTH) > USHRT_MAX)
+    return (0);
+
+  if ((n = fd_read_n (fd, header, IPMI_SEL_MIRROR_HEADER_LENGTH)) < 0)
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "read: %s: %s\n",
+                       filename,
+                       strerror (errno));
+      return (-1);
+    }
+
+  if (n != IPMI_SEL_MIRROR_HEADER_LENGTH
+      || _ipmi_sel_mirror_header_unmarshall (header, mirror_info) < 0)
+    return (0);
+
+  if (!records_len)
+    return (1);
+
+  if (!(mr->records = (uint8_t *)malloc (records_len)))
+    {
+      pstdout_perror (state_data->pstate, "malloc");
+      return (-1);
+    }
+  mr->records_size = records_len;
+
+  if ((n = fd_read_n (fd, mr->records, records_len)) < 0)
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "read: %s: %s\n",
+                       filename,
+                       strerror (errno));
+      return (-1);
+    }
+
+  if (n != records_len)
+    return (0);
+
+  mr->records_len = records_len;
+  return (1);
+}
+
+static int
+_ipmi_sel_mirror_write (ipmi_sel_state_data_t *state_data,
+                        int fd,
+                        const char *filename,
+                        off_t offset,
+                        void *buf,
+                        size_t len)
+{
+  assert (state_data);
+  assert (fd >= 0);
+  assert (filename);
+
+  if (!len)
+    return (0);
+
+  if (lseek (fd, offset, SEEK_SET) < 0)
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "lseek: %s: %s\n",
+                       filename,
+                       strerror (errno));
+      return (-1);
+    }
+
+  if (fd_write_n (fd, buf, len) < 0)
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "write: %s: %s\n",
+                       filename,
+                       strerror (errno));
+      return (-1);
+    }
+
+  return (0);
+}
+
+int
+ipmi_sel_mirror_sync (ipmi_sel_state_data_t *state_data)
+{
+  char filename[MAXPATHLEN+1];
+  uint8_t header[IPMI_SEL_MIRROR_HEADER_LENGTH];
+  uint8_t last_record[IPMI_SEL_MIRROR_RECORD_LENGTH];
+  struct ipmi_sel_mirror_info mirror_info;
+  struct ipmi_sel_mirror_info sel_info;
+  struct ipmi_sel_mirror_read mr;
+  unsigned int mirrored_len = 0;
+  unsigned int records_count;
+  int mirror_loaded;
+  int fd = -1;
+  int rv = -1;
+
+  assert (state_data);
+  assert (state_data->prog_data->args->mirror);
+  assert (!state_data->sel_mirror_loaded);
+
+  memset (&mirror_info, '\0', sizeof (struct ipmi_sel_mirror_info));
+  memset (&mr, '\0', sizeof (struct ipmi_sel_mirror_read));
+  mr.state_data = state_data;
+
+  memset (filename, '\0', MAXPATHLEN + 1);
+  if (sdr_cache_get_cache_directory_filename (state_data->pstate,
+                                              state_data->hostname,
+                                              &(state_data->prog_data->args->common_args),
+                                              IPMI_SEL_MIRROR_FILENAME_PREFIX,
+                                              filename,
+                                              MAXPATHLEN) < 0)
+    goto cleanup;
+
+  if ((fd = open (filename, O_RDWR | O_CREAT, 0644)) < 0)
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "Cannot open SEL mirror: %s: %s\n",
+                       filename,
+                       strerror (errno));
+      goto cleanup;
+    }
+
+  /* another ipmi-sel may be syncing the same host */
+  if (fd_get_writew_lock (fd) < 0)
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "Cannot lock SEL mirror: %s: %s\n",
+                       filename,
+                       strerror (errno));
+      goto cleanup;
+    }
+
+  if ((mirror_loaded = _ipmi_sel_mirror_load (state_data,
+                                              fd,
+                                              filename,
+                                              &mirror_info,
+                                              &mr)) < 0)
+    goto cleanup;
+
+  if (_ipmi_sel_mirror_get_sel_info (state_data, &sel_info) < 0)
+    goto cleanup;
+
+  records_count = mr.records_len / IPMI_SEL_MIRROR_RECORD_LENGTH;
+
+  /* The erase timestamp changes whenever the SEL is cleared or entries
+   * are deleted, the mirror has to be rebuilt then.
+   */
+  if (mirror_loaded
+      && records_count <= sel_info.entries
+      && mirror_info.most_recent_erase_timestamp == sel_info.most_recent_erase_timestamp)
+    {
+      if (records_count == sel_info.entries
+          && mirror_info.most_recent_addition_timestamp == sel_info.most_recent_addition_timestamp)
+        goto out;
+    }
+  else
+    mr.records_len = 0;
+
+  if (mr.records_len)
+    {
+      uint16_t last_record_id;
+
+      memcpy (last_record,
+              mr.records + mr.records_len - IPMI_SEL_MIRROR_RECORD_LENGTH,
+              IPMI_SEL_MIRROR_RECORD_LENGTH);
+
+      if (ipmi_sel_parse_read_record_id (state_data->sel_ctx,
+                                         last_record,
+                                         IPMI_SEL_MIRROR_RECORD_LENGTH,
+                                         &last_record_id) < 0)
+        {
+          pstdout_fprintf (state_data->pstate,
+                           stderr,
+                           "ipmi_sel_parse_read_record_id: %s\n",
+                           ipmi_sel_ctx_errormsg (state_data->sel_ctx));
+          goto cleanup;
+        }
+
+      mirrored_len = mr.records_len;
+      mr.last_record = last_record;
+
+      if (ipmi_sel_parse (state_data->sel_ctx,
+                          last_record_id,
+                          IPMI_SEL_RECORD_ID_LAST,
+                          _ipmi_sel_mirror_callback,
+                          &mr) < 0
+          || !mr.last_record_seen
+          || mr.last_record_mismatch)
+        {
+          /* last record gone, fall through to rebuild */
+          mirrored_len = 0;
+          mr.records_len = 0;
+        }
+    }
+
+  if (!mirrored_len)
+    {
+      mr.last_record = NULL;
+
+      if (ipmi_sel_parse (state_data->sel_ctx,
+                          IPMI_SEL_RECORD_ID_FIRST,
+                          IPMI_SEL_RECORD_ID_LAST,
+                          _ipmi_sel_mirror_callback,
+                          &mr) < 0)
+        {
+          pstdout_fprintf (state_data->pstate,
+                           stderr,
+                           "ipmi_sel_parse: %s\n",
+                           ipmi_sel_ctx_errormsg (state_data->sel_ctx));
+          goto cleanup;
+        }
+
+      if (ftruncate (fd, 0) < 0)
+        {
+          pstdout_fprintf (state_data->pstate,
+                           stderr,
+                           "ftruncate: %s: %s\n",
+                           filename,
+                           strerror (errno));
+          goto cleanup;
+        }
+    }
+
+  if (_ipmi_sel_mirror_write (state_data,
+                              fd,
+                              filename,
+                              IPMI_SEL_MIRROR_HEADER_LENGTH + mirrored_len,
+                              mr.records + mirrored_len,
+                              mr.records_len - mirrored_len) < 0)
+    goto cleanup;
+
+  _ipmi_sel_mirror_header_marshall (header, &sel_info);
+
+  if (_ipmi_sel_mirror_write (state_data,
+                              fd,
+                              filename,
+                              0,
+                              header,
+                              IPMI_SEL_MIRROR_HEADER_LENGTH) < 0)
+    goto cleanup;
+
+ out:
+  state_data->sel_mirror_records = mr.records;
+  state_data->sel_mirror_records_len = mr.records_len;
+  state_data->sel_mirror_loaded = 1;
+  mr.records = NULL;
+  rv = 0;
+ cleanup:
+  free (mr.records);
+  /* closing releases the lock */
+  if (fd >= 0)
+    close (fd);
+  return (rv);
+}
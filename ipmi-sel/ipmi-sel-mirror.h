@@ -0,0 +1,32 @@
+/*
+ * Copyright (C) 2003-2015 FreeIPMI Core Team
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef IPMI_SEL_MIRROR_H
+#define IPMI_SEL_MIRROR_H
+
+#include "ipmi-sel_.h"
+
+/* Bring the local mirror of the host's SEL up to date, reading only
+ * entries added since the last sync unless the SEL was cleared or
+ * entries were deleted.  On success the mirrored SEL records are
+ * stored in state_data->sel_mirror_records, to be freed by the
+ * caller.
+ */
+int ipmi_sel_mirror_sync (ipmi_sel_state_data_t *state_data);
+
+#endif /* IPMI_SEL_MIRROR_H */
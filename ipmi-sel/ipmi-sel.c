@@ -41,6 +41,7 @@
 
 #include "ipmi-sel_.h"
 #include "ipmi-sel-argp.h"
+#include "ipmi-sel-mirror.h"
 
 #include "freeipmi-portability.h"
 #include "pstdout.h"
@@ -1551,6 +1552,50 @@ _sel_record_id_last_callback (ipmi_sel_ctx_t ctx, void *callback_data)
   return (rv);
 }
 
+/* parse from the SEL mirror if it is loaded, the BMC otherwise */
+static int
+_sel_parse (ipmi_sel_state_data_t *state_data,
+            uint16_t record_id_start,
+            uint16_t record_id_last,
+            Ipmi_Sel_Parse_Callback callback)
+{
+  assert (state_data);
+
+  if (state_data->sel_mirror_loaded)
+    {
+      if (ipmi_sel_parse_records (state_data->sel_ctx,
+                                  state_data->sel_mirror_records,
+                                  state_data->sel_mirror_records_len,
+                                  record_id_start,
+                                  record_id_last,
+                                  callback,
+                                  state_data) < 0)
+        {
+          pstdout_fprintf (state_data->pstate,
+                           stderr,
+                           "ipmi_sel_parse_records: %s\n",
+                           ipmi_sel_ctx_errormsg (state_data->sel_ctx));
+          return (-1);
+        }
+      return (0);
+    }
+
+  if (ipmi_sel_parse (state_data->sel_ctx,
+                      record_id_start,
+                      record_id_last,
+                      callback,
+                      state_data) < 0)
+    {
+      pstdout_fprintf (state_data->pstate,
+                       stderr,
+                       "ipmi_sel_parse: %s\n",
+                       ipmi_sel_ctx_errormsg (state_data->sel_ctx));
+      return (-1);
+    }
+
+  return (0);
+}
+
 static int
 _display_sel_records (ipmi_sel_state_data_t *state_data)
 {
@@ -1584,6 +1629,13 @@ _display_sel_records (ipmi_sel_state_data_t *state_data)
         }
     }
 
+  /* record lists are read from the BMC directly */
+  if (args->mirror && !args->display)
+    {
+      if (ipmi_sel_mirror_sync (state_data) < 0)
+        goto cleanup;
+    }
+
   if (!args->common_args.ignore_sdr_cache)
     {
       if (calculate_column_widths (state_data->pstate,
@@ -1678,34 +1730,20 @@ _display_sel_records (ipmi_sel_state_data_t *state_data)
   else if (state_data->prog_data->args->display_range)
     {
       /* assume biggest record is is the last specified */
-      if (ipmi_sel_parse (state_data->sel_ctx,
-                          state_data->prog_data->args->display_range2,
-                          state_data->prog_data->args->display_range2,
-                          _sel_record_id_callback,
-                          state_data) < 0)
-        {
-          pstdout_fprintf (state_data->pstate,
-                           stderr,
-                           "ipmi_sel_parse: %s\n",
-                           ipmi_sel_ctx_errormsg (state_data->sel_ctx));
-          goto cleanup;
-        }
+      if (_sel_parse (state_data,
+                      state_data->prog_data->args->display_range2,
+                      state_data->prog_data->args->display_range2,
+                      _sel_record_id_callback) < 0)
+        goto cleanup;
     }
   else
     {
       /* assume biggest record id is the last one */
-      if (ipmi_sel_parse (state_data->sel_ctx,
-                          IPMI_SEL_RECORD_ID_LAST,
-                          IPMI_SEL_RECORD_ID_LAST,
-                          _sel_record_id_callback,
-                          state_data) < 0)
-        {
-          pstdout_fprintf (state_data->pstate,
-                           stderr,
-                           "ipmi_sel_parse: %s\n",
-                           ipmi_sel_ctx_errormsg (state_data->sel_ctx));
-          goto cleanup;
-        }
+      if (_sel_parse (state_data,
+                      IPMI_SEL_RECORD_ID_LAST,
+                      IPMI_SEL_RECORD_ID_LAST,
+                      _sel_record_id_callback) < 0)
+        goto cleanup;
     }
 
   if (args->interpret_oem_data || args->output_oem_event_strings)
@@ -1787,15 +1825,34 @@ _display_sel_records (ipmi_sel_state_data_t *state_data)
     }
   else if (state_data->prog_data->args->display_range)
     {
-      if (ipmi_sel_parse (state_data->sel_ctx,
-                          state_data->prog_data->args->display_range1,
-                          state_data->prog_data->args->display_range2,
-                          _sel_parse_callback,
-                          state_data) < 0)
+      if (_sel_parse (state_data,
+                      state_data->prog_data->args->display_range1,
+                      state_data->prog_data->args->display_range2,
+                      _sel_parse_callback) < 0)
+        goto cleanup;
+    }
+  else if (state_data->prog_data->args->tail
+           && state_data->sel_mirror_loaded)
+    {
+      unsigned int count;
+      unsigned int skip = 0;
+
+      /* the mirror knows exactly where the last entries are */
+      count = state_data->sel_mirror_records_len / IPMI_SEL_RECORD_MAX_RECORD_LENGTH;
+      if (count > state_data->prog_data->args->tail_count)
+        skip = count - state_data->prog_data->args->tail_count;
+
+      if (ipmi_sel_parse_records (state_data->sel_ctx,
+                                  state_data->sel_mirror_records + (skip * IPMI_SEL_RECORD_MAX_RECORD_LENGTH),
+                                  (count - skip) * IPMI_SEL_RECORD_MAX_RECORD_LENGTH,
+                                  IPMI_SEL_RECORD_ID_FIRST,
+                                  IPMI_SEL_RECORD_ID_LAST,
+                                  _sel_parse_callback,
+                                  state_data) < 0)
         {
           pstdout_fprintf (state_data->pstate,
                            stderr,
-                           "ipmi_sel_parse: %s\n",
+                           "ipmi_sel_parse_records: %s\n",
                            ipmi_sel_ctx_errormsg (state_data->sel_ctx));
           goto cleanup;
         }
@@ -1836,46 +1893,25 @@ _display_sel_records (ipmi_sel_state_data_t *state_data)
       /* Special case, display all records */
       if (entries <= state_data->prog_data->args->tail_count)
         {
-          if (ipmi_sel_parse (state_data->sel_ctx,
-                              IPMI_SEL_RECORD_ID_FIRST,
-                              IPMI_SEL_RECORD_ID_LAST,
-                              _sel_parse_callback,
-                              state_data) < 0)
-            {
-              pstdout_fprintf (state_data->pstate,
-                               stderr,
-                               "ipmi_sel_parse: %s\n",
-                               ipmi_sel_ctx_errormsg (state_data->sel_ctx));
-              goto cleanup;
-            }
+          if (_sel_parse (state_data,
+                          IPMI_SEL_RECORD_ID_FIRST,
+                          IPMI_SEL_RECORD_ID_LAST,
+                          _sel_parse_callback) < 0)
+            goto cleanup;
           goto out;
         }
 
-      if (ipmi_sel_parse (state_data->sel_ctx,
-                          IPMI_SEL_RECORD_ID_FIRST,
-                          IPMI_SEL_RECORD_ID_FIRST,
-                          _sel_record_id_first_callback,
-                          state_data) < 0)
-        {
-          pstdout_fprintf (state_data->pstate,
-                           stderr,
-                           "ipmi_sel_parse: %s\n",
-                           ipmi_sel_ctx_errormsg (state_data->sel_ctx));
-          goto cleanup;
-        }
+      if (_sel_parse (state_data,
+                      IPMI_SEL_RECORD_ID_FIRST,
+                      IPMI_SEL_RECORD_ID_FIRST,
+                      _sel_record_id_first_callback) < 0)
+        goto cleanup;
 
-      if (ipmi_sel_parse (state_data->sel_ctx,
-                          IPMI_SEL_RECORD_ID_LAST,
-                          IPMI_SEL_RECORD_ID_LAST,
-                          _sel_record_id_last_callback,
-                          state_data) < 0)
-        {
-          pstdout_fprintf (state_data->pstate,
-                           stderr,
-                           "ipmi_sel_parse: %s\n",
-                           ipmi_sel_ctx_errormsg (state_data->sel_ctx));
-          goto cleanup;
-        }
+      if (_sel_parse (state_data,
+                      IPMI_SEL_RECORD_ID_LAST,
+                      IPMI_SEL_RECORD_ID_LAST,
+                      _sel_record_id_last_callback) < 0)
+        goto cleanup;
 
       /* Assume entries distributed evenly throughout SEL */
 
@@ -1900,36 +1936,22 @@ _display_sel_records (ipmi_sel_state_data_t *state_data)
             range_begin = state_data->last_record_id - (state_data->prog_data->args->tail_count * spacing) + 1;
         }
 
-      if (ipmi_sel_parse (state_data->sel_ctx,
-                          range_begin,
-                          IPMI_SEL_RECORD_ID_LAST,
-                          _sel_parse_callback,
-                          state_data) < 0)
-        {
-          pstdout_fprintf (state_data->pstate,
-                           stderr,
-                           "ipmi_sel_parse: %s\n",
-                           ipmi_sel_ctx_errormsg (state_data->sel_ctx));
-          goto cleanup;
-        }
+      if (_sel_parse (state_data,
+                      range_begin,
+                      IPMI_SEL_RECORD_ID_LAST,
+                      _sel_parse_callback) < 0)
+        goto cleanup;
 
       fiid_obj_destroy (obj_cmd_rs);
       obj_cmd_rs = NULL;
     }
   else
     {
-      if (ipmi_sel_parse (state_data->sel_ctx,
-                          IPMI_SEL_RECORD_ID_FIRST,
-                          IPMI_SEL_RECORD_ID_LAST,
-                          _sel_parse_callback,
-                          state_data) < 0)
-        {
-          pstdout_fprintf (state_data->pstate,
-                           stderr,
-                           "ipmi_sel_parse: %s\n",
-                           ipmi_sel_ctx_errormsg (state_data->sel_ctx));
-          goto cleanup;
-        }
+      if (_sel_parse (state_data,
+                      IPMI_SEL_RECORD_ID_FIRST,
+                      IPMI_SEL_RECORD_ID_LAST,
+                      _sel_parse_callback) < 0)
+        goto cleanup;
     }
 
   if (args->post_clear)
@@ -2056,6 +2078,9 @@ _ipmi_sel (pstdout_state_t pstate,
   if (state_data.prog_data->args->assume_system_event_records)
     sel_flags |= IPMI_SEL_FLAGS_ASSUME_SYSTEM_EVENT_RECORDS;
 
+  if (state_data.prog_data->args->speculative_read)
+    sel_flags |= IPMI_SEL_FLAGS_SPECULATIVE_READ;
+
   if (sel_flags)
     {
       /* Don't error out, if this fails we can still continue */
@@ -2142,6 +2167,7 @@ _ipmi_sel (pstdout_state_t pstate,
  cleanup:
   ipmi_sdr_ctx_destroy (state_data.sdr_ctx);
   ipmi_sel_ctx_destroy (state_data.sel_ctx);
+  free (state_data.sel_mirror_records);
   ipmi_ctx_close (state_data.ipmi_ctx);
   ipmi_ctx_destroy (state_data.ipmi_ctx);
   return (exit_code);
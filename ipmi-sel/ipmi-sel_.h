@@ -68,6 +68,8 @@ enum ipmi_sel_argp_option_keys
     COMMA_SEPARATED_OUTPUT_KEY = 181,
     NO_HEADER_OUTPUT_KEY = 182,
     NON_ABBREVIATED_UNITS_KEY = 183,
+    SPECULATIVE_READ_KEY = 184,
+    MIRROR_KEY = 185,
   };
 
 struct ipmi_sel_arguments
@@ -122,6 +124,8 @@ struct ipmi_sel_arguments
   int comma_separated_output;
   int no_header_output;
   int non_abbreviated_units;
+  int speculative_read;
+  int mirror;
 };
 
 typedef struct ipmi_sel_prog_data
@@ -145,6 +149,10 @@ typedef struct ipmi_sel_state_data
   /* for tail usage */
   uint16_t first_record_id;
   uint16_t last_record_id;
+  /* for mirror usage */
+  uint8_t *sel_mirror_records;
+  unsigned int sel_mirror_records_len;
+  int sel_mirror_loaded;
 } ipmi_sel_state_data_t;
 
 #endif /* IPMI_SEL__H */
@@ -42,6 +42,7 @@
 #include <unistd.h>
 #endif /* HAVE_UNISTD_H */
 #include <sys/param.h>
+#include <limits.h>
 #include <assert.h>
 #include <errno.h>
 
@@ -95,6 +96,20 @@ static struct argp_option cmdline_options[] =
       "Deactivate all payload instances instead of just the configured payload instance.", 46},
     { "lock-memory", LOCK_MEMORY_KEY, 0, 0,
       "Lock sensitive information (such as usernames and passwords) in memory.", 47},
+    { "adaptive-retransmission", ADAPTIVE_RETRANSMISSION_KEY, 0, 0,
+      "Adjust retransmission timeouts to the BMC's measured round trip time.", 47},
+    { "coalesce-input", COALESCE_INPUT_KEY, 0, 0,
+      "Buffer typed characters briefly so they are sent in fewer packets.", 47},
+    { "throughput", THROUGHPUT_KEY, 0, 0,
+      "Acknowledge console output immediately and allow larger output buffers.", 47},
+    { "log-dir", LOG_DIR_KEY, "DIRECTORY", 0,
+      "Log the consoles of all hosts to files in DIRECTORY rather than running interactively.", 47},
+    { "log-threads", LOG_THREADS_KEY, "NUM", 0,
+      "Specify the number of engine threads used when logging consoles.", 47},
+    { "log-max-size", LOG_MAX_SIZE_KEY, "BYTES", 0,
+      "Rotate a console log once it grows larger than BYTES.", 47},
+    { "log-rotate-count", LOG_ROTATE_COUNT_KEY, "NUM", 0,
+      "Specify the number of rotated console logs to keep.", 47},
 #ifndef NDEBUG
     { "debugfile", DEBUGFILE_KEY, 0, 0,
       "Output debugging to files in current directory rather than to standard output.", 48},
@@ -121,6 +136,7 @@ cmdline_parse (int key, char *arg, struct argp_state *state)
 {
   struct ipmiconsole_arguments *cmd_args;
   char *endptr;
+  long tmpl;
   int tmp;
 
   assert (state);
@@ -162,6 +178,62 @@ cmdline_parse (int key, char *arg, struct argp_state *state)
     case LOCK_MEMORY_KEY:       /* --lock-memory */
       cmd_args->lock_memory++;
       break;
+    case ADAPTIVE_RETRANSMISSION_KEY:       /* --adaptive-retransmission */
+      cmd_args->adaptive_retransmission++;
+      break;
+    case COALESCE_INPUT_KEY:       /* --coalesce-input */
+      cmd_args->coalesce_input++;
+      break;
+    case THROUGHPUT_KEY:       /* --throughput */
+      cmd_args->throughput++;
+      break;
+    case LOG_DIR_KEY:       /* --log-dir */
+      free (cmd_args->log_dir);
+      if (!(cmd_args->log_dir = strdup (arg)))
+        {
+          perror ("strdup");
+          exit (EXIT_FAILURE);
+        }
+      break;
+    case LOG_THREADS_KEY:       /* --log-threads */
+      errno = 0;
+      tmp = strtol (arg, &endptr, 0);
+      if (errno
+          || endptr[0] != '\0'
+          || tmp <= 0
+          || tmp > IPMICONSOLE_THREAD_COUNT_MAX)
+        {
+          fprintf (stderr, "invalid log threads\n");
+          exit (EXIT_FAILURE);
+        }
+      cmd_args->log_threads = tmp;
+      break;
+    case LOG_MAX_SIZE_KEY:       /* --log-max-size */
+      errno = 0;
+      tmpl = strtol (arg, &endptr, 0);
+      if (errno
+          || endptr[0] != '\0'
+          || tmpl < 0
+          || tmpl > UINT_MAX)
+        {
+          fprintf (stderr, "invalid log max size\n");
+          exit (EXIT_FAILURE);
+        }
+      cmd_args->log_max_size = tmpl;
+      break;
+    case LOG_ROTATE_COUNT_KEY:       /* --log-rotate-count */
+      errno = 0;
+      tmp = strtol (arg, &endptr, 0);
+      if (errno
+          || endptr[0] != '\0'
+          || tmp < 0
+          || tmp > IPMICONSOLE_LOG_ROTATE_COUNT_MAX)
+        {
+          fprintf (stderr, "invalid log rotate count\n");
+          exit (EXIT_FAILURE);
+        }
+      cmd_args->log_rotate_count = tmp;
+      break;
 #ifndef NDEBUG
     case DEBUGFILE_KEY: /* --debugfile */
       cmd_args->debugfile++;
@@ -215,6 +287,12 @@ _ipmiconsole_config_file_parse (struct ipmiconsole_arguments *cmd_args)
     cmd_args->serial_keepalive_empty = config_file_data.serial_keepalive_empty;
   if (config_file_data.lock_memory_count)
     cmd_args->lock_memory = config_file_data.lock_memory;
+  if (config_file_data.adaptive_retransmission_count)
+    cmd_args->adaptive_retransmission = config_file_data.adaptive_retransmission;
+  if (config_file_data.coalesce_input_count)
+    cmd_args->coalesce_input = config_file_data.coalesce_input;
+  if (config_file_data.throughput_count)
+    cmd_args->throughput = config_file_data.throughput;
 }
 
 static void
@@ -227,6 +305,12 @@ _ipmiconsole_args_validate (struct ipmiconsole_arguments *cmd_args)
       fprintf (stderr, "hostname input required\n");
       exit (EXIT_FAILURE);
     }
+
+  if (cmd_args->log_dir && cmd_args->deactivate)
+    {
+      fprintf (stderr, "cannot deactivate SOL sessions while logging consoles\n");
+      exit (EXIT_FAILURE);
+    }
 }
 
 void
@@ -251,6 +335,13 @@ ipmiconsole_argp_parse (int argc, char **argv, struct ipmiconsole_arguments *cmd
   cmd_args->sol_payload_instance = 0;
   cmd_args->deactivate_all_instances = 0;
   cmd_args->lock_memory = 0;
+  cmd_args->adaptive_retransmission = 0;
+  cmd_args->coalesce_input = 0;
+  cmd_args->throughput = 0;
+  cmd_args->log_dir = NULL;
+  cmd_args->log_threads = 0;
+  cmd_args->log_max_size = 0;
+  cmd_args->log_rotate_count = IPMICONSOLE_LOG_ROTATE_COUNT_DEFAULT;
 #ifndef NDEBUG
   cmd_args->debugfile = 0;
   cmd_args->noraw = 0;
@@ -0,0 +1,707 @@
+/*****************************************************************************\
+ *****************************************************************************
+ *  Copyright (C) 2007-2015 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2006-2007 The Regents of the University of California.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  Written by Albert Chu <chu11@llnl.gov>
+ *  UCRL-CODE-221226
+ *
+ *  This file is part of Ipmiconsole, a set of IPMI 2.0 SOL libraries
+ *  and utilities.  For details, see https://savannah.gnu.org/projects/freeipmi/.
+ *
+ *  Ipmiconsole is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 3 of the License, or (at your
+ *  option) any later version.
+ *
+ *  Ipmiconsole is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Ipmiconsole.  If not, see <http://www.gnu.org/licenses/>.
+\*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#if STDC_HEADERS
+#include <string.h>
+#endif /* STDC_HEADERS */
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+#include <sys/poll.h>
+#if HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif /* HAVE_SYS_EPOLL_H */
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif /* HAVE_FCNTL_H */
+#include <time.h>
+#include <signal.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <ipmiconsole.h>        /* lib ipmiconsole.h */
+#include "ipmiconsole_.h"       /* tool ipmiconsole.h */
+#include "ipmiconsole-log.h"
+
+#include "freeipmi-portability.h"
+#include "fi_hostlist.h"
+
+#define IPMICONSOLE_LOG_BUFLEN          4096
+
+#define IPMICONSOLE_LOG_MESSAGE_LEN     1024
+
+#define IPMICONSOLE_LOG_TIMESTAMP_LEN   64
+
+/* in seconds */
+#define IPMICONSOLE_LOG_RECONNECT_DELAY 30
+
+/* in seconds, how long to wait before reopening a log that could
+ * not be opened after a rotation
+ */
+#define IPMICONSOLE_LOG_REOPEN_DELAY    30
+
+/* in milliseconds, how often hosts are checked for reconnects */
+#define IPMICONSOLE_LOG_WAIT_TIMEOUT    1000
+
+struct ipmiconsole_log_host
+{
+  char *hostname;
+  char path[MAXPATHLEN + 1];
+  ipmiconsole_ctx_t c;
+  int fd;
+  int logfd;
+  uint64_t size;
+  int line_start;
+  int established;
+  int write_error;
+  /* set if the host can never be connected to, e.g. bad password */
+  int failed;
+  time_t reconnect;
+  /* console data is dropped until the log can be reopened */
+  time_t reopen;
+};
+
+static volatile sig_atomic_t log_exit = 0;
+
+static void
+_log_signal_handler (int sig)
+{
+  log_exit = 1;
+}
+
+static int
+_log_open (struct ipmiconsole_log_host *h, int truncate)
+{
+  struct stat statbuf;
+  int flags;
+
+  assert (h);
+  assert (h->logfd < 0);
+
+  flags = O_WRONLY | O_CREAT | O_APPEND;
+  if (truncate)
+    flags |= O_TRUNC;
+
+  if ((h->logfd = open (h->path, flags, 0600)) < 0)
+    {
+      fprintf (stderr, "open: %s: %s\n", h->path, strerror (errno));
+      return (-1);
+    }
+
+  if (fstat (h->logfd, &statbuf) < 0)
+    {
+      fprintf (stderr, "fstat: %s: %s\n", h->path, strerror (errno));
+      /* ignore potential error, error path */
+      close (h->logfd);
+      h->logfd = -1;
+      return (-1);
+    }
+
+  h->size = statbuf.st_size;
+  h->line_start = 1;
+  return (0);
+}
+
+/* rotate host.log to host.log.1, host.log.1 to host.log.2, etc.  If
+ * no rotated logs are kept, the log is simply truncated.
+ */
+static int
+_log_rotate (struct ipmiconsole_log_host *h, unsigned int rotate_count)
+{
+  /* room for the rotation suffix */
+  char oldpath[MAXPATHLEN + 16];
+  char newpath[MAXPATHLEN + 16];
+  unsigned int i;
+
+  assert (h);
+  assert (h->logfd >= 0);
+
+  /* ignore potential error, log is reopened below */
+  close (h->logfd);
+  h->logfd = -1;
+  h->size = 0;
+
+  for (i = rotate_count; i > 0; i--)
+    {
+      if (i > 1)
+        snprintf (oldpath, sizeof (oldpath), "%s.%u", h->path, i - 1);
+      else
+        snprintf (oldpath, sizeof (oldpath), "%s", h->path);
+      snprintf (newpath, sizeof (newpath), "%s.%u", h->path, i);
+
+      if (rename (oldpath, newpath) < 0
+          && errno != ENOENT)
+        fprintf (stderr, "rename: %s: %s\n", oldpath, strerror (errno));
+    }
+
+  return (_log_open (h, !rotate_count));
+}
+
+static int
+_log_write (struct ipmiconsole_log_host *h, const char *buf, unsigned int buflen)
+{
+  ssize_t n;
+
+  assert (h);
+  assert (buf);
+
+  if (h->logfd < 0)
+    return (-1);
+
+  while (buflen)
+    {
+      if ((n = write (h->logfd, buf, buflen)) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+
+          /* don't flood stderr if the disk is full */
+          if (!h->write_error)
+            fprintf (stderr, "write: %s: %s\n", h->path, strerror (errno));
+          h->write_error++;
+          return (-1);
+        }
+
+      buf += n;
+      buflen -= n;
+      h->size += n;
+    }
+
+  h->write_error = 0;
+  return (0);
+}
+
+/* write console data, prefixing every line with a timestamp.  Logs
+ * are only rotated at line boundaries so lines are never split
+ * across files.
+ */
+static void
+_log_output (struct ipmiconsole_log_host *h,
+             struct ipmiconsole_arguments *cmd_args,
+             const char *buf,
+             unsigned int buflen)
+{
+  assert (h);
+  assert (cmd_args);
+  assert (buf);
+
+  while (buflen)
+    {
+      const char *eol;
+      unsigned int len;
+
+      if (h->line_start)
+        {
+          char timestamp[IPMICONSOLE_LOG_TIMESTAMP_LEN];
+          struct tm tm;
+          time_t t;
+
+          if (h->logfd < 0)
+            {
+              if (time (NULL) < h->reopen)
+                return;
+
+              if (_log_open (h, 0) < 0)
+                {
+                  h->reopen = time (NULL) + IPMICONSOLE_LOG_REOPEN_DELAY;
+                  return;
+                }
+            }
+          else if (cmd_args->log_max_size
+                   && h->size >= cmd_args->log_max_size)
+            {
+              if (_log_rotate (h, cmd_args->log_rotate_count) < 0)
+                {
+                  h->reopen = time (NULL) + IPMICONSOLE_LOG_REOPEN_DELAY;
+                  return;
+                }
+            }
+
+          t = time (NULL);
+          localtime_r (&t, &tm);
+          len = strftime (timestamp,
+                          IPMICONSOLE_LOG_TIMESTAMP_LEN,
+                          "[%Y-%m-%d %H:%M:%S] ",
+                          &tm);
+          _log_write (h, timestamp, len);
+          h->line_start = 0;
+        }
+
+      if ((eol = memchr (buf, '\n', buflen)))
+        {
+          len = eol - buf + 1;
+          h->line_start = 1;
+        }
+      else
+        len = buflen;
+
+      _log_write (h, buf, len);
+      buf += len;
+      buflen -= len;
+    }
+}
+
+/* messages from ipmiconsole itself are always on their own line */
+static void
+_log_message (struct ipmiconsole_log_host *h,
+              struct ipmiconsole_arguments *cmd_args,
+              const char *fmt,
+              ...)
+{
+  char buf[IPMICONSOLE_LOG_MESSAGE_LEN];
+  va_list ap;
+  int len;
+
+  assert (h);
+  assert (cmd_args);
+  assert (fmt);
+
+  if (!h->line_start)
+    _log_output (h, cmd_args, "\n", 1);
+
+  va_start (ap, fmt);
+  len = vsnprintf (buf, IPMICONSOLE_LOG_MESSAGE_LEN - 1, fmt, ap);
+  va_end (ap);
+
+  if (len < 0)
+    return;
+  if (len > IPMICONSOLE_LOG_MESSAGE_LEN - 2)
+    len = IPMICONSOLE_LOG_MESSAGE_LEN - 2;
+  buf[len++] = '\n';
+
+  _log_output (h, cmd_args, buf, len);
+}
+
+/* errors that will not go away by trying again later */
+static int
+_log_error_permanent (int errnum)
+{
+  return (errnum == IPMICONSOLE_ERR_IPMI_2_0_UNAVAILABLE
+          || errnum == IPMICONSOLE_ERR_CIPHER_SUITE_ID_UNAVAILABLE
+          || errnum == IPMICONSOLE_ERR_HOSTNAME_INVALID
+          || errnum == IPMICONSOLE_ERR_USERNAME_INVALID
+          || errnum == IPMICONSOLE_ERR_PASSWORD_INVALID
+          || errnum == IPMICONSOLE_ERR_K_G_INVALID
+          || errnum == IPMICONSOLE_ERR_PRIVILEGE_LEVEL_INSUFFICIENT
+          || errnum == IPMICONSOLE_ERR_PRIVILEGE_LEVEL_CANNOT_BE_OBTAINED
+          || errnum == IPMICONSOLE_ERR_SOL_UNAVAILABLE
+          || errnum == IPMICONSOLE_ERR_SOL_REQUIRES_ENCRYPTION
+          || errnum == IPMICONSOLE_ERR_SOL_REQUIRES_NO_ENCRYPTION);
+}
+
+static void
+_log_fail (struct ipmiconsole_log_host *h,
+           struct ipmiconsole_arguments *cmd_args,
+           int errnum,
+           const char *errormsg)
+{
+  assert (h);
+  assert (cmd_args);
+  assert (errormsg);
+
+  if (errnum == IPMICONSOLE_ERR_SOL_STOLEN)
+    _log_message (h, cmd_args, "[%s]", errormsg);
+  else if (errnum != IPMICONSOLE_ERR_SUCCESS)
+    _log_message (h, cmd_args, "[error received]: %s", errormsg);
+  else
+    _log_message (h, cmd_args, "[closing the connection]");
+
+  if (_log_error_permanent (errnum))
+    {
+      fprintf (stderr, "%s: %s\n", h->hostname, errormsg);
+      h->failed++;
+    }
+  else
+    h->reconnect = time (NULL) + IPMICONSOLE_LOG_RECONNECT_DELAY;
+}
+
+static void
+_log_disconnect (struct ipmiconsole_log_host *h, int efd)
+{
+  assert (h);
+
+  if (h->fd >= 0)
+    {
+#if HAVE_SYS_EPOLL_H
+      /* ignore potential error, cleanup path */
+      epoll_ctl (efd, EPOLL_CTL_DEL, h->fd, NULL);
+#endif /* HAVE_SYS_EPOLL_H */
+      /* ignore potential error, cleanup path.  The engine never
+       * closes this fd, IPMICONSOLE_ENGINE_CLOSE_FD is cleared in
+       * ipmiconsole_log().
+       */
+      close (h->fd);
+      h->fd = -1;
+    }
+
+  ipmiconsole_ctx_destroy (h->c);
+  h->c = NULL;
+  h->established = 0;
+}
+
+static void
+_log_connect (struct ipmiconsole_log_host *h,
+              int efd,
+              struct ipmiconsole_arguments *cmd_args,
+              struct ipmiconsole_ipmi_config *ipmi_config,
+              struct ipmiconsole_protocol_config *protocol_config,
+              struct ipmiconsole_engine_config *engine_config)
+{
+  assert (h);
+  assert (!h->c);
+  assert (cmd_args);
+  assert (ipmi_config);
+  assert (protocol_config);
+  assert (engine_config);
+
+  if (!(h->c = ipmiconsole_ctx_create (h->hostname,
+                                       ipmi_config,
+                                       protocol_config,
+                                       engine_config)))
+    {
+      fprintf (stderr, "ipmiconsole_ctx_create: %s: %s\n",
+               h->hostname, strerror (errno));
+      h->reconnect = time (NULL) + IPMICONSOLE_LOG_RECONNECT_DELAY;
+      return;
+    }
+
+  if (cmd_args->sol_payload_instance)
+    {
+      if (ipmiconsole_ctx_set_config (h->c,
+                                      IPMICONSOLE_CTX_CONFIG_OPTION_SOL_PAYLOAD_INSTANCE,
+                                      &(cmd_args->sol_payload_instance)) < 0)
+        goto fail;
+    }
+
+  if (ipmiconsole_engine_submit (h->c, NULL, NULL) < 0)
+    goto fail;
+
+  if ((h->fd = ipmiconsole_ctx_fd (h->c)) < 0)
+    goto fail;
+
+#if HAVE_SYS_EPOLL_H
+  {
+    struct epoll_event ev;
+
+    memset (&ev, '\0', sizeof (struct epoll_event));
+    ev.events = EPOLLIN;
+    ev.data.ptr = h;
+    if (epoll_ctl (efd, EPOLL_CTL_ADD, h->fd, &ev) < 0)
+      {
+        fprintf (stderr, "epoll_ctl: %s\n", strerror (errno));
+        _log_disconnect (h, efd);
+        h->reconnect = time (NULL) + IPMICONSOLE_LOG_RECONNECT_DELAY;
+      }
+  }
+#endif /* HAVE_SYS_EPOLL_H */
+  return;
+
+ fail:
+  _log_fail (h, cmd_args, ipmiconsole_ctx_errnum (h->c), ipmiconsole_ctx_errormsg (h->c));
+  _log_disconnect (h, efd);
+}
+
+static void
+_log_read (struct ipmiconsole_log_host *h,
+           int efd,
+           struct ipmiconsole_arguments *cmd_args)
+{
+  char buf[IPMICONSOLE_LOG_BUFLEN];
+  ssize_t n;
+
+  assert (h);
+  assert (h->c);
+  assert (h->fd >= 0);
+  assert (cmd_args);
+
+  if ((n = read (h->fd, buf, IPMICONSOLE_LOG_BUFLEN)) < 0)
+    {
+      if (errno == EINTR || errno == EAGAIN)
+        return;
+      fprintf (stderr, "read: %s: %s\n", h->hostname, strerror (errno));
+      _log_fail (h, cmd_args, IPMICONSOLE_ERR_SUCCESS, "");
+      _log_disconnect (h, efd);
+      return;
+    }
+
+  if (n)
+    {
+      _log_output (h, cmd_args, buf, n);
+      return;
+    }
+
+  _log_fail (h, cmd_args, ipmiconsole_ctx_errnum (h->c), ipmiconsole_ctx_errormsg (h->c));
+  _log_disconnect (h, efd);
+}
+
+int
+ipmiconsole_log (struct ipmiconsole_arguments *cmd_args,
+                 struct ipmiconsole_ipmi_config *ipmi_config,
+                 struct ipmiconsole_protocol_config *protocol_config,
+                 struct ipmiconsole_engine_config *engine_config)
+{
+  struct ipmiconsole_log_host *hosts = NULL;
+  fi_hostlist_t hl = NULL;
+  fi_hostlist_iterator_t hitr = NULL;
+  struct sigaction sa;
+  unsigned int hosts_count = 0;
+  unsigned int i;
+  char *host;
+  int rv = EXIT_FAILURE;
+  int efd = -1;
+#if HAVE_SYS_EPOLL_H
+  struct epoll_event *events = NULL;
+#else /* !HAVE_SYS_EPOLL_H */
+  struct pollfd *pfds = NULL;
+  struct ipmiconsole_log_host **pfds_hosts = NULL;
+#endif /* !HAVE_SYS_EPOLL_H */
+
+  assert (cmd_args);
+  assert (cmd_args->log_dir);
+  assert (ipmi_config);
+  assert (protocol_config);
+  assert (engine_config);
+
+  if (!(hl = fi_hostlist_create (cmd_args->common_args.hostname)))
+    {
+      fprintf (stderr, "fi_hostlist_create: %s\n", cmd_args->common_args.hostname);
+      goto cleanup;
+    }
+
+  /* the fd is closed by _log_disconnect(), the engine must not close
+   * it too or a reused fd number could be closed
+   */
+  engine_config->engine_flags &= ~IPMICONSOLE_ENGINE_CLOSE_FD;
+
+  /* two contexts must never log to the same file */
+  fi_hostlist_uniq (hl);
+
+  if (!(hosts = (struct ipmiconsole_log_host *)calloc (fi_hostlist_count (hl),
+                                                       sizeof (struct ipmiconsole_log_host))))
+    {
+      perror ("calloc");
+      goto cleanup;
+    }
+
+  if (!(hitr = fi_hostlist_iterator_create (hl)))
+    {
+      perror ("fi_hostlist_iterator_create");
+      goto cleanup;
+    }
+
+  while ((host = fi_hostlist_next (hitr)))
+    {
+      struct ipmiconsole_log_host *h = &hosts[hosts_count++];
+
+      h->hostname = host;
+      h->fd = -1;
+      h->logfd = -1;
+
+      if (snprintf (h->path,
+                    MAXPATHLEN,
+                    "%s/%s.log",
+                    cmd_args->log_dir,
+                    h->hostname) >= MAXPATHLEN)
+        {
+          fprintf (stderr, "log path too long: %s\n", h->hostname);
+          goto cleanup;
+        }
+
+      /* fail early on a bad log directory rather than once per host */
+      if (_log_open (h, 0) < 0)
+        goto cleanup;
+    }
+
+#if HAVE_SYS_EPOLL_H
+  if ((efd = epoll_create (hosts_count)) < 0)
+    {
+      perror ("epoll_create");
+      goto cleanup;
+    }
+
+  if (!(events = (struct epoll_event *)calloc (hosts_count, sizeof (struct epoll_event))))
+    {
+      perror ("calloc");
+      goto cleanup;
+    }
+#else /* !HAVE_SYS_EPOLL_H */
+  if (!(pfds = (struct pollfd *)calloc (hosts_count, sizeof (struct pollfd))))
+    {
+      perror ("calloc");
+      goto cleanup;
+    }
+
+  if (!(pfds_hosts = (struct ipmiconsole_log_host **)calloc (hosts_count, sizeof (struct ipmiconsole_log_host *))))
+    {
+      perror ("calloc");
+      goto cleanup;
+    }
+#endif /* !HAVE_SYS_EPOLL_H */
+
+  /* no SA_RESTART, so a signal interrupts the wait below */
+  memset (&sa, '\0', sizeof (struct sigaction));
+  sa.sa_handler = _log_signal_handler;
+  sigemptyset (&sa.sa_mask);
+  if (sigaction (SIGINT, &sa, NULL) < 0
+      || sigaction (SIGTERM, &sa, NULL) < 0)
+    {
+      perror ("sigaction");
+      goto cleanup;
+    }
+
+  while (!log_exit)
+    {
+      unsigned int active = 0;
+      time_t now;
+      int n;
+
+      now = time (NULL);
+
+      for (i = 0; i < hosts_count; i++)
+        {
+          struct ipmiconsole_log_host *h = &hosts[i];
+
+          if (h->failed)
+            continue;
+          active++;
+
+          if (!h->c)
+            {
+              if (h->reconnect <= now)
+                _log_connect (h,
+                              efd,
+                              cmd_args,
+                              ipmi_config,
+                              protocol_config,
+                              engine_config);
+            }
+          else if (!h->established
+                   && ipmiconsole_ctx_status (h->c) == IPMICONSOLE_CTX_STATUS_SOL_ESTABLISHED)
+            {
+              _log_message (h, cmd_args, "[SOL established]");
+              h->established++;
+            }
+        }
+
+      if (!active)
+        {
+          fprintf (stderr, "no consoles left to log\n");
+          goto cleanup;
+        }
+
+#if HAVE_SYS_EPOLL_H
+      if ((n = epoll_wait (efd, events, hosts_count, IPMICONSOLE_LOG_WAIT_TIMEOUT)) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          perror ("epoll_wait");
+          goto cleanup;
+        }
+
+      for (i = 0; i < (unsigned int)n; i++)
+        {
+          struct ipmiconsole_log_host *h = events[i].data.ptr;
+
+          /* EOF or error is detected via read() */
+          if (h->fd >= 0)
+            _log_read (h, efd, cmd_args);
+        }
+#else /* !HAVE_SYS_EPOLL_H */
+      {
+        unsigned int nfds = 0;
+
+        for (i = 0; i < hosts_count; i++)
+          {
+            if (hosts[i].fd < 0)
+              continue;
+            pfds[nfds].fd = hosts[i].fd;
+            pfds[nfds].events = POLLIN;
+            pfds[nfds].revents = 0;
+            pfds_hosts[nfds] = &hosts[i];
+            nfds++;
+          }
+
+        if ((n = poll (pfds, nfds, IPMICONSOLE_LOG_WAIT_TIMEOUT)) < 0)
+          {
+            if (errno == EINTR)
+              continue;
+            perror ("poll");
+            goto cleanup;
+          }
+
+        for (i = 0; n && i < nfds; i++)
+          {
+            /* EOF or error is detected via read() */
+            if (pfds[i].revents)
+              _log_read (pfds_hosts[i], efd, cmd_args);
+          }
+      }
+#endif /* !HAVE_SYS_EPOLL_H */
+    }
+
+  rv = EXIT_SUCCESS;
+ cleanup:
+  if (hosts)
+    {
+      for (i = 0; i < hosts_count; i++)
+        {
+          if (hosts[i].c)
+            {
+              _log_message (&hosts[i], cmd_args, "[closing the connection]");
+              _log_disconnect (&hosts[i], efd);
+            }
+          if (hosts[i].logfd >= 0)
+            /* ignore potential error, cleanup path */
+            close (hosts[i].logfd);
+          free (hosts[i].hostname);
+        }
+      free (hosts);
+    }
+#if HAVE_SYS_EPOLL_H
+  free (events);
+  if (efd >= 0)
+    /* ignore potential error, cleanup path */
+    close (efd);
+#else /* !HAVE_SYS_EPOLL_H */
+  free (pfds);
+  free (pfds_hosts);
+#endif /* !HAVE_SYS_EPOLL_H */
+  if (hitr)
+    fi_hostlist_iterator_destroy (hitr);
+  if (hl)
+    fi_hostlist_destroy (hl);
+  return (rv);
+}
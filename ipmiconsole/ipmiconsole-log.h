@@ -0,0 +1,43 @@
+/*****************************************************************************\
+ *****************************************************************************
+ *  Copyright (C) 2007-2015 Lawrence Livermore National Security, LLC.
+ *  Copyright (C) 2006-2007 The Regents of the University of California.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  Written by Albert Chu <chu11@llnl.gov>
+ *  UCRL-CODE-221226
+ *
+ *  This file is part of Ipmiconsole, a set of IPMI 2.0 SOL libraries
+ *  and utilities.  For details, see https://savannah.gnu.org/projects/freeipmi/.
+ *
+ *  Ipmiconsole is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 3 of the License, or (at your
+ *  option) any later version.
+ *
+ *  Ipmiconsole is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Ipmiconsole.  If not, see <http://www.gnu.org/licenses/>.
+\*****************************************************************************/
+
+#ifndef IPMICONSOLE_LOG_H
+#define IPMICONSOLE_LOG_H
+
+#include <ipmiconsole.h>        /* lib ipmiconsole.h */
+#include "ipmiconsole_.h"       /* tool ipmiconsole.h */
+
+/* Log the console of every host in the configured hostrange to its
+ * own file in the configured log directory until interrupted.  The
+ * engine must already be initialized.
+ *
+ * Returns EXIT_SUCCESS or EXIT_FAILURE.
+ */
+int ipmiconsole_log (struct ipmiconsole_arguments *cmd_args,
+                     struct ipmiconsole_ipmi_config *ipmi_config,
+                     struct ipmiconsole_protocol_config *protocol_config,
+                     struct ipmiconsole_engine_config *engine_config);
+
+#endif /* IPMICONSOLE_LOG_H */
@@ -58,6 +58,7 @@
 #include <ipmiconsole.h>        /* lib ipmiconsole.h */
 #include "ipmiconsole_.h"       /* tool ipmiconsole.h */
 #include "ipmiconsole-argp.h"
+#include "ipmiconsole-log.h"
 
 #include "freeipmi-portability.h"
 
@@ -279,7 +280,9 @@ main (int argc, char **argv)
       exit (EXIT_FAILURE);
     }
 
-  if (ipmiconsole_engine_init (1, debug_flags) < 0)
+  /* when logging, 0 lets the library pick its default thread count */
+  if (ipmiconsole_engine_init (cmd_args.log_dir ? cmd_args.log_threads : 1,
+                               debug_flags) < 0)
     {
       perror ("ipmiconsole_setup");
       exit (EXIT_FAILURE);
@@ -351,6 +354,12 @@ main (int argc, char **argv)
     engine_config.engine_flags |= IPMICONSOLE_ENGINE_SERIAL_KEEPALIVE_EMPTY;
   if (cmd_args.lock_memory)
     engine_config.engine_flags |= IPMICONSOLE_ENGINE_LOCK_MEMORY;
+  if (cmd_args.adaptive_retransmission)
+    engine_config.engine_flags |= IPMICONSOLE_ENGINE_ADAPTIVE_RETRANSMISSION;
+  if (cmd_args.coalesce_input)
+    engine_config.engine_flags |= IPMICONSOLE_ENGINE_COALESCE_INPUT;
+  if (cmd_args.throughput)
+    engine_config.engine_flags |= IPMICONSOLE_ENGINE_THROUGHPUT;
 
   engine_config.behavior_flags = 0;
   if (cmd_args.dont_steal)
@@ -361,6 +370,18 @@ main (int argc, char **argv)
     engine_config.behavior_flags |= IPMICONSOLE_BEHAVIOR_DEACTIVATE_ALL_INSTANCES;
   engine_config.debug_flags = debug_flags;
 
+  if (cmd_args.log_dir)
+    {
+      int rv;
+
+      rv = ipmiconsole_log (&cmd_args,
+                            &ipmi_config,
+                            &protocol_config,
+                            &engine_config);
+      ipmiconsole_engine_teardown (1);
+      return (rv);
+    }
+
   if (!(c = ipmiconsole_ctx_create (cmd_args.common_args.hostname,
                                     &ipmi_config,
                                     &protocol_config,
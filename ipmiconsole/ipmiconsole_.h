@@ -52,8 +52,18 @@ enum ipmiconsole_argp_option_keys
     DEBUG_KEY = 167,
     DEBUGFILE_KEY = 168,
     NORAW_KEY = 169,
+    ADAPTIVE_RETRANSMISSION_KEY = 170,
+    COALESCE_INPUT_KEY = 171,
+    THROUGHPUT_KEY = 172,
+    LOG_DIR_KEY = 173,
+    LOG_THREADS_KEY = 174,
+    LOG_MAX_SIZE_KEY = 175,
+    LOG_ROTATE_COUNT_KEY = 176,
   };
 
+#define IPMICONSOLE_LOG_ROTATE_COUNT_DEFAULT 4
+#define IPMICONSOLE_LOG_ROTATE_COUNT_MAX     99
+
 struct ipmiconsole_arguments
 {
   struct common_cmd_args common_args;
@@ -65,6 +75,13 @@ struct ipmiconsole_arguments
   unsigned int sol_payload_instance;
   int deactivate_all_instances;
   int lock_memory;
+  int adaptive_retransmission;
+  int coalesce_input;
+  int throughput;
+  char *log_dir;
+  unsigned int log_threads;
+  unsigned int log_max_size;
+  unsigned int log_rotate_count;
 #ifndef NDEBUG
   int debugfile;
   int noraw;
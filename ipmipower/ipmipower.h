@@ -68,6 +68,26 @@
 
 #define IPMIPOWER_OUTPUT_BUFLEN                          65536
 
+#define IPMIPOWER_JSON_STRING_BUFLEN                     1024
+
+/* lower bound on the retransmission timeout when
+ * --adaptive-retransmission is used, in milliseconds
+ */
+#define IPMIPOWER_ADAPTIVE_RETRANSMISSION_TIMEOUT_MIN    50
+
+/* maximum for --session-rate and --power-on-rate, per second */
+#define IPMIPOWER_RATE_MAX                               1000
+
+/* when --power-on-rate is used, how far ahead of its scheduled power
+ * on a session may be started, in milliseconds
+ */
+#define IPMIPOWER_POWER_ON_LOOKAHEAD                     2000
+
+/* upper bound on the multiplier applied to the retransmission wait
+ * timeout as a host is repeatedly polled with --wait-until-on/off
+ */
+#define IPMIPOWER_WAIT_UNTIL_BACKOFF_MAX                 8
+
 #define IPMI_MAX_SIK_KEY_LENGTH                          64
 
 #define IPMI_MAX_INTEGRITY_KEY_LENGTH                    64
@@ -317,16 +337,17 @@ typedef enum
     IPMIPOWER_MSG_TYPE_INVALID_ARGUMENT_FOR_OEM_EXTENSION = 21,
     IPMIPOWER_MSG_TYPE_BMC_BUSY                           = 22,
     IPMIPOWER_MSG_TYPE_BMC_ERROR                          = 23,
+    IPMIPOWER_MSG_TYPE_WAIT_UNTIL_TIMEOUT                 = 24,
   } ipmipower_msg_type_t;
 
 #define IPMIPOWER_MSG_TYPE_VALID(__m)         \
   ((__m) >= IPMIPOWER_MSG_TYPE_ON             \
-   && (__m) <= IPMIPOWER_MSG_TYPE_BMC_ERROR)
+   && (__m) <= IPMIPOWER_MSG_TYPE_WAIT_UNTIL_TIMEOUT)
 
 #define IPMIPOWER_MSG_TYPE_ERROR_MIN IPMIPOWER_MSG_TYPE_UNKNOWN
-#define IPMIPOWER_MSG_TYPE_ERROR_MAX IPMIPOWER_MSG_TYPE_BMC_ERROR
+#define IPMIPOWER_MSG_TYPE_ERROR_MAX IPMIPOWER_MSG_TYPE_WAIT_UNTIL_TIMEOUT
 
-#define IPMIPOWER_MSG_TYPE_NUM_ENTRIES (IPMIPOWER_MSG_TYPE_BMC_ERROR + 1)
+#define IPMIPOWER_MSG_TYPE_NUM_ENTRIES (IPMIPOWER_MSG_TYPE_WAIT_UNTIL_TIMEOUT + 1)
 
 /* ipmipower_powercmd
  * - Stores all information needed to execute a power command
@@ -339,7 +360,9 @@ struct ipmipower_powercmd {
    * Protocol State Machine Variables
    */
   struct timeval time_begin;
+  struct timeval time_session_established;
   unsigned int retransmission_count;
+  unsigned int total_retransmission_count;
   uint8_t close_timeout;
 
   /*
@@ -376,6 +399,13 @@ struct ipmipower_powercmd {
   /* Ipmipower variables */
   int wait_until_on_state;
   int wait_until_off_state;
+  struct timeval wait_until_begin;
+  unsigned int wait_until_poll_count;
+
+  /* for power on rate limiting */
+  struct ipmipower_power_on_group *power_on_group;
+  struct timeval power_on_slot;
+  int chassis_control_delayed;
 
   struct ipmipower_connection *ic;
 
@@ -453,6 +483,14 @@ struct ipmipower_connection
   struct timeval last_ipmi_recv;
   struct timeval last_ping_recv;
 
+  /* for adaptive retransmission option, round trip time estimates
+   * per RFC 6298, all in milliseconds
+   */
+  unsigned int srtt;
+  unsigned int rttvar;
+  unsigned int rto;
+  unsigned int rtt_sample_count;
+
   ipmipower_link_state_t link_state;
   unsigned int ping_last_packet_recv_flag;
   unsigned int ping_packet_count_send;
@@ -502,6 +540,13 @@ enum ipmipower_argp_option_keys
     PING_PACKET_COUNT_KEY = 174,
     PING_PERCENT_KEY = 175,
     PING_CONSEC_COUNT_KEY = 176,
+    ADAPTIVE_RETRANSMISSION_KEY = 177,
+    SESSION_RATE_KEY = 178,
+    POWER_ON_RATE_KEY = 179,
+    POWER_ON_GROUP_DELIMITER_KEY = 180,
+    WAIT_UNTIL_KEY = 181,
+    WAIT_UNTIL_TIMEOUT_KEY = 182,
+    JSON_OUTPUT_KEY = 183,
   };
 
 struct ipmipower_arguments
@@ -515,15 +560,22 @@ struct ipmipower_arguments
   int on_if_off;
   int wait_until_on;
   int wait_until_off;
+  int wait_until_report;
+  unsigned int wait_until_timeout;
   oem_power_type_t oem_power_type;
 
   unsigned int retransmission_wait_timeout;
   unsigned int retransmission_backoff_count;
+  int adaptive_retransmission;
+  unsigned int session_rate;
+  unsigned int power_on_rate;
+  char power_on_group_delimiter;
   unsigned int ping_interval;
   unsigned int ping_timeout;
   unsigned int ping_packet_count;
   unsigned int ping_percent;
   unsigned int ping_consec_count;
+  int json_output;
 };
 
 #endif /* IPMIPOWER_H */
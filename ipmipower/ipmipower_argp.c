@@ -100,12 +100,26 @@ static struct argp_option cmdline_options[] =
       "Regularly query the remote BMC and return only after the machine has powered off.", 49},
     { "wait-until-on", WAIT_UNTIL_ON_KEY, 0, 0,
       "Regularly query the remote BMC and return only after the machine has powered on.", 50},
+    { "wait-until", WAIT_UNTIL_KEY, "STATE", 0,
+      "Like --wait-until-on or --wait-until-off, but also output the time each machine took to reach STATE.", 50},
+    { "wait-until-timeout", WAIT_UNTIL_TIMEOUT_KEY, "MILLISECONDS", 0,
+      "Specify how long to wait for machines to reach the requested power state in milliseconds.", 50},
     { "oem-power-type", OEM_POWER_TYPE_KEY, "OEM-POWER-TYPE", 0,
       "Specify an OEM power type to be used.", 51},
+    { "json-output", JSON_OUTPUT_KEY, 0, 0,
+      "Output results as JSON lines, including per host timing information.", 51},
     { "retransmission-wait-timeout", RETRANSMISSION_WAIT_TIMEOUT_KEY, "MILLISECONDS", 0,
       "Specify the retransmission timeout length in milliseconds.", 52},
     { "retransmission-backoff-count", RETRANSMISSION_BACKOFF_COUNT_KEY, "COUNT", 0,
       "Specify the retransmission backoff count for retransmissions.", 53},
+    { "adaptive-retransmission", ADAPTIVE_RETRANSMISSION_KEY, 0, 0,
+      "Adjust retransmission timeouts to each BMC's measured round trip time.", 53},
+    { "session-rate", SESSION_RATE_KEY, "COUNT", 0,
+      "Specify the maximum number of sessions started per second.", 53},
+    { "power-on-rate", POWER_ON_RATE_KEY, "COUNT", 0,
+      "Specify the maximum number of power on commands per second for each group of hosts.", 53},
+    { "power-on-group-delimiter", POWER_ON_GROUP_DELIMITER_KEY, "CHAR", 0,
+      "Group hosts for --power-on-rate by the part of their hostname before CHAR.", 53},
     { "ping-interval", PING_INTERVAL_KEY, "MILLISECONDS", 0,
       "Specify the ping interval length in milliseconds.", 54},
     { "ping-timeout", PING_TIMEOUT_KEY, "MILLISECONDS", 0,
@@ -148,6 +162,23 @@ void _parse_oem_power_type (struct ipmipower_arguments *cmd_args, const char *oe
     cmd_args->oem_power_type = IPMIPOWER_OEM_POWER_TYPE_INVALID;
 }
 
+void _parse_wait_until (struct ipmipower_arguments *cmd_args, const char *wait_until_str)
+{
+  assert (cmd_args);
+  assert (wait_until_str);
+
+  if (!strcasecmp (wait_until_str, "on"))
+    cmd_args->wait_until_on = 1;
+  else if (!strcasecmp (wait_until_str, "off"))
+    cmd_args->wait_until_off = 1;
+  else
+    {
+      fprintf (stderr, "invalid wait until state\n");
+      exit (EXIT_FAILURE);
+    }
+  cmd_args->wait_until_report = 1;
+}
+
 static error_t
 cmdline_parse (int key,
                char *arg,
@@ -198,9 +229,27 @@ cmdline_parse (int key,
     case WAIT_UNTIL_OFF_KEY:       /* --wait-until-off */
       cmd_args->wait_until_off++;
       break;
+    case WAIT_UNTIL_KEY:       /* --wait-until */
+      _parse_wait_until (cmd_args, arg);
+      break;
+    case WAIT_UNTIL_TIMEOUT_KEY:       /* --wait-until-timeout */
+      errno = 0;
+      tmp = strtol (arg, &endptr, 10);
+      if (errno
+          || endptr[0] != '\0'
+          || tmp < 0)
+        {
+          fprintf (stderr, "wait until timeout length invalid");
+          exit (EXIT_FAILURE);
+        }
+      cmd_args->wait_until_timeout = tmp;
+      break;
     case OEM_POWER_TYPE_KEY:
       _parse_oem_power_type (cmd_args, arg);
       break;
+    case JSON_OUTPUT_KEY:       /* --json-output */
+      cmd_args->json_output++;
+      break;
     case RETRANSMISSION_WAIT_TIMEOUT_KEY:       /* --retransmission-wait-timeout */
       errno = 0;
       tmp = strtol (arg, &endptr, 10);
@@ -225,6 +274,43 @@ cmdline_parse (int key,
         }
       cmd_args->retransmission_backoff_count = tmp;
       break;
+    case ADAPTIVE_RETRANSMISSION_KEY:       /* --adaptive-retransmission */
+      cmd_args->adaptive_retransmission++;
+      break;
+    case SESSION_RATE_KEY:       /* --session-rate */
+      errno = 0;
+      tmp = strtol (arg, &endptr, 10);
+      if (errno
+          || endptr[0] != '\0'
+          || tmp < 0
+          || tmp > IPMIPOWER_RATE_MAX)
+        {
+          fprintf (stderr, "session rate invalid");
+          exit (EXIT_FAILURE);
+        }
+      cmd_args->session_rate = tmp;
+      break;
+    case POWER_ON_RATE_KEY:       /* --power-on-rate */
+      errno = 0;
+      tmp = strtol (arg, &endptr, 10);
+      if (errno
+          || endptr[0] != '\0'
+          || tmp < 0
+          || tmp > IPMIPOWER_RATE_MAX)
+        {
+          fprintf (stderr, "power on rate invalid");
+          exit (EXIT_FAILURE);
+        }
+      cmd_args->power_on_rate = tmp;
+      break;
+    case POWER_ON_GROUP_DELIMITER_KEY:       /* --power-on-group-delimiter */
+      if (strlen (arg) != 1)
+        {
+          fprintf (stderr, "power on group delimiter invalid");
+          exit (EXIT_FAILURE);
+        }
+      cmd_args->power_on_group_delimiter = arg[0];
+      break;
     case PING_INTERVAL_KEY:       /* --ping-interval */
       errno = 0;
       tmp = strtol (arg, &endptr, 10);
@@ -320,13 +406,27 @@ _ipmipower_config_file_parse (struct ipmipower_arguments *cmd_args)
     cmd_args->wait_until_on = config_file_data.wait_until_on;
   if (config_file_data.wait_until_off_count)
     cmd_args->wait_until_off = config_file_data.wait_until_off;
+  if (config_file_data.wait_until_str_count)
+    _parse_wait_until (cmd_args, config_file_data.wait_until_str);
+  if (config_file_data.wait_until_timeout_count)
+    cmd_args->wait_until_timeout = config_file_data.wait_until_timeout;
   /* See comments in config file parsing */
   if (config_file_data.oem_power_type_str_count)
     _parse_oem_power_type (cmd_args, config_file_data.oem_power_type_str);
+  if (config_file_data.json_output_count)
+    cmd_args->json_output = config_file_data.json_output;
   if (config_file_data.retransmission_wait_timeout_count)
     cmd_args->retransmission_wait_timeout = config_file_data.retransmission_wait_timeout;
   if (config_file_data.retransmission_backoff_count_count)
     cmd_args->retransmission_backoff_count = config_file_data.retransmission_backoff_count;
+  if (config_file_data.adaptive_retransmission_count)
+    cmd_args->adaptive_retransmission = config_file_data.adaptive_retransmission;
+  if (config_file_data.session_rate_count)
+    cmd_args->session_rate = config_file_data.session_rate;
+  if (config_file_data.power_on_rate_count)
+    cmd_args->power_on_rate = config_file_data.power_on_rate;
+  if (config_file_data.power_on_group_delimiter_count)
+    cmd_args->power_on_group_delimiter = config_file_data.power_on_group_delimiter;
   if (config_file_data.ping_interval_count)
     cmd_args->ping_interval = config_file_data.ping_interval;
   if (config_file_data.ping_timeout_count)
@@ -356,6 +456,25 @@ _ipmipower_args_validate (struct ipmipower_arguments *cmd_args)
       exit (EXIT_FAILURE);
     }
 
+  if (cmd_args->wait_until_timeout
+      && cmd_args->wait_until_timeout < cmd_args->retransmission_wait_timeout)
+    {
+      fprintf (stderr, "wait until timeout smaller than retransmission wait timeout\n");
+      exit (EXIT_FAILURE);
+    }
+
+  if (cmd_args->session_rate > IPMIPOWER_RATE_MAX)
+    {
+      fprintf (stderr, "session rate larger than %u\n", IPMIPOWER_RATE_MAX);
+      exit (EXIT_FAILURE);
+    }
+
+  if (cmd_args->power_on_rate > IPMIPOWER_RATE_MAX)
+    {
+      fprintf (stderr, "power on rate larger than %u\n", IPMIPOWER_RATE_MAX);
+      exit (EXIT_FAILURE);
+    }
+
   if (cmd_args->powercmd != IPMIPOWER_POWER_CMD_NONE && !cmd_args->common_args.hostname)
     {
       fprintf (stderr, "must specify target hostname(s) in non-interactive mode\n");
@@ -398,14 +517,21 @@ ipmipower_argp_parse (int argc, char **argv, struct ipmipower_arguments *cmd_arg
   cmd_args->on_if_off = 0;
   cmd_args->wait_until_on = 0;
   cmd_args->wait_until_off = 0;
+  cmd_args->wait_until_report = 0;
+  cmd_args->wait_until_timeout = 0;
   cmd_args->oem_power_type = IPMIPOWER_OEM_POWER_TYPE_NONE;
   cmd_args->retransmission_wait_timeout = 500; /* .5 seconds  */
   cmd_args->retransmission_backoff_count = 8;
+  cmd_args->adaptive_retransmission = 0;
+  cmd_args->session_rate = 0;
+  cmd_args->power_on_rate = 0;
+  cmd_args->power_on_group_delimiter = '\0';
   cmd_args->ping_interval = 5000; /* 5 seconds */
   cmd_args->ping_timeout = 30000; /* 30 seconds */
   cmd_args->ping_packet_count = 10;
   cmd_args->ping_percent = 50;
   cmd_args->ping_consec_count = 5;
+  cmd_args->json_output = 0;
 
   argp_parse (&cmdline_config_file_argp,
               argc,
@@ -197,6 +197,11 @@ _connection_setup (struct ipmipower_connection *ic, const char *hostname)
   memset (&ic->last_ipmi_recv, '\0', sizeof (struct timeval));
   memset (&ic->last_ping_recv, '\0', sizeof (struct timeval));
 
+  ic->srtt = 0;
+  ic->rttvar = 0;
+  ic->rto = 0;
+  ic->rtt_sample_count = 0;
+
   ic->link_state = IPMIPOWER_LINK_STATE_GOOD; /* assumed good to begin with */
   ic->ping_last_packet_recv_flag = 0;
   ic->ping_packet_count_send = 0;
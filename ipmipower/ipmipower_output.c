@@ -74,19 +74,119 @@ static char *ipmipower_outputs[] =
     "ipmi 2.0 unavailable",
     "invalid argument for OEM extension",
     "BMC busy",
-    "BMC error"
+    "BMC error",
+    "wait until timeout"
   };
 
+/* _json_escape
+ * - Escape str for output as a JSON string, truncating if necessary
+ */
+static void
+_json_escape (const char *str, char *buf, unsigned int buflen)
+{
+  unsigned int len = 0;
+
+  assert (str);
+  assert (buf);
+  assert (buflen);
+
+  for (; *str; str++)
+    {
+      unsigned char c = *str;
+      char tmp[7];
+
+      if (c == '"' || c == '\\')
+        snprintf (tmp, sizeof (tmp), "\\%c", c);
+      else if (c < 0x20)
+        snprintf (tmp, sizeof (tmp), "\\u%04x", c);
+      else
+        {
+          tmp[0] = c;
+          tmp[1] = '\0';
+        }
+
+      if (len + strlen (tmp) >= buflen)
+        break;
+
+      strcpy (buf + len, tmp);
+      len += strlen (tmp);
+    }
+  buf[len] = '\0';
+}
+
+static void
+_output_json (ipmipower_msg_type_t num,
+              const char *hostname,
+              const char *extra_arg,
+              const struct ipmipower_output_timing *timing,
+              int convergence_time)
+{
+  char hostbuf[IPMIPOWER_JSON_STRING_BUFLEN + 1];
+  char extrabuf[IPMIPOWER_JSON_STRING_BUFLEN + 1];
+  char timebuf[IPMIPOWER_JSON_STRING_BUFLEN + 1];
+  int len = 0;
+
+  assert (IPMIPOWER_MSG_TYPE_VALID (num));
+  assert (hostname);
+
+  _json_escape (hostname, hostbuf, IPMIPOWER_JSON_STRING_BUFLEN + 1);
+  if (extra_arg)
+    _json_escape (extra_arg, extrabuf, IPMIPOWER_JSON_STRING_BUFLEN + 1);
+
+  memset (timebuf, '\0', IPMIPOWER_JSON_STRING_BUFLEN + 1);
+  if (timing)
+    {
+      if (timing->session_established)
+        len += snprintf (timebuf + len,
+                         IPMIPOWER_JSON_STRING_BUFLEN + 1 - len,
+                         ", \"handshake_ms\": %u, \"command_ms\": %u",
+                         timing->handshake_time,
+                         timing->command_time);
+      len += snprintf (timebuf + len,
+                       IPMIPOWER_JSON_STRING_BUFLEN + 1 - len,
+                       ", \"retransmits\": %u",
+                       timing->retransmission_count);
+    }
+  if (convergence_time >= 0)
+    snprintf (timebuf + len,
+              IPMIPOWER_JSON_STRING_BUFLEN + 1 - len,
+              ", \"convergence_ms\": %d",
+              convergence_time);
+
+  ipmipower_cbuf_printf (ttyout,
+                         "{\"host\": \"%s\"%s%s%s, \"result\": \"%s\"%s}\n",
+                         hostbuf,
+                         extra_arg ? ", \"extra_arg\": \"" : "",
+                         extra_arg ? extrabuf : "",
+                         extra_arg ? "\"" : "",
+                         ipmipower_outputs[num],
+                         timebuf);
+}
+
 void
 ipmipower_output (ipmipower_msg_type_t num, const char *hostname, const char *extra_arg)
+{
+  ipmipower_output_timed (num, hostname, extra_arg, NULL);
+}
+
+void
+ipmipower_output_timed (ipmipower_msg_type_t num,
+                        const char *hostname,
+                        const char *extra_arg,
+                        const struct ipmipower_output_timing *timing)
 {
   assert (IPMIPOWER_MSG_TYPE_VALID (num));
   assert (hostname);
 
-  /* If extra argument required, then we can't do consolidated output */
+  /* JSON lines are output as soon as each host completes.
+   *
+   * If extra argument required, then we can't do consolidated output
+   */
 
-  if (cmd_args.common_args.consolidate_output
-      && !IPMIPOWER_OEM_POWER_TYPE_REQUIRES_EXTRA_ARGUMENT (cmd_args.oem_power_type))
+  if (cmd_args.json_output)
+    _output_json (num, hostname, extra_arg, timing, -1);
+  else if (cmd_args.common_args.consolidate_output
+           && !IPMIPOWER_OEM_POWER_TYPE_REQUIRES_EXTRA_ARGUMENT (cmd_args.oem_power_type))
     {
       if (!fi_hostlist_push_host (output_hostrange[num], hostname))
         {
@@ -106,10 +206,44 @@ ipmipower_output (ipmipower_msg_type_t num, const char *hostname, const char *ex
   return;
 }
 
+void
+ipmipower_output_convergence_time (const char *hostname,
+                                   const char *extra_arg,
+                                   const struct ipmipower_output_timing *timing,
+                                   unsigned int convergence_time)
+{
+  assert (hostname);
+
+  /* Consolidated output groups hosts by message, so the per-host
+   * convergence time can't be output.
+   */
+
+  if (cmd_args.json_output)
+    _output_json (IPMIPOWER_MSG_TYPE_OK, hostname, extra_arg, timing, convergence_time);
+  else if (cmd_args.common_args.consolidate_output
+           && !IPMIPOWER_OEM_POWER_TYPE_REQUIRES_EXTRA_ARGUMENT (cmd_args.oem_power_type))
+    {
+      ipmipower_output (IPMIPOWER_MSG_TYPE_OK, hostname, extra_arg);
+      return;
+    }
+  else
+    ipmipower_cbuf_printf (ttyout,
+                           "%s%s%s: %s (%u ms)\n",
+                           hostname,
+                           extra_arg ? "+" : "",
+                           extra_arg ? extra_arg : "",
+                           ipmipower_outputs[IPMIPOWER_MSG_TYPE_OK],
+                           convergence_time);
+
+  output_counts[IPMIPOWER_MSG_TYPE_OK]++;
+  return;
+}
+
 void
 ipmipower_output_finish (void)
 {
-  if (cmd_args.common_args.consolidate_output
+  if (!cmd_args.json_output
+      && cmd_args.common_args.consolidate_output
       && !IPMIPOWER_OEM_POWER_TYPE_REQUIRES_EXTRA_ARGUMENT (cmd_args.oem_power_type))
     {
       int i, rv;
@@ -29,8 +29,37 @@
 
 #include "ipmipower.h"
 
+/* ipmipower_output_timing
+ * - Per host timing information, output with --json-output
+ */
+struct ipmipower_output_timing
+{
+  int session_established;
+  unsigned int handshake_time;
+  unsigned int command_time;
+  unsigned int retransmission_count;
+};
+
 void ipmipower_output (ipmipower_msg_type_t num, const char *hostname, const char *extra_arg);
 
+/* ipmipower_output_timed
+ * - Like ipmipower_output, including timing information when
+ *   --json-output is specified.
+ */
+void ipmipower_output_timed (ipmipower_msg_type_t num,
+                             const char *hostname,
+                             const char *extra_arg,
+                             const struct ipmipower_output_timing *timing);
+
+/* ipmipower_output_convergence_time
+ * - Output "ok" along with the time, in milliseconds, the host took
+ *   to reach the state requested with --wait-until.
+ */
+void ipmipower_output_convergence_time (const char *hostname,
+                                        const char *extra_arg,
+                                        const struct ipmipower_output_timing *timing,
+                                        unsigned int convergence_time);
+
 /* ipmipower_output_finish
  * - Output final results, mostly notably w/ consolidated output.
  */
@@ -82,6 +82,18 @@ static List add_to_pending = NULL;
 /* Count of currently executing power commands for fanout */
 static unsigned int executing_count = 0;
 
+/* Time the next session may be started, for --session-rate */
+static struct timeval next_session_start;
+
+/* Groups of hosts sharing a power on rate limit, for --power-on-rate */
+struct ipmipower_power_on_group
+{
+  char key[FREEIPMI_MAXHOSTNAMELEN+1];
+  struct timeval next_power_on;
+};
+
+static List power_on_groups = NULL;
+
 static int
 _find_ipmipower_powercmd (void *x, void *key)
 {
@@ -97,6 +109,126 @@ _find_ipmipower_powercmd (void *x, void *key)
   return (!strcasecmp (ip->ic->hostname, hostname));
 }
 
+static int
+_find_power_on_group (void *x, void *key)
+{
+  struct ipmipower_power_on_group *group;
+
+  assert (x);
+  assert (key);
+
+  group = (struct ipmipower_power_on_group *)x;
+
+  return (!strcasecmp (group->key, (char *)key));
+}
+
+/* _power_on_group
+ * - Find (or create) the power on group of a host.  Hosts are grouped
+ *   by the portion of their hostname preceding the power on group
+ *   delimiter.  Without a delimiter, all hosts are in one group.
+ */
+static struct ipmipower_power_on_group *
+_power_on_group (const char *hostname)
+{
+  struct ipmipower_power_on_group *group;
+  char key[FREEIPMI_MAXHOSTNAMELEN+1];
+
+  assert (hostname);
+  assert (power_on_groups);
+
+  memset (key, '\0', FREEIPMI_MAXHOSTNAMELEN + 1);
+  if (cmd_args.power_on_group_delimiter)
+    {
+      char *ptr;
+
+      snprintf (key, FREEIPMI_MAXHOSTNAMELEN + 1, "%s", hostname);
+      if ((ptr = strchr (key, cmd_args.power_on_group_delimiter)))
+        *ptr = '\0';
+    }
+
+  if ((group = list_find_first (power_on_groups, _find_power_on_group, key)))
+    return (group);
+
+  if (!(group = (struct ipmipower_power_on_group *)malloc (sizeof (struct ipmipower_power_on_group))))
+    {
+      IPMIPOWER_ERROR (("malloc: %s", strerror (errno)));
+      exit (EXIT_FAILURE);
+    }
+  memcpy (group->key, key, FREEIPMI_MAXHOSTNAMELEN + 1);
+  timeval_clear (&(group->next_power_on));
+
+  if (!list_append (power_on_groups, group))
+    {
+      IPMIPOWER_ERROR (("list_append: %s", strerror (errno)));
+      exit (EXIT_FAILURE);
+    }
+
+  return (group);
+}
+
+/* _rate_limit_wait
+ * - Returns milliseconds until the time 'next' is reached, 0 if
+ *   it has already been reached
+ */
+static unsigned int
+_rate_limit_wait (struct timeval *cur_time, struct timeval *next)
+{
+  struct timeval result;
+  unsigned int ms;
+
+  assert (cur_time);
+  assert (next);
+
+  if (!timeval_gt (next, cur_time))
+    return (0);
+
+  timeval_sub (next, cur_time, &result);
+  timeval_millisecond_calc (&result, &ms);
+
+  /* don't spin on a sub-millisecond wait */
+  return (ms ? ms : 1);
+}
+
+/* _rate_limit_take
+ * - Take the slot at 'next' (or now if that has passed) and schedule
+ *   the following slot 1/rate seconds later.  Unused slots do not
+ *   accumulate, so at most one operation is allowed in every 1/rate
+ *   seconds.
+ */
+static void
+_rate_limit_take (struct timeval *cur_time,
+                  struct timeval *next,
+                  unsigned int rate,
+                  struct timeval *slot)
+{
+  struct timeval tmp;
+
+  assert (cur_time);
+  assert (next);
+  assert (rate);
+
+  if (timeval_gt (cur_time, next))
+    tmp = *cur_time;
+  else
+    tmp = *next;
+
+  if (slot)
+    *slot = tmp;
+
+  timeval_add_ms (&tmp, 1000 / rate, next);
+}
+
+/* _powercmd_is_power_on
+ * - Returns 1 if the power command may power on a host
+ */
+static int
+_powercmd_is_power_on (ipmipower_power_cmd_t cmd)
+{
+  return (cmd == IPMIPOWER_POWER_CMD_POWER_ON
+          || cmd == IPMIPOWER_POWER_CMD_POWER_CYCLE
+          || (cmd_args.on_if_off && cmd == IPMIPOWER_POWER_CMD_POWER_RESET));
+}
+
 static void
 _destroy_ipmipower_powercmd (void *x)
 {
@@ -197,6 +329,15 @@ ipmipower_powercmd_setup ()
       IPMIPOWER_ERROR (("list_create: %s", strerror (errno)));
       exit (EXIT_FAILURE);
     }
+
+  power_on_groups = list_create ((ListDelF)free);
+  if (!power_on_groups)
+    {
+      IPMIPOWER_ERROR (("list_create: %s", strerror (errno)));
+      exit (EXIT_FAILURE);
+    }
+
+  timeval_clear (&next_session_start);
 }
 
 void
@@ -205,8 +346,10 @@ ipmipower_powercmd_cleanup ()
   assert (pending);  /* did not run ipmipower_powercmd_setup() */
   list_destroy (pending);
   list_destroy (add_to_pending);
+  list_destroy (power_on_groups);
   pending = NULL;
   add_to_pending = NULL;
+  power_on_groups = NULL;
 }
 
 void
@@ -246,7 +389,9 @@ ipmipower_powercmd_queue (ipmipower_power_cmd_t cmd,
 #else  /* 0 */
   memset (&(ip->time_begin), '\0', sizeof (struct timeval));
 #endif  /* 0 */
+  timeval_clear (&(ip->time_session_established));
   ip->retransmission_count = 0;
+  ip->total_retransmission_count = 0;
   ip->close_timeout = 0;
 
   /*
@@ -390,6 +535,15 @@ ipmipower_powercmd_queue (ipmipower_power_cmd_t cmd,
 
   ip->wait_until_on_state = 0;
   ip->wait_until_off_state = 0;
+  timeval_clear (&(ip->wait_until_begin));
+  ip->wait_until_poll_count = 0;
+
+  if (cmd_args.power_on_rate && _powercmd_is_power_on (cmd))
+    ip->power_on_group = _power_on_group (ic->hostname);
+  else
+    ip->power_on_group = NULL;
+  timeval_clear (&(ip->power_on_slot));
+  ip->chassis_control_delayed = 0;
 
   ip->ic = ic;
 
@@ -684,6 +838,54 @@ ipmipower_powercmd_pending ()
   return (!list_is_empty (pending));
 }
 
+/* _powercmd_output_timing
+ * - Gather timing information for output
+ */
+static void
+_powercmd_output_timing (ipmipower_powercmd_t ip,
+                         struct ipmipower_output_timing *timing)
+{
+  struct timeval cur_time, result;
+
+  assert (ip);
+  assert (timing);
+
+  memset (timing, '\0', sizeof (struct ipmipower_output_timing));
+
+  timing->retransmission_count = ip->total_retransmission_count;
+
+  if (!timeval_gt (&(ip->time_session_established), &(ip->time_begin)))
+    return;
+
+  if (gettimeofday (&cur_time, NULL) < 0)
+    {
+      IPMIPOWER_ERROR (("gettimeofday: %s", strerror (errno)));
+      exit (EXIT_FAILURE);
+    }
+
+  timing->session_established = 1;
+
+  timeval_sub (&(ip->time_session_established), &(ip->time_begin), &result);
+  timeval_millisecond_calc (&result, &(timing->handshake_time));
+
+  timeval_sub (&cur_time, &(ip->time_session_established), &result);
+  timeval_millisecond_calc (&result, &(timing->command_time));
+}
+
+/* _powercmd_output
+ * - Output result for this power command
+ */
+static void
+_powercmd_output (ipmipower_powercmd_t ip, ipmipower_msg_type_t num)
+{
+  struct ipmipower_output_timing timing;
+
+  assert (ip);
+
+  _powercmd_output_timing (ip, &timing);
+  ipmipower_output_timed (num, ip->ic->hostname, ip->extra_arg, &timing);
+}
+
 /* _send_packet
  * - Send a packet of the specified type
  * - updates state and counts
@@ -818,6 +1020,69 @@ _send_packet (ipmipower_powercmd_t ip, ipmipower_packet_type_t pkt)
     }
 }
 
+/* _update_rtt
+ * - Update the round trip time estimates of a connection using the
+ *   request/response pair just completed.  Estimates are calculated
+ *   as described in RFC 6298.
+ */
+static void
+_update_rtt (ipmipower_powercmd_t ip)
+{
+  struct timeval cur_time, result;
+  unsigned int rtt;
+  unsigned int rto;
+
+  assert (ip);
+
+  if (!cmd_args.adaptive_retransmission)
+    return;
+
+  /* Karn's algorithm - the response to a retransmitted request is
+   * ambiguous, so don't sample it.
+   */
+  if (ip->retransmission_count)
+    return;
+
+  if (gettimeofday (&cur_time, NULL) < 0)
+    {
+      IPMIPOWER_ERROR (("gettimeofday: %s", strerror (errno)));
+      exit (EXIT_FAILURE);
+    }
+
+  timeval_sub (&cur_time, &(ip->ic->last_ipmi_send), &result);
+  timeval_millisecond_calc (&result, &rtt);
+
+  if (!ip->ic->rtt_sample_count)
+    {
+      ip->ic->srtt = rtt;
+      ip->ic->rttvar = rtt / 2;
+    }
+  else
+    {
+      unsigned int delta;
+
+      delta = (ip->ic->srtt > rtt) ? (ip->ic->srtt - rtt) : (rtt - ip->ic->srtt);
+      ip->ic->rttvar = (3 * ip->ic->rttvar + delta) / 4;
+      ip->ic->srtt = (7 * ip->ic->srtt + rtt) / 8;
+    }
+
+  /* clock granularity is 1 millisecond */
+  rto = ip->ic->srtt + ((4 * ip->ic->rttvar) > 1 ? (4 * ip->ic->rttvar) : 1);
+  if (rto < IPMIPOWER_ADAPTIVE_RETRANSMISSION_TIMEOUT_MIN)
+    rto = IPMIPOWER_ADAPTIVE_RETRANSMISSION_TIMEOUT_MIN;
+  if (rto > cmd_args.common_args.session_timeout)
+    rto = cmd_args.common_args.session_timeout;
+  ip->ic->rto = rto;
+  ip->ic->rtt_sample_count++;
+
+  IPMIPOWER_DEBUG (("host = %s; rtt = %u; srtt = %u; rttvar = %u; rto = %u",
+                    ip->ic->hostname,
+                    rtt,
+                    ip->ic->srtt,
+                    ip->ic->rttvar,
+                    ip->ic->rto));
+}
+
 /* _recv_packet
  * - Receive a packet
  * Returns 1 if packet is of correct size and passes checks
@@ -881,7 +1146,7 @@ _recv_packet (ipmipower_powercmd_t ip, ipmipower_packet_type_t pkt)
        */
       if (!ipmipower_check_completion_code (ip, pkt))
         {
-          ipmipower_output (ipmipower_packet_errmsg (ip, pkt), ip->ic->hostname, ip->extra_arg);
+          _powercmd_output (ip, ipmipower_packet_errmsg (ip, pkt));
           ip->retransmission_count = 0;  /* important to reset */
           if (gettimeofday (&ip->ic->last_ipmi_recv, NULL) < 0)
             {
@@ -941,7 +1206,7 @@ _recv_packet (ipmipower_powercmd_t ip, ipmipower_packet_type_t pkt)
        */
       if (!ipmipower_check_completion_code (ip, pkt))
         {
-          ipmipower_output (ipmipower_packet_errmsg (ip, pkt), ip->ic->hostname, ip->extra_arg);
+          _powercmd_output (ip, ipmipower_packet_errmsg (ip, pkt));
           ip->retransmission_count = 0;  /* important to reset */
           if (gettimeofday (&ip->ic->last_ipmi_recv, NULL) < 0)
             {
@@ -1055,7 +1320,7 @@ _recv_packet (ipmipower_powercmd_t ip, ipmipower_packet_type_t pkt)
           if (pkt == IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RS)
             goto close_session_workaround;
 
-          ipmipower_output (ipmipower_packet_errmsg (ip, pkt), ip->ic->hostname, ip->extra_arg);
+          _powercmd_output (ip, ipmipower_packet_errmsg (ip, pkt));
 
           ip->retransmission_count = 0;  /* important to reset */
           if (gettimeofday (&ip->ic->last_ipmi_recv, NULL) < 0)
@@ -1097,7 +1362,7 @@ _recv_packet (ipmipower_powercmd_t ip, ipmipower_packet_type_t pkt)
        */
       if (!ipmipower_check_rmcpplus_status_code (ip, pkt))
         {
-          ipmipower_output (ipmipower_packet_errmsg (ip, pkt), ip->ic->hostname, ip->extra_arg);
+          _powercmd_output (ip, ipmipower_packet_errmsg (ip, pkt));
           ip->retransmission_count = 0;  /* important to reset */
           if (gettimeofday (&ip->ic->last_ipmi_recv, NULL) < 0)
             {
@@ -1117,7 +1382,7 @@ _recv_packet (ipmipower_powercmd_t ip, ipmipower_packet_type_t pkt)
         {
           if (!ipmipower_check_open_session_response_privilege (ip, pkt))
             {
-              ipmipower_output (IPMIPOWER_MSG_TYPE_PRIVILEGE_LEVEL_CANNOT_BE_OBTAINED, ip->ic->hostname, ip->extra_arg);
+              _powercmd_output (ip, IPMIPOWER_MSG_TYPE_PRIVILEGE_LEVEL_CANNOT_BE_OBTAINED);
               goto cleanup;
             }
         }
@@ -1134,7 +1399,7 @@ _recv_packet (ipmipower_powercmd_t ip, ipmipower_packet_type_t pkt)
                * at a high privilege level, that in reality is not
                * allowed).  Dunno how to deal with this.
                */
-              ipmipower_output (IPMIPOWER_MSG_TYPE_PASSWORD_INVALID, ip->ic->hostname, ip->extra_arg);
+              _powercmd_output (ip, IPMIPOWER_MSG_TYPE_PASSWORD_INVALID);
               goto cleanup;
             }
         }
@@ -1142,7 +1407,7 @@ _recv_packet (ipmipower_powercmd_t ip, ipmipower_packet_type_t pkt)
         {
           if (!ipmipower_check_rakp_4_integrity_check_value (ip, pkt))
             {
-              ipmipower_output (IPMIPOWER_MSG_TYPE_K_G_INVALID, ip->ic->hostname, ip->extra_arg);
+              _powercmd_output (ip, IPMIPOWER_MSG_TYPE_K_G_INVALID);
               goto cleanup;
             }
         }
@@ -1260,6 +1525,7 @@ _recv_packet (ipmipower_powercmd_t ip, ipmipower_packet_type_t pkt)
    * close the session anyways.
    */
  close_session_workaround:
+  _update_rtt (ip);
   ip->retransmission_count = 0;  /* important to reset */
   if (gettimeofday (&ip->ic->last_ipmi_recv, NULL) < 0)
     {
@@ -1283,6 +1549,99 @@ _recv_packet (ipmipower_powercmd_t ip, ipmipower_packet_type_t pkt)
   return (rv);
 }
 
+/* _wait_until_state
+ * - Check if we are polling the power state for --wait-until-on/off
+ * Returns 1 if polling, 0 if not
+ */
+static int
+_wait_until_state (ipmipower_powercmd_t ip)
+{
+  assert (ip);
+
+  if ((ip->wait_until_on_state
+       && ip->cmd == IPMIPOWER_POWER_CMD_POWER_ON)
+      || (ip->wait_until_off_state
+          && ip->cmd == IPMIPOWER_POWER_CMD_POWER_OFF))
+    return (1);
+  return (0);
+}
+
+/* _wait_until_start
+ * - Begin polling the power state after the power control command
+ */
+static void
+_wait_until_start (ipmipower_powercmd_t ip)
+{
+  assert (ip);
+
+  if (ip->cmd == IPMIPOWER_POWER_CMD_POWER_ON)
+    ip->wait_until_on_state++;
+  else
+    ip->wait_until_off_state++;
+
+  if (gettimeofday (&(ip->wait_until_begin), NULL) < 0)
+    {
+      IPMIPOWER_ERROR (("gettimeofday: %s", strerror (errno)));
+      exit (EXIT_FAILURE);
+    }
+  ip->wait_until_poll_count = 0;
+}
+
+/* _wait_until_converged
+ * - Host reached the requested power state, output and close session
+ */
+static void
+_wait_until_converged (ipmipower_powercmd_t ip)
+{
+  assert (ip);
+
+  if (cmd_args.wait_until_report)
+    {
+      struct ipmipower_output_timing timing;
+      struct timeval cur_time, result;
+      unsigned int convergence_time;
+
+      if (gettimeofday (&cur_time, NULL) < 0)
+        {
+          IPMIPOWER_ERROR (("gettimeofday: %s", strerror (errno)));
+          exit (EXIT_FAILURE);
+        }
+
+      timeval_sub (&cur_time, &(ip->wait_until_begin), &result);
+      timeval_millisecond_calc (&result, &convergence_time);
+
+      _powercmd_output_timing (ip, &timing);
+      ipmipower_output_convergence_time (ip->ic->hostname,
+                                         ip->extra_arg,
+                                         &timing,
+                                         convergence_time);
+    }
+  else
+    _powercmd_output (ip, IPMIPOWER_MSG_TYPE_OK);
+
+  ip->wait_until_on_state = 0;
+  ip->wait_until_off_state = 0;
+  _send_packet (ip, IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RQ);
+}
+
+/* _end_time
+ * - Determine when the command times out.  Normally the session
+ *   timeout, but --wait-until-timeout replaces it once we are
+ *   polling the power state.
+ */
+static void
+_end_time (ipmipower_powercmd_t ip, struct timeval *end_time)
+{
+  assert (ip);
+  assert (end_time);
+
+  if (cmd_args.wait_until_timeout
+      && _wait_until_state (ip))
+    timeval_add_ms (&(ip->wait_until_begin), cmd_args.wait_until_timeout, end_time);
+  else
+    timeval_add_ms (&(ip->time_begin), cmd_args.common_args.session_timeout, end_time);
+}
+
 /* _has_timed_out
  * - Check if command timed out
  * Returns 1 if timed out, 0 if not
@@ -1290,7 +1649,7 @@ _recv_packet (ipmipower_powercmd_t ip, ipmipower_packet_type_t pkt)
 static int
 _has_timed_out (ipmipower_powercmd_t ip)
 {
-  struct timeval cur_time, result;
+  struct timeval cur_time, end_time, result;
   unsigned int session_timeout;
 
   assert (ip);
@@ -1305,6 +1664,20 @@ _has_timed_out (ipmipower_powercmd_t ip)
       exit (EXIT_FAILURE);
     }
 
+  if (cmd_args.wait_until_timeout
+      && _wait_until_state (ip))
+    {
+      _end_time (ip, &end_time);
+
+      /* Must use >=, otherwise we could potentially spin */
+      if (!timeval_lt (&cur_time, &end_time))
+        {
+          _powercmd_output (ip, IPMIPOWER_MSG_TYPE_WAIT_UNTIL_TIMEOUT);
+          return (1);
+        }
+      return (0);
+    }
+
   timeval_sub (&cur_time, &(ip->time_begin), &result);
   timeval_millisecond_calc (&result, &session_timeout);
 
@@ -1317,11 +1690,11 @@ _has_timed_out (ipmipower_powercmd_t ip)
         {
           /* Special cases */
           if (ip->protocol_state == IPMIPOWER_PROTOCOL_STATE_AUTHENTICATION_CAPABILITIES_SENT)
-            ipmipower_output (IPMIPOWER_MSG_TYPE_CONNECTION_TIMEOUT, ip->ic->hostname, ip->extra_arg);
+            _powercmd_output (ip, IPMIPOWER_MSG_TYPE_CONNECTION_TIMEOUT);
           else if (ip->protocol_state == IPMIPOWER_PROTOCOL_STATE_ACTIVATE_SESSION_SENT)
-            ipmipower_output (IPMIPOWER_MSG_TYPE_PASSWORD_VERIFICATION_TIMEOUT, ip->ic->hostname, ip->extra_arg);
+            _powercmd_output (ip, IPMIPOWER_MSG_TYPE_PASSWORD_VERIFICATION_TIMEOUT);
           else
-            ipmipower_output (IPMIPOWER_MSG_TYPE_SESSION_TIMEOUT, ip->ic->hostname, ip->extra_arg);
+            _powercmd_output (ip, IPMIPOWER_MSG_TYPE_SESSION_TIMEOUT);
         }
       return (1);
     }
@@ -1329,6 +1702,38 @@ _has_timed_out (ipmipower_powercmd_t ip)
   return (0);
 }
 
+/* _retransmission_timeout
+ * - Determine the current retransmission timeout, including backoff
+ */
+static unsigned int
+_retransmission_timeout (ipmipower_powercmd_t ip)
+{
+  unsigned int retransmission_timeout;
+
+  assert (ip);
+
+  if (_wait_until_state (ip))
+    {
+      unsigned int backoff;
+
+      /* Poll less often the longer the host takes to change state */
+      backoff = 1 + (ip->wait_until_poll_count/cmd_args.retransmission_backoff_count);
+      if (backoff > IPMIPOWER_WAIT_UNTIL_BACKOFF_MAX)
+        backoff = IPMIPOWER_WAIT_UNTIL_BACKOFF_MAX;
+
+      retransmission_timeout = cmd_args.retransmission_wait_timeout * backoff;
+      if (retransmission_timeout > cmd_args.common_args.session_timeout)
+        retransmission_timeout = cmd_args.common_args.session_timeout;
+    }
+  else if (cmd_args.adaptive_retransmission
+           && ip->ic->rtt_sample_count)
+    retransmission_timeout = ip->ic->rto;
+  else
+    retransmission_timeout = cmd_args.common_args.retransmission_timeout;
+
+  return (retransmission_timeout * (1 + (ip->retransmission_count/cmd_args.retransmission_backoff_count)));
+}
+
 /* _retry_packets
  * - Check if we should retransmit and retransmit if necessary
  * Returns 1 if we sent a packet, 0 if not
@@ -1348,13 +1753,7 @@ _retry_packets (ipmipower_powercmd_t ip)
     return (0);
 
   /* Did we timeout on this packet? */
-  if ((ip->wait_until_on_state
-       && ip->cmd == IPMIPOWER_POWER_CMD_POWER_ON)
-      || (ip->wait_until_off_state
-          && ip->cmd == IPMIPOWER_POWER_CMD_POWER_OFF))
-    retransmission_timeout = cmd_args.retransmission_wait_timeout * (1 + (ip->retransmission_count/cmd_args.retransmission_backoff_count));
-  else
-    retransmission_timeout = cmd_args.common_args.retransmission_timeout * (1 + (ip->retransmission_count/cmd_args.retransmission_backoff_count));
+  retransmission_timeout = _retransmission_timeout (ip);
 
   if (gettimeofday (&cur_time, NULL) < 0)
     {
@@ -1376,6 +1775,7 @@ _retry_packets (ipmipower_powercmd_t ip)
     return (0);
 
   ip->retransmission_count++;
+  ip->total_retransmission_count++;
 
   IPMIPOWER_DEBUG (("host = %s; p = %d; Sending retry, retry count=%d",
                     ip->ic->hostname,
@@ -1420,7 +1820,7 @@ _retry_packets (ipmipower_powercmd_t ip)
                 exit (EXIT_FAILURE);
               }
 
-            ipmipower_output (IPMIPOWER_MSG_TYPE_RESOURCES, ip->ic->hostname, ip->extra_arg);
+            _powercmd_output (ip, IPMIPOWER_MSG_TYPE_RESOURCES);
             return (-1);
           }
 
@@ -1551,7 +1951,7 @@ _check_ipmi_1_5_authentication_capabilities (ipmipower_powercmd_t ip)
 
       if (!ret)
         {
-          ipmipower_output (IPMIPOWER_MSG_TYPE_USERNAME_INVALID, ip->ic->hostname, ip->extra_arg);
+          _powercmd_output (ip, IPMIPOWER_MSG_TYPE_USERNAME_INVALID);
           return (-1);
         }
     }
@@ -1576,7 +1976,7 @@ _check_ipmi_1_5_authentication_capabilities (ipmipower_powercmd_t ip)
 
       if (!ret)
         {
-          ipmipower_output (IPMIPOWER_MSG_TYPE_AUTHENTICATION_TYPE_UNAVAILABLE, ip->ic->hostname, ip->extra_arg);
+          _powercmd_output (ip, IPMIPOWER_MSG_TYPE_AUTHENTICATION_TYPE_UNAVAILABLE);
           return (-1);
         }
     }
@@ -1624,7 +2024,7 @@ _check_ipmi_2_0_authentication_capabilities (ipmipower_powercmd_t ip)
 
   if (!ret)
     {
-      ipmipower_output (IPMIPOWER_MSG_TYPE_IPMI_2_0_UNAVAILABLE, ip->ic->hostname, ip->extra_arg);
+      _powercmd_output (ip, IPMIPOWER_MSG_TYPE_IPMI_2_0_UNAVAILABLE);
       return (-1);
     }
 
@@ -1653,7 +2053,7 @@ _check_ipmi_2_0_authentication_capabilities (ipmipower_powercmd_t ip)
 
       if (!ret)
         {
-          ipmipower_output (IPMIPOWER_MSG_TYPE_USERNAME_INVALID, ip->ic->hostname, ip->extra_arg);
+          _powercmd_output (ip, IPMIPOWER_MSG_TYPE_USERNAME_INVALID);
           return (-1);
         }
 
@@ -1670,7 +2070,7 @@ _check_ipmi_2_0_authentication_capabilities (ipmipower_powercmd_t ip)
 
       if (!ret)
         {
-          ipmipower_output (IPMIPOWER_MSG_TYPE_K_G_INVALID, ip->ic->hostname, ip->extra_arg);
+          _powercmd_output (ip, IPMIPOWER_MSG_TYPE_K_G_INVALID);
           return (-1);
         }
     }
@@ -1738,7 +2138,7 @@ _check_activate_session_authentication_type (ipmipower_powercmd_t ip)
                             ip->ic->hostname,
                             ip->protocol_state));
 
-          ipmipower_output (IPMIPOWER_MSG_TYPE_BMC_ERROR, ip->ic->hostname, ip->extra_arg);
+          _powercmd_output (ip, IPMIPOWER_MSG_TYPE_BMC_ERROR);
 
           ip->retransmission_count = 0;  /* important to reset */
           if (gettimeofday (&ip->ic->last_ipmi_recv, NULL) < 0)
@@ -1861,6 +2261,39 @@ _calculate_cipher_keys (ipmipower_powercmd_t ip)
   return (0);
 }
 
+/* _send_chassis_control
+ * - Send the chassis control request, unless this is a power on
+ *   that must wait for its scheduled time under --power-on-rate.
+ */
+static void
+_send_chassis_control (ipmipower_powercmd_t ip)
+{
+  struct timeval cur_time;
+
+  assert (ip);
+
+  if (ip->power_on_group
+      && (ip->cmd == IPMIPOWER_POWER_CMD_POWER_ON
+          || ip->cmd == IPMIPOWER_POWER_CMD_POWER_CYCLE))
+    {
+      if (gettimeofday (&cur_time, NULL) < 0)
+        {
+          IPMIPOWER_ERROR (("gettimeofday: %s", strerror (errno)));
+          exit (EXIT_FAILURE);
+        }
+
+      if (timeval_lt (&cur_time, &(ip->power_on_slot)))
+        {
+          IPMIPOWER_DEBUG (("host = %s; delaying power on", ip->ic->hostname));
+          ip->chassis_control_delayed = 1;
+          return;
+        }
+    }
+
+  ip->chassis_control_delayed = 0;
+  _send_packet (ip, IPMIPOWER_PACKET_TYPE_CHASSIS_CONTROL_RQ);
+}
+
 /* _process_ipmi_packets
  * - Main function that handles packet sends/receives for
  *   the power control protocol
@@ -1872,6 +2305,7 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
 {
   struct timeval cur_time, end_time, result;
   unsigned int timeout;
+  unsigned int retransmission_timeout;
   uint64_t val;
   int rv;
 
@@ -1883,6 +2317,24 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
   if (_has_timed_out (ip))
     return (-1);
 
+  /* power on delayed for --power-on-rate? */
+  if (ip->chassis_control_delayed)
+    {
+      unsigned int wait;
+
+      if (gettimeofday (&cur_time, NULL) < 0)
+        {
+          IPMIPOWER_ERROR (("gettimeofday: %s", strerror (errno)));
+          exit (EXIT_FAILURE);
+        }
+
+      if ((wait = _rate_limit_wait (&cur_time, &(ip->power_on_slot))))
+        return (wait);
+
+      _send_chassis_control (ip);
+      goto done;
+    }
+
   /* retransmit? */
   if ((rv = _retry_packets (ip)))
     {
@@ -1900,6 +2352,55 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
           && (executing_count >= cmd_args.common_args.fanout))
         return (cmd_args.common_args.session_timeout);
 
+      /* Don't execute if the session start rate or this host's power
+       * on rate has been reached.  Sessions for a power on are
+       * started a little before their scheduled power on, so the
+       * session handshake overlaps the wait.
+       */
+      if (cmd_args.session_rate || ip->power_on_group)
+        {
+          unsigned int wait = 0;
+
+          if (gettimeofday (&cur_time, NULL) < 0)
+            {
+              IPMIPOWER_ERROR (("gettimeofday: %s", strerror (errno)));
+              exit (EXIT_FAILURE);
+            }
+
+          if (cmd_args.session_rate)
+            wait = _rate_limit_wait (&cur_time, &next_session_start);
+
+          if (ip->power_on_group)
+            {
+              unsigned int power_on_wait;
+              unsigned int lookahead;
+
+              lookahead = IPMIPOWER_POWER_ON_LOOKAHEAD;
+              if (lookahead > cmd_args.common_args.session_timeout / 2)
+                lookahead = cmd_args.common_args.session_timeout / 2;
+
+              power_on_wait = _rate_limit_wait (&cur_time, &(ip->power_on_group->next_power_on));
+              if (power_on_wait > lookahead
+                  && (power_on_wait - lookahead) > wait)
+                wait = power_on_wait - lookahead;
+            }
+
+          if (wait)
+            return (wait);
+
+          if (cmd_args.session_rate)
+            _rate_limit_take (&cur_time,
+                              &next_session_start,
+                              cmd_args.session_rate,
+                              NULL);
+
+          if (ip->power_on_group)
+            _rate_limit_take (&cur_time,
+                              &(ip->power_on_group->next_power_on),
+                              cmd_args.power_on_rate,
+                              &(ip->power_on_slot));
+        }
+
       _send_packet (ip, IPMIPOWER_PACKET_TYPE_AUTHENTICATION_CAPABILITIES_RQ);
 
       if (gettimeofday (&(ip->time_begin), NULL) < 0)
@@ -2016,6 +2517,12 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
           goto done;
         }
 
+      if (gettimeofday (&(ip->time_session_established), NULL) < 0)
+        {
+          IPMIPOWER_ERROR (("gettimeofday: %s", strerror (errno)));
+          exit (EXIT_FAILURE);
+        }
+
       if (cmd_args.oem_power_type == IPMIPOWER_OEM_POWER_TYPE_NONE)
         {
           if (ip->cmd == IPMIPOWER_POWER_CMD_POWER_STATUS
@@ -2028,7 +2535,7 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
                    || ip->cmd == IPMIPOWER_POWER_CMD_IDENTIFY_OFF)
             _send_packet (ip, IPMIPOWER_PACKET_TYPE_CHASSIS_IDENTIFY_RQ);
           else /* on, off, cycle, reset, pulse diag interrupt, soft shutdown */
-            _send_packet (ip, IPMIPOWER_PACKET_TYPE_CHASSIS_CONTROL_RQ);
+            _send_chassis_control (ip);
         }
       else /* cmd_args.oem_power_type == IPMIPOWER_OEM_POWER_TYPE_C410X */
         {
@@ -2066,28 +2573,22 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
           && ip->wait_until_on_state)
         {
           if (power_state == IPMI_SYSTEM_POWER_IS_ON)
-            {
-              ipmipower_output (IPMIPOWER_MSG_TYPE_OK, ip->ic->hostname, ip->extra_arg);
-              ip->wait_until_on_state = 0;
-              _send_packet (ip, IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RQ);
-            }
+            _wait_until_converged (ip);
+          else
+            ip->wait_until_poll_count++;
         }
       else if (cmd_args.wait_until_off
                && ip->cmd == IPMIPOWER_POWER_CMD_POWER_OFF
                && ip->wait_until_off_state)
         {
           if (power_state == IPMI_SYSTEM_POWER_IS_OFF)
-            {
-              ipmipower_output (IPMIPOWER_MSG_TYPE_OK, ip->ic->hostname, ip->extra_arg);
-              ip->wait_until_off_state = 0;
-              _send_packet (ip, IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RQ);
-            }
+            _wait_until_converged (ip);
+          else
+            ip->wait_until_poll_count++;
         }
       else if (ip->cmd == IPMIPOWER_POWER_CMD_POWER_STATUS)
         {
-          ipmipower_output ((power_state == IPMI_SYSTEM_POWER_IS_ON) ? IPMIPOWER_MSG_TYPE_ON : IPMIPOWER_MSG_TYPE_OFF,
-                            ip->ic->hostname,
-                            ip->extra_arg);
+          _powercmd_output (ip, (power_state == IPMI_SYSTEM_POWER_IS_ON) ? IPMIPOWER_MSG_TYPE_ON : IPMIPOWER_MSG_TYPE_OFF);
           _send_packet (ip, IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RQ);
         }
       else if (cmd_args.on_if_off && (ip->cmd == IPMIPOWER_POWER_CMD_POWER_CYCLE
@@ -2098,7 +2599,7 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
               /* This is now a power-on operation */
               ip->cmd = IPMIPOWER_POWER_CMD_POWER_ON;
             }
-          _send_packet (ip, IPMIPOWER_PACKET_TYPE_CHASSIS_CONTROL_RQ);
+          _send_chassis_control (ip);
         }
       else if (ip->cmd == IPMIPOWER_POWER_CMD_IDENTIFY_STATUS)
         {
@@ -2129,15 +2630,15 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
               identify_status = val;
 
               if (identify_status == IPMI_CHASSIS_IDENTIFY_STATE_OFF)
-                ipmipower_output (IPMIPOWER_MSG_TYPE_OFF, ip->ic->hostname, ip->extra_arg);
+                _powercmd_output (ip, IPMIPOWER_MSG_TYPE_OFF);
               else if (identify_status == IPMI_CHASSIS_IDENTIFY_STATE_TEMPORARY_ON
                        || identify_status == IPMI_CHASSIS_IDENTIFY_STATE_INDEFINITE_ON)
-                ipmipower_output (IPMIPOWER_MSG_TYPE_ON, ip->ic->hostname, ip->extra_arg);
+                _powercmd_output (ip, IPMIPOWER_MSG_TYPE_ON);
               else
-                ipmipower_output (IPMIPOWER_MSG_TYPE_UNKNOWN, ip->ic->hostname, ip->extra_arg);
+                _powercmd_output (ip, IPMIPOWER_MSG_TYPE_UNKNOWN);
             }
           else
-            ipmipower_output (IPMIPOWER_MSG_TYPE_UNKNOWN, ip->ic->hostname, ip->extra_arg);
+            _powercmd_output (ip, IPMIPOWER_MSG_TYPE_UNKNOWN);
 
           _send_packet (ip, IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RQ);
         }
@@ -2162,15 +2663,12 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
           || (cmd_args.wait_until_off
               && ip->cmd == IPMIPOWER_POWER_CMD_POWER_OFF))
         {
-          if (ip->cmd == IPMIPOWER_POWER_CMD_POWER_ON)
-            ip->wait_until_on_state++;
-          else
-            ip->wait_until_off_state++;
+          _wait_until_start (ip);
           _send_packet (ip, IPMIPOWER_PACKET_TYPE_GET_CHASSIS_STATUS_RQ);
         }
       else
         {
-          ipmipower_output (IPMIPOWER_MSG_TYPE_OK, ip->ic->hostname, ip->extra_arg);
+          _powercmd_output (ip, IPMIPOWER_MSG_TYPE_OK);
 
           /* IPMI Workaround (achu)
            *
@@ -2196,7 +2694,7 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
           goto done;
         }
 
-      ipmipower_output (IPMIPOWER_MSG_TYPE_OK, ip->ic->hostname, ip->extra_arg);
+      _powercmd_output (ip, IPMIPOWER_MSG_TYPE_OK);
       _send_packet (ip, IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RQ);
     }
   else if (ip->protocol_state == IPMIPOWER_PROTOCOL_STATE_C410X_GET_SENSOR_READING_SENT)
@@ -2247,7 +2745,7 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
       if (reading_state == IPMI_SENSOR_READING_STATE_UNAVAILABLE
           || sensor_scanning == IPMI_SENSOR_SCANNING_ON_THIS_SENSOR_DISABLE)
         {
-          ipmipower_output (IPMIPOWER_MSG_TYPE_BMC_ERROR, ip->ic->hostname, ip->extra_arg);
+          _powercmd_output (ip, IPMIPOWER_MSG_TYPE_BMC_ERROR);
           _send_packet (ip, IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RQ);
           goto done;
         }
@@ -2264,35 +2762,29 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
           && ip->wait_until_on_state)
         {
           if (slot_power_on_flag)
-            {
-              ipmipower_output (IPMIPOWER_MSG_TYPE_OK, ip->ic->hostname, ip->extra_arg);
-              ip->wait_until_on_state = 0;
-              _send_packet (ip, IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RQ);
-            }
+            _wait_until_converged (ip);
+          else
+            ip->wait_until_poll_count++;
         }
       else if (cmd_args.wait_until_off
                && ip->cmd == IPMIPOWER_POWER_CMD_POWER_OFF
                && ip->wait_until_off_state)
         {
           if (!slot_power_on_flag)
-            {
-              ipmipower_output (IPMIPOWER_MSG_TYPE_OK, ip->ic->hostname, ip->extra_arg);
-              ip->wait_until_off_state = 0;
-              _send_packet (ip, IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RQ);
-            }
+            _wait_until_converged (ip);
+          else
+            ip->wait_until_poll_count++;
         }
       else if (ip->cmd == IPMIPOWER_POWER_CMD_POWER_STATUS)
         {
-          ipmipower_output ((slot_power_on_flag) ? IPMIPOWER_MSG_TYPE_ON : IPMIPOWER_MSG_TYPE_OFF,
-                            ip->ic->hostname,
-                            ip->extra_arg);
+          _powercmd_output (ip, (slot_power_on_flag) ? IPMIPOWER_MSG_TYPE_ON : IPMIPOWER_MSG_TYPE_OFF);
           _send_packet (ip, IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RQ);
         }
       else if (ip->cmd == IPMIPOWER_POWER_CMD_POWER_ON)
         {
           if (slot_power_on_flag)
             {
-              ipmipower_output (IPMIPOWER_MSG_TYPE_OK, ip->ic->hostname, ip->extra_arg);
+              _powercmd_output (ip, IPMIPOWER_MSG_TYPE_OK);
               _send_packet (ip, IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RQ);
             }
           else
@@ -2302,7 +2794,7 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
         {
           if (!slot_power_on_flag)
             {
-              ipmipower_output (IPMIPOWER_MSG_TYPE_OK, ip->ic->hostname, ip->extra_arg);
+              _powercmd_output (ip, IPMIPOWER_MSG_TYPE_OK);
               _send_packet (ip, IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RQ);
             }
           else
@@ -2329,15 +2821,12 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
           || (cmd_args.wait_until_off
               && ip->cmd == IPMIPOWER_POWER_CMD_POWER_OFF))
         {
-          if (ip->cmd == IPMIPOWER_POWER_CMD_POWER_ON)
-            ip->wait_until_on_state++;
-          else
-            ip->wait_until_off_state++;
+          _wait_until_start (ip);
           _send_packet (ip, IPMIPOWER_PACKET_TYPE_C410X_GET_SENSOR_READING_RQ);
         }
       else
         {
-          ipmipower_output (IPMIPOWER_MSG_TYPE_OK, ip->ic->hostname, ip->extra_arg);
+          _powercmd_output (ip, IPMIPOWER_MSG_TYPE_OK);
           _send_packet (ip, IPMIPOWER_PACKET_TYPE_CLOSE_SESSION_RQ);
         }
     }
@@ -2379,24 +2868,14 @@ _process_ipmi_packets (ipmipower_powercmd_t ip)
       IPMIPOWER_ERROR (("gettimeofday: %s", strerror (errno)));
       exit (EXIT_FAILURE);
     }
-  timeval_add_ms (&(ip->time_begin), cmd_args.common_args.session_timeout, &end_time);
+  _end_time (ip, &end_time);
   timeval_sub (&end_time, &cur_time, &result);
   timeval_millisecond_calc (&result, &timeout);
 
   /* shorter timeout b/c of retransmission timeout */
-  if ((ip->wait_until_on_state && ip->cmd == IPMIPOWER_POWER_CMD_POWER_ON)
-      || (ip->wait_until_off_state && ip->cmd == IPMIPOWER_POWER_CMD_POWER_OFF))
-    {
-      int retransmission_wait_timeout = cmd_args.retransmission_wait_timeout * (1 + (ip->retransmission_count/cmd_args.retransmission_backoff_count));
-      if (timeout > retransmission_wait_timeout)
-        timeout = retransmission_wait_timeout;
-    }
-  else
-    {
-      int retransmission_timeout = cmd_args.common_args.retransmission_timeout * (1 + (ip->retransmission_count/cmd_args.retransmission_backoff_count));
-      if (timeout > retransmission_timeout)
-        timeout = retransmission_timeout;
-    }
+  retransmission_timeout = _retransmission_timeout (ip);
+  if (timeout > retransmission_timeout)
+    timeout = retransmission_timeout;
 
   return (timeout);
 }
@@ -34,6 +34,7 @@
 #include <string.h>
 #endif /* STDC_HEADERS */
 #include <stdint.h>
+#include <limits.h>
 #include <sys/stat.h>
 #if HAVE_FCNTL_H
 #include <fcntl.h>
@@ -683,8 +684,13 @@ _cmd_help (void)
                          "on-if-off [on|off]                       - Toggle on-if-off functionality.\n"
                          "wait-until-on [on|off]                   - Toggle wait-until-on functionality.\n"
                          "wait-until-off [on|off]                  - Toggle wait-until-off functionality.\n"
+                         "wait-until on|off                        - Wait for the state and output convergence times.\n"
+                         "wait-until-timeout MILLISECONDS          - Specify a new wait-until timeout length.\n"
                          "retransmission-wait-timeout MILLISECONDS - Specify a new retransmission timeout length.\n"
                          "retransmission-backoff-count COUNT       - Specify a new retransmission backoff count.\n"
+                         "adaptive-retransmission [on|off]         - Toggle adaptive-retransmission functionality.\n"
+                         "session-rate COUNT                       - Specify a new session rate.\n"
+                         "power-on-rate COUNT                      - Specify a new power on rate.\n"
                          "ping-interval MILLISECONDS               - Specify a new ping interval length.\n"
                          "ping-timeout MILLISECONDS                - Specify a new ping timeout length.\n"
                          "ping-packet-count COUNT                  - Specify a new ping packet count.\n"
@@ -694,6 +700,7 @@ _cmd_help (void)
                          "consolidate-output [on|off]              - Toggle consolidate-output functionality.\n"
                          "fanout COUNT                             - Specify a fanout.\n"
                          "always-prefix [on|off]                   - Toggle always-prefix functionality.\n"
+                         "json-output [on|off]                     - Toggle json-output functionality.\n"
                          "help                                     - Output help menu.\n"
                          "version                                  - Output version.\n"
                          "config                                   - Output current configuration.\n"
@@ -1033,12 +1040,27 @@ _cmd_config (void)
   ipmipower_cbuf_printf (ttyout,
                          "Wait-Until-Off:               %s\n",
                          (cmd_args.wait_until_off) ? "enabled" : "disabled");
+  ipmipower_cbuf_printf (ttyout,
+                         "Wait-Until Report:            %s\n",
+                         (cmd_args.wait_until_report) ? "enabled" : "disabled");
+  ipmipower_cbuf_printf (ttyout,
+                         "Wait-Until Timeout:           %u ms\n",
+                         cmd_args.wait_until_timeout);
   ipmipower_cbuf_printf (ttyout,
                          "Retransmission Wait Timeout:  %u ms\n",
                          cmd_args.retransmission_wait_timeout);
   ipmipower_cbuf_printf (ttyout,
                          "Retransmission Backoff Count: %u\n",
                          cmd_args.retransmission_backoff_count);
+  ipmipower_cbuf_printf (ttyout,
+                         "Adaptive-Retransmission:      %s\n",
+                         (cmd_args.adaptive_retransmission) ? "enabled" : "disabled");
+  ipmipower_cbuf_printf (ttyout,
+                         "Session Rate:                 %u per second\n",
+                         cmd_args.session_rate);
+  ipmipower_cbuf_printf (ttyout,
+                         "Power On Rate:                %u per second\n",
+                         cmd_args.power_on_rate);
   ipmipower_cbuf_printf (ttyout,
                          "Ping Interval:                %u ms\n",
                          cmd_args.ping_interval);
@@ -1067,6 +1089,9 @@ _cmd_config (void)
   ipmipower_cbuf_printf (ttyout,
                          "Always-Prefix:                %s\n",
                          (cmd_args.common_args.always_prefix) ? "enabled" : "disabled");
+  ipmipower_cbuf_printf (ttyout,
+                         "JSON-Output:                  %s\n",
+                         (cmd_args.json_output) ? "enabled" : "disabled");
 }
 
 static void
@@ -1179,6 +1204,33 @@ _cmd_set_flag (char **argv, int *flag, const char *str)
                          (*flag) ? "on" : "off");
 }
 
+static void
+_cmd_wait_until (char **argv)
+{
+  assert (argv);
+
+  if (!argv[1])
+    {
+      ipmipower_cbuf_printf (ttyout, "wait-until state not specified\n");
+      return;
+    }
+
+  if (!strcasecmp (argv[1], "on"))
+    cmd_args.wait_until_on = 1;
+  else if (!strcasecmp (argv[1], "off"))
+    cmd_args.wait_until_off = 1;
+  else
+    {
+      ipmipower_cbuf_printf (ttyout, "invalid parameter\n");
+      return;
+    }
+  cmd_args.wait_until_report = 1;
+
+  ipmipower_cbuf_printf (ttyout,
+                         "wait-until-%s is now on\n",
+                         !strcasecmp (argv[1], "on") ? "on" : "off");
+}
+
 /* _readcmd
  * - Read a command line from the tty and return it in buf.
  *   If no commands are available, return a null-terminated empty string.
@@ -1319,6 +1371,15 @@ ipmipower_prompt_process_cmdline (void)
                 _cmd_set_flag (argv,
                                &cmd_args.wait_until_off,
                                "wait-until-off");
+              else if (!strcmp (argv[0], "wait-until"))
+                _cmd_wait_until (argv);
+              else if (!strcmp (argv[0], "wait-until-timeout"))
+                _cmd_set_unsigned_int_ranged (argv,
+                                              &cmd_args.wait_until_timeout,
+                                              "wait-until-timeout",
+                                              1,
+                                              cmd_args.retransmission_wait_timeout,
+                                              INT_MAX);
               else if (!strcmp (argv[0], "retransmission-wait-timeout"))
                 _cmd_set_unsigned_int_ranged (argv,
                                               &cmd_args.retransmission_wait_timeout,
@@ -1331,6 +1392,24 @@ ipmipower_prompt_process_cmdline (void)
                                        &cmd_args.retransmission_backoff_count,
                                        "retransmission-backoff-count",
                                        0);
+              else if (!strcmp (argv[0], "adaptive-retransmission"))
+                _cmd_set_flag (argv,
+                               &cmd_args.adaptive_retransmission,
+                               "adaptive-retransmission");
+              else if (!strcmp (argv[0], "session-rate"))
+                _cmd_set_unsigned_int_ranged (argv,
+                                              &cmd_args.session_rate,
+                                              "session-rate",
+                                              1,
+                                              1,
+                                              IPMIPOWER_RATE_MAX);
+              else if (!strcmp (argv[0], "power-on-rate"))
+                _cmd_set_unsigned_int_ranged (argv,
+                                              &cmd_args.power_on_rate,
+                                              "power-on-rate",
+                                              1,
+                                              1,
+                                              IPMIPOWER_RATE_MAX);
               else if (!strcmp (argv[0], "ping-interval"))
                 _cmd_set_unsigned_int_ranged (argv,
                                               &cmd_args.ping_interval,
@@ -1372,6 +1451,10 @@ ipmipower_prompt_process_cmdline (void)
                 _cmd_set_flag (argv,
                                &cmd_args.common_args.always_prefix,
                                "always-prefix");
+              else if (!strcmp (argv[0], "json-output"))
+                _cmd_set_flag (argv,
+                               &cmd_args.json_output,
+                               "json-output");
               else if (!strcmp (argv[0], "fanout"))
                 _cmd_set_unsigned_int_ranged (argv,
                                               &cmd_args.common_args.fanout,
@@ -110,12 +110,28 @@ static struct argp_option cmdline_options[] =
       "Specify format for oem non-timestamped event outputs.", 55},
     { "poll-interval", IPMISELD_POLL_INTERVAL_KEY, "SECONDS", 0,
       "Specify poll interval to check the SEL for new events.", 56},
+    { "adaptive-poll-interval", IPMISELD_ADAPTIVE_POLL_INTERVAL_KEY, 0, 0,
+      "Adapt each host's poll interval to how fast its SEL fills.", 56},
+    { "min-poll-interval", IPMISELD_MIN_POLL_INTERVAL_KEY, "SECONDS", 0,
+      "Specify minimum poll interval with adaptive polling.", 56},
+    { "max-poll-interval", IPMISELD_MAX_POLL_INTERVAL_KEY, "SECONDS", 0,
+      "Specify maximum poll interval with adaptive polling.", 56},
     { "log-facility", IPMISELD_LOG_FACILITY_KEY, "STRING", 0,
       "Specify syslog log facility.", 57},
     { "log-priority", IPMISELD_LOG_PRIORITY_KEY, "STRING", 0,
       "Specify syslog log priority.", 58},
+    { "log-file", IPMISELD_LOG_FILE_KEY, "FILE", 0,
+      "Log to the specified file instead of syslog.", 58},
+    { "log-socket", IPMISELD_LOG_SOCKET_KEY, "PATH", 0,
+      "Log to the specified Unix datagram socket instead of syslog.", 58},
+    { "log-queue-length", IPMISELD_LOG_QUEUE_LENGTH_KEY, "NUM", 0,
+      "Specify number of log messages that may be queued for output.", 58},
+    { "log-queue-overflow", IPMISELD_LOG_QUEUE_OVERFLOW_KEY, "POLICY", 0,
+      "Specify behavior when the log queue is full.", 58},
     { "cache-directory", IPMISELD_CACHE_DIRECTORY_KEY, "DIRECTORY", 0,
       "Specify alternate cache directory.", 59},
+    { "consolidated-state", IPMISELD_CONSOLIDATED_STATE_KEY, 0, 0,
+      "Keep the state of all hosts in one file in the cache directory.", 59},
     { "ignore-sdr", IPMISELD_IGNORE_SDR_KEY, 0, 0,
       "Ignore SDR related processing.", 60},
     { "re-download-sdr", IPMISELD_RE_DOWNLOAD_SDR_KEY, 0, 0,
@@ -124,6 +140,14 @@ static struct argp_option cmdline_options[] =
       "Clear SEL on startup.", 62},
     { "threadpool-count", IPMISELD_THREADPOOL_COUNT_KEY, "NUM", 0,
       "Specify threadpool count for parallel SEL polling.", 63},
+    { "persistent-sessions", IPMISELD_PERSISTENT_SESSIONS_KEY, 0, 0,
+      "Keep IPMI sessions open between SEL polls.", 63},
+    { "async-threads", IPMISELD_ASYNC_THREADS_KEY, "NUM", 0,
+      "Specify number of threads polling hosts asynchronously after their first poll.", 63},
+    { "speculative-read", IPMISELD_SPECULATIVE_READ_KEY, 0, 0,
+      "Read several SEL entries per round trip assuming sequential record ids.", 63},
+    { "stats-interval", IPMISELD_STATS_INTERVAL_KEY, "SECONDS", 0,
+      "Log daemon statistics every SECONDS seconds.", 63},
     { "test-run", IPMISELD_TEST_RUN_KEY, 0, 0,
       "Do not daemonize, output current SEL as test of current settings.", 64},
     { "foreground", IPMISELD_FOREGROUND_KEY, 0, 0,
@@ -264,6 +288,33 @@ cmdline_parse (int key, char *arg, struct argp_state *state)
         }
       cmd_args->poll_interval = tmp;
       break;
+    case IPMISELD_ADAPTIVE_POLL_INTERVAL_KEY:
+      cmd_args->adaptive_poll_interval = 1;
+      break;
+    case IPMISELD_MIN_POLL_INTERVAL_KEY:
+      errno = 0;
+      tmp = strtol (arg, &endptr, 0);
+      if (errno
+          || endptr[0] != '\0'
+          || tmp <= 0)
+        {
+          fprintf (stderr, "invalid min poll interval\n");
+          exit (EXIT_FAILURE);
+        }
+      cmd_args->min_poll_interval = tmp;
+      break;
+    case IPMISELD_MAX_POLL_INTERVAL_KEY:
+      errno = 0;
+      tmp = strtol (arg, &endptr, 0);
+      if (errno
+          || endptr[0] != '\0'
+          || tmp <= 0)
+        {
+          fprintf (stderr, "invalid max poll interval\n");
+          exit (EXIT_FAILURE);
+        }
+      cmd_args->max_poll_interval = tmp;
+      break;
     case IPMISELD_LOG_FACILITY_KEY:
       if (!(cmd_args->log_facility_str = strdup (arg)))
         {
@@ -278,6 +329,39 @@ cmdline_parse (int key, char *arg, struct argp_state *state)
           exit (EXIT_FAILURE);
         }
       break;
+    case IPMISELD_LOG_FILE_KEY:
+      if (!(cmd_args->log_file = strdup (arg)))
+        {
+          perror ("strdup");
+          exit (EXIT_FAILURE);
+        }
+      break;
+    case IPMISELD_LOG_SOCKET_KEY:
+      if (!(cmd_args->log_socket = strdup (arg)))
+        {
+          perror ("strdup");
+          exit (EXIT_FAILURE);
+        }
+      break;
+    case IPMISELD_LOG_QUEUE_LENGTH_KEY:
+      errno = 0;
+      tmp = strtol (arg, &endptr, 0);
+      if (errno
+          || endptr[0] != '\0'
+          || tmp <= 0)
+        {
+          fprintf (stderr, "invalid log queue length\n");
+          exit (EXIT_FAILURE);
+        }
+      cmd_args->log_queue_length = tmp;
+      break;
+    case IPMISELD_LOG_QUEUE_OVERFLOW_KEY:
+      if (!(cmd_args->log_queue_overflow_str = strdup (arg)))
+        {
+          perror ("strdup");
+          exit (EXIT_FAILURE);
+        }
+      break;
     case IPMISELD_CACHE_DIRECTORY_KEY:
       if (!(cmd_args->cache_directory = strdup (arg)))
         {
@@ -285,6 +369,9 @@ cmdline_parse (int key, char *arg, struct argp_state *state)
           exit (EXIT_FAILURE);
         }
       break;
+    case IPMISELD_CONSOLIDATED_STATE_KEY:
+      cmd_args->consolidated_state = 1;
+      break;
     case IPMISELD_IGNORE_SDR_KEY:
       cmd_args->ignore_sdr = 1;
       break;
@@ -306,6 +393,36 @@ cmdline_parse (int key, char *arg, struct argp_state *state)
         }
       cmd_args->threadpool_count = tmp;
       break;
+    case IPMISELD_PERSISTENT_SESSIONS_KEY:
+      cmd_args->persistent_sessions = 1;
+      break;
+    case IPMISELD_ASYNC_THREADS_KEY:
+      errno = 0;
+      tmp = strtol (arg, &endptr, 0);
+      if (errno
+          || endptr[0] != '\0'
+          || tmp < 0)
+        {
+          fprintf (stderr, "invalid async threads count\n");
+          exit (EXIT_FAILURE);
+        }
+      cmd_args->async_threads = tmp;
+      break;
+    case IPMISELD_SPECULATIVE_READ_KEY:
+      cmd_args->speculative_read = 1;
+      break;
+    case IPMISELD_STATS_INTERVAL_KEY:
+      errno = 0;
+      tmp = strtol (arg, &endptr, 0);
+      if (errno
+          || endptr[0] != '\0'
+          || tmp < 0)
+        {
+          fprintf (stderr, "invalid stats interval\n");
+          exit (EXIT_FAILURE);
+        }
+      cmd_args->stats_interval = tmp;
+      break;
     case IPMISELD_TEST_RUN_KEY:
       cmd_args->test_run = 1;
       break;
@@ -421,12 +538,28 @@ _ipmiseld_config_file_parse (struct ipmiseld_arguments *cmd_args)
     cmd_args->oem_non_timestamped_event_format_str = config_file_data.oem_non_timestamped_event_format_str;
   if (config_file_data.poll_interval_count)
     cmd_args->poll_interval = config_file_data.poll_interval;
+  if (config_file_data.adaptive_poll_interval_count)
+    cmd_args->adaptive_poll_interval = config_file_data.adaptive_poll_interval;
+  if (config_file_data.min_poll_interval_count)
+    cmd_args->min_poll_interval = config_file_data.min_poll_interval;
+  if (config_file_data.max_poll_interval_count)
+    cmd_args->max_poll_interval = config_file_data.max_poll_interval;
   if (config_file_data.log_facility_str_count)
     cmd_args->log_facility_str = config_file_data.log_facility_str;
   if (config_file_data.log_priority_str_count)
     cmd_args->log_priority_str = config_file_data.log_priority_str;
+  if (config_file_data.log_file_count)
+    cmd_args->log_file = config_file_data.log_file;
+  if (config_file_data.log_socket_count)
+    cmd_args->log_socket = config_file_data.log_socket;
+  if (config_file_data.log_queue_length_count)
+    cmd_args->log_queue_length = config_file_data.log_queue_length;
+  if (config_file_data.log_queue_overflow_str_count)
+    cmd_args->log_queue_overflow_str = config_file_data.log_queue_overflow_str;
   if (config_file_data.cache_directory_count)
     cmd_args->cache_directory = config_file_data.cache_directory;
+  if (config_file_data.consolidated_state_count)
+    cmd_args->consolidated_state = config_file_data.consolidated_state;
   if (config_file_data.ignore_sdr_count)
     cmd_args->ignore_sdr = config_file_data.ignore_sdr;
   if (config_file_data.re_download_sdr_count)
@@ -435,6 +568,14 @@ _ipmiseld_config_file_parse (struct ipmiseld_arguments *cmd_args)
     cmd_args->clear_sel = config_file_data.clear_sel;
   if (config_file_data.threadpool_count_count)
     cmd_args->threadpool_count = config_file_data.threadpool_count;
+  if (config_file_data.persistent_sessions_count)
+    cmd_args->persistent_sessions = config_file_data.persistent_sessions;
+  if (config_file_data.async_threads_count)
+    cmd_args->async_threads = config_file_data.async_threads;
+  if (config_file_data.speculative_read_count)
+    cmd_args->speculative_read = config_file_data.speculative_read;
+  if (config_file_data.stats_interval_count)
+    cmd_args->stats_interval = config_file_data.stats_interval;
 }
 
 static void
@@ -474,6 +615,29 @@ _ipmiseld_args_validate (struct ipmiseld_arguments *cmd_args)
         err_exit ("Invalid log priority specified\n");
     }
 
+  if (!cmd_args->min_poll_interval)
+    {
+      cmd_args->min_poll_interval = cmd_args->poll_interval / IPMISELD_MIN_POLL_INTERVAL_DIVISOR;
+      if (!cmd_args->min_poll_interval)
+        cmd_args->min_poll_interval = 1;
+    }
+
+  if (!cmd_args->max_poll_interval)
+    cmd_args->max_poll_interval = cmd_args->poll_interval * IPMISELD_MAX_POLL_INTERVAL_MULTIPLIER;
+
+  if (cmd_args->adaptive_poll_interval
+      && cmd_args->min_poll_interval > cmd_args->max_poll_interval)
+    err_exit ("min poll interval greater than max poll interval");
+
+  if (cmd_args->log_file && cmd_args->log_socket)
+    err_exit ("log file and log socket are mutually exclusive");
+
+  if (cmd_args->log_queue_overflow_str)
+    {
+      if (ipmiseld_log_queue_overflow_parse (cmd_args->log_queue_overflow_str) < 0)
+        err_exit ("Invalid log queue overflow specified\n");
+    }
+
   if (cmd_args->cache_directory)
     {
       if (access (cmd_args->cache_directory, R_OK|W_OK|X_OK) < 0)
@@ -483,6 +647,19 @@ _ipmiseld_args_validate (struct ipmiseld_arguments *cmd_args)
           exit (EXIT_FAILURE);
         }
     }
+
+  /* the async engine only speaks IPMI 1.5 to remote BMCs */
+  if (cmd_args->async_threads)
+    {
+      if (!cmd_args->common_args.hostname)
+        err_exit ("async threads require hosts to be specified");
+
+      if (cmd_args->common_args.driver_type == IPMI_DEVICE_LAN_2_0)
+        err_exit ("async threads do not support driver type LAN_2_0");
+
+      if (cmd_args->clear_threshold)
+        err_exit ("async threads do not support clear threshold");
+    }
 }
 
 void
@@ -524,13 +701,25 @@ ipmiseld_argp_parse (int argc, char **argv, struct ipmiseld_arguments *cmd_args)
   cmd_args->oem_timestamped_event_format_str = NULL;
   cmd_args->oem_non_timestamped_event_format_str = NULL;
   cmd_args->poll_interval = IPMISELD_POLL_INTERVAL_DEFAULT;
+  cmd_args->adaptive_poll_interval = 0;
+  cmd_args->min_poll_interval = 0;
+  cmd_args->max_poll_interval = 0;
   cmd_args->log_facility_str = NULL;
   cmd_args->log_priority_str = NULL;
+  cmd_args->log_file = NULL;
+  cmd_args->log_socket = NULL;
+  cmd_args->log_queue_length = IPMISELD_LOG_QUEUE_LENGTH_DEFAULT;
+  cmd_args->log_queue_overflow_str = NULL;
   cmd_args->cache_directory = NULL;
+  cmd_args->consolidated_state = 0;
   cmd_args->ignore_sdr = 0;
   cmd_args->re_download_sdr = 0;
   cmd_args->clear_sel = 0;
   cmd_args->threadpool_count = IPMISELD_THREADPOOL_COUNT;
+  cmd_args->persistent_sessions = 0;
+  cmd_args->async_threads = 0;
+  cmd_args->speculative_read = 0;
+  cmd_args->stats_interval = 0;
   cmd_args->test_run = 0;
   cmd_args->foreground = 0;
 
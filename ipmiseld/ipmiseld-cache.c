@@ -34,6 +34,17 @@
 #endif /* STDC_HEADERS */
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#if TIME_WITH_SYS_TIME
+#include <sys/time.h>
+#include <time.h>
+#else /* !TIME_WITH_SYS_TIME */
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#else /* !HAVE_SYS_TIME_H */
+#include <time.h>
+#endif /* !HAVE_SYS_TIME_H */
+#endif /* !TIME_WITH_SYS_TIME */
 #if HAVE_UNISTD_H
 #include <unistd.h>
 #endif /* HAVE_UNISTD_H */
@@ -41,6 +52,7 @@
 #include <fcntl.h>
 #endif /* HAVE_FCNTL_H */
 #include <sys/param.h>          /* MAXPATHLEN */
+#include <pthread.h>
 #include <assert.h>
 #include <errno.h>
 
@@ -48,10 +60,13 @@
 #include "ipmiseld-cache.h"
 #include "ipmiseld-common.h"
 #include "ipmiseld-debug.h"
+#include "ipmiseld-stats.h"
 
 #include "freeipmi-portability.h"
 #include "error.h"
 #include "fd.h"
+#include "fi_hostlist.h"
+#include "hash.h"
 
 #ifndef MAXPATHLEN
 #define MAXPATHLEN 4096
@@ -77,6 +92,8 @@
  * uint8_t delete_sel_command_supported;
  * uint8_t reserve_sel_command_supported;
  * uint8_t overflow_flag;
+ * uint32_t fill_rate; (version 2)
+ * uint32_t fill_rate_timestamp; (version 2)
  * uint8_t zerosumchecksum;
  */
 
@@ -84,9 +101,81 @@
 
 #define IPMISELD_DATA_CACHE_FILE_MAGIC    0x4A1B11E6
 
-#define IPMISELD_DATA_CACHE_FILE_VERSION  0x00000001
+#define IPMISELD_DATA_CACHE_FILE_VERSION_1 0x00000001
 
-#define IPMISELD_DATA_CACHE_LENGTH        (4 + 4 + 2 + 4 + 2 + 2 + 4 + 4 + 1 + 1 + 1 + 1)
+#define IPMISELD_DATA_CACHE_FILE_VERSION_2 0x00000002
+
+#define IPMISELD_DATA_CACHE_FILE_VERSION  IPMISELD_DATA_CACHE_FILE_VERSION_2
+
+#define IPMISELD_DATA_CACHE_LENGTH_1      (4 + 4 + 2 + 4 + 2 + 2 + 4 + 4 + 1 + 1 + 1 + 1)
+
+#define IPMISELD_DATA_CACHE_LENGTH_2      (IPMISELD_DATA_CACHE_LENGTH_1 + 4 + 4)
+
+#define IPMISELD_DATA_CACHE_LENGTH        IPMISELD_DATA_CACHE_LENGTH_2
+
+/*
+ * State Database Format
+ *
+ * All numbers stored little endian
+ *
+ * Header, IPMISELD_STATE_DB_HEADER_LENGTH bytes:
+ *
+ * uint32_t file_magic
+ * uint32_t file_version
+ * uint32_t slot_count
+ * zero padding
+ *
+ * Followed by slot_count slots, IPMISELD_STATE_DB_SLOT_LENGTH bytes
+ * each:
+ *
+ * char hostname[IPMISELD_STATE_DB_HOSTNAME_LENGTH], empty if unused
+ * two copies of:
+ *   uint32_t sequence
+ *   uint8_t data[IPMISELD_DATA_CACHE_LENGTH], in data cache format
+ *   uint8_t zerosumchecksum, of hostname, sequence, and data
+ * zero padding
+ *
+ * A host's state is written to the copy with the older sequence
+ * number, so the latest state survives a crash in the middle of an
+ * update.
+ */
+
+#define IPMISELD_STATE_DB_FILENAME        "ipmiseldstate"
+
+#define IPMISELD_STATE_DB_FILE_MAGIC      0x4A1B11E7
+
+#define IPMISELD_STATE_DB_FILE_VERSION    0x00000001
+
+#define IPMISELD_STATE_DB_HEADER_LENGTH   64
+
+#define IPMISELD_STATE_DB_HOSTNAME_LENGTH 256
+
+#define IPMISELD_STATE_DB_SEQUENCE_LENGTH 4
+
+#define IPMISELD_STATE_DB_COPY_LENGTH     (IPMISELD_STATE_DB_SEQUENCE_LENGTH + IPMISELD_DATA_CACHE_LENGTH + 1)
+
+#define IPMISELD_STATE_DB_SLOT_COPIES     2
+
+#define IPMISELD_STATE_DB_SLOT_LENGTH     384
+
+/* in seconds */
+#define IPMISELD_STATE_DB_SYNC_INTERVAL   30
+
+/* set once by ipmiseld_state_db_init(), selects the backend without
+ * looking at state_db, which is remapped when the database grows
+ */
+static int state_db_enabled = 0;
+static int state_db_fd = -1;
+/* state_db and everything below only accessed with state_db_lock
+ * held once hosts are polled
+ */
+static uint8_t *state_db = NULL;
+static size_t state_db_len = 0;
+static unsigned int state_db_slot_count = 0;
+static unsigned int state_db_next_free = 0;
+static hash_t state_db_hosts = NULL;
+static struct timeval state_db_last_sync;
+static pthread_mutex_t state_db_lock = PTHREAD_MUTEX_INITIALIZER;
 
 static int
 _ipmiseld_sdr_cache_create (ipmiseld_host_data_t *host_data,
@@ -228,6 +317,8 @@ ipmiseld_sdr_cache_create_and_load (ipmiseld_host_data_t *host_data)
           goto cleanup;
         }
 
+      ipmiseld_stats_sdr_cache (0);
+
       /* 2nd try after the sdr was retrieved */
       if (ipmi_sdr_cache_open (host_data->host_poll->sdr_ctx,
                                host_data->host_poll->ipmi_ctx,
@@ -239,6 +330,8 @@ ipmiseld_sdr_cache_create_and_load (ipmiseld_host_data_t *host_data)
           goto cleanup;
         }
     }
+  else
+    ipmiseld_stats_sdr_cache (1);
 
   return (0);
 
@@ -250,33 +343,41 @@ ipmiseld_sdr_cache_create_and_load (ipmiseld_host_data_t *host_data)
   return (-1);
 }
 
+static char *
+_cache_directory (ipmiseld_prog_data_t *prog_data)
+{
+  assert (prog_data);
+
+  if (prog_data->args->cache_directory)
+    return (prog_data->args->cache_directory);
+  return (IPMISELD_CACHE_DIRECTORY);
+}
+
+static char *
+_cache_hostname (ipmiseld_host_data_t *host_data)
+{
+  assert (host_data);
+
+  if (host_data->hostname)
+    return (host_data->hostname);
+  return (IPMISELD_CACHE_INBAND);
+}
+
 static void
 _data_cache_filename (ipmiseld_host_data_t *host_data,
                       char *filename_buf,
                       unsigned int filename_buflen)
 {
-  char *sdr_cache_dir;
-  char *hostname;
-
   assert (host_data);
   assert (filename_buf);
   assert (filename_buflen);
 
-  if (host_data->prog_data->args->cache_directory)
-    sdr_cache_dir = host_data->prog_data->args->cache_directory;
-  else
-    sdr_cache_dir = IPMISELD_CACHE_DIRECTORY;
-
-  hostname = host_data->hostname;
-  if (!hostname)
-    hostname = IPMISELD_CACHE_INBAND;
-
   snprintf (filename_buf,
             filename_buflen,
             "%s/%s.%s",
-            sdr_cache_dir,
+            _cache_directory (host_data->prog_data),
             IPMISELD_DATA_CACHE_FILENAME,
-            hostname);
+            _cache_hostname (host_data));
 }
 
 static unsigned int
@@ -318,76 +419,81 @@ _unmarshall_uint8 (uint8_t *databuf, uint8_t *value)
   return (sizeof (uint8_t));
 }
 
-/* returns 1 on data found/loaded, 0 if not found, -1 on error loading
- *  (permission, corrupted, etc.)
- */
-int
-ipmiseld_data_cache_load (ipmiseld_host_data_t *host_data)
+static unsigned int
+_marshall_uint32 (uint8_t *databuf, uint32_t value)
 {
-  uint32_t file_magic;
-  uint32_t file_version;
-  uint8_t zerosumchecksum = 0;
-  char filename[MAXPATHLEN+1];
-  uint8_t databuf[IPMISELD_DATA_CACHE_LENGTH];
-  unsigned int databuf_offset = 0;
-  int databuflen;
-  unsigned int i;
-  int fd = -1;
-  int rv = -1;
+  assert (databuf);
 
-  assert (host_data);
+  /* store little endian */
+  databuf[0] = (value & 0x000000FF);
+  databuf[1] = (value & 0x0000FF00) >> 8;
+  databuf[2] = (value & 0x00FF0000) >> 16;
+  databuf[3] = (value & 0xFF000000) >> 24;
 
-  memset (filename, '\0', MAXPATHLEN + 1);
+  return (sizeof (uint32_t));
+}
 
-  _data_cache_filename (host_data,
-                        filename,
-                        MAXPATHLEN);
+static unsigned int
+_marshall_uint16 (uint8_t *databuf, uint16_t value)
+{
+  assert (databuf);
 
-  if (access (filename, F_OK) < 0)
-    {
-      if (errno != ENOENT)
-        {
-          ipmiseld_err_output (host_data,"Error finding '%s': %s", filename, strerror (errno));
-          goto cleanup;
-        }
+  /* store little endian */
+  databuf[0] = (value & 0x00FF);
+  databuf[1] = (value & 0xFF00) >> 8;
 
-      rv = 0;
-      goto cleanup;
-    }
-  else
-    {
-      if (access (filename, R_OK) < 0)
-        {
-          ipmiseld_err_output (host_data, "Error read accessing '%s': %s", filename, strerror (errno));
-          goto cleanup;
-        }
-    }
+  return (sizeof (uint16_t));
+}
 
-  if ((fd = open (filename, O_RDONLY)) < 0)
-    {
-      ipmiseld_err_output (host_data, "Error opening '%s': %s", filename, strerror (errno));
-      goto cleanup;
-    }
+static unsigned int
+_marshall_uint8 (uint8_t *databuf, uint8_t value)
+{
+  assert (databuf);
 
-  if ((databuflen = fd_read_n (fd, databuf, IPMISELD_DATA_CACHE_LENGTH)) < 0)
-    {
-      ipmiseld_err_output (host_data, "fd_write_n: %s", strerror (errno));
-      goto cleanup;
-    }
+  databuf[0] = value;
 
-  if (databuflen < IPMISELD_DATA_CACHE_LENGTH)
-    {
-      ipmiseld_err_output (host_data, "invalid read length = %d", databuflen);
-      goto cleanup;
-    }
+  return (sizeof (uint8_t));
+}
+
+static uint8_t
+_zerosum (uint8_t *databuf, unsigned int databuflen)
+{
+  uint8_t zerosumchecksum = 0;
+  unsigned int i;
+
+  assert (databuf);
 
   for (i = 0; i < databuflen; i++)
     zerosumchecksum += databuf[i];
 
-  if (zerosumchecksum)
+  return (zerosumchecksum);
+}
+
+/* returns 1 on data loaded, -1 if corrupted or out of date */
+static int
+_data_cache_unmarshall (ipmiseld_host_data_t *host_data,
+                        uint8_t *databuf,
+                        unsigned int databuflen)
+{
+  uint32_t file_magic;
+  uint32_t file_version;
+  unsigned int databuf_offset = 0;
+
+  assert (host_data);
+  assert (databuf);
+
+  /* version 1 caches are shorter, version checked below */
+  if (databuflen != IPMISELD_DATA_CACHE_LENGTH_1
+      && databuflen != IPMISELD_DATA_CACHE_LENGTH_2)
+    {
+      ipmiseld_err_output (host_data, "invalid read length = %u", databuflen);
+      return (-1);
+    }
+
+  if (_zerosum (databuf, databuflen))
     {
       ipmiseld_err_output (host_data, "data cache corrupted");
-      goto cleanup;
+      return (-1);
     }
 
   databuf_offset += _unmarshall_uint32 (databuf + databuf_offset, &file_magic);
@@ -395,15 +501,25 @@ ipmiseld_data_cache_load (ipmiseld_host_data_t *host_data)
   if (file_magic != IPMISELD_DATA_CACHE_FILE_MAGIC)
     {
       ipmiseld_err_output (host_data, "data cache corrupted");
-      goto cleanup;
+      return (-1);
     }
 
   databuf_offset += _unmarshall_uint32 (databuf + databuf_offset, &file_version);
 
-  if (file_version != IPMISELD_DATA_CACHE_FILE_VERSION)
+  if (file_version != IPMISELD_DATA_CACHE_FILE_VERSION_1
+      && file_version != IPMISELD_DATA_CACHE_FILE_VERSION_2)
     {
       ipmiseld_err_output (host_data, "data cache out of date");
-      goto cleanup;
+      return (-1);
+    }
+
+  if ((file_version == IPMISELD_DATA_CACHE_FILE_VERSION_1
+       && databuflen != IPMISELD_DATA_CACHE_LENGTH_1)
+      || (file_version == IPMISELD_DATA_CACHE_FILE_VERSION_2
+          && databuflen != IPMISELD_DATA_CACHE_LENGTH_2))
+    {
+      ipmiseld_err_output (host_data, "data cache corrupted");
+      return (-1);
     }
 
   databuf_offset += _unmarshall_uint16 (databuf + databuf_offset, &host_data->last_host_state.last_record_id.record_id);
@@ -416,60 +532,114 @@ ipmiseld_data_cache_load (ipmiseld_host_data_t *host_data)
   databuf_offset += _unmarshall_uint8 (databuf + databuf_offset, &host_data->last_host_state.sel_info.delete_sel_command_supported);
   databuf_offset += _unmarshall_uint8 (databuf + databuf_offset, &host_data->last_host_state.sel_info.reserve_sel_command_supported);
   databuf_offset += _unmarshall_uint8 (databuf + databuf_offset, &host_data->last_host_state.sel_info.overflow_flag);
+
+  /* version 1 has no fill rate, it will be learned again */
+  if (file_version == IPMISELD_DATA_CACHE_FILE_VERSION_2)
+    {
+      databuf_offset += _unmarshall_uint32 (databuf + databuf_offset, &host_data->last_host_state.fill_rate);
+      databuf_offset += _unmarshall_uint32 (databuf + databuf_offset, &host_data->last_host_state.fill_rate_timestamp);
+    }
+  else
+    {
+      host_data->last_host_state.fill_rate = 0;
+      host_data->last_host_state.fill_rate_timestamp = 0;
+    }
   host_data->last_host_state.initialized = 1;
 
-  rv = 1;
- cleanup:
-  close (fd);
-  return (rv);
+  return (1);
 }
 
-static unsigned int
-_marshall_uint32 (uint8_t *databuf, uint32_t value)
+/* databuf must be IPMISELD_DATA_CACHE_LENGTH bytes */
+static void
+_data_cache_marshall (ipmiseld_host_data_t *host_data, uint8_t *databuf)
 {
+  unsigned int databuf_offset = 0;
+
+  assert (host_data);
   assert (databuf);
 
-  /* store little endian */
-  databuf[0] = (value & 0x000000FF);
-  databuf[1] = (value & 0x0000FF00) >> 8;
-  databuf[2] = (value & 0x00FF0000) >> 16;
-  databuf[3] = (value & 0xFF000000) >> 24;
+  databuf_offset += _marshall_uint32 (databuf + databuf_offset, IPMISELD_DATA_CACHE_FILE_MAGIC);
+  databuf_offset += _marshall_uint32 (databuf + databuf_offset, IPMISELD_DATA_CACHE_FILE_VERSION);
+  databuf_offset += _marshall_uint16 (databuf + databuf_offset, host_data->last_host_state.last_record_id.record_id);
+  databuf_offset += _marshall_uint32 (databuf + databuf_offset, host_data->last_host_state.last_percent_full);
+  databuf_offset += _marshall_uint16 (databuf + databuf_offset, host_data->last_host_state.sel_info.entries);
+  databuf_offset += _marshall_uint16 (databuf + databuf_offset, host_data->last_host_state.sel_info.free_space);
+  databuf_offset += _marshall_uint32 (databuf + databuf_offset, host_data->last_host_state.sel_info.most_recent_addition_timestamp);
+  databuf_offset += _marshall_uint32 (databuf + databuf_offset, host_data->last_host_state.sel_info.most_recent_erase_timestamp);
+  databuf_offset += _marshall_uint8 (databuf + databuf_offset, host_data->last_host_state.sel_info.delete_sel_command_supported);
+  databuf_offset += _marshall_uint8 (databuf + databuf_offset, host_data->last_host_state.sel_info.reserve_sel_command_supported);
+  databuf_offset += _marshall_uint8 (databuf + databuf_offset, host_data->last_host_state.sel_info.overflow_flag);
+  databuf_offset += _marshall_uint32 (databuf + databuf_offset, host_data->last_host_state.fill_rate);
+  databuf_offset += _marshall_uint32 (databuf + databuf_offset, host_data->last_host_state.fill_rate_timestamp);
 
-  return (sizeof (uint32_t));
+  databuf_offset += _marshall_uint8 (databuf + databuf_offset, 0xFF - _zerosum (databuf, databuf_offset) + 1);
+
+  assert (databuf_offset == IPMISELD_DATA_CACHE_LENGTH);
 }
 
-static unsigned int
-_marshall_uint16 (uint8_t *databuf, uint16_t value)
+/* returns 1 on data found/loaded, 0 if not found, -1 on error loading
+ *  (permission, corrupted, etc.)
+ */
+static int
+_data_cache_file_load (ipmiseld_host_data_t *host_data)
 {
-  assert (databuf);
+  char filename[MAXPATHLEN+1];
+  uint8_t databuf[IPMISELD_DATA_CACHE_LENGTH];
+  int databuflen;
+  int fd = -1;
+  int rv = -1;
 
-  /* store little endian */
-  databuf[0] = (value & 0x00FF);
-  databuf[1] = (value & 0xFF00) >> 8;
+  assert (host_data);
 
-  return (sizeof (uint16_t));
-}
+  memset (filename, '\0', MAXPATHLEN + 1);
 
-static unsigned int
-_marshall_uint8 (uint8_t *databuf, uint8_t value)
-{
-  assert (databuf);
+  _data_cache_filename (host_data,
+                        filename,
+                        MAXPATHLEN);
 
-  databuf[0] = value;
+  if (access (filename, F_OK) < 0)
+    {
+      if (errno != ENOENT)
+        {
+          ipmiseld_err_output (host_data,"Error finding '%s': %s", filename, strerror (errno));
+          goto cleanup;
+        }
 
-  return (sizeof (uint8_t));
+      rv = 0;
+      goto cleanup;
+    }
+  else
+    {
+      if (access (filename, R_OK) < 0)
+        {
+          ipmiseld_err_output (host_data, "Error read accessing '%s': %s", filename, strerror (errno));
+          goto cleanup;
+        }
+    }
+
+  if ((fd = open (filename, O_RDONLY)) < 0)
+    {
+      ipmiseld_err_output (host_data, "Error opening '%s': %s", filename, strerror (errno));
+      goto cleanup;
+    }
+
+  if ((databuflen = fd_read_n (fd, databuf, IPMISELD_DATA_CACHE_LENGTH)) < 0)
+    {
+      ipmiseld_err_output (host_data, "fd_write_n: %s", strerror (errno));
+      goto cleanup;
+    }
+
+  rv = _data_cache_unmarshall (host_data, databuf, databuflen);
+ cleanup:
+  close (fd);
+  return (rv);
 }
 
-int
-ipmiseld_data_cache_store (ipmiseld_host_data_t *host_data)
+static int
+_data_cache_file_store (ipmiseld_host_data_t *host_data)
 {
-  uint32_t file_magic = IPMISELD_DATA_CACHE_FILE_MAGIC;
-  uint32_t file_version = IPMISELD_DATA_CACHE_FILE_VERSION;
   char filename[MAXPATHLEN+1];
   uint8_t databuf[IPMISELD_DATA_CACHE_LENGTH];
-  unsigned int databuf_offset = 0;
-  uint8_t zerosumchecksum = 0;
-  unsigned int i;
   int n;
   int open_flags;
   int file_found = 0;
@@ -514,32 +684,15 @@ ipmiseld_data_cache_store (ipmiseld_host_data_t *host_data)
       goto cleanup;
     }
 
-  databuf_offset += _marshall_uint32 (databuf + databuf_offset, file_magic);
-  databuf_offset += _marshall_uint32 (databuf + databuf_offset, file_version);
-  databuf_offset += _marshall_uint16 (databuf + databuf_offset, host_data->last_host_state.last_record_id.record_id);
-  databuf_offset += _marshall_uint32 (databuf + databuf_offset, host_data->last_host_state.last_percent_full);
-  databuf_offset += _marshall_uint16 (databuf + databuf_offset, host_data->last_host_state.sel_info.entries);
-  databuf_offset += _marshall_uint16 (databuf + databuf_offset, host_data->last_host_state.sel_info.free_space);
-  databuf_offset += _marshall_uint32 (databuf + databuf_offset, host_data->last_host_state.sel_info.most_recent_addition_timestamp);
-  databuf_offset += _marshall_uint32 (databuf + databuf_offset, host_data->last_host_state.sel_info.most_recent_erase_timestamp);
-  databuf_offset += _marshall_uint8 (databuf + databuf_offset, host_data->last_host_state.sel_info.delete_sel_command_supported);
-  databuf_offset += _marshall_uint8 (databuf + databuf_offset, host_data->last_host_state.sel_info.reserve_sel_command_supported);
-  databuf_offset += _marshall_uint8 (databuf + databuf_offset, host_data->last_host_state.sel_info.overflow_flag);
-
-  for (i = 0; i < databuf_offset; i++)
-    zerosumchecksum += databuf[i];
-
-  databuf_offset += _marshall_uint8 (databuf + databuf_offset, 0xFF - zerosumchecksum + 1);
-
-  assert (databuf_offset == IPMISELD_DATA_CACHE_LENGTH);
+  _data_cache_marshall (host_data, databuf);
 
-  if ((n = fd_write_n (fd, databuf, databuf_offset)) < 0)
+  if ((n = fd_write_n (fd, databuf, IPMISELD_DATA_CACHE_LENGTH)) < 0)
     {
       ipmiseld_err_output (host_data, "fd_write_n: %s", strerror (errno));
       goto cleanup;
     }
 
-  if (n != databuf_offset)
+  if (n != IPMISELD_DATA_CACHE_LENGTH)
     {
       ipmiseld_err_output (host_data, "incomplete write");
       goto cleanup;
@@ -566,3 +719,503 @@ ipmiseld_data_cache_store (ipmiseld_host_data_t *host_data)
     }
   return (rv);
 }
+
+static uint8_t *
+_state_db_slot (unsigned int slot)
+{
+  assert (state_db);
+  assert (slot < state_db_slot_count);
+
+  return (state_db + IPMISELD_STATE_DB_HEADER_LENGTH + (slot * IPMISELD_STATE_DB_SLOT_LENGTH));
+}
+
+static uint8_t *
+_state_db_copy (unsigned int slot, unsigned int copy)
+{
+  assert (copy < IPMISELD_STATE_DB_SLOT_COPIES);
+
+  return (_state_db_slot (slot)
+          + IPMISELD_STATE_DB_HOSTNAME_LENGTH
+          + (copy * IPMISELD_STATE_DB_COPY_LENGTH));
+}
+
+/* returns the copy with the latest valid state, -1 if none */
+static int
+_state_db_latest_copy (unsigned int slot, uint32_t *sequence)
+{
+  uint8_t *slotbuf;
+  uint32_t latest_sequence = 0;
+  int latest = -1;
+  unsigned int i;
+
+  slotbuf = _state_db_slot (slot);
+
+  for (i = 0; i < IPMISELD_STATE_DB_SLOT_COPIES; i++)
+    {
+      uint8_t *copybuf = _state_db_copy (slot, i);
+      uint32_t seq;
+
+      /* checksum covers the hostname, so a copy can't be mistaken
+       * for another host's state
+       */
+      if ((uint8_t)(_zerosum (slotbuf, IPMISELD_STATE_DB_HOSTNAME_LENGTH)
+                    + _zerosum (copybuf, IPMISELD_STATE_DB_COPY_LENGTH)))
+        continue;
+
+      _unmarshall_uint32 (copybuf, &seq);
+      if (!seq)
+        continue;
+
+      if (latest < 0 || seq > latest_sequence)
+        {
+          latest = i;
+          latest_sequence = seq;
+        }
+    }
+
+  if (sequence)
+    (*sequence) = latest_sequence;
+  return (latest);
+}
+
+static void
+_state_db_header_write (void)
+{
+  unsigned int offset = 0;
+
+  assert (state_db);
+
+  offset += _marshall_uint32 (state_db + offset, IPMISELD_STATE_DB_FILE_MAGIC);
+  offset += _marshall_uint32 (state_db + offset, IPMISELD_STATE_DB_FILE_VERSION);
+  offset += _marshall_uint32 (state_db + offset, state_db_slot_count);
+}
+
+/* (re)map the state database for slot_count slots.  The old mapping
+ * is only replaced once the new one exists, so on error the database
+ * is still mapped as before.
+ */
+static int
+_state_db_map (unsigned int slot_count)
+{
+  size_t len;
+  void *ptr;
+
+  assert (state_db_fd >= 0);
+  assert (slot_count >= state_db_slot_count);
+
+  len = IPMISELD_STATE_DB_HEADER_LENGTH + ((size_t)slot_count * IPMISELD_STATE_DB_SLOT_LENGTH);
+
+  /* growing the file leaves the old mapping valid */
+  if (ftruncate (state_db_fd, len) < 0)
+    {
+      err_output ("ftruncate: %s", strerror (errno));
+      return (-1);
+    }
+
+  if ((ptr = mmap (NULL,
+                   len,
+                   PROT_READ | PROT_WRITE,
+                   MAP_SHARED,
+                   state_db_fd,
+                   0)) == MAP_FAILED)
+    {
+      err_output ("mmap: %s", strerror (errno));
+      return (-1);
+    }
+
+  if (state_db)
+    {
+      /* both mappings share the file's pages, the sync only gets the
+       * old state to disk before the new mapping is used
+       */
+      if (msync (state_db, state_db_len, MS_SYNC) < 0)
+        err_output ("msync: %s", strerror (errno));
+      /* ignore potential error, cleanup path */
+      munmap (state_db, state_db_len);
+    }
+
+  state_db = (uint8_t *)ptr;
+  state_db_len = len;
+  state_db_slot_count = slot_count;
+  _state_db_header_write ();
+  return (0);
+}
+
+struct ipmiseld_state_db_host
+{
+  char *hostname;
+  unsigned int slot;
+};
+
+static void
+_state_db_host_free (void *x)
+{
+  struct ipmiseld_state_db_host *db_host;
+
+  assert (x);
+
+  db_host = (struct ipmiseld_state_db_host *)x;
+  free (db_host->hostname);
+  free (db_host);
+}
+
+static int
+_state_db_host_add (const char *hostname, unsigned int slot)
+{
+  struct ipmiseld_state_db_host *db_host;
+
+  assert (hostname);
+
+  if (!(db_host = (struct ipmiseld_state_db_host *)malloc (sizeof (struct ipmiseld_state_db_host))))
+    {
+      err_output ("malloc: %s", strerror (errno));
+      return (-1);
+    }
+
+  if (!(db_host->hostname = strdup (hostname)))
+    {
+      err_output ("strdup: %s", strerror (errno));
+      free (db_host);
+      return (-1);
+    }
+  db_host->slot = slot;
+
+  if (!hash_insert (state_db_hosts, db_host->hostname, db_host))
+    {
+      /* duplicate, keep the first slot */
+      _state_db_host_free (db_host);
+      return (0);
+    }
+
+  return (0);
+}
+
+/* Is the hostname of a slot still one of the configured hosts */
+static int
+_state_db_host_configured (ipmiseld_prog_data_t *prog_data,
+                           fi_hostlist_t hlist,
+                           const char *hostname)
+{
+  assert (prog_data);
+  assert (hostname);
+
+  if (!prog_data->args->common_args.hostname)
+    return (!strcmp (hostname, IPMISELD_CACHE_INBAND));
+
+  if (!strcmp (hostname, prog_data->args->common_args.hostname))
+    return (1);
+
+  return (hlist && fi_hostlist_find (hlist, hostname) >= 0);
+}
+
+int
+ipmiseld_state_db_init (ipmiseld_prog_data_t *prog_data, unsigned int hosts_count)
+{
+  char filename[MAXPATHLEN+1];
+  fi_hostlist_t hlist = NULL;
+  struct stat buf;
+  uint32_t file_magic = 0;
+  uint32_t file_version = 0;
+  uint32_t slot_count = 0;
+  unsigned int i;
+
+  assert (prog_data);
+  assert (state_db_fd < 0);
+  assert (IPMISELD_STATE_DB_HOSTNAME_LENGTH
+          + IPMISELD_STATE_DB_SLOT_COPIES * IPMISELD_STATE_DB_COPY_LENGTH
+          <= IPMISELD_STATE_DB_SLOT_LENGTH);
+
+  memset (filename, '\0', MAXPATHLEN + 1);
+
+  snprintf (filename,
+            MAXPATHLEN,
+            "%s/%s",
+            _cache_directory (prog_data),
+            IPMISELD_STATE_DB_FILENAME);
+
+  if ((state_db_fd = open (filename, O_RDWR | O_CREAT, 0644)) < 0)
+    {
+      err_output ("Error opening '%s': %s", filename, strerror (errno));
+      goto cleanup;
+    }
+
+  if (fd_get_write_lock (state_db_fd) < 0)
+    {
+      err_output ("Error locking '%s': %s", filename, strerror (errno));
+      goto cleanup;
+    }
+
+  if (fstat (state_db_fd, &buf) < 0)
+    {
+      err_output ("fstat: %s", strerror (errno));
+      goto cleanup;
+    }
+
+  if (buf.st_size >= IPMISELD_STATE_DB_HEADER_LENGTH)
+    {
+      uint8_t header[IPMISELD_STATE_DB_HEADER_LENGTH];
+      unsigned int offset = 0;
+
+      if (fd_read_n (state_db_fd, header, IPMISELD_STATE_DB_HEADER_LENGTH) != IPMISELD_STATE_DB_HEADER_LENGTH)
+        {
+          err_output ("Error reading '%s': %s", filename, strerror (errno));
+          goto cleanup;
+        }
+
+      offset += _unmarshall_uint32 (header + offset, &file_magic);
+      offset += _unmarshall_uint32 (header + offset, &file_version);
+      offset += _unmarshall_uint32 (header + offset, &slot_count);
+    }
+
+  /* slots past the end of a partially grown file are lost */
+  if (file_magic == IPMISELD_STATE_DB_FILE_MAGIC
+      && file_version == IPMISELD_STATE_DB_FILE_VERSION)
+    {
+      uint64_t max_slot_count = (buf.st_size - IPMISELD_STATE_DB_HEADER_LENGTH) / IPMISELD_STATE_DB_SLOT_LENGTH;
+
+      if (slot_count > max_slot_count)
+        slot_count = max_slot_count;
+    }
+  else
+    {
+      if (buf.st_size)
+        err_output ("'%s' invalid, state will be reloaded from per host caches", filename);
+      slot_count = 0;
+
+      /* don't map stale slots of an unknown format */
+      if (ftruncate (state_db_fd, 0) < 0)
+        {
+          err_output ("ftruncate: %s", strerror (errno));
+          goto cleanup;
+        }
+    }
+
+  if (!(state_db_hosts = hash_create (hosts_count + slot_count,
+                                      (hash_key_f)hash_key_string,
+                                      (hash_cmp_f)strcmp,
+                                      (hash_del_f)_state_db_host_free)))
+    {
+      err_output ("hash_create: %s", strerror (errno));
+      goto cleanup;
+    }
+
+  if (_state_db_map (slot_count > hosts_count ? slot_count : hosts_count) < 0)
+    goto cleanup;
+
+  if (prog_data->args->common_args.hostname
+      && !(hlist = fi_hostlist_create (prog_data->args->common_args.hostname)))
+    {
+      err_output ("fi_hostlist_create: %s", strerror (errno));
+      goto cleanup;
+    }
+
+  state_db_next_free = 0;
+  for (i = 0; i < slot_count; i++)
+    {
+      char *hostname = (char *)_state_db_slot (i);
+
+      if (!hostname[0])
+        continue;
+
+      /* not a hostname, or a host no longer polled, free the slot so
+       * it is reused rather than growing the file
+       */
+      if (memchr (hostname, '\0', IPMISELD_STATE_DB_HOSTNAME_LENGTH) == NULL
+          || !_state_db_host_configured (prog_data, hlist, hostname))
+        {
+          memset (hostname, '\0', IPMISELD_STATE_DB_SLOT_LENGTH);
+          continue;
+        }
+
+      if (_state_db_host_add (hostname, i) < 0)
+        goto cleanup;
+    }
+
+  if (hlist)
+    fi_hostlist_destroy (hlist);
+
+  gettimeofday (&state_db_last_sync, NULL);
+  state_db_enabled = 1;
+  return (0);
+
+ cleanup:
+  if (hlist)
+    fi_hostlist_destroy (hlist);
+  ipmiseld_state_db_cleanup ();
+  return (-1);
+}
+
+void
+ipmiseld_state_db_cleanup (void)
+{
+  state_db_enabled = 0;
+
+  if (state_db)
+    {
+      if (msync (state_db, state_db_len, MS_SYNC) < 0)
+        err_output ("msync: %s", strerror (errno));
+      /* ignore potential error, cleanup path */
+      munmap (state_db, state_db_len);
+      state_db = NULL;
+      state_db_len = 0;
+    }
+  state_db_slot_count = 0;
+
+  if (state_db_hosts)
+    {
+      hash_destroy (state_db_hosts);
+      state_db_hosts = NULL;
+    }
+
+  if (state_db_fd >= 0)
+    {
+      /* closing releases the lock */
+      close (state_db_fd);
+      state_db_fd = -1;
+    }
+}
+
+/* returns 1 on data found/loaded, 0 if not found, -1 on error
+ * loading, as ipmiseld_data_cache_load().  State not yet in the
+ * database is loaded from the per host cache.
+ */
+static int
+_state_db_load (ipmiseld_host_data_t *host_data)
+{
+  struct ipmiseld_state_db_host *db_host;
+  uint8_t databuf[IPMISELD_DATA_CACHE_LENGTH];
+  int copy;
+
+  assert (host_data);
+
+  pthread_mutex_lock (&state_db_lock);
+
+  if (!(db_host = hash_find (state_db_hosts, _cache_hostname (host_data))))
+    {
+      pthread_mutex_unlock (&state_db_lock);
+      return (_data_cache_file_load (host_data));
+    }
+
+  if ((copy = _state_db_latest_copy (db_host->slot, NULL)) < 0)
+    {
+      pthread_mutex_unlock (&state_db_lock);
+      ipmiseld_err_output (host_data, "state database entry corrupted");
+      return (-1);
+    }
+
+  memcpy (databuf,
+          _state_db_copy (db_host->slot, copy) + IPMISELD_STATE_DB_SEQUENCE_LENGTH,
+          IPMISELD_DATA_CACHE_LENGTH);
+
+  pthread_mutex_unlock (&state_db_lock);
+
+  return (_data_cache_unmarshall (host_data, databuf, IPMISELD_DATA_CACHE_LENGTH));
+}
+
+static int
+_state_db_store (ipmiseld_host_data_t *host_data)
+{
+  struct ipmiseld_state_db_host *db_host;
+  struct timeval now;
+  char *hostname;
+  uint8_t *slotbuf;
+  uint8_t *copybuf;
+  uint32_t sequence;
+  unsigned int offset = 0;
+  int copy;
+  int rv = -1;
+
+  assert (host_data);
+
+  hostname = _cache_hostname (host_data);
+
+  if (strlen (hostname) >= IPMISELD_STATE_DB_HOSTNAME_LENGTH)
+    return (_data_cache_file_store (host_data));
+
+  pthread_mutex_lock (&state_db_lock);
+
+  if (!(db_host = hash_find (state_db_hosts, hostname)))
+    {
+      while (state_db_next_free < state_db_slot_count
+             && _state_db_slot (state_db_next_free)[0])
+        state_db_next_free++;
+
+      if (state_db_next_free == state_db_slot_count)
+        {
+          if (_state_db_map (state_db_slot_count ? state_db_slot_count * 2 : 1) < 0)
+            goto cleanup;
+        }
+
+      slotbuf = _state_db_slot (state_db_next_free);
+      memset (slotbuf, '\0', IPMISELD_STATE_DB_SLOT_LENGTH);
+      strcpy ((char *)slotbuf, hostname);
+
+      if (_state_db_host_add (hostname, state_db_next_free) < 0)
+        goto cleanup;
+
+      if (!(db_host = hash_find (state_db_hosts, hostname)))
+        goto cleanup;
+    }
+
+  slotbuf = _state_db_slot (db_host->slot);
+
+  /* overwrite the older copy, the latest stays intact if the write
+   * is torn by a crash
+   */
+  if ((copy = _state_db_latest_copy (db_host->slot, &sequence)) < 0)
+    {
+      copy = 0;
+      sequence = 0;
+    }
+  else
+    copy = (copy + 1) % IPMISELD_STATE_DB_SLOT_COPIES;
+
+  copybuf = _state_db_copy (db_host->slot, copy);
+
+  offset += _marshall_uint32 (copybuf + offset, sequence + 1);
+  _data_cache_marshall (host_data, copybuf + offset);
+  offset += IPMISELD_DATA_CACHE_LENGTH;
+  _marshall_uint8 (copybuf + offset,
+                   0xFF - (uint8_t)(_zerosum (slotbuf, IPMISELD_STATE_DB_HOSTNAME_LENGTH)
+                                    + _zerosum (copybuf, offset)) + 1);
+
+  /* flushed periodically rather than on every poll of every host */
+  gettimeofday (&now, NULL);
+  if (now.tv_sec - state_db_last_sync.tv_sec >= IPMISELD_STATE_DB_SYNC_INTERVAL
+      || now.tv_sec < state_db_last_sync.tv_sec)
+    {
+      if (msync (state_db, state_db_len, MS_SYNC) < 0)
+        ipmiseld_err_output (host_data, "msync: %s", strerror (errno));
+      state_db_last_sync = now;
+    }
+
+  rv = 0;
+ cleanup:
+  pthread_mutex_unlock (&state_db_lock);
+  return (rv);
+}
+
+/* returns 1 on data found/loaded, 0 if not found, -1 on error loading
+ *  (permission, corrupted, etc.)
+ */
+int
+ipmiseld_data_cache_load (ipmiseld_host_data_t *host_data)
+{
+  assert (host_data);
+
+  if (state_db_enabled)
+    return (_state_db_load (host_data));
+
+  return (_data_cache_file_load (host_data));
+}
+
+int
+ipmiseld_data_cache_store (ipmiseld_host_data_t *host_data)
+{
+  assert (host_data);
+
+  if (state_db_enabled)
+    return (_state_db_store (host_data));
+
+  return (_data_cache_file_store (host_data));
+}
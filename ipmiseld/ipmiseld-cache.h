@@ -37,4 +37,11 @@ int ipmiseld_data_cache_load (ipmiseld_host_data_t *host_data);
 
 int ipmiseld_data_cache_store (ipmiseld_host_data_t *host_data);
 
+/* Keep the data cache of all hosts in one memory mapped file rather
+ * than a file per host.
+ */
+int ipmiseld_state_db_init (ipmiseld_prog_data_t *prog_data, unsigned int hosts_count);
+
+void ipmiseld_state_db_cleanup (void);
+
 #endif /* IPMISELD_CACHE_H */
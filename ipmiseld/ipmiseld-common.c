@@ -41,6 +41,7 @@
 
 #include "ipmiseld.h"
 #include "ipmiseld-common.h"
+#include "ipmiseld-output.h"
 
 #include "freeipmi-portability.h"
 #include "error.h"
@@ -142,6 +143,37 @@ ipmiseld_log_priority_parse (const char *str)
   return (-1);
 }
 
+int
+ipmiseld_log_queue_overflow_parse (const char *str)
+{
+  assert (str);
+
+  if (!strcasecmp (str, "BLOCK"))
+    return (IPMISELD_LOG_QUEUE_OVERFLOW_BLOCK);
+  else if (!strcasecmp (str, "DROP-OLDEST")
+           || !strcasecmp (str, "DROP_OLDEST"))
+    return (IPMISELD_LOG_QUEUE_OVERFLOW_DROP_OLDEST);
+  else if (!strcasecmp (str, "DROP-NEWEST")
+           || !strcasecmp (str, "DROP_NEWEST"))
+    return (IPMISELD_LOG_QUEUE_OVERFLOW_DROP_NEWEST);
+  return (-1);
+}
+
+static void
+_ipmiseld_output (ipmiseld_prog_data_t *prog_data, const char *buf)
+{
+  assert (prog_data);
+  assert (buf);
+
+  if (ipmiseld_output_queue (buf))
+    return;
+
+  if (prog_data->args->test_run
+      || prog_data->args->foreground)
+    printf ("%s\n", buf);
+  else
+    syslog (prog_data->log_priority, "%s", buf);
+}
 
 static void
 _ipmiseld_syslog (ipmiseld_host_data_t *host_data,
@@ -153,11 +185,7 @@ _ipmiseld_syslog (ipmiseld_host_data_t *host_data,
   memset (buf, '\0', IPMISELD_ERR_BUFLEN + 1);
   vsnprintf(buf, IPMISELD_ERR_BUFLEN, message, ap);
 
-  if (host_data->prog_data->args->test_run
-      || host_data->prog_data->args->foreground)
-    printf ("%s\n", buf);
-  else
-    syslog (host_data->prog_data->log_priority, "%s", buf);
+  _ipmiseld_output (host_data->prog_data, buf);
 }
 
 void
@@ -191,21 +219,37 @@ ipmiseld_syslog_host (ipmiseld_host_data_t *host_data,
   else
     {
       char buf[IPMISELD_ERR_BUFLEN + 1];
+      int len;
+
       memset (buf, '\0', IPMISELD_ERR_BUFLEN + 1);
-      vsnprintf(buf, IPMISELD_ERR_BUFLEN, message, ap);
+      len = snprintf (buf, IPMISELD_ERR_BUFLEN, "%s: ", host_data->hostname);
+      if (len >= 0 && len < IPMISELD_ERR_BUFLEN)
+        vsnprintf(buf + len, IPMISELD_ERR_BUFLEN - len, message, ap);
 
-      if (host_data->prog_data->args->test_run
-          || host_data->prog_data->args->foreground)
-        printf ("%s: %s\n", host_data->hostname, buf);
-      else
-        syslog (host_data->prog_data->log_priority,
-                "%s: %s",
-                host_data->hostname,
-                buf);
+      _ipmiseld_output (host_data->prog_data, buf);
     }
   va_end (ap);
 }
 
+void
+ipmiseld_syslog_prog (ipmiseld_prog_data_t *prog_data,
+                      const char *message,
+                      ...)
+{
+  char buf[IPMISELD_ERR_BUFLEN + 1];
+  va_list ap;
+
+  assert (prog_data);
+  assert (message);
+  memset (buf, '\0', IPMISELD_ERR_BUFLEN + 1);
+
+  va_start (ap, message);
+  vsnprintf(buf, IPMISELD_ERR_BUFLEN, message, ap);
+  va_end (ap);
+
+  _ipmiseld_output (prog_data, buf);
+}
+
 void
 ipmiseld_err_output (ipmiseld_host_data_t *host_data,
                      const char *message,
@@ -33,12 +33,18 @@
 #define IPMISELD_CRITICAL_FILTER 0x04
 #define IPMISELD_NA_FILTER       0x08
 
+#define IPMISELD_LOG_QUEUE_OVERFLOW_BLOCK       0
+#define IPMISELD_LOG_QUEUE_OVERFLOW_DROP_OLDEST 1
+#define IPMISELD_LOG_QUEUE_OVERFLOW_DROP_NEWEST 2
+
 int ipmiseld_event_state_filter_parse (const char *str);
 
 int ipmiseld_log_facility_parse (const char *str);
 
 int ipmiseld_log_priority_parse (const char *str);
 
+int ipmiseld_log_queue_overflow_parse (const char *str);
+
 void ipmiseld_syslog (ipmiseld_host_data_t *host_data,
                       const char *message,
                       ...);
@@ -47,6 +53,11 @@ void ipmiseld_syslog_host (ipmiseld_host_data_t *host_data,
                            const char *message,
                            ...);
 
+/* for messages about the daemon itself rather than a host */
+void ipmiseld_syslog_prog (ipmiseld_prog_data_t *prog_data,
+                           const char *message,
+                           ...);
+
 void ipmiseld_err_output (ipmiseld_host_data_t *host_data,
                           const char *message,
                           ...);
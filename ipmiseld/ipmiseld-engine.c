@@ -0,0 +1,2101 @@
+/*****************************************************************************\
+ *  $Id: ipmiseld.h,v 1.11 2010-02-08 22:02:30 chu11 Exp $
+ *****************************************************************************
+ *  Copyright (C) 2012-2015 Lawrence Livermore National Security, LLC.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  Written by Albert Chu <chu11@llnl.gov>
+ *  LLNL-CODE-559172
+ *
+ *  This file is part of Ipmiseld, an IPMI SEL syslog logging daemon.
+ *  For details, see https://savannah.gnu.org/projects/freeipmi/.
+ *
+ *  Ipmiseld is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 3 of the License, or (at your
+ *  option) any later version.
+ *
+ *  Ipmiseld is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Ipmiseld.  If not, see <http://www.gnu.org/licenses/>.
+\*****************************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#if STDC_HEADERS
+#include <string.h>
+#endif /* STDC_HEADERS */
+#if TIME_WITH_SYS_TIME
+#include <sys/time.h>
+#include <time.h>
+#else  /* !TIME_WITH_SYS_TIME */
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#else /* !HAVE_SYS_TIME_H */
+#include <time.h>
+#endif  /* !HAVE_SYS_TIME_H */
+#endif /* !TIME_WITH_SYS_TIME */
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netdb.h>
+#include <sys/poll.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif /* HAVE_FCNTL_H */
+#include <limits.h>
+#include <pthread.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <freeipmi/freeipmi.h>
+
+#include "ipmiseld.h"
+#include "ipmiseld-common.h"
+#include "ipmiseld-debug.h"
+#include "ipmiseld-engine.h"
+#include "ipmiseld-stats.h"
+
+#include "freeipmi-portability.h"
+#include "error.h"
+#include "hash.h"
+#include "list.h"
+#include "network.h"
+#include "timeval.h"
+
+#define IPMISELD_ENGINE_PKT_BUFLEN       1024
+
+#define IPMISELD_ENGINE_KEY_BUFLEN       (NI_MAXHOST + NI_MAXSERV + 2)
+
+#define IPMISELD_ENGINE_PORT_BUFLEN      16
+
+#define IPMISELD_ENGINE_HASH_SIZE        1024
+
+#define IPMISELD_ENGINE_NOTIFIER_BUFLEN  64
+
+#define IPMISELD_ENGINE_INITIAL_OUTBOUND_SEQUENCE_NUMBER 1
+
+/* The engine speaks IPMI 1.5 on its own, one state per request in
+ * flight.  Sessions are established the same way as
+ * ipmi_ctx_open_outofband(), SEL entries are then read the same way
+ * as ipmi_sel_parse().
+ */
+typedef enum
+  {
+    IPMISELD_ENGINE_STATE_IDLE = 0,
+    IPMISELD_ENGINE_STATE_AUTHENTICATION_CAPABILITIES = 1,
+    IPMISELD_ENGINE_STATE_GET_SESSION_CHALLENGE = 2,
+    IPMISELD_ENGINE_STATE_ACTIVATE_SESSION = 3,
+    IPMISELD_ENGINE_STATE_SET_SESSION_PRIVILEGE_LEVEL = 4,
+    IPMISELD_ENGINE_STATE_GET_SEL_INFO = 5,
+    IPMISELD_ENGINE_STATE_GET_LAST_SEL_ENTRY = 6,
+    IPMISELD_ENGINE_STATE_GET_SEL_ENTRY = 7,
+    IPMISELD_ENGINE_STATE_GET_DEVICE_ID = 8,
+    IPMISELD_ENGINE_STATE_CLOSE_SESSION = 9,
+    IPMISELD_ENGINE_STATE_COUNT = 10,
+  } ipmiseld_engine_state_t;
+
+#define IPMISELD_ENGINE_STATE_SESSION_SETUP(__s)                        \
+  ((__s) == IPMISELD_ENGINE_STATE_AUTHENTICATION_CAPABILITIES           \
+   || (__s) == IPMISELD_ENGINE_STATE_GET_SESSION_CHALLENGE              \
+   || (__s) == IPMISELD_ENGINE_STATE_ACTIVATE_SESSION)
+
+#define IPMISELD_ENGINE_STATE_SESSION_PACKET(__s)                       \
+  ((__s) >= IPMISELD_ENGINE_STATE_SET_SESSION_PRIVILEGE_LEVEL           \
+   && (__s) <= IPMISELD_ENGINE_STATE_CLOSE_SESSION)
+
+struct ipmiseld_engine_cmd
+{
+  char *name;
+  uint8_t net_fn;
+  uint8_t cmd;
+  fiid_field_t *tmpl_cmd_rq;
+  fiid_field_t *tmpl_cmd_rs;
+};
+
+static struct ipmiseld_engine_cmd engine_cmds[IPMISELD_ENGINE_STATE_COUNT] =
+  {
+    { NULL, 0, 0, NULL, NULL },
+    { "Get Channel Authentication Capabilities",
+      IPMI_NET_FN_APP_RQ,
+      IPMI_CMD_GET_CHANNEL_AUTHENTICATION_CAPABILITIES,
+      tmpl_cmd_get_channel_authentication_capabilities_rq,
+      tmpl_cmd_get_channel_authentication_capabilities_rs },
+    { "Get Session Challenge",
+      IPMI_NET_FN_APP_RQ,
+      IPMI_CMD_GET_SESSION_CHALLENGE,
+      tmpl_cmd_get_session_challenge_rq,
+      tmpl_cmd_get_session_challenge_rs },
+    { "Activate Session",
+      IPMI_NET_FN_APP_RQ,
+      IPMI_CMD_ACTIVATE_SESSION,
+      tmpl_cmd_activate_session_rq,
+      tmpl_cmd_activate_session_rs },
+    { "Set Session Privilege Level",
+      IPMI_NET_FN_APP_RQ,
+      IPMI_CMD_SET_SESSION_PRIVILEGE_LEVEL,
+      tmpl_cmd_set_session_privilege_level_rq,
+      tmpl_cmd_set_session_privilege_level_rs },
+    { "Get SEL Info",
+      IPMI_NET_FN_STORAGE_RQ,
+      IPMI_CMD_GET_SEL_INFO,
+      tmpl_cmd_get_sel_info_rq,
+      tmpl_cmd_get_sel_info_rs },
+    { "Get SEL Entry",
+      IPMI_NET_FN_STORAGE_RQ,
+      IPMI_CMD_GET_SEL_ENTRY,
+      tmpl_cmd_get_sel_entry_rq,
+      tmpl_cmd_get_sel_entry_rs },
+    { "Get SEL Entry",
+      IPMI_NET_FN_STORAGE_RQ,
+      IPMI_CMD_GET_SEL_ENTRY,
+      tmpl_cmd_get_sel_entry_rq,
+      tmpl_cmd_get_sel_entry_rs },
+    { "Get Device ID",
+      IPMI_NET_FN_APP_RQ,
+      IPMI_CMD_GET_DEVICE_ID,
+      tmpl_cmd_get_device_id_rq,
+      tmpl_cmd_get_device_id_rs },
+    { "Close Session",
+      IPMI_NET_FN_APP_RQ,
+      IPMI_CMD_CLOSE_SESSION,
+      tmpl_cmd_close_session_rq,
+      tmpl_cmd_close_session_rs },
+  };
+
+struct ipmiseld_engine_thread;
+
+struct ipmiseld_engine_host
+{
+  ipmiseld_host_data_t *host_data;
+  struct ipmiseld_engine_thread *thread;
+  struct sockaddr_storage addr;
+  socklen_t addrlen;
+  char key[IPMISELD_ENGINE_KEY_BUFLEN];
+  ipmiseld_engine_state_t state;
+  int active;
+  int teardown;
+
+  /* session */
+  int session_open;
+  int session_reused;
+  int session_retried;
+  int permsgauth_enabled;
+  uint32_t temp_session_id;
+  uint8_t challenge_string[IPMI_CHALLENGE_STRING_LENGTH];
+  uint32_t session_id;
+  uint32_t initial_inbound_sequence_number;
+  uint32_t session_sequence_number_count;
+  uint32_t highest_received_sequence_number;
+  uint32_t previously_received_list;
+  unsigned int rq_seq_count;
+  uint8_t rq_seq;
+
+  /* timers */
+  struct timeval retransmission_time;
+  struct timeval timeout_time;
+
+  /* SEL reading */
+  uint16_t record_id;
+  ipmiseld_last_record_id_t last_record_id;
+  int parsed_atleast_one_entry;
+};
+
+struct ipmiseld_engine_thread
+{
+  pthread_t tid;
+  int started;
+  int fd4;
+  int fd6;
+  int notifier_fd[2];
+  /* lock protects hosts, hosts_count, queue, dead, and exit_flag */
+  pthread_mutex_t lock;
+  hash_t hosts;
+  unsigned int hosts_count;
+  List queue;
+  /* destroyed hosts, freed by the engine thread as it may still be
+   * using them
+   */
+  List dead;
+  int exit_flag;
+  /* only accessed by the engine thread */
+  List active;
+  int teardown;
+  fiid_obj_t obj_rmcp_hdr_rq;
+  fiid_obj_t obj_rmcp_hdr_rs;
+  fiid_obj_t obj_lan_session_hdr_rq;
+  fiid_obj_t obj_lan_session_hdr_rs;
+  fiid_obj_t obj_lan_msg_hdr_rq;
+  fiid_obj_t obj_lan_msg_hdr_rs;
+  fiid_obj_t obj_lan_msg_trlr_rs;
+  fiid_obj_t obj_cmd_rq[IPMISELD_ENGINE_STATE_COUNT];
+  fiid_obj_t obj_cmd_rs[IPMISELD_ENGINE_STATE_COUNT];
+};
+
+static struct ipmiseld_engine_thread *engine_threads = NULL;
+static unsigned int engine_threads_len = 0;
+
+static struct ipmiseld_prog_data *engine_prog_data = NULL;
+static struct ipmiseld_engine_callbacks engine_callbacks;
+
+static void _engine_host_state_start (struct ipmiseld_engine_host *h,
+                                      ipmiseld_engine_state_t state);
+
+static unsigned int
+_engine_session_timeout (void)
+{
+  if (engine_prog_data->args->common_args.session_timeout)
+    return (engine_prog_data->args->common_args.session_timeout);
+  return (IPMI_SESSION_TIMEOUT_DEFAULT);
+}
+
+static unsigned int
+_engine_retransmission_timeout (void)
+{
+  if (engine_prog_data->args->common_args.retransmission_timeout)
+    return (engine_prog_data->args->common_args.retransmission_timeout);
+  return (IPMI_RETRANSMISSION_TIMEOUT_DEFAULT);
+}
+
+static int
+_engine_nonblock (int fd)
+{
+  int flags;
+
+  if ((flags = fcntl (fd, F_GETFL, 0)) < 0)
+    {
+      err_output ("fcntl: %s", strerror (errno));
+      return (-1);
+    }
+
+  if (fcntl (fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+      err_output ("fcntl: %s", strerror (errno));
+      return (-1);
+    }
+
+  return (0);
+}
+
+/* returns fd on success, -1 if the address family is not available */
+static int
+_engine_socket (int family)
+{
+  int fd;
+
+  if ((fd = socket (family, SOCK_DGRAM, 0)) < 0)
+    return (-1);
+
+  if (_engine_nonblock (fd) < 0)
+    {
+      /* ignore potential error, error path */
+      close (fd);
+      return (-1);
+    }
+
+  return (fd);
+}
+
+static void
+_engine_notify (struct ipmiseld_engine_thread *t)
+{
+  char c = '\0';
+
+  assert (t);
+
+  /* ignore potential error, if the pipe is full a wakeup is
+   * already pending
+   */
+  if (write (t->notifier_fd[1], &c, 1) < 0)
+    return;
+}
+
+static int
+_engine_fd (struct ipmiseld_engine_thread *t, int family)
+{
+  assert (t);
+
+  if (family == AF_INET)
+    return (t->fd4);
+  else if (family == AF_INET6)
+    return (t->fd6);
+  return (-1);
+}
+
+/* Output errors as ipmiseld_ipmi_setup() and friends do, repeated
+ * errors are limited to every IPMISELD_ERROR_OUTPUT_LIMIT occurrences
+ * unless verbose.
+ */
+static void
+_engine_host_err_output (struct ipmiseld_engine_host *h,
+                         int errnum,
+                         const char *errmsg)
+{
+  ipmiseld_host_data_t *host_data;
+
+  assert (h);
+  assert (errmsg);
+
+  host_data = h->host_data;
+
+  /* keepalive errors are only of interest to the verbose, the next
+   * poll will report any problem
+   */
+  if (h->state == IPMISELD_ENGINE_STATE_GET_DEVICE_ID)
+    {
+      if (host_data->prog_data->args->verbose_count)
+        ipmiseld_err_output (host_data, "%s: %s", engine_cmds[h->state].name, errmsg);
+      return;
+    }
+
+  ipmiseld_stats_ipmi_error (errnum);
+
+  if (host_data->last_ipmi_errnum != errnum
+      || host_data->prog_data->args->verbose_count)
+    {
+      if (IPMISELD_ENGINE_STATE_SESSION_SETUP (h->state)
+          || h->state == IPMISELD_ENGINE_STATE_SET_SESSION_PRIVILEGE_LEVEL)
+        ipmiseld_err_output (host_data, "Error connecting: %s", errmsg);
+      else
+        ipmiseld_err_output (host_data, "%s: %s", engine_cmds[h->state].name, errmsg);
+    }
+
+  if (host_data->last_ipmi_errnum != errnum)
+    {
+      host_data->last_ipmi_errnum = errnum;
+      host_data->last_ipmi_errnum_count = 1;
+    }
+  else
+    {
+      host_data->last_ipmi_errnum_count++;
+      if (host_data->last_ipmi_errnum_count > IPMISELD_ERROR_OUTPUT_LIMIT)
+        {
+          host_data->last_ipmi_errnum = 0;
+          host_data->last_ipmi_errnum_count = 0;
+        }
+    }
+}
+
+static void
+_engine_host_done (struct ipmiseld_engine_host *h)
+{
+  assert (h);
+
+  h->state = IPMISELD_ENGINE_STATE_IDLE;
+
+  if (h->teardown)
+    return;
+
+  if (engine_callbacks.postprocess)
+    engine_callbacks.postprocess (h->host_data);
+}
+
+/* on any error, drop the session like the threadpool drops its
+ * ipmi context, the next poll starts over
+ */
+static void
+_engine_host_fail (struct ipmiseld_engine_host *h)
+{
+  assert (h);
+
+  if (h->session_open
+      && h->state != IPMISELD_ENGINE_STATE_CLOSE_SESSION)
+    {
+      _engine_host_state_start (h, IPMISELD_ENGINE_STATE_CLOSE_SESSION);
+      return;
+    }
+
+  h->session_open = 0;
+  _engine_host_done (h);
+}
+
+static void
+_engine_host_error (struct ipmiseld_engine_host *h,
+                    int errnum,
+                    const char *errmsg)
+{
+  assert (h);
+
+  _engine_host_err_output (h, errnum, errmsg ? errmsg : ipmi_ctx_strerror (errnum));
+  _engine_host_fail (h);
+}
+
+static void
+_engine_host_dump (struct ipmiseld_engine_host *h,
+                   const char *direction,
+                   const void *buf,
+                   unsigned int buflen,
+                   fiid_field_t *tmpl_lan_msg_hdr,
+                   fiid_field_t *tmpl_cmd)
+{
+  ipmiseld_host_data_t *host_data;
+  char hdrbuf[IPMISELD_DEBUG_BUFFER_LEN];
+
+  assert (h);
+  assert (direction);
+
+  host_data = h->host_data;
+
+  if (!host_data->prog_data->args->foreground
+      || host_data->prog_data->args->common_args.debug < 2)
+    return;
+
+  snprintf (hdrbuf,
+            IPMISELD_DEBUG_BUFFER_LEN,
+            "====================================================\n"
+            "%s %s\n"
+            "====================================================",
+            engine_cmds[h->state].name,
+            direction);
+
+  ipmi_dump_lan_packet (STDERR_FILENO,
+                        host_data->hostname,
+                        hdrbuf,
+                        NULL,
+                        buf,
+                        buflen,
+                        tmpl_lan_msg_hdr,
+                        tmpl_cmd);
+}
+
+static int
+_engine_host_fill_cmd (struct ipmiseld_engine_host *h, fiid_obj_t obj_cmd_rq)
+{
+  struct common_cmd_args *common_args;
+
+  assert (h);
+  assert (obj_cmd_rq);
+
+  common_args = &(engine_prog_data->args->common_args);
+
+  switch (h->state)
+    {
+    case IPMISELD_ENGINE_STATE_AUTHENTICATION_CAPABILITIES:
+      return (fill_cmd_get_channel_authentication_capabilities (IPMI_CHANNEL_NUMBER_CURRENT_CHANNEL,
+                                                                common_args->privilege_level,
+                                                                IPMI_GET_IPMI_V15_DATA,
+                                                                obj_cmd_rq));
+    case IPMISELD_ENGINE_STATE_GET_SESSION_CHALLENGE:
+      return (fill_cmd_get_session_challenge (common_args->authentication_type,
+                                              common_args->username,
+                                              common_args->username ? strlen (common_args->username) : 0,
+                                              obj_cmd_rq));
+    case IPMISELD_ENGINE_STATE_ACTIVATE_SESSION:
+      return (fill_cmd_activate_session (common_args->authentication_type,
+                                         common_args->privilege_level,
+                                         h->challenge_string,
+                                         IPMI_CHALLENGE_STRING_LENGTH,
+                                         IPMISELD_ENGINE_INITIAL_OUTBOUND_SEQUENCE_NUMBER,
+                                         obj_cmd_rq));
+    case IPMISELD_ENGINE_STATE_SET_SESSION_PRIVILEGE_LEVEL:
+      return (fill_cmd_set_session_privilege_level (common_args->privilege_level, obj_cmd_rq));
+    case IPMISELD_ENGINE_STATE_GET_SEL_INFO:
+      return (fill_cmd_get_sel_info (obj_cmd_rq));
+    case IPMISELD_ENGINE_STATE_GET_LAST_SEL_ENTRY:
+      return (fill_cmd_get_sel_entry (0,
+                                      IPMI_SEL_GET_RECORD_ID_LAST_ENTRY,
+                                      0,
+                                      IPMI_SEL_READ_ENTIRE_RECORD_BYTES_TO_READ,
+                                      obj_cmd_rq));
+    case IPMISELD_ENGINE_STATE_GET_SEL_ENTRY:
+      /* SEL entries are only read, never deleted, so like
+       * ipmi_sel_parse() no reservation is needed
+       */
+      return (fill_cmd_get_sel_entry (0,
+                                      h->record_id,
+                                      0,
+                                      IPMI_SEL_READ_ENTIRE_RECORD_BYTES_TO_READ,
+                                      obj_cmd_rq));
+    case IPMISELD_ENGINE_STATE_GET_DEVICE_ID:
+      return (fill_cmd_get_device_id (obj_cmd_rq));
+    case IPMISELD_ENGINE_STATE_CLOSE_SESSION:
+      return (fill_cmd_close_session (h->session_id, NULL, obj_cmd_rq));
+    default:
+      break;
+    }
+
+  errno = EINVAL;
+  return (-1);
+}
+
+/* (re)send the request of the current state, every send is a new
+ * packet with new sequence numbers
+ */
+static void
+_engine_host_send (struct ipmiseld_engine_host *h)
+{
+  struct ipmiseld_engine_thread *t;
+  ipmiseld_host_data_t *host_data;
+  struct common_cmd_args *common_args;
+  uint8_t buf[IPMISELD_ENGINE_PKT_BUFLEN];
+  fiid_obj_t obj_cmd_rq;
+  uint8_t authentication_type;
+  uint32_t session_sequence_number;
+  uint32_t session_id;
+  char *password;
+  struct timeval now;
+  int len;
+
+  assert (h);
+  assert (h->thread);
+  assert (h->state != IPMISELD_ENGINE_STATE_IDLE);
+
+  t = h->thread;
+  host_data = h->host_data;
+  common_args = &(engine_prog_data->args->common_args);
+  obj_cmd_rq = t->obj_cmd_rq[h->state];
+
+  if (h->state == IPMISELD_ENGINE_STATE_AUTHENTICATION_CAPABILITIES
+      || h->state == IPMISELD_ENGINE_STATE_GET_SESSION_CHALLENGE)
+    {
+      authentication_type = IPMI_AUTHENTICATION_TYPE_NONE;
+      session_sequence_number = 0;
+      session_id = 0;
+    }
+  else if (h->state == IPMISELD_ENGINE_STATE_ACTIVATE_SESSION)
+    {
+      authentication_type = common_args->authentication_type;
+      session_sequence_number = 0;
+      session_id = h->temp_session_id;
+    }
+  else
+    {
+      if (h->permsgauth_enabled)
+        authentication_type = common_args->authentication_type;
+      else
+        authentication_type = IPMI_AUTHENTICATION_TYPE_NONE;
+      session_sequence_number = h->initial_inbound_sequence_number + (++h->session_sequence_number_count);
+      session_id = h->session_id;
+    }
+
+  if (authentication_type != IPMI_AUTHENTICATION_TYPE_NONE)
+    password = common_args->password;
+  else
+    password = NULL;
+
+  h->rq_seq = h->rq_seq_count++ % (IPMI_LAN_REQUESTER_SEQUENCE_NUMBER_MAX + 1);
+
+  if (fiid_obj_clear (t->obj_rmcp_hdr_rq) < 0
+      || fiid_obj_clear (t->obj_lan_session_hdr_rq) < 0
+      || fiid_obj_clear (t->obj_lan_msg_hdr_rq) < 0
+      || fiid_obj_clear (obj_cmd_rq) < 0)
+    {
+      ipmiseld_err_output (host_data, "fiid_obj_clear: %s", strerror (errno));
+      goto fail;
+    }
+
+  if (fill_rmcp_hdr_ipmi (t->obj_rmcp_hdr_rq) < 0)
+    {
+      ipmiseld_err_output (host_data, "fill_rmcp_hdr_ipmi: %s", strerror (errno));
+      goto fail;
+    }
+
+  if (fill_lan_session_hdr (authentication_type,
+                            session_sequence_number,
+                            session_id,
+                            t->obj_lan_session_hdr_rq) < 0)
+    {
+      ipmiseld_err_output (host_data, "fill_lan_session_hdr: %s", strerror (errno));
+      goto fail;
+    }
+
+  if (fill_lan_msg_hdr (IPMI_SLAVE_ADDRESS_BMC,
+                        engine_cmds[h->state].net_fn,
+                        IPMI_BMC_IPMB_LUN_BMC,
+                        h->rq_seq,
+                        t->obj_lan_msg_hdr_rq) < 0)
+    {
+      ipmiseld_err_output (host_data, "fill_lan_msg_hdr: %s", strerror (errno));
+      goto fail;
+    }
+
+  if (_engine_host_fill_cmd (h, obj_cmd_rq) < 0)
+    {
+      ipmiseld_err_output (host_data, "fill_cmd: %s", strerror (errno));
+      goto fail;
+    }
+
+  if ((len = assemble_ipmi_lan_pkt (t->obj_rmcp_hdr_rq,
+                                    t->obj_lan_session_hdr_rq,
+                                    t->obj_lan_msg_hdr_rq,
+                                    obj_cmd_rq,
+                                    password,
+                                    password ? strlen (password) : 0,
+                                    buf,
+                                    IPMISELD_ENGINE_PKT_BUFLEN,
+                                    IPMI_INTERFACE_FLAGS_DEFAULT)) < 0)
+    {
+      ipmiseld_err_output (host_data, "assemble_ipmi_lan_pkt: %s", strerror (errno));
+      goto fail;
+    }
+
+  _engine_host_dump (h, "Request", buf, len, tmpl_lan_msg_hdr_rq, engine_cmds[h->state].tmpl_cmd_rq);
+
+  /* a failed send is retransmitted like a lost packet */
+  if (sendto (_engine_fd (t, h->addr.ss_family),
+              buf,
+              len,
+              0,
+              (struct sockaddr *)&h->addr,
+              h->addrlen) < 0)
+    {
+      if (host_data->prog_data->args->foreground
+          && host_data->prog_data->args->common_args.debug)
+        IPMISELD_HOST_DEBUG (("sendto: %s", strerror (errno)));
+    }
+
+  gettimeofday (&now, NULL);
+  timeval_add_ms (&now, _engine_retransmission_timeout (), &h->retransmission_time);
+  return;
+
+ fail:
+  _engine_host_fail (h);
+}
+
+static void
+_engine_host_state_start (struct ipmiseld_engine_host *h,
+                          ipmiseld_engine_state_t state)
+{
+  struct timeval now;
+
+  assert (h);
+  assert (state != IPMISELD_ENGINE_STATE_IDLE);
+
+  h->state = state;
+
+  gettimeofday (&now, NULL);
+  timeval_add_ms (&now, _engine_session_timeout (), &h->timeout_time);
+
+  _engine_host_send (h);
+}
+
+static void
+_engine_host_session_start (struct ipmiseld_engine_host *h)
+{
+  assert (h);
+
+  h->session_open = 0;
+  h->permsgauth_enabled = 0;
+  h->temp_session_id = 0;
+  h->session_id = 0;
+  h->initial_inbound_sequence_number = 0;
+  h->session_sequence_number_count = 0;
+  ipmi_check_session_sequence_number_1_5_init (&h->highest_received_sequence_number,
+                                               &h->previously_received_list);
+
+  _engine_host_state_start (h, IPMISELD_ENGINE_STATE_AUTHENTICATION_CAPABILITIES);
+}
+
+static void
+_engine_host_poll_finish (struct ipmiseld_engine_host *h)
+{
+  assert (h);
+
+  if (engine_callbacks.finish (h->host_data) < 0)
+    {
+      _engine_host_fail (h);
+      return;
+    }
+
+  if (h->session_open
+      && !engine_prog_data->args->persistent_sessions)
+    {
+      _engine_host_state_start (h, IPMISELD_ENGINE_STATE_CLOSE_SESSION);
+      return;
+    }
+
+  _engine_host_done (h);
+}
+
+static void
+_engine_host_check_sel_info (struct ipmiseld_engine_host *h,
+                             ipmiseld_last_record_id_t *last_record_id)
+{
+  uint16_t record_id_start = 0;
+  int ret;
+
+  assert (h);
+
+  if ((ret = engine_callbacks.check_sel_info (h->host_data,
+                                              last_record_id,
+                                              &record_id_start)) < 0)
+    {
+      _engine_host_fail (h);
+      return;
+    }
+
+  if (!ret)
+    {
+      _engine_host_poll_finish (h);
+      return;
+    }
+
+  h->record_id = record_id_start;
+  h->parsed_atleast_one_entry = 0;
+  _engine_host_state_start (h, IPMISELD_ENGINE_STATE_GET_SEL_ENTRY);
+}
+
+static void
+_engine_host_start (struct ipmiseld_engine_host *h)
+{
+  ipmiseld_host_data_t *host_data;
+  struct timeval now;
+
+  assert (h);
+  assert (h->state == IPMISELD_ENGINE_STATE_IDLE);
+
+  host_data = h->host_data;
+
+  host_data->keepalive = 0;
+  h->session_reused = 0;
+  h->session_retried = 0;
+
+  gettimeofday (&now, NULL);
+
+  /* woken up early to keep the session alive, not to poll */
+  if (timeval_lt (&now, &host_data->next_poll_time))
+    {
+      host_data->keepalive = 1;
+
+      if (!h->session_open)
+        {
+          _engine_host_done (h);
+          return;
+        }
+
+      if (host_data->prog_data->args->foreground
+          && host_data->prog_data->args->common_args.debug)
+        IPMISELD_DEBUG (("Keepalive %s", host_data->hostname));
+
+      _engine_host_state_start (h, IPMISELD_ENGINE_STATE_GET_DEVICE_ID);
+      return;
+    }
+
+  ipmiseld_stats_poll_start (host_data);
+
+  if (host_data->prog_data->args->foreground
+      && host_data->prog_data->args->common_args.debug)
+    IPMISELD_DEBUG (("Poll %s", host_data->hostname));
+
+  if (h->session_open)
+    {
+      h->session_reused = 1;
+      _engine_host_state_start (h, IPMISELD_ENGINE_STATE_GET_SEL_INFO);
+    }
+  else
+    _engine_host_session_start (h);
+}
+
+static void
+_engine_host_timeout (struct ipmiseld_engine_host *h)
+{
+  assert (h);
+
+  if (h->state == IPMISELD_ENGINE_STATE_CLOSE_SESSION)
+    {
+      h->session_open = 0;
+      _engine_host_done (h);
+      return;
+    }
+
+  if (IPMISELD_ENGINE_STATE_SESSION_SETUP (h->state))
+    {
+      _engine_host_error (h, IPMI_ERR_CONNECTION_TIMEOUT, NULL);
+      return;
+    }
+
+  /* assume the BMC has dropped the session */
+  h->session_open = 0;
+
+  /* The BMC may have dropped a session kept open since the last
+   * poll, so try once more with a new session.
+   */
+  if (h->state == IPMISELD_ENGINE_STATE_GET_SEL_INFO
+      && h->session_reused
+      && !h->session_retried)
+    {
+      h->session_retried = 1;
+      _engine_host_session_start (h);
+      return;
+    }
+
+  _engine_host_error (h, IPMI_ERR_SESSION_TIMEOUT, NULL);
+}
+
+/* returns 1 if the packet is a valid response to the current
+ * request, 0 if it should be dropped
+ */
+static int
+_engine_host_check (struct ipmiseld_engine_host *h,
+                    const void *buf,
+                    unsigned int buflen,
+                    fiid_obj_t obj_cmd_rs)
+{
+  struct ipmiseld_engine_thread *t;
+  ipmiseld_host_data_t *host_data;
+  struct common_cmd_args *common_args;
+  char *check = NULL;
+  int ret;
+
+  assert (h);
+  assert (h->thread);
+  assert (buf);
+  assert (obj_cmd_rs);
+
+  t = h->thread;
+  host_data = h->host_data;
+  common_args = &(engine_prog_data->args->common_args);
+
+  if ((ret = unassemble_ipmi_lan_pkt (buf,
+                                      buflen,
+                                      t->obj_rmcp_hdr_rs,
+                                      t->obj_lan_session_hdr_rs,
+                                      t->obj_lan_msg_hdr_rs,
+                                      obj_cmd_rs,
+                                      t->obj_lan_msg_trlr_rs,
+                                      IPMI_INTERFACE_FLAGS_DEFAULT)) < 0)
+    {
+      ipmiseld_err_output (host_data, "unassemble_ipmi_lan_pkt: %s", strerror (errno));
+      return (0);
+    }
+
+  if (!ret)
+    {
+      check = "packet";
+      goto drop;
+    }
+
+  if ((ret = ipmi_lan_check_checksum (t->obj_lan_msg_hdr_rs,
+                                      obj_cmd_rs,
+                                      t->obj_lan_msg_trlr_rs)) <= 0)
+    {
+      check = "checksum";
+      goto drop;
+    }
+
+  if (h->state == IPMISELD_ENGINE_STATE_ACTIVATE_SESSION
+      || IPMISELD_ENGINE_STATE_SESSION_PACKET (h->state))
+    {
+      uint8_t authentication_type;
+
+      if (h->state == IPMISELD_ENGINE_STATE_ACTIVATE_SESSION
+          || h->permsgauth_enabled)
+        authentication_type = common_args->authentication_type;
+      else
+        authentication_type = IPMI_AUTHENTICATION_TYPE_NONE;
+
+      if ((ret = ipmi_lan_check_packet_session_authentication_code (buf,
+                                                                    buflen,
+                                                                    authentication_type,
+                                                                    common_args->password,
+                                                                    common_args->password ? strlen (common_args->password) : 0)) <= 0)
+        {
+          check = "authentication code";
+          goto drop;
+        }
+    }
+
+  if (IPMISELD_ENGINE_STATE_SESSION_PACKET (h->state))
+    {
+      uint64_t val;
+
+      if ((ret = ipmi_lan_check_session_id (t->obj_lan_session_hdr_rs,
+                                            h->session_id)) <= 0)
+        {
+          check = "session id";
+          goto drop;
+        }
+
+      /* a BMC may close the session before responding to the
+       * close, don't bother checking
+       */
+      if (h->state != IPMISELD_ENGINE_STATE_CLOSE_SESSION)
+        {
+          if (FIID_OBJ_GET (t->obj_lan_session_hdr_rs,
+                            "session_sequence_number",
+                            &val) < 0)
+            {
+              check = "session sequence number";
+              goto drop;
+            }
+
+          if ((ret = ipmi_check_session_sequence_number_1_5 ((uint32_t)val,
+                                                             &h->highest_received_sequence_number,
+                                                             &h->previously_received_list,
+                                                             0)) <= 0)
+            {
+              check = "session sequence number";
+              goto drop;
+            }
+        }
+    }
+
+  if ((ret = ipmi_lan_check_net_fn (t->obj_lan_msg_hdr_rs, engine_cmds[h->state].net_fn + 1)) <= 0)
+    {
+      check = "network function";
+      goto drop;
+    }
+
+  if ((ret = ipmi_lan_check_rq_seq (t->obj_lan_msg_hdr_rs, h->rq_seq)) <= 0)
+    {
+      check = "requester sequence number";
+      goto drop;
+    }
+
+  if ((ret = ipmi_check_cmd (obj_cmd_rs, engine_cmds[h->state].cmd)) <= 0)
+    {
+      check = "command";
+      goto drop;
+    }
+
+  return (1);
+
+ drop:
+  if (host_data->prog_data->args->foreground
+      && host_data->prog_data->args->common_args.debug)
+    IPMISELD_HOST_DEBUG (("%s response dropped, %s check failed",
+                          engine_cmds[h->state].name,
+                          check));
+  return (0);
+}
+
+static void
+_engine_host_completion_code (struct ipmiseld_engine_host *h,
+                              fiid_obj_t obj_cmd_rs)
+{
+  char errbuf[IPMI_ERR_STR_MAX_LEN + 1];
+  uint8_t comp_code;
+  uint64_t val;
+
+  assert (h);
+  assert (obj_cmd_rs);
+
+  if (FIID_OBJ_GET (obj_cmd_rs, "comp_code", &val) < 0)
+    {
+      ipmiseld_err_output (h->host_data,
+                           "fiid_obj_get: 'comp_code': %s",
+                           fiid_obj_errormsg (obj_cmd_rs));
+      _engine_host_fail (h);
+      return;
+    }
+  comp_code = val;
+
+  switch (h->state)
+    {
+    case IPMISELD_ENGINE_STATE_GET_SESSION_CHALLENGE:
+      if (comp_code == IPMI_COMP_CODE_GET_SESSION_CHALLENGE_INVALID_USERNAME
+          || comp_code == IPMI_COMP_CODE_GET_SESSION_CHALLENGE_NULL_USERNAME_NOT_ENABLED)
+        {
+          _engine_host_error (h, IPMI_ERR_USERNAME_INVALID, NULL);
+          return;
+        }
+      break;
+    case IPMISELD_ENGINE_STATE_ACTIVATE_SESSION:
+      if (comp_code == IPMI_COMP_CODE_ACTIVATE_SESSION_EXCEEDS_PRIVILEGE_LEVEL)
+        {
+          _engine_host_error (h, IPMI_ERR_PRIVILEGE_LEVEL_CANNOT_BE_OBTAINED, NULL);
+          return;
+        }
+      break;
+    case IPMISELD_ENGINE_STATE_SET_SESSION_PRIVILEGE_LEVEL:
+      if (comp_code == IPMI_COMP_CODE_SET_SESSION_PRIVILEGE_LEVEL_REQUESTED_LEVEL_NOT_AVAILABLE_FOR_USER
+          || comp_code == IPMI_COMP_CODE_SET_SESSION_PRIVILEGE_LEVEL_REQUESTED_LEVEL_EXCEEDS_USER_PRIVILEGE_LIMIT)
+        {
+          _engine_host_error (h, IPMI_ERR_PRIVILEGE_LEVEL_CANNOT_BE_OBTAINED, NULL);
+          return;
+        }
+      break;
+    case IPMISELD_ENGINE_STATE_GET_LAST_SEL_ENTRY:
+      /* SEL is empty */
+      if (comp_code == IPMI_COMP_CODE_REQUESTED_SENSOR_DATA_OR_RECORD_NOT_PRESENT)
+        {
+          h->last_record_id.record_id = 0;
+          h->last_record_id.loaded = 0;
+          _engine_host_check_sel_info (h, &h->last_record_id);
+          return;
+        }
+      break;
+    case IPMISELD_ENGINE_STATE_GET_SEL_ENTRY:
+      if (comp_code == IPMI_COMP_CODE_REQUESTED_SENSOR_DATA_OR_RECORD_NOT_PRESENT)
+        {
+          /* SEL is empty */
+          if (h->record_id == IPMI_SEL_GET_RECORD_ID_FIRST_ENTRY)
+            {
+              _engine_host_poll_finish (h);
+              return;
+            }
+
+          /* As in ipmi_sel_parse(), the starting record may have been
+           * deleted, so search forward for the next one.
+           */
+          if (!h->parsed_atleast_one_entry
+              && (!h->last_record_id.loaded
+                  || h->record_id < h->last_record_id.record_id))
+            {
+              h->record_id++;
+              _engine_host_state_start (h, IPMISELD_ENGINE_STATE_GET_SEL_ENTRY);
+              return;
+            }
+        }
+      break;
+    case IPMISELD_ENGINE_STATE_GET_DEVICE_ID:
+      /* an error response means the session is still alive */
+      _engine_host_done (h);
+      return;
+    case IPMISELD_ENGINE_STATE_CLOSE_SESSION:
+      h->session_open = 0;
+      _engine_host_done (h);
+      return;
+    default:
+      break;
+    }
+
+  if (ipmi_completion_code_strerror_cmd_r (obj_cmd_rs,
+                                           engine_cmds[h->state].net_fn,
+                                           errbuf,
+                                           IPMI_ERR_STR_MAX_LEN) < 0)
+    snprintf (errbuf, IPMI_ERR_STR_MAX_LEN, "completion code 0x%02X", comp_code);
+
+  _engine_host_error (h, IPMI_ERR_BAD_COMPLETION_CODE, errbuf);
+}
+
+static void
+_engine_host_recv (struct ipmiseld_engine_host *h,
+                   const void *buf,
+                   unsigned int buflen)
+{
+  struct ipmiseld_engine_thread *t;
+  ipmiseld_host_data_t *host_data;
+  struct common_cmd_args *common_args;
+  uint8_t record_buf[IPMISELD_ENGINE_PKT_BUFLEN];
+  fiid_obj_t obj_cmd_rs;
+  uint64_t val;
+  int len;
+  int ret;
+
+  assert (h);
+  assert (h->thread);
+  assert (h->state != IPMISELD_ENGINE_STATE_IDLE);
+
+  t = h->thread;
+  host_data = h->host_data;
+  common_args = &(engine_prog_data->args->common_args);
+  obj_cmd_rs = t->obj_cmd_rs[h->state];
+
+  _engine_host_dump (h, "Response", buf, buflen, tmpl_lan_msg_hdr_rs, engine_cmds[h->state].tmpl_cmd_rs);
+
+  if (fiid_obj_clear (t->obj_rmcp_hdr_rs) < 0
+      || fiid_obj_clear (t->obj_lan_session_hdr_rs) < 0
+      || fiid_obj_clear (t->obj_lan_msg_hdr_rs) < 0
+      || fiid_obj_clear (t->obj_lan_msg_trlr_rs) < 0
+      || fiid_obj_clear (obj_cmd_rs) < 0)
+    {
+      ipmiseld_err_output (host_data, "fiid_obj_clear: %s", strerror (errno));
+      return;
+    }
+
+  if (!_engine_host_check (h, buf, buflen, obj_cmd_rs))
+    return;
+
+  if ((ret = ipmi_check_completion_code_success (obj_cmd_rs)) < 0)
+    {
+      ipmiseld_err_output (host_data, "ipmi_check_completion_code_success: %s", strerror (errno));
+      _engine_host_fail (h);
+      return;
+    }
+
+  if (!ret)
+    {
+      _engine_host_completion_code (h, obj_cmd_rs);
+      return;
+    }
+
+  switch (h->state)
+    {
+    case IPMISELD_ENGINE_STATE_AUTHENTICATION_CAPABILITIES:
+      if ((ret = ipmi_check_authentication_capabilities_username (common_args->username,
+                                                                  common_args->password,
+                                                                  obj_cmd_rs)) < 0)
+        {
+          ipmiseld_err_output (host_data,
+                               "ipmi_check_authentication_capabilities_username: %s",
+                               strerror (errno));
+          goto fail;
+        }
+
+      if (!ret)
+        {
+          _engine_host_error (h, IPMI_ERR_USERNAME_INVALID, NULL);
+          return;
+        }
+
+      if ((ret = ipmi_check_authentication_capabilities_authentication_type (common_args->authentication_type,
+                                                                             obj_cmd_rs)) < 0)
+        {
+          ipmiseld_err_output (host_data,
+                               "ipmi_check_authentication_capabilities_authentication_type: %s",
+                               strerror (errno));
+          goto fail;
+        }
+
+      if (!ret)
+        {
+          _engine_host_error (h, IPMI_ERR_AUTHENTICATION_TYPE_UNAVAILABLE, NULL);
+          return;
+        }
+
+      if (FIID_OBJ_GET (obj_cmd_rs,
+                        "authentication_status.per_message_authentication",
+                        &val) < 0)
+        {
+          ipmiseld_err_output (host_data,
+                               "fiid_obj_get: 'authentication_status.per_message_authentication': %s",
+                               fiid_obj_errormsg (obj_cmd_rs));
+          goto fail;
+        }
+
+      /* if per message authentication is disabled, the bit is set */
+      h->permsgauth_enabled = val ? 0 : 1;
+
+      _engine_host_state_start (h, IPMISELD_ENGINE_STATE_GET_SESSION_CHALLENGE);
+      break;
+
+    case IPMISELD_ENGINE_STATE_GET_SESSION_CHALLENGE:
+      if (FIID_OBJ_GET (obj_cmd_rs, "temp_session_id", &val) < 0)
+        {
+          ipmiseld_err_output (host_data,
+                               "fiid_obj_get: 'temp_session_id': %s",
+                               fiid_obj_errormsg (obj_cmd_rs));
+          goto fail;
+        }
+      h->temp_session_id = val;
+
+      if (fiid_obj_get_data (obj_cmd_rs,
+                             "challenge_string",
+                             h->challenge_string,
+                             IPMI_CHALLENGE_STRING_LENGTH) < 0)
+        {
+          ipmiseld_err_output (host_data,
+                               "fiid_obj_get_data: 'challenge_string': %s",
+                               fiid_obj_errormsg (obj_cmd_rs));
+          goto fail;
+        }
+
+      _engine_host_state_start (h, IPMISELD_ENGINE_STATE_ACTIVATE_SESSION);
+      break;
+
+    case IPMISELD_ENGINE_STATE_ACTIVATE_SESSION:
+      if (FIID_OBJ_GET (obj_cmd_rs, "session_id", &val) < 0)
+        {
+          ipmiseld_err_output (host_data,
+                               "fiid_obj_get: 'session_id': %s",
+                               fiid_obj_errormsg (obj_cmd_rs));
+          goto fail;
+        }
+      h->session_id = val;
+
+      if (FIID_OBJ_GET (obj_cmd_rs, "initial_inbound_sequence_number", &val) < 0)
+        {
+          ipmiseld_err_output (host_data,
+                               "fiid_obj_get: 'initial_inbound_sequence_number': %s",
+                               fiid_obj_errormsg (obj_cmd_rs));
+          goto fail;
+        }
+      h->initial_inbound_sequence_number = val;
+
+      if (FIID_OBJ_GET (obj_cmd_rs, "authentication_type", &val) < 0)
+        {
+          ipmiseld_err_output (host_data,
+                               "fiid_obj_get: 'authentication_type': %s",
+                               fiid_obj_errormsg (obj_cmd_rs));
+          goto fail;
+        }
+
+      /* As in libfreeipmi, if the BMC expects authentication
+       * anyways, go along with it.
+       */
+      if (!h->permsgauth_enabled
+          && val != IPMI_AUTHENTICATION_TYPE_NONE)
+        h->permsgauth_enabled = 1;
+
+      h->session_open = 1;
+      _engine_host_state_start (h, IPMISELD_ENGINE_STATE_SET_SESSION_PRIVILEGE_LEVEL);
+      break;
+
+    case IPMISELD_ENGINE_STATE_SET_SESSION_PRIVILEGE_LEVEL:
+      _engine_host_state_start (h, IPMISELD_ENGINE_STATE_GET_SEL_INFO);
+      break;
+
+    case IPMISELD_ENGINE_STATE_GET_SEL_INFO:
+      if ((ret = engine_callbacks.sel_info (host_data, obj_cmd_rs)) < 0)
+        goto fail;
+
+      if (ret)
+        _engine_host_state_start (h, IPMISELD_ENGINE_STATE_GET_LAST_SEL_ENTRY);
+      else
+        _engine_host_check_sel_info (h, NULL);
+      break;
+
+    case IPMISELD_ENGINE_STATE_GET_LAST_SEL_ENTRY:
+      if ((len = fiid_obj_get_data (obj_cmd_rs,
+                                    "record_data",
+                                    record_buf,
+                                    IPMISELD_ENGINE_PKT_BUFLEN)) < 0)
+        {
+          ipmiseld_err_output (host_data,
+                               "fiid_obj_get_data: 'record_data': %s",
+                               fiid_obj_errormsg (obj_cmd_rs));
+          goto fail;
+        }
+
+      if (ipmi_sel_parse_read_record_id (host_data->host_poll->sel_ctx,
+                                         record_buf,
+                                         len,
+                                         &h->last_record_id.record_id) < 0)
+        {
+          ipmiseld_err_output (host_data,
+                               "ipmi_sel_parse_read_record_id: %s",
+                               ipmi_sel_ctx_errormsg (host_data->host_poll->sel_ctx));
+          goto fail;
+        }
+      h->last_record_id.loaded = 1;
+
+      _engine_host_check_sel_info (h, &h->last_record_id);
+      break;
+
+    case IPMISELD_ENGINE_STATE_GET_SEL_ENTRY:
+      if (FIID_OBJ_GET (obj_cmd_rs, "next_record_id", &val) < 0)
+        {
+          ipmiseld_err_output (host_data,
+                               "fiid_obj_get: 'next_record_id': %s",
+                               fiid_obj_errormsg (obj_cmd_rs));
+          goto fail;
+        }
+
+      if ((len = fiid_obj_get_data (obj_cmd_rs,
+                                    "record_data",
+                                    record_buf,
+                                    IPMISELD_ENGINE_PKT_BUFLEN)) < 0)
+        {
+          ipmiseld_err_output (host_data,
+                               "fiid_obj_get_data: 'record_data': %s",
+                               fiid_obj_errormsg (obj_cmd_rs));
+          goto fail;
+        }
+
+      h->parsed_atleast_one_entry = 1;
+
+      if (engine_callbacks.sel_record (host_data, record_buf, len) < 0)
+        goto fail;
+
+      if (val == IPMI_SEL_GET_RECORD_ID_LAST_ENTRY)
+        {
+          _engine_host_poll_finish (h);
+          break;
+        }
+
+      h->record_id = val;
+      _engine_host_state_start (h, IPMISELD_ENGINE_STATE_GET_SEL_ENTRY);
+      break;
+
+    case IPMISELD_ENGINE_STATE_GET_DEVICE_ID:
+      _engine_host_done (h);
+      break;
+
+    case IPMISELD_ENGINE_STATE_CLOSE_SESSION:
+      h->session_open = 0;
+      _engine_host_done (h);
+      break;
+
+    default:
+      break;
+    }
+
+  return;
+
+ fail:
+  _engine_host_fail (h);
+}
+
+static void
+_engine_recv (struct ipmiseld_engine_thread *t, int fd)
+{
+  uint8_t buf[IPMISELD_ENGINE_PKT_BUFLEN];
+  char key[IPMISELD_ENGINE_KEY_BUFLEN];
+  char hbuf[NI_MAXHOST];
+  char sbuf[NI_MAXSERV];
+  struct sockaddr_storage from;
+  socklen_t fromlen;
+  struct ipmiseld_engine_host *h;
+  ssize_t len;
+
+  assert (t);
+
+  while (1)
+    {
+      fromlen = sizeof (struct sockaddr_storage);
+      if ((len = recvfrom (fd,
+                           buf,
+                           IPMISELD_ENGINE_PKT_BUFLEN,
+                           0,
+                           (struct sockaddr *)&from,
+                           &fromlen)) < 0)
+        {
+          if (errno == EINTR)
+            continue;
+          if (errno != EAGAIN && errno != EWOULDBLOCK)
+            err_output ("recvfrom: %s", strerror (errno));
+          return;
+        }
+
+      if (getnameinfo ((struct sockaddr *)&from,
+                       fromlen,
+                       hbuf,
+                       NI_MAXHOST,
+                       sbuf,
+                       NI_MAXSERV,
+                       NI_NUMERICHOST | NI_NUMERICSERV))
+        continue;
+
+      snprintf (key, IPMISELD_ENGINE_KEY_BUFLEN, "%s:%s", hbuf, sbuf);
+
+      pthread_mutex_lock (&t->lock);
+      h = hash_find (t->hosts, key);
+      pthread_mutex_unlock (&t->lock);
+
+      /* stale response to a completed request */
+      if (!h || h->state == IPMISELD_ENGINE_STATE_IDLE)
+        continue;
+
+      _engine_host_recv (h, buf, len);
+    }
+}
+
+static int
+_engine_host_teardown (void *data, const void *key, void *arg)
+{
+  struct ipmiseld_engine_host *h;
+  struct ipmiseld_engine_thread *t;
+
+  assert (data);
+  assert (arg);
+
+  h = (struct ipmiseld_engine_host *)data;
+  t = (struct ipmiseld_engine_thread *)arg;
+
+  if (h->session_open && h->state == IPMISELD_ENGINE_STATE_IDLE)
+    {
+      h->teardown = 1;
+      _engine_host_state_start (h, IPMISELD_ENGINE_STATE_CLOSE_SESSION);
+      if (h->state != IPMISELD_ENGINE_STATE_IDLE && !h->active)
+        {
+          if (!list_append (t->active, h))
+            {
+              err_output ("list_append: %s", strerror (errno));
+              h->state = IPMISELD_ENGINE_STATE_IDLE;
+              return (0);
+            }
+          h->active = 1;
+        }
+    }
+
+  return (0);
+}
+
+static int
+_engine_host_find (void *x, void *key)
+{
+  return (x == key);
+}
+
+/* free hosts destroyed since the last pass */
+static void
+_engine_reap (struct ipmiseld_engine_thread *t)
+{
+  struct ipmiseld_engine_host *h;
+
+  assert (t);
+
+  while (1)
+    {
+      pthread_mutex_lock (&t->lock);
+      if ((h = list_dequeue (t->dead)))
+        list_delete_all (t->queue, _engine_host_find, h);
+      pthread_mutex_unlock (&t->lock);
+
+      if (!h)
+        break;
+
+      if (h->active)
+        list_delete_all (t->active, _engine_host_find, h);
+
+      free (h);
+    }
+}
+
+/* Start hosts handed over by the scheduler.  Once exiting, hosts
+ * are not polled anymore and are handed right back.
+ */
+static void
+_engine_queue_drain (struct ipmiseld_engine_thread *t)
+{
+  struct ipmiseld_engine_host *h;
+  int exiting;
+
+  assert (t);
+
+  while (1)
+    {
+      pthread_mutex_lock (&t->lock);
+      h = list_dequeue (t->queue);
+      exiting = t->exit_flag;
+      pthread_mutex_unlock (&t->lock);
+
+      if (!h)
+        break;
+
+      if (exiting)
+        {
+          if (engine_callbacks.postprocess)
+            engine_callbacks.postprocess (h->host_data);
+          continue;
+        }
+
+      _engine_host_start (h);
+
+      if (h->state != IPMISELD_ENGINE_STATE_IDLE && !h->active)
+        {
+          if (!list_append (t->active, h))
+            {
+              err_output ("list_append: %s", strerror (errno));
+              h->state = IPMISELD_ENGINE_STATE_IDLE;
+              if (engine_callbacks.postprocess)
+                engine_callbacks.postprocess (h->host_data);
+              continue;
+            }
+          h->active = 1;
+        }
+    }
+}
+
+/* handle expired timers, returns milliseconds until the next timer
+ * expires, -1 if there are none
+ */
+static int
+_engine_timers (struct ipmiseld_engine_thread *t)
+{
+  struct ipmiseld_engine_host *h;
+  ListIterator itr;
+  struct timeval now;
+  struct timeval next;
+  int next_set = 0;
+  int timeout = -1;
+
+  assert (t);
+
+  gettimeofday (&now, NULL);
+
+  if (!(itr = list_iterator_create (t->active)))
+    {
+      err_output ("list_iterator_create: %s", strerror (errno));
+      return (_engine_retransmission_timeout ());
+    }
+
+  while ((h = list_next (itr)))
+    {
+      if (h->state != IPMISELD_ENGINE_STATE_IDLE)
+        {
+          if (!timeval_lt (&now, &h->timeout_time))
+            _engine_host_timeout (h);
+          else if (!timeval_lt (&now, &h->retransmission_time))
+            _engine_host_send (h);
+        }
+
+      if (h->state == IPMISELD_ENGINE_STATE_IDLE)
+        {
+          h->active = 0;
+          list_delete (itr);
+          continue;
+        }
+
+      if (!next_set || timeval_lt (&h->retransmission_time, &next))
+        {
+          next = h->retransmission_time;
+          next_set = 1;
+        }
+
+      if (timeval_lt (&h->timeout_time, &next))
+        next = h->timeout_time;
+    }
+
+  list_iterator_destroy (itr);
+
+  if (next_set)
+    {
+      struct timeval delta;
+      unsigned int ms;
+
+      if (timeval_gt (&next, &now))
+        {
+          timeval_sub (&next, &now, &delta);
+          timeval_millisecond_calc (&delta, &ms);
+          /* round up, so we don't wake up too early */
+          timeout = ms + 1;
+        }
+      else
+        timeout = 0;
+    }
+
+  return (timeout);
+}
+
+static void *
+_engine_thread_func (void *arg)
+{
+  struct ipmiseld_engine_thread *t;
+
+  assert (arg);
+
+  t = (struct ipmiseld_engine_thread *)arg;
+
+  while (1)
+    {
+      struct pollfd pfds[3];
+      char buf[IPMISELD_ENGINE_NOTIFIER_BUFLEN];
+      unsigned int nfds = 0;
+      int exiting;
+      int timeout;
+
+      _engine_reap (t);
+
+      _engine_queue_drain (t);
+
+      timeout = _engine_timers (t);
+
+      pthread_mutex_lock (&t->lock);
+      exiting = t->exit_flag;
+      pthread_mutex_unlock (&t->lock);
+
+      /* Once all polls in progress have completed, close any
+       * sessions still open before exiting.
+       */
+      if (exiting && list_is_empty (t->active))
+        {
+          if (t->teardown)
+            break;
+
+          t->teardown = 1;
+
+          pthread_mutex_lock (&t->lock);
+          hash_for_each (t->hosts, _engine_host_teardown, t);
+          pthread_mutex_unlock (&t->lock);
+          continue;
+        }
+
+      pfds[nfds].fd = t->notifier_fd[0];
+      pfds[nfds].events = POLLIN;
+      pfds[nfds].revents = 0;
+      nfds++;
+
+      if (t->fd4 >= 0)
+        {
+          pfds[nfds].fd = t->fd4;
+          pfds[nfds].events = POLLIN;
+          pfds[nfds].revents = 0;
+          nfds++;
+        }
+
+      if (t->fd6 >= 0)
+        {
+          pfds[nfds].fd = t->fd6;
+          pfds[nfds].events = POLLIN;
+          pfds[nfds].revents = 0;
+          nfds++;
+        }
+
+      if (poll (pfds, nfds, timeout) < 0)
+        {
+          if (errno != EINTR)
+            err_output ("poll: %s", strerror (errno));
+          continue;
+        }
+
+      if (pfds[0].revents & POLLIN)
+        {
+          /* drain all pending wakeups */
+          while (read (t->notifier_fd[0], buf, IPMISELD_ENGINE_NOTIFIER_BUFLEN) > 0)
+            ;
+        }
+
+      if (nfds > 1 && (pfds[1].revents & POLLIN))
+        _engine_recv (t, pfds[1].fd);
+
+      if (nfds > 2 && (pfds[2].revents & POLLIN))
+        _engine_recv (t, pfds[2].fd);
+    }
+
+  return (NULL);
+}
+
+static int
+_engine_thread_setup (struct ipmiseld_engine_thread *t)
+{
+  int i;
+  int ret;
+
+  assert (t);
+
+  t->fd4 = _engine_socket (AF_INET);
+  t->fd6 = _engine_socket (AF_INET6);
+
+  if (t->fd4 < 0 && t->fd6 < 0)
+    {
+      err_output ("socket: %s", strerror (errno));
+      return (-1);
+    }
+
+  if (pipe (t->notifier_fd) < 0)
+    {
+      err_output ("pipe: %s", strerror (errno));
+      t->notifier_fd[0] = t->notifier_fd[1] = -1;
+      return (-1);
+    }
+
+  for (i = 0; i < 2; i++)
+    {
+      if (_engine_nonblock (t->notifier_fd[i]) < 0)
+        return (-1);
+    }
+
+  if ((ret = pthread_mutex_init (&t->lock, NULL)))
+    {
+      err_output ("pthread_mutex_init: %s", strerror (ret));
+      return (-1);
+    }
+
+  if (!(t->hosts = hash_create (IPMISELD_ENGINE_HASH_SIZE,
+                                (hash_key_f)hash_key_string,
+                                (hash_cmp_f)strcmp,
+                                NULL)))
+    {
+      err_output ("hash_create: %s", strerror (errno));
+      return (-1);
+    }
+
+  if (!(t->queue = list_create (NULL)))
+    {
+      err_output ("list_create: %s", strerror (errno));
+      return (-1);
+    }
+
+  if (!(t->active = list_create (NULL)))
+    {
+      err_output ("list_create: %s", strerror (errno));
+      return (-1);
+    }
+
+  if (!(t->dead = list_create ((ListDelF)free)))
+    {
+      err_output ("list_create: %s", strerror (errno));
+      return (-1);
+    }
+
+  if (!(t->obj_rmcp_hdr_rq = fiid_obj_create (tmpl_rmcp_hdr))
+      || !(t->obj_rmcp_hdr_rs = fiid_obj_create (tmpl_rmcp_hdr))
+      || !(t->obj_lan_session_hdr_rq = fiid_obj_create (tmpl_lan_session_hdr))
+      || !(t->obj_lan_session_hdr_rs = fiid_obj_create (tmpl_lan_session_hdr))
+      || !(t->obj_lan_msg_hdr_rq = fiid_obj_create (tmpl_lan_msg_hdr_rq))
+      || !(t->obj_lan_msg_hdr_rs = fiid_obj_create (tmpl_lan_msg_hdr_rs))
+      || !(t->obj_lan_msg_trlr_rs = fiid_obj_create (tmpl_lan_msg_trlr)))
+    {
+      err_output ("fiid_obj_create: %s", strerror (errno));
+      return (-1);
+    }
+
+  for (i = IPMISELD_ENGINE_STATE_IDLE + 1; i < IPMISELD_ENGINE_STATE_COUNT; i++)
+    {
+      if (!(t->obj_cmd_rq[i] = fiid_obj_create (engine_cmds[i].tmpl_cmd_rq))
+          || !(t->obj_cmd_rs[i] = fiid_obj_create (engine_cmds[i].tmpl_cmd_rs)))
+        {
+          err_output ("fiid_obj_create: %s", strerror (errno));
+          return (-1);
+        }
+    }
+
+  if ((ret = pthread_create (&t->tid, NULL, _engine_thread_func, t)))
+    {
+      err_output ("pthread_create: %s", strerror (ret));
+      return (-1);
+    }
+  t->started = 1;
+
+  return (0);
+}
+
+static int
+_engine_host_orphan (void *data, const void *key, void *arg)
+{
+  struct ipmiseld_engine_host *h;
+
+  assert (data);
+
+  h = (struct ipmiseld_engine_host *)data;
+  h->thread = NULL;
+  return (0);
+}
+
+static void
+_engine_thread_cleanup (struct ipmiseld_engine_thread *t)
+{
+  int i;
+
+  assert (t);
+
+  if (t->hosts)
+    {
+      hash_for_each (t->hosts, _engine_host_orphan, NULL);
+      hash_destroy (t->hosts);
+    }
+
+  if (t->queue)
+    list_destroy (t->queue);
+
+  if (t->active)
+    list_destroy (t->active);
+
+  if (t->dead)
+    list_destroy (t->dead);
+
+  /* ignore potential error, cleanup path */
+  if (t->fd4 >= 0)
+    close (t->fd4);
+  if (t->fd6 >= 0)
+    close (t->fd6);
+  for (i = 0; i < 2; i++)
+    {
+      if (t->notifier_fd[i] >= 0)
+        close (t->notifier_fd[i]);
+    }
+
+  fiid_obj_destroy (t->obj_rmcp_hdr_rq);
+  fiid_obj_destroy (t->obj_rmcp_hdr_rs);
+  fiid_obj_destroy (t->obj_lan_session_hdr_rq);
+  fiid_obj_destroy (t->obj_lan_session_hdr_rs);
+  fiid_obj_destroy (t->obj_lan_msg_hdr_rq);
+  fiid_obj_destroy (t->obj_lan_msg_hdr_rs);
+  fiid_obj_destroy (t->obj_lan_msg_trlr_rs);
+  for (i = 0; i < IPMISELD_ENGINE_STATE_COUNT; i++)
+    {
+      fiid_obj_destroy (t->obj_cmd_rq[i]);
+      fiid_obj_destroy (t->obj_cmd_rs[i]);
+    }
+}
+
+int
+ipmiseld_engine_init (struct ipmiseld_prog_data *prog_data,
+                      struct ipmiseld_engine_callbacks *callbacks)
+{
+  unsigned int i;
+
+  assert (prog_data);
+  assert (prog_data->args->async_threads);
+  assert (callbacks);
+  assert (callbacks->sel_info);
+  assert (callbacks->check_sel_info);
+  assert (callbacks->sel_record);
+  assert (callbacks->finish);
+  /* postprocess can be NULL */
+  assert (!engine_threads);
+
+  engine_prog_data = prog_data;
+  memcpy (&engine_callbacks, callbacks, sizeof (struct ipmiseld_engine_callbacks));
+
+  if (!(engine_threads = (struct ipmiseld_engine_thread *)calloc (prog_data->args->async_threads,
+                                                                    sizeof (struct ipmiseld_engine_thread))))
+    {
+      err_output ("calloc: %s", strerror (errno));
+      return (-1);
+    }
+  engine_threads_len = prog_data->args->async_threads;
+
+  for (i = 0; i < engine_threads_len; i++)
+    {
+      engine_threads[i].fd4 = -1;
+      engine_threads[i].fd6 = -1;
+      engine_threads[i].notifier_fd[0] = -1;
+      engine_threads[i].notifier_fd[1] = -1;
+    }
+
+  for (i = 0; i < engine_threads_len; i++)
+    {
+      if (_engine_thread_setup (&engine_threads[i]) < 0)
+        return (-1);
+    }
+
+  return (0);
+}
+
+void
+ipmiseld_engine_destroy (void)
+{
+  unsigned int i;
+  int ret;
+
+  if (!engine_threads)
+    return;
+
+  /* As with the threadpool, let polls in progress complete rather
+   * than cancel the threads.
+   */
+  for (i = 0; i < engine_threads_len; i++)
+    {
+      if (!engine_threads[i].started)
+        continue;
+
+      pthread_mutex_lock (&engine_threads[i].lock);
+      engine_threads[i].exit_flag = 1;
+      pthread_mutex_unlock (&engine_threads[i].lock);
+
+      _engine_notify (&engine_threads[i]);
+    }
+
+  for (i = 0; i < engine_threads_len; i++)
+    {
+      if (!engine_threads[i].started)
+        continue;
+
+      if ((ret = pthread_join (engine_threads[i].tid, NULL)))
+        err_output ("pthread_join: %s", strerror (ret));
+    }
+
+  for (i = 0; i < engine_threads_len; i++)
+    _engine_thread_cleanup (&engine_threads[i]);
+
+  free (engine_threads);
+  engine_threads = NULL;
+  engine_threads_len = 0;
+}
+
+int
+ipmiseld_engine_host_add (ipmiseld_host_data_t *host_data)
+{
+  struct ipmiseld_engine_host *h = NULL;
+  struct ipmiseld_engine_thread *t = NULL;
+  struct addrinfo hints, *res = NULL, *rp;
+  char hbuf[NI_MAXHOST];
+  char sbuf[NI_MAXSERV];
+  char portbuf[IPMISELD_ENGINE_PORT_BUFLEN];
+  char *addr = NULL;
+  char *port = NULL;
+  uint16_t portnum = RMCP_PRIMARY_RMCP_PORT;
+  unsigned int i;
+  int ret;
+  int rv = -1;
+
+  assert (host_data);
+  assert (!host_data->engine_host);
+
+  if (!engine_threads
+      || !host_data->hostname
+      || host_is_localhost (host_data->hostname))
+    return (-1);
+
+  if ((ret = host_is_host_with_port (host_data->hostname, &addr, &port)) < 0)
+    {
+      ipmiseld_err_output (host_data, "host_is_host_with_port: %s", strerror (errno));
+      goto cleanup;
+    }
+
+  if (ret)
+    {
+      if (host_is_valid (addr, port, &portnum) <= 0)
+        goto cleanup;
+    }
+
+  snprintf (portbuf, IPMISELD_ENGINE_PORT_BUFLEN, "%u", portnum);
+
+  memset (&hints, '\0', sizeof (struct addrinfo));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_DGRAM;
+
+  if ((ret = getaddrinfo (ret ? addr : host_data->hostname, portbuf, &hints, &res)))
+    {
+      ipmiseld_err_output (host_data, "getaddrinfo: %s", gai_strerror (ret));
+      goto cleanup;
+    }
+
+  for (rp = res; rp; rp = rp->ai_next)
+    {
+      if (_engine_fd (&engine_threads[0], rp->ai_family) >= 0
+          && rp->ai_addrlen <= sizeof (struct sockaddr_storage))
+        break;
+    }
+
+  if (!rp)
+    goto cleanup;
+
+  if (getnameinfo (rp->ai_addr,
+                   rp->ai_addrlen,
+                   hbuf,
+                   NI_MAXHOST,
+                   sbuf,
+                   NI_MAXSERV,
+                   NI_NUMERICHOST | NI_NUMERICSERV))
+    goto cleanup;
+
+  if (!(h = (struct ipmiseld_engine_host *)malloc (sizeof (struct ipmiseld_engine_host))))
+    {
+      ipmiseld_err_output (host_data, "malloc: %s", strerror (errno));
+      goto cleanup;
+    }
+
+  memset (h, '\0', sizeof (struct ipmiseld_engine_host));
+  h->host_data = host_data;
+  memcpy (&h->addr, rp->ai_addr, rp->ai_addrlen);
+  h->addrlen = rp->ai_addrlen;
+  snprintf (h->key, IPMISELD_ENGINE_KEY_BUFLEN, "%s:%s", hbuf, sbuf);
+  h->state = IPMISELD_ENGINE_STATE_IDLE;
+
+  /* Responses are matched to hosts by address, so the same address
+   * can't be polled twice by one thread.  Otherwise spread hosts
+   * evenly across threads.
+   */
+  for (i = 0; i < engine_threads_len; i++)
+    {
+      pthread_mutex_lock (&engine_threads[i].lock);
+      if (!hash_find (engine_threads[i].hosts, h->key)
+          && (!t || engine_threads[i].hosts_count < t->hosts_count))
+        t = &engine_threads[i];
+      pthread_mutex_unlock (&engine_threads[i].lock);
+    }
+
+  if (!t)
+    goto cleanup;
+
+  pthread_mutex_lock (&t->lock);
+  if (!hash_insert (t->hosts, h->key, h))
+    {
+      pthread_mutex_unlock (&t->lock);
+      goto cleanup;
+    }
+  t->hosts_count++;
+  h->thread = t;
+  pthread_mutex_unlock (&t->lock);
+
+  host_data->engine_host = h;
+  rv = 0;
+ cleanup:
+  if (rv < 0)
+    free (h);
+  if (res)
+    freeaddrinfo (res);
+  free (addr);
+  free (port);
+  return (rv);
+}
+
+void
+ipmiseld_engine_host_destroy (ipmiseld_host_data_t *host_data)
+{
+  struct ipmiseld_engine_host *h;
+
+  assert (host_data);
+
+  if (!(h = host_data->engine_host))
+    return;
+
+  host_data->engine_host = NULL;
+
+  /* Once out of the hash, responses are no longer dispatched to the
+   * host, but the engine thread may be in the middle of handling one.
+   * Leave it to the engine thread to free the host.
+   */
+  if (h->thread)
+    {
+      struct ipmiseld_engine_thread *t = h->thread;
+
+      pthread_mutex_lock (&t->lock);
+      hash_remove (t->hosts, h->key);
+      t->hosts_count--;
+      if (!list_append (t->dead, h))
+        {
+          pthread_mutex_unlock (&t->lock);
+          /* leak rather than risk a use after free */
+          err_output ("list_append: %s", strerror (errno));
+          return;
+        }
+      pthread_mutex_unlock (&t->lock);
+
+      _engine_notify (t);
+      return;
+    }
+
+  free (h);
+}
+
+int
+ipmiseld_engine_host_session_open (ipmiseld_host_data_t *host_data)
+{
+  assert (host_data);
+
+  if (!host_data->engine_host)
+    return (0);
+
+  return (host_data->engine_host->session_open);
+}
+
+int
+ipmiseld_engine_queue (ipmiseld_host_data_t *host_data)
+{
+  struct ipmiseld_engine_host *h;
+  struct ipmiseld_engine_thread *t;
+
+  assert (host_data);
+  assert (host_data->engine_host);
+  assert (host_data->engine_host->thread);
+
+  h = host_data->engine_host;
+  t = h->thread;
+
+  pthread_mutex_lock (&t->lock);
+
+  if (!list_enqueue (t->queue, h))
+    {
+      pthread_mutex_unlock (&t->lock);
+      err_output ("list_enqueue: %s", strerror (errno));
+      return (-1);
+    }
+
+  pthread_mutex_unlock (&t->lock);
+
+  _engine_notify (t);
+  return (0);
+}
+
+int
+ipmiseld_engine_queue_count (void)
+{
+  unsigned int i;
+  int count = 0;
+
+  for (i = 0; i < engine_threads_len; i++)
+    {
+      pthread_mutex_lock (&engine_threads[i].lock);
+      if (engine_threads[i].queue)
+        count += list_count (engine_threads[i].queue);
+      pthread_mutex_unlock (&engine_threads[i].lock);
+    }
+
+  return (count);
+}
@@ -0,0 +1,94 @@
+/*****************************************************************************\
+ *  $Id: ipmiseld.h,v 1.11 2010-02-08 22:02:30 chu11 Exp $
+ *****************************************************************************
+ *  Copyright (C) 2012-2015 Lawrence Livermore National Security, LLC.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  Written by Albert Chu <chu11@llnl.gov>
+ *  LLNL-CODE-559172
+ *
+ *  This file is part of Ipmiseld, an IPMI SEL syslog logging daemon.
+ *  For details, see https://savannah.gnu.org/projects/freeipmi/.
+ *
+ *  Ipmiseld is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 3 of the License, or (at your
+ *  option) any later version.
+ *
+ *  Ipmiseld is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Ipmiseld.  If not, see <http://www.gnu.org/licenses/>.
+\*****************************************************************************/
+
+#ifndef IPMISELD_ENGINE_H
+#define IPMISELD_ENGINE_H
+
+#include <freeipmi/freeipmi.h>
+
+#include "ipmiseld.h"
+
+/* Called with the Get SEL Info response of a poll.  Returns 1 if
+ * the last SEL record id is needed to check for new entries, 0 if
+ * not, -1 on error.
+ */
+typedef int (*IpmiSeldEngineSelInfo)(ipmiseld_host_data_t *host_data,
+                                     fiid_obj_t obj_cmd_rs);
+
+/* Called with the last SEL record id if one was needed, NULL
+ * otherwise.  Returns 1 if SEL entries from record_id_start on should
+ * be logged, 0 if not, -1 on error.
+ */
+typedef int (*IpmiSeldEngineCheckSelInfo)(ipmiseld_host_data_t *host_data,
+                                          ipmiseld_last_record_id_t *last_record_id,
+                                          uint16_t *record_id_start);
+
+/* Called with each SEL record read.  Returns 0 on success, -1 on
+ * error.
+ */
+typedef int (*IpmiSeldEngineSelRecord)(ipmiseld_host_data_t *host_data,
+                                       const void *sel_record,
+                                       unsigned int sel_record_len);
+
+/* Called after a poll completes successfully. */
+typedef int (*IpmiSeldEngineFinish)(ipmiseld_host_data_t *host_data);
+
+/* Called after every poll or keepalive, successful or not. */
+typedef int (*IpmiSeldEnginePostProcess)(void *arg);
+
+struct ipmiseld_engine_callbacks
+{
+  IpmiSeldEngineSelInfo sel_info;
+  IpmiSeldEngineCheckSelInfo check_sel_info;
+  IpmiSeldEngineSelRecord sel_record;
+  IpmiSeldEngineFinish finish;
+  IpmiSeldEnginePostProcess postprocess;
+};
+
+int ipmiseld_engine_init (struct ipmiseld_prog_data *prog_data,
+                          struct ipmiseld_engine_callbacks *callbacks);
+
+/* Completes polls in progress and closes open sessions before
+ * returning.
+ */
+void ipmiseld_engine_destroy (void);
+
+/* Hand a host over to the engine.  Returns 0 on success, -1 if the
+ * host cannot be polled by the engine and must continue to be polled
+ * by the threadpool.
+ */
+int ipmiseld_engine_host_add (ipmiseld_host_data_t *host_data);
+
+void ipmiseld_engine_host_destroy (ipmiseld_host_data_t *host_data);
+
+/* returns 1 if the engine has an IPMI session open to the host, 0 if not */
+int ipmiseld_engine_host_session_open (ipmiseld_host_data_t *host_data);
+
+int ipmiseld_engine_queue (ipmiseld_host_data_t *host_data);
+
+/* returns number of queued polls not yet started by the engine */
+int ipmiseld_engine_queue_count (void);
+
+#endif /* IPMISELD_ENGINE_H */
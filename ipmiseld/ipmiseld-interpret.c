@@ -0,0 +1,339 @@
+/*****************************************************************************\
+ *  $Id: ipmiseld.h,v 1.11 2010-02-08 22:02:30 chu11 Exp $
+ *****************************************************************************
+ *  Copyright (C) 2012-2015 Lawrence Livermore National Security, LLC.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  Written by Albert Chu <chu11@llnl.gov>
+ *  LLNL-CODE-559172
+ *
+ *  This file is part of Ipmiseld, an IPMI SEL syslog logging daemon.
+ *  For details, see https://savannah.gnu.org/projects/freeipmi/.
+ *
+ *  Ipmiseld is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 3 of the License, or (at your
+ *  option) any later version.
+ *
+ *  Ipmiseld is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Ipmiseld.  If not, see <http://www.gnu.org/licenses/>.
+\*****************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#if STDC_HEADERS
+#include <string.h>
+#endif /* STDC_HEADERS */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <signal.h>
+#include <pthread.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <freeipmi/freeipmi.h>
+
+#include "ipmiseld.h"
+#include "ipmiseld-interpret.h"
+#include "ipmiseld-common.h"
+#include "ipmiseld-debug.h"
+
+#include "freeipmi-portability.h"
+#include "error.h"
+
+/* in seconds, how often the config file is checked for changes */
+#define IPMISELD_INTERPRET_CHECK_INTERVAL 30
+
+struct ipmiseld_interpret
+{
+  ipmi_interpret_ctx_t interpret_ctx;
+  /* hosts using this configuration + 1 while it is the current one */
+  unsigned int refcount;
+  time_t mtime;
+};
+
+static ipmiseld_prog_data_t *interpret_prog_data = NULL;
+
+static struct ipmiseld_interpret *interpret_current = NULL;
+
+/* lock protects interpret_current, refcounts, and the check state
+ * below.  It is never held while the config is parsed.
+ */
+static pthread_mutex_t interpret_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static time_t interpret_check_time = 0;
+
+/* set while a thread loads the config, so only one does */
+static int interpret_loading = 0;
+
+static volatile sig_atomic_t interpret_reload_flag = 0;
+
+/* 0 if the config file does not exist */
+static time_t
+_interpret_config_mtime (void)
+{
+  struct stat buf;
+
+  assert (interpret_prog_data);
+
+  if (stat (interpret_prog_data->args->event_state_config_file
+            ? interpret_prog_data->args->event_state_config_file
+            : INTERPRET_SEL_CONFIG_FILE_DEFAULT,
+            &buf) < 0)
+    return (0);
+
+  return (buf.st_mtime);
+}
+
+static struct ipmiseld_interpret *
+_interpret_load (time_t mtime)
+{
+  struct ipmiseld_interpret *interpret = NULL;
+
+  assert (interpret_prog_data);
+
+  if (!(interpret = (struct ipmiseld_interpret *)malloc (sizeof (struct ipmiseld_interpret))))
+    {
+      err_output ("malloc: %s", strerror (errno));
+      return (NULL);
+    }
+  memset (interpret, '\0', sizeof (struct ipmiseld_interpret));
+
+  interpret->mtime = mtime;
+
+  if (!(interpret->interpret_ctx = ipmi_interpret_ctx_create ()))
+    {
+      err_output ("ipmi_interpret_ctx_create: %s", strerror (errno));
+      goto cleanup;
+    }
+
+  if (ipmi_interpret_load_sel_config (interpret->interpret_ctx,
+                                      interpret_prog_data->args->event_state_config_file) < 0)
+    {
+      /* if default file is missing its ok */
+      if (!(!interpret_prog_data->args->event_state_config_file
+            && ipmi_interpret_ctx_errnum (interpret->interpret_ctx) == IPMI_INTERPRET_ERR_SEL_CONFIG_FILE_DOES_NOT_EXIST))
+        {
+          err_output ("ipmi_interpret_load_sel_config: %s",
+                      ipmi_interpret_ctx_errormsg (interpret->interpret_ctx));
+          goto cleanup;
+        }
+    }
+
+  interpret->refcount = 1;
+  return (interpret);
+
+ cleanup:
+  ipmi_interpret_ctx_destroy (interpret->interpret_ctx);
+  free (interpret);
+  return (NULL);
+}
+
+/* must be called with interpret_lock held */
+static void
+_interpret_release (struct ipmiseld_interpret *interpret)
+{
+  assert (interpret);
+  assert (interpret->refcount);
+
+  if (!--interpret->refcount)
+    {
+      ipmi_interpret_ctx_destroy (interpret->interpret_ctx);
+      free (interpret);
+    }
+}
+
+/* Reload the config on SIGHUP, or if it was modified.  The file is
+ * stat()ed at most every IPMISELD_INTERPRET_CHECK_INTERVAL seconds
+ * and parsed without interpret_lock held, so other hosts are not
+ * held up.
+ */
+static void
+_interpret_check_reload (void)
+{
+  struct ipmiseld_interpret *interpret;
+  time_t current_mtime;
+  time_t mtime;
+  time_t now;
+  int reload;
+
+  now = time (NULL);
+
+  pthread_mutex_lock (&interpret_lock);
+  if (interpret_loading
+      || (!interpret_reload_flag && now < interpret_check_time))
+    {
+      pthread_mutex_unlock (&interpret_lock);
+      return;
+    }
+  interpret_loading = 1;
+  interpret_check_time = now + IPMISELD_INTERPRET_CHECK_INTERVAL;
+  reload = interpret_reload_flag;
+  interpret_reload_flag = 0;
+  current_mtime = interpret_current->mtime;
+  pthread_mutex_unlock (&interpret_lock);
+
+  /* before parsing, so a change while parsing is not missed */
+  mtime = _interpret_config_mtime ();
+
+  if (!reload && mtime == current_mtime)
+    {
+      pthread_mutex_lock (&interpret_lock);
+      interpret_loading = 0;
+      pthread_mutex_unlock (&interpret_lock);
+      return;
+    }
+
+  interpret = _interpret_load (mtime);
+
+  pthread_mutex_lock (&interpret_lock);
+  interpret_loading = 0;
+  /* Keep the old configuration if the new one can't be loaded, it's
+   * retried once the file changes again.
+   */
+  if (!interpret)
+    interpret_current->mtime = mtime;
+  else
+    {
+      if (interpret_prog_data->args->foreground
+          && interpret_prog_data->args->common_args.debug)
+        IPMISELD_DEBUG (("Event state configuration reloaded"));
+
+      _interpret_release (interpret_current);
+      interpret_current = interpret;
+    }
+  pthread_mutex_unlock (&interpret_lock);
+}
+
+int
+ipmiseld_interpret_init (ipmiseld_prog_data_t *prog_data)
+{
+  assert (prog_data);
+  assert (!interpret_current);
+
+  interpret_prog_data = prog_data;
+
+  if (!(interpret_current = _interpret_load (_interpret_config_mtime ())))
+    return (-1);
+
+  interpret_check_time = time (NULL) + IPMISELD_INTERPRET_CHECK_INTERVAL;
+
+  return (0);
+}
+
+void
+ipmiseld_interpret_cleanup (void)
+{
+  if (!interpret_current)
+    return;
+
+  pthread_mutex_lock (&interpret_lock);
+  _interpret_release (interpret_current);
+  interpret_current = NULL;
+  pthread_mutex_unlock (&interpret_lock);
+}
+
+void
+ipmiseld_interpret_reload (void)
+{
+  interpret_reload_flag = 1;
+}
+
+int
+ipmiseld_interpret_setup (ipmiseld_host_data_t *host_data)
+{
+  struct ipmiseld_interpret *interpret;
+  ipmi_interpret_ctx_t interpret_ctx = NULL;
+  unsigned int interpret_flags = 0;
+
+  assert (host_data);
+  assert (host_data->host_poll);
+  assert (interpret_current);
+
+  _interpret_check_reload ();
+
+  pthread_mutex_lock (&interpret_lock);
+  interpret = interpret_current;
+  if (interpret != host_data->host_poll->interpret)
+    interpret->refcount++;
+  pthread_mutex_unlock (&interpret_lock);
+
+  if (interpret == host_data->host_poll->interpret)
+    return (0);
+
+  if (!(interpret_ctx = ipmi_interpret_ctx_create_shared (interpret->interpret_ctx)))
+    {
+      ipmiseld_err_output (host_data, "ipmi_interpret_ctx_create_shared: %s", strerror (errno));
+      goto cleanup;
+    }
+
+  if (host_data->prog_data->args->interpret_oem_data)
+    interpret_flags |= IPMI_INTERPRET_FLAGS_INTERPRET_OEM_DATA;
+
+  if (interpret_flags)
+    {
+      if (ipmi_interpret_ctx_set_flags (interpret_ctx, interpret_flags) < 0)
+        {
+          ipmiseld_err_output (host_data, "ipmi_interpret_ctx_set_flags: %s",
+                               ipmi_interpret_ctx_errormsg (interpret_ctx));
+          goto cleanup;
+        }
+    }
+
+  if (host_data->prog_data->args->interpret_oem_data)
+    {
+      if (ipmi_interpret_ctx_set_manufacturer_id (interpret_ctx,
+                                                  host_data->host_poll->oem_data.manufacturer_id) < 0)
+        {
+          ipmiseld_err_output (host_data, "ipmi_interpret_ctx_set_manufacturer_id: %s",
+                               ipmi_interpret_ctx_errormsg (interpret_ctx));
+          goto cleanup;
+        }
+
+      if (ipmi_interpret_ctx_set_product_id (interpret_ctx,
+                                             host_data->host_poll->oem_data.product_id) < 0)
+        {
+          ipmiseld_err_output (host_data, "ipmi_interpret_ctx_set_product_id: %s",
+                               ipmi_interpret_ctx_errormsg (interpret_ctx));
+          goto cleanup;
+        }
+    }
+
+  ipmiseld_interpret_destroy (host_data);
+  host_data->host_poll->interpret_ctx = interpret_ctx;
+  host_data->host_poll->interpret = interpret;
+  return (1);
+
+ cleanup:
+  ipmi_interpret_ctx_destroy (interpret_ctx);
+  pthread_mutex_lock (&interpret_lock);
+  _interpret_release (interpret);
+  pthread_mutex_unlock (&interpret_lock);
+  return (-1);
+}
+
+void
+ipmiseld_interpret_destroy (ipmiseld_host_data_t *host_data)
+{
+  assert (host_data);
+  assert (host_data->host_poll);
+
+  ipmi_interpret_ctx_destroy (host_data->host_poll->interpret_ctx);
+  host_data->host_poll->interpret_ctx = NULL;
+
+  if (host_data->host_poll->interpret)
+    {
+      pthread_mutex_lock (&interpret_lock);
+      _interpret_release (host_data->host_poll->interpret);
+      pthread_mutex_unlock (&interpret_lock);
+      host_data->host_poll->interpret = NULL;
+    }
+}
@@ -0,0 +1,50 @@
+/*****************************************************************************\
+ *  $Id: ipmiseld.h,v 1.11 2010-02-08 22:02:30 chu11 Exp $
+ *****************************************************************************
+ *  Copyright (C) 2012-2015 Lawrence Livermore National Security, LLC.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  Written by Albert Chu <chu11@llnl.gov>
+ *  LLNL-CODE-559172
+ *
+ *  This file is part of Ipmiseld, an IPMI SEL syslog logging daemon.
+ *  For details, see https://savannah.gnu.org/projects/freeipmi/.
+ *
+ *  Ipmiseld is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 3 of the License, or (at your
+ *  option) any later version.
+ *
+ *  Ipmiseld is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Ipmiseld.  If not, see <http://www.gnu.org/licenses/>.
+\*****************************************************************************/
+
+#ifndef IPMISELD_INTERPRET_H
+#define IPMISELD_INTERPRET_H
+
+#include "ipmiseld.h"
+
+/* The event state configuration is parsed once and shared by the
+ * interpret contexts of all hosts.  It is re-read when the config
+ * file changes or after ipmiseld_interpret_reload() is called.
+ */
+int ipmiseld_interpret_init (ipmiseld_prog_data_t *prog_data);
+
+void ipmiseld_interpret_cleanup (void);
+
+/* async signal safe */
+void ipmiseld_interpret_reload (void);
+
+/* Sets up the host's interpret context on the current configuration.
+ * Returns 1 if the context was (re-)created, 0 if the host is already
+ * on the current configuration, -1 on error.
+ */
+int ipmiseld_interpret_setup (ipmiseld_host_data_t *host_data);
+
+void ipmiseld_interpret_destroy (ipmiseld_host_data_t *host_data);
+
+#endif /* IPMISELD_INTERPRET_H */
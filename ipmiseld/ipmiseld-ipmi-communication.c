@@ -42,6 +42,7 @@
 #include "ipmiseld.h"
 #include "ipmiseld-common.h"
 #include "ipmiseld-ipmi-communication.h"
+#include "ipmiseld-stats.h"
 
 #include "freeipmi-portability.h"
 #include "error.h"
@@ -53,6 +54,8 @@ _last_errnum_manage (ipmiseld_host_data_t *host_data)
 {
   assert (host_data);
 
+  ipmiseld_stats_ipmi_error (ipmi_ctx_errnum (host_data->host_poll->ipmi_ctx));
+
   if (host_data->last_ipmi_errnum != ipmi_ctx_errnum (host_data->host_poll->ipmi_ctx))
     {
       host_data->last_ipmi_errnum = ipmi_ctx_errnum (host_data->host_poll->ipmi_ctx);
@@ -284,3 +287,39 @@ ipmiseld_ipmi_setup (ipmiseld_host_data_t *host_data)
     }
   return (rv);
 }
+
+int
+ipmiseld_ipmi_keepalive (ipmiseld_host_data_t *host_data)
+{
+  fiid_obj_t obj_cmd_rs = NULL;
+  int rv = -1;
+
+  assert (host_data);
+  assert (host_data->host_poll);
+  assert (host_data->host_poll->ipmi_ctx);
+
+  if (!(obj_cmd_rs = fiid_obj_create (tmpl_cmd_get_device_id_rs)))
+    {
+      ipmiseld_err_output (host_data, "fiid_obj_create: %s", strerror (errno));
+      goto cleanup;
+    }
+
+  if (ipmi_cmd_get_device_id (host_data->host_poll->ipmi_ctx, obj_cmd_rs) < 0)
+    {
+      /* the BMC responded, so the session is still alive */
+      if (ipmi_ctx_errnum (host_data->host_poll->ipmi_ctx) == IPMI_ERR_BAD_COMPLETION_CODE)
+        goto out;
+
+      if (host_data->prog_data->args->verbose_count)
+        ipmiseld_err_output (host_data,
+                             "ipmi_cmd_get_device_id: %s",
+                             ipmi_ctx_errormsg (host_data->host_poll->ipmi_ctx));
+      goto cleanup;
+    }
+
+ out:
+  rv = 0;
+ cleanup:
+  fiid_obj_destroy (obj_cmd_rs);
+  return (rv);
+}
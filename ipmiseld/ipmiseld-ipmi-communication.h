@@ -30,4 +30,9 @@
 
 int ipmiseld_ipmi_setup (ipmiseld_host_data_t *host_data);
 
+/* Send a cheap command so the BMC does not time out an idle session.
+ * Returns 0 if the session is still alive, -1 if not.
+ */
+int ipmiseld_ipmi_keepalive (ipmiseld_host_data_t *host_data);
+
 #endif /* IPMISELD_IPMI_COMMUNICATION_H */
@@ -0,0 +1,626 @@
+/*****************************************************************************\
+ *  $Id: ipmiseld.h,v 1.11 2010-02-08 22:02:30 chu11 Exp $
+ *****************************************************************************
+ *  Copyright (C) 2012-2015 Lawrence Livermore National Security, LLC.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  Written by Albert Chu <chu11@llnl.gov>
+ *  LLNL-CODE-559172
+ *
+ *  This file is part of Ipmiseld, an IPMI SEL syslog logging daemon.
+ *  For details, see https://savannah.gnu.org/projects/freeipmi/.
+ *
+ *  Ipmiseld is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 3 of the License, or (at your
+ *  option) any later version.
+ *
+ *  Ipmiseld is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Ipmiseld.  If not, see <http://www.gnu.org/licenses/>.
+\*****************************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#if STDC_HEADERS
+#include <string.h>
+#endif /* STDC_HEADERS */
+#if TIME_WITH_SYS_TIME
+#include <sys/time.h>
+#include <time.h>
+#else /* !TIME_WITH_SYS_TIME */
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#else /* !HAVE_SYS_TIME_H */
+#include <time.h>
+#endif /* !HAVE_SYS_TIME_H */
+#endif /* !TIME_WITH_SYS_TIME */
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif /* HAVE_FCNTL_H */
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <syslog.h>
+#include <signal.h>
+#include <pthread.h>
+#include <assert.h>
+#include <errno.h>
+
+#include <freeipmi/freeipmi.h>
+
+#include "ipmiseld.h"
+#include "ipmiseld-common.h"
+#include "ipmiseld-output.h"
+
+#include "freeipmi-portability.h"
+#include "error.h"
+#include "fd.h"
+
+/* max messages written out per wakeup of the writer thread */
+#define IPMISELD_OUTPUT_BATCH_MAX    64
+
+#define IPMISELD_OUTPUT_TIMESTAMP_LEN 15
+
+#define IPMISELD_OUTPUT_HEADER_LEN   128
+
+#define IPMISELD_OUTPUT_BUFLEN       1024
+
+#define IPMISELD_OUTPUT_TARGET_SYSLOG 0
+#define IPMISELD_OUTPUT_TARGET_FILE   1
+#define IPMISELD_OUTPUT_TARGET_SOCKET 2
+
+struct ipmiseld_output_msg
+{
+  time_t timestamp;
+  char *message;
+};
+
+static struct ipmiseld_prog_data *output_prog_data = NULL;
+static int output_target = IPMISELD_OUTPUT_TARGET_SYSLOG;
+static int output_overflow = IPMISELD_LOG_QUEUE_OVERFLOW_BLOCK;
+static const char *output_ident = NULL;
+static pid_t output_pid = 0;
+static int output_fd = -1;
+static struct sockaddr_un output_addr;
+static int output_error_reported = 0;
+static volatile sig_atomic_t output_reopen_flag = 0;
+
+static pthread_t output_tid;
+static int output_running = 0;
+static int output_exit_flag = 0;
+
+/* circular queue of pending messages */
+static struct ipmiseld_output_msg **output_queue = NULL;
+static unsigned int output_queue_len = 0;
+static unsigned int output_queue_head = 0;
+static unsigned int output_queue_count = 0;
+static unsigned int output_dropped = 0;
+static unsigned int output_dropped_total = 0;
+static pthread_mutex_t output_queue_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t output_queue_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t output_queue_space_cond = PTHREAD_COND_INITIALIZER;
+
+static struct ipmiseld_output_msg *
+_output_msg_create (time_t timestamp, const char *message)
+{
+  struct ipmiseld_output_msg *msg;
+  size_t len;
+
+  assert (message);
+
+  len = strlen (message);
+
+  /* message stored in the same allocation */
+  if (!(msg = (struct ipmiseld_output_msg *)malloc (sizeof (struct ipmiseld_output_msg) + len + 1)))
+    return (NULL);
+
+  msg->timestamp = timestamp;
+  msg->message = (char *)(msg + 1);
+  memcpy (msg->message, message, len + 1);
+  return (msg);
+}
+
+static void
+_output_error (const char *func)
+{
+  assert (func);
+
+  /* output errors go to syslog, don't flood it if the target stays
+   * broken
+   */
+  if (!output_error_reported)
+    {
+      if (output_target == IPMISELD_OUTPUT_TARGET_FILE)
+        err_output ("%s: %s: %s",
+                    output_prog_data->args->log_file,
+                    func,
+                    strerror (errno));
+      else
+        err_output ("%s: %s: %s",
+                    output_prog_data->args->log_socket,
+                    func,
+                    strerror (errno));
+      output_error_reported = 1;
+    }
+}
+
+static int
+_output_open (void)
+{
+  assert (output_fd < 0);
+
+  if (output_target == IPMISELD_OUTPUT_TARGET_FILE)
+    {
+      if ((output_fd = open (output_prog_data->args->log_file,
+                             O_WRONLY | O_APPEND | O_CREAT,
+                             0644)) < 0)
+        {
+          _output_error ("open");
+          return (-1);
+        }
+    }
+  else
+    {
+      if ((output_fd = socket (AF_UNIX, SOCK_DGRAM, 0)) < 0)
+        {
+          _output_error ("socket");
+          return (-1);
+        }
+
+      if (connect (output_fd,
+                   (struct sockaddr *)&output_addr,
+                   sizeof (struct sockaddr_un)) < 0)
+        {
+          _output_error ("connect");
+          close (output_fd);
+          output_fd = -1;
+          return (-1);
+        }
+    }
+
+  return (0);
+}
+
+static void
+_output_close (void)
+{
+  if (output_fd >= 0)
+    {
+      close (output_fd);
+      output_fd = -1;
+    }
+}
+
+/* syslog style "Mmm dd hh:mm:ss ident[pid]: " header */
+static int
+_output_header (time_t timestamp, char *buf, unsigned int buflen)
+{
+  struct tm tm;
+  char timebuf[IPMISELD_OUTPUT_TIMESTAMP_LEN + 1];
+  int len;
+
+  assert (buf);
+  assert (buflen);
+
+  memset (timebuf, '\0', IPMISELD_OUTPUT_TIMESTAMP_LEN + 1);
+  localtime_r (&timestamp, &tm);
+  strftime (timebuf, IPMISELD_OUTPUT_TIMESTAMP_LEN + 1, "%b %e %H:%M:%S", &tm);
+
+  len = snprintf (buf,
+                  buflen,
+                  "%s %s[%u]: ",
+                  timebuf,
+                  output_ident,
+                  (unsigned int)output_pid);
+  if (len < 0 || (unsigned int)len >= buflen)
+    len = buflen - 1;
+  return (len);
+}
+
+static void
+_output_write_file (struct ipmiseld_output_msg **msgs, unsigned int msgs_len)
+{
+  char *buf;
+  size_t buflen = 0;
+  size_t len = 0;
+  unsigned int i;
+
+  assert (msgs);
+  assert (msgs_len);
+
+  for (i = 0; i < msgs_len; i++)
+    buflen += IPMISELD_OUTPUT_HEADER_LEN + strlen (msgs[i]->message) + 1;
+
+  if (!(buf = (char *)malloc (buflen + 1)))
+    {
+      _output_error ("malloc");
+      return;
+    }
+
+  for (i = 0; i < msgs_len; i++)
+    {
+      size_t msglen = strlen (msgs[i]->message);
+
+      len += _output_header (msgs[i]->timestamp,
+                             buf + len,
+                             IPMISELD_OUTPUT_HEADER_LEN);
+      memcpy (buf + len, msgs[i]->message, msglen);
+      len += msglen;
+      buf[len++] = '\n';
+    }
+
+  /* single write for the whole batch, O_APPEND keeps lines intact
+   * with other writers
+   */
+  if (fd_write_n (output_fd, buf, len) < 0)
+    _output_error ("write");
+  else
+    output_error_reported = 0;
+
+  free (buf);
+}
+
+static void
+_output_write_socket (struct ipmiseld_output_msg **msgs, unsigned int msgs_len)
+{
+  char buf[IPMISELD_OUTPUT_HEADER_LEN + IPMISELD_OUTPUT_BUFLEN + 1];
+  unsigned int i;
+
+  assert (msgs);
+  assert (msgs_len);
+
+  for (i = 0; i < msgs_len; i++)
+    {
+      int len;
+
+      /* RFC 3164 format, as syslog(3) sends it */
+      len = snprintf (buf,
+                      IPMISELD_OUTPUT_HEADER_LEN,
+                      "<%d>",
+                      output_prog_data->log_facility | output_prog_data->log_priority);
+      len += _output_header (msgs[i]->timestamp,
+                             buf + len,
+                             IPMISELD_OUTPUT_HEADER_LEN - len);
+      len += snprintf (buf + len,
+                       IPMISELD_OUTPUT_BUFLEN + 1,
+                       "%s",
+                       msgs[i]->message);
+      if (len > IPMISELD_OUTPUT_HEADER_LEN + IPMISELD_OUTPUT_BUFLEN)
+        len = IPMISELD_OUTPUT_HEADER_LEN + IPMISELD_OUTPUT_BUFLEN;
+
+      if (send (output_fd, buf, len, 0) < 0)
+        {
+          /* the log daemon may have been restarted, reconnect and
+           * try again once
+           */
+          if (errno == ECONNREFUSED
+              || errno == ENOTCONN
+              || errno == ENOENT)
+            {
+              _output_close ();
+              if (_output_open () < 0)
+                return;
+              if (send (output_fd, buf, len, 0) >= 0)
+                continue;
+            }
+          _output_error ("send");
+          return;
+        }
+      output_error_reported = 0;
+    }
+}
+
+static void
+_output_write (struct ipmiseld_output_msg **msgs, unsigned int msgs_len)
+{
+  unsigned int i;
+
+  assert (msgs);
+  assert (msgs_len);
+
+  if (output_target == IPMISELD_OUTPUT_TARGET_SYSLOG)
+    {
+      for (i = 0; i < msgs_len; i++)
+        syslog (output_prog_data->log_priority, "%s", msgs[i]->message);
+      return;
+    }
+
+  if (output_reopen_flag)
+    {
+      output_reopen_flag = 0;
+      _output_close ();
+    }
+
+  if (output_fd < 0)
+    {
+      if (_output_open () < 0)
+        return;
+    }
+
+  if (output_target == IPMISELD_OUTPUT_TARGET_FILE)
+    _output_write_file (msgs, msgs_len);
+  else
+    _output_write_socket (msgs, msgs_len);
+}
+
+static void *
+_output_func (void *arg)
+{
+  /* +1 for overflow message */
+  struct ipmiseld_output_msg *msgs[IPMISELD_OUTPUT_BATCH_MAX + 1];
+
+  while (1)
+    {
+      unsigned int msgs_len = 0;
+      unsigned int dropped;
+      unsigned int dropped_total;
+      unsigned int i;
+
+      pthread_mutex_lock (&output_queue_lock);
+
+      while (!output_queue_count && !output_exit_flag)
+        pthread_cond_wait (&output_queue_cond, &output_queue_lock);
+
+      if (!output_queue_count && output_exit_flag)
+        {
+          pthread_mutex_unlock (&output_queue_lock);
+          break;
+        }
+
+      dropped = output_dropped;
+      dropped_total = output_dropped_total;
+      output_dropped = 0;
+
+      /* msgs[0] reserved for the overflow message */
+      while (output_queue_count && msgs_len < IPMISELD_OUTPUT_BATCH_MAX)
+        {
+          msgs[1 + msgs_len++] = output_queue[output_queue_head];
+          output_queue_head = (output_queue_head + 1) % output_queue_len;
+          output_queue_count--;
+        }
+
+      pthread_cond_broadcast (&output_queue_space_cond);
+
+      pthread_mutex_unlock (&output_queue_lock);
+
+      msgs[0] = NULL;
+
+      /* report drops ahead of the messages that survived them */
+      if (dropped)
+        {
+          char buf[IPMISELD_OUTPUT_BUFLEN];
+
+          snprintf (buf,
+                    IPMISELD_OUTPUT_BUFLEN,
+                    "log queue full, %u messages dropped (%u total)",
+                    dropped,
+                    dropped_total);
+
+          msgs[0] = _output_msg_create (time (NULL), buf);
+        }
+
+      if (msgs[0])
+        _output_write (msgs, msgs_len + 1);
+      else
+        _output_write (msgs + 1, msgs_len);
+
+      for (i = 0; i < msgs_len + 1; i++)
+        free (msgs[i]);
+    }
+
+  return (NULL);
+}
+
+int
+ipmiseld_output_init (struct ipmiseld_prog_data *prog_data)
+{
+  pthread_attr_t attr;
+  int ret;
+  int rv = -1;
+
+  assert (prog_data);
+  assert (!output_running);
+
+  /* test runs and the foreground write straight to stdout, unless
+   * asked to log elsewhere
+   */
+  if (prog_data->args->test_run
+      || (prog_data->args->foreground
+          && !prog_data->args->log_file
+          && !prog_data->args->log_socket))
+    return (0);
+
+  output_prog_data = prog_data;
+
+  if (prog_data->args->log_file)
+    output_target = IPMISELD_OUTPUT_TARGET_FILE;
+  else if (prog_data->args->log_socket)
+    output_target = IPMISELD_OUTPUT_TARGET_SOCKET;
+  else
+    output_target = IPMISELD_OUTPUT_TARGET_SYSLOG;
+
+  if (prog_data->args->log_queue_overflow_str)
+    output_overflow = ipmiseld_log_queue_overflow_parse (prog_data->args->log_queue_overflow_str);
+  else
+    output_overflow = IPMISELD_LOG_QUEUE_OVERFLOW_BLOCK;
+
+  if ((output_ident = strrchr (prog_data->progname, '/')))
+    output_ident++;
+  else
+    output_ident = prog_data->progname;
+  output_pid = getpid ();
+
+  if (output_target == IPMISELD_OUTPUT_TARGET_SOCKET)
+    {
+      if (strlen (prog_data->args->log_socket) >= sizeof (output_addr.sun_path))
+        {
+          err_output ("log socket path '%s' too long", prog_data->args->log_socket);
+          goto cleanup;
+        }
+
+      memset (&output_addr, '\0', sizeof (struct sockaddr_un));
+      output_addr.sun_family = AF_UNIX;
+      strcpy (output_addr.sun_path, prog_data->args->log_socket);
+    }
+
+  /* catch bad paths up front */
+  if (output_target != IPMISELD_OUTPUT_TARGET_SYSLOG)
+    {
+      if (_output_open () < 0)
+        goto cleanup;
+    }
+
+  assert (prog_data->args->log_queue_length);
+
+  if (!(output_queue = (struct ipmiseld_output_msg **)calloc (prog_data->args->log_queue_length,
+                                                              sizeof (struct ipmiseld_output_msg *))))
+    {
+      err_output ("calloc: %s", strerror (errno));
+      goto cleanup;
+    }
+  output_queue_len = prog_data->args->log_queue_length;
+  output_queue_head = 0;
+  output_queue_count = 0;
+  output_dropped = 0;
+  output_dropped_total = 0;
+  output_exit_flag = 0;
+
+  if ((ret = pthread_attr_init (&attr)))
+    {
+      err_output ("pthread_attr_init: %s", strerror (ret));
+      goto cleanup;
+    }
+
+  if ((ret = pthread_create (&output_tid,
+                             &attr,
+                             _output_func,
+                             NULL)))
+    {
+      err_output ("pthread_create: %s", strerror (ret));
+      pthread_attr_destroy (&attr);
+      goto cleanup;
+    }
+
+  pthread_attr_destroy (&attr);
+
+  output_running = 1;
+  rv = 0;
+ cleanup:
+  if (rv < 0)
+    {
+      free (output_queue);
+      output_queue = NULL;
+      _output_close ();
+    }
+  return (rv);
+}
+
+void
+ipmiseld_output_destroy (void)
+{
+  unsigned int i;
+
+  if (!output_running)
+    return;
+
+  pthread_mutex_lock (&output_queue_lock);
+  output_exit_flag = 1;
+  pthread_cond_signal (&output_queue_cond);
+  pthread_cond_broadcast (&output_queue_space_cond);
+  pthread_mutex_unlock (&output_queue_lock);
+
+  pthread_join (output_tid, NULL);
+  output_running = 0;
+
+  for (i = 0; i < output_queue_count; i++)
+    free (output_queue[(output_queue_head + i) % output_queue_len]);
+  free (output_queue);
+  output_queue = NULL;
+  output_queue_len = 0;
+  output_queue_count = 0;
+
+  _output_close ();
+}
+
+int
+ipmiseld_output_queue (const char *message)
+{
+  struct ipmiseld_output_msg *msg;
+
+  assert (message);
+
+  if (!output_running)
+    return (0);
+
+  if (!(msg = _output_msg_create (time (NULL), message)))
+    return (0);
+
+  pthread_mutex_lock (&output_queue_lock);
+
+  if (output_queue_count == output_queue_len)
+    {
+      if (output_overflow == IPMISELD_LOG_QUEUE_OVERFLOW_BLOCK)
+        {
+          while (output_queue_count == output_queue_len
+                 && !output_exit_flag)
+            pthread_cond_wait (&output_queue_space_cond, &output_queue_lock);
+        }
+
+      if (output_queue_count == output_queue_len)
+        {
+          output_dropped++;
+          output_dropped_total++;
+
+          if (output_overflow == IPMISELD_LOG_QUEUE_OVERFLOW_DROP_OLDEST)
+            {
+              free (output_queue[output_queue_head]);
+              output_queue_head = (output_queue_head + 1) % output_queue_len;
+              output_queue_count--;
+            }
+          else
+            {
+              pthread_mutex_unlock (&output_queue_lock);
+              free (msg);
+              return (1);
+            }
+        }
+    }
+
+  output_queue[(output_queue_head + output_queue_count) % output_queue_len] = msg;
+  output_queue_count++;
+
+  pthread_cond_signal (&output_queue_cond);
+
+  pthread_mutex_unlock (&output_queue_lock);
+
+  return (1);
+}
+
+void
+ipmiseld_output_reopen (void)
+{
+  output_reopen_flag = 1;
+}
+
+int
+ipmiseld_output_queue_count (void)
+{
+  int count;
+
+  pthread_mutex_lock (&output_queue_lock);
+  count = output_queue_count;
+  pthread_mutex_unlock (&output_queue_lock);
+
+  return (count);
+}
@@ -0,0 +1,53 @@
+/*****************************************************************************\
+ *  $Id: ipmiseld.h,v 1.11 2010-02-08 22:02:30 chu11 Exp $
+ *****************************************************************************
+ *  Copyright (C) 2012-2015 Lawrence Livermore National Security, LLC.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  Written by Albert Chu <chu11@llnl.gov>
+ *  LLNL-CODE-559172
+ *
+ *  This file is part of Ipmiseld, an IPMI SEL syslog logging daemon.
+ *  For details, see https://savannah.gnu.org/projects/freeipmi/.
+ *
+ *  Ipmiseld is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 3 of the License, or (at your
+ *  option) any later version.
+ *
+ *  Ipmiseld is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Ipmiseld.  If not, see <http://www.gnu.org/licenses/>.
+\*****************************************************************************/
+
+#ifndef IPMISELD_OUTPUT_H
+#define IPMISELD_OUTPUT_H
+
+#include "ipmiseld.h"
+
+/* Start the log writer thread if log messages are to be handed off
+ * to it, i.e. the daemon is not running in the foreground writing to
+ * stdout.
+ */
+int ipmiseld_output_init (struct ipmiseld_prog_data *prog_data);
+
+/* Write out queued messages, then stop the log writer thread */
+void ipmiseld_output_destroy (void);
+
+/* Returns 1 if message was handed to the log writer thread, 0 if the
+ * caller should output it itself.
+ */
+int ipmiseld_output_queue (const char *message);
+
+/* Reopen the log file on next write, safe to call from a signal
+ * handler.
+ */
+void ipmiseld_output_reopen (void);
+
+/* returns number of messages waiting for the log writer thread */
+int ipmiseld_output_queue_count (void);
+
+#endif /* IPMISELD_OUTPUT_H */
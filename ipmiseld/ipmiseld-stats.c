@@ -0,0 +1,362 @@
+/*****************************************************************************\
+ *  $Id: ipmiseld.h,v 1.11 2010-02-08 22:02:30 chu11 Exp $
+ *****************************************************************************
+ *  Copyright (C) 2012-2015 Lawrence Livermore National Security, LLC.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  Written by Albert Chu <chu11@llnl.gov>
+ *  LLNL-CODE-559172
+ *
+ *  This file is part of Ipmiseld, an IPMI SEL syslog logging daemon.
+ *  For details, see https://savannah.gnu.org/projects/freeipmi/.
+ *
+ *  Ipmiseld is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 3 of the License, or (at your
+ *  option) any later version.
+ *
+ *  Ipmiseld is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Ipmiseld.  If not, see <http://www.gnu.org/licenses/>.
+\*****************************************************************************/
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif /* HAVE_CONFIG_H */
+
+#include <stdio.h>
+#include <stdlib.h>
+#if STDC_HEADERS
+#include <string.h>
+#endif /* STDC_HEADERS */
+#if TIME_WITH_SYS_TIME
+#include <sys/time.h>
+#include <time.h>
+#else /* !TIME_WITH_SYS_TIME */
+#if HAVE_SYS_TIME_H
+#include <sys/time.h>
+#else /* !HAVE_SYS_TIME_H */
+#include <time.h>
+#endif /* !HAVE_SYS_TIME_H */
+#endif /* !TIME_WITH_SYS_TIME */
+#include <pthread.h>
+#include <limits.h>
+#include <assert.h>
+
+#include <freeipmi/freeipmi.h>
+
+#include "ipmiseld.h"
+#include "ipmiseld-common.h"
+#include "ipmiseld-engine.h"
+#include "ipmiseld-output.h"
+#include "ipmiseld-stats.h"
+#include "ipmiseld-threadpool.h"
+
+#include "freeipmi-portability.h"
+#include "timeval.h"
+
+#define IPMISELD_STATS_DURATION_BUCKETS 8
+
+#define IPMISELD_STATS_BUFLEN           1024
+
+/* upper bounds of the poll duration histogram buckets in
+ * milliseconds, the last bucket is everything longer
+ */
+static unsigned int stats_duration_limits[IPMISELD_STATS_DURATION_BUCKETS - 1] =
+  {
+    100,
+    250,
+    500,
+    1000,
+    2500,
+    5000,
+    10000,
+  };
+
+static char *stats_duration_labels[IPMISELD_STATS_DURATION_BUCKETS] =
+  {
+    "<100ms",
+    "<250ms",
+    "<500ms",
+    "<1s",
+    "<2.5s",
+    "<5s",
+    "<10s",
+    ">=10s",
+  };
+
+struct ipmiseld_stats
+{
+  struct timeval interval_start;
+  unsigned int polls;
+  unsigned long poll_lag_total;
+  unsigned int poll_lag_max;
+  unsigned int poll_durations[IPMISELD_STATS_DURATION_BUCKETS];
+  unsigned int poll_duration_max;
+  unsigned int sel_entries_logged;
+  unsigned int sdr_cache_hits;
+  unsigned int sdr_cache_misses;
+  /* last slot counts errnums out of range */
+  unsigned int ipmi_errors[IPMI_ERR_ERRNUMRANGE + 1];
+};
+
+static int stats_enabled = 0;
+static unsigned int stats_interval = 0;
+/* only used by the main thread */
+static struct timeval stats_next_output;
+
+static struct ipmiseld_stats stats;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* milliseconds from a to b, 0 if b is not later than a */
+static unsigned int
+_stats_ms_since (struct timeval *a, struct timeval *b)
+{
+  struct timeval delta;
+  unsigned int ms;
+
+  assert (a);
+  assert (b);
+
+  if (!timeval_gt (b, a))
+    return (0);
+
+  timeval_sub (b, a, &delta);
+  if (delta.tv_sec >= UINT_MAX / 1000)
+    return (UINT_MAX);
+
+  timeval_millisecond_calc (&delta, &ms);
+  return (ms);
+}
+
+int
+ipmiseld_stats_init (struct ipmiseld_prog_data *prog_data)
+{
+  struct timeval now;
+
+  assert (prog_data);
+
+  if (!prog_data->args->stats_interval
+      || prog_data->args->test_run)
+    return (0);
+
+  stats_interval = prog_data->args->stats_interval;
+
+  gettimeofday (&now, NULL);
+
+  memset (&stats, '\0', sizeof (struct ipmiseld_stats));
+  stats.interval_start = now;
+
+  stats_next_output = now;
+  stats_next_output.tv_sec += stats_interval;
+
+  stats_enabled = 1;
+  return (0);
+}
+
+void
+ipmiseld_stats_poll_start (ipmiseld_host_data_t *host_data)
+{
+  unsigned int lag;
+
+  assert (host_data);
+
+  if (!stats_enabled)
+    return;
+
+  gettimeofday (&host_data->poll_start_time, NULL);
+
+  lag = _stats_ms_since (&host_data->next_poll_time, &host_data->poll_start_time);
+
+  pthread_mutex_lock (&stats_lock);
+  stats.polls++;
+  stats.poll_lag_total += lag;
+  if (lag > stats.poll_lag_max)
+    stats.poll_lag_max = lag;
+  pthread_mutex_unlock (&stats_lock);
+}
+
+void
+ipmiseld_stats_poll_finish (ipmiseld_host_data_t *host_data)
+{
+  struct timeval now;
+  unsigned int duration;
+  unsigned int i;
+
+  assert (host_data);
+
+  if (!stats_enabled
+      || !host_data->poll_start_time.tv_sec)
+    return;
+
+  gettimeofday (&now, NULL);
+
+  duration = _stats_ms_since (&host_data->poll_start_time, &now);
+
+  for (i = 0; i < IPMISELD_STATS_DURATION_BUCKETS - 1; i++)
+    {
+      if (duration < stats_duration_limits[i])
+        break;
+    }
+
+  pthread_mutex_lock (&stats_lock);
+  stats.poll_durations[i]++;
+  if (duration > stats.poll_duration_max)
+    stats.poll_duration_max = duration;
+  pthread_mutex_unlock (&stats_lock);
+}
+
+void
+ipmiseld_stats_ipmi_error (int errnum)
+{
+  if (!stats_enabled)
+    return;
+
+  if (errnum < 0 || errnum >= IPMI_ERR_ERRNUMRANGE)
+    errnum = IPMI_ERR_ERRNUMRANGE;
+
+  pthread_mutex_lock (&stats_lock);
+  stats.ipmi_errors[errnum]++;
+  pthread_mutex_unlock (&stats_lock);
+}
+
+void
+ipmiseld_stats_sel_entry_logged (void)
+{
+  if (!stats_enabled)
+    return;
+
+  pthread_mutex_lock (&stats_lock);
+  stats.sel_entries_logged++;
+  pthread_mutex_unlock (&stats_lock);
+}
+
+void
+ipmiseld_stats_sdr_cache (int hit)
+{
+  if (!stats_enabled)
+    return;
+
+  pthread_mutex_lock (&stats_lock);
+  if (hit)
+    stats.sdr_cache_hits++;
+  else
+    stats.sdr_cache_misses++;
+  pthread_mutex_unlock (&stats_lock);
+}
+
+int
+ipmiseld_stats_timeout (void)
+{
+  struct timeval now;
+  unsigned int ms;
+
+  if (!stats_enabled)
+    return (-1);
+
+  gettimeofday (&now, NULL);
+
+  ms = _stats_ms_since (&now, &stats_next_output);
+  if (ms >= INT_MAX)
+    return (INT_MAX);
+
+  /* round up, so we don't wake up too early */
+  return (ms ? ms + 1 : 0);
+}
+
+void
+ipmiseld_stats_output (struct ipmiseld_prog_data *prog_data,
+                       int hosts_waiting)
+{
+  struct ipmiseld_stats s;
+  char buf[IPMISELD_STATS_BUFLEN + 1];
+  struct timeval now;
+  unsigned int lag_avg = 0;
+  int len;
+  unsigned int i;
+  int ret;
+
+  assert (prog_data);
+
+  if (!stats_enabled)
+    return;
+
+  gettimeofday (&now, NULL);
+
+  /* take the counters and start a new interval, output without
+   * holding up the polls
+   */
+  pthread_mutex_lock (&stats_lock);
+  memcpy (&s, &stats, sizeof (struct ipmiseld_stats));
+  memset (&stats, '\0', sizeof (struct ipmiseld_stats));
+  stats.interval_start = now;
+  pthread_mutex_unlock (&stats_lock);
+
+  stats_next_output = now;
+  stats_next_output.tv_sec += stats_interval;
+
+  if (s.polls)
+    lag_avg = s.poll_lag_total / s.polls;
+
+  ipmiseld_syslog_prog (prog_data,
+                        "stats: %u seconds, %u polls, poll lag avg %u ms max %u ms, "
+                        "%u SEL entries logged, SDR cache %u hits %u misses",
+                        _stats_ms_since (&s.interval_start, &now) / 1000,
+                        s.polls,
+                        lag_avg,
+                        s.poll_lag_max,
+                        s.sel_entries_logged,
+                        s.sdr_cache_hits,
+                        s.sdr_cache_misses);
+
+  memset (buf, '\0', IPMISELD_STATS_BUFLEN + 1);
+  len = 0;
+  for (i = 0; i < IPMISELD_STATS_DURATION_BUCKETS; i++)
+    {
+      ret = snprintf (buf + len,
+                      IPMISELD_STATS_BUFLEN - len,
+                      " %s %u",
+                      stats_duration_labels[i],
+                      s.poll_durations[i]);
+      if (ret < 0 || ret >= IPMISELD_STATS_BUFLEN - len)
+        break;
+      len += ret;
+    }
+
+  ipmiseld_syslog_prog (prog_data,
+                        "stats: poll durations%s, max %u ms",
+                        buf,
+                        s.poll_duration_max);
+
+  memset (buf, '\0', IPMISELD_STATS_BUFLEN + 1);
+  len = 0;
+  for (i = 0; i <= IPMI_ERR_ERRNUMRANGE; i++)
+    {
+      if (!s.ipmi_errors[i])
+        continue;
+
+      ret = snprintf (buf + len,
+                      IPMISELD_STATS_BUFLEN - len,
+                      "%s%s %u",
+                      len ? ", " : "",
+                      ipmi_ctx_strerror (i),
+                      s.ipmi_errors[i]);
+      if (ret < 0 || ret >= IPMISELD_STATS_BUFLEN - len)
+        break;
+      len += ret;
+    }
+
+  if (len)
+    ipmiseld_syslog_prog (prog_data, "stats: IPMI errors: %s", buf);
+
+  ipmiseld_syslog_prog (prog_data,
+                        "stats: %d hosts waiting, %d polls queued, %d async polls queued, "
+                        "%d log messages queued",
+                        hosts_waiting,
+                        ipmiseld_threadpool_queue_count (),
+                        ipmiseld_engine_queue_count (),
+                        ipmiseld_output_queue_count ());
+}
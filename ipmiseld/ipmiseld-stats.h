@@ -0,0 +1,62 @@
+/*****************************************************************************\
+ *  $Id: ipmiseld.h,v 1.11 2010-02-08 22:02:30 chu11 Exp $
+ *****************************************************************************
+ *  Copyright (C) 2012-2015 Lawrence Livermore National Security, LLC.
+ *  Produced at Lawrence Livermore National Laboratory (cf, DISCLAIMER).
+ *  Written by Albert Chu <chu11@llnl.gov>
+ *  LLNL-CODE-559172
+ *
+ *  This file is part of Ipmiseld, an IPMI SEL syslog logging daemon.
+ *  For details, see https://savannah.gnu.org/projects/freeipmi/.
+ *
+ *  Ipmiseld is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by the
+ *  Free Software Foundation; either version 3 of the License, or (at your
+ *  option) any later version.
+ *
+ *  Ipmiseld is distributed in the hope that it will be useful, but
+ *  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ *  or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ *  for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along
+ *  with Ipmiseld.  If not, see <http://www.gnu.org/licenses/>.
+\*****************************************************************************/
+
+
+#ifndef IPMISELD_STATS_H
+#define IPMISELD_STATS_H
+
+#include "ipmiseld.h"
+
+/* Statistics about the daemon itself, collected between outputs
+ * every --stats-interval seconds.  All calls do nothing if statistics
+ * are not enabled.
+ */
+int ipmiseld_stats_init (struct ipmiseld_prog_data *prog_data);
+
+/* A poll of the host starts now, late by however long it is past
+ * its next_poll_time.
+ */
+void ipmiseld_stats_poll_start (ipmiseld_host_data_t *host_data);
+
+void ipmiseld_stats_poll_finish (ipmiseld_host_data_t *host_data);
+
+void ipmiseld_stats_ipmi_error (int errnum);
+
+void ipmiseld_stats_sel_entry_logged (void);
+
+void ipmiseld_stats_sdr_cache (int hit);
+
+/* returns milliseconds until statistics should next be output, 0 if
+ * due now, -1 if statistics are not enabled
+ */
+int ipmiseld_stats_timeout (void);
+
+/* output statistics and start a new interval, hosts_waiting is the
+ * number of hosts waiting for their next poll
+ */
+void ipmiseld_stats_output (struct ipmiseld_prog_data *prog_data,
+                            int hosts_waiting);
+
+#endif /* IPMISELD_STATS_H */
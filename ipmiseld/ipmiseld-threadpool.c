@@ -208,6 +208,21 @@ ipmiseld_threadpool_destroy (void)
     list_destroy (threadpool_queue);
 }
 
+int
+ipmiseld_threadpool_queue_count (void)
+{
+  int count = 0;
+
+  pthread_mutex_lock (&threadpool_queue_lock);
+
+  if (threadpool_queue)
+    count = list_count (threadpool_queue);
+
+  pthread_mutex_unlock (&threadpool_queue_lock);
+
+  return (count);
+}
+
 int
 ipmiseld_threadpool_queue (void *arg)
 {
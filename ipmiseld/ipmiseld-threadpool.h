@@ -40,4 +40,7 @@ void ipmiseld_threadpool_destroy (void);
 
 int ipmiseld_threadpool_queue (void *arg);
 
+/* returns number of queued polls not yet picked up by a thread */
+int ipmiseld_threadpool_queue_count (void);
+
 #endif /* IPMISELD_THREADPOOL_H */
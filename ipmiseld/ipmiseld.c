@@ -44,7 +44,16 @@
 #endif /* !HAVE_SYS_TIME_H */
 #endif /* !TIME_WITH_SYS_TIME */
 #include <syslog.h>
+#include <signal.h>
 #include <pthread.h>
+#if HAVE_UNISTD_H
+#include <unistd.h>
+#endif /* HAVE_UNISTD_H */
+#if HAVE_FCNTL_H
+#include <fcntl.h>
+#endif /* HAVE_FCNTL_H */
+#include <sys/poll.h>
+#include <limits.h>
 #include <assert.h>
 #include <errno.h>
 
@@ -55,14 +64,20 @@
 #include "ipmiseld-cache.h"
 #include "ipmiseld-common.h"
 #include "ipmiseld-debug.h"
+#include "ipmiseld-engine.h"
+#include "ipmiseld-interpret.h"
 #include "ipmiseld-ipmi-communication.h"
+#include "ipmiseld-output.h"
+#include "ipmiseld-stats.h"
 #include "ipmiseld-threadpool.h"
 
 #include "freeipmi-portability.h"
 #include "error.h"
 #include "fi_hostlist.h"
 #include "heap.h"
+#include "network.h"
 #include "pstdout.h"
+#include "timeval.h"
 #include "tool-common.h"
 #include "tool-daemon-common.h"
 #include "tool-event-common.h"
@@ -76,41 +91,47 @@
 
 #define IPMISELD_RETRY_ATTEMPT_MAX      3
 
+#define IPMISELD_SCHEDULER_BUFLEN       64
+
+/* in milliseconds, BMCs commonly time out idle sessions after 60 seconds */
+#define IPMISELD_SESSION_KEEPALIVE_INTERVAL 30000
+
+/* in seconds, how long the SEL fill rate average remembers bursts */
+#define IPMISELD_FILL_RATE_TIME_CONSTANT (6 * 60 * 60)
+
+/* with adaptive polling, poll at least this many times before the
+ * SEL is predicted to fill
+ */
+#define IPMISELD_FILL_RATE_POLLS_MIN    4
+
 static Heap host_data_heap = NULL;
 static pthread_mutex_t host_data_heap_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/* A byte is written to the pipe to wake up the scheduler early,
+ * either when a host is put back on the heap or when a signal is
+ * received.  A pipe is used instead of a condition variable b/c it
+ * may be written to from a signal handler.
+ */
+static int scheduler_wakeup_fd[2] = { -1, -1 };
+
 static int exit_flag = 1;
 
 static int
-ipmiseld_sel_info_get (ipmiseld_host_data_t *host_data, ipmiseld_sel_info_t *sel_info)
+_sel_info_parse (ipmiseld_host_data_t *host_data,
+                 fiid_obj_t obj_cmd_rs,
+                 ipmiseld_sel_info_t *sel_info)
 {
-  fiid_obj_t obj_cmd_rs = NULL;
   uint64_t val;
-  int rv = -1;
 
   assert (host_data);
-  assert (host_data->host_poll);
-  assert (host_data->host_poll->ipmi_ctx);
+  assert (fiid_obj_valid (obj_cmd_rs));
   assert (sel_info);
 
-  if (!(obj_cmd_rs = fiid_obj_create (tmpl_cmd_get_sel_info_rs)))
-    {
-      ipmiseld_err_output (host_data, "fiid_obj_create: %s", strerror (errno));
-      goto cleanup;
-    }
-
-  if (ipmi_cmd_get_sel_info (host_data->host_poll->ipmi_ctx, obj_cmd_rs) < 0)
-    {
-      ipmiseld_err_output (host_data, "ipmi_cmd_get_sel_info: %s",
-                  ipmi_ctx_errormsg (host_data->host_poll->ipmi_ctx));
-      goto cleanup;
-    }
-
   if (FIID_OBJ_GET (obj_cmd_rs, "entries", &val) < 0)
     {
       ipmiseld_err_output (host_data, "fiid_obj_get: 'entries': %s",
                   fiid_obj_errormsg (obj_cmd_rs));
-      goto cleanup;
+      return (-1);
     }
   sel_info->entries = val;
 
@@ -118,7 +139,7 @@ ipmiseld_sel_info_get (ipmiseld_host_data_t *host_data, ipmiseld_sel_info_t *sel
     {
       ipmiseld_err_output (host_data, "fiid_obj_get: 'free_space': %s",
                   fiid_obj_errormsg (obj_cmd_rs));
-      goto cleanup;
+      return (-1);
     }
   sel_info->free_space = val;
 
@@ -126,7 +147,7 @@ ipmiseld_sel_info_get (ipmiseld_host_data_t *host_data, ipmiseld_sel_info_t *sel
     {
       ipmiseld_err_output (host_data, "fiid_obj_get: 'most_recent_addition_timestamp': %s",
                   fiid_obj_errormsg (obj_cmd_rs));
-      goto cleanup;
+      return (-1);
     }
   sel_info->most_recent_addition_timestamp = val;
 
@@ -134,7 +155,7 @@ ipmiseld_sel_info_get (ipmiseld_host_data_t *host_data, ipmiseld_sel_info_t *sel
     {
       ipmiseld_err_output (host_data, "fiid_obj_get: 'most_recent_erase_timestamp': %s",
                   fiid_obj_errormsg (obj_cmd_rs));
-      goto cleanup;
+      return (-1);
     }
   sel_info->most_recent_erase_timestamp = val;
 
@@ -142,7 +163,7 @@ ipmiseld_sel_info_get (ipmiseld_host_data_t *host_data, ipmiseld_sel_info_t *sel
     {
       ipmiseld_err_output (host_data, "fiid_obj_get: 'delete_sel_command_supported': %s",
                   fiid_obj_errormsg (obj_cmd_rs));
-      goto cleanup;
+      return (-1);
     }
  sel_info->delete_sel_command_supported = val;
 
@@ -150,7 +171,7 @@ ipmiseld_sel_info_get (ipmiseld_host_data_t *host_data, ipmiseld_sel_info_t *sel
     {
       ipmiseld_err_output (host_data, "fiid_obj_get: 'reserve_sel_command_supported': %s",
                   fiid_obj_errormsg (obj_cmd_rs));
-      goto cleanup;
+      return (-1);
     }
   sel_info->reserve_sel_command_supported = val;
 
@@ -158,10 +179,40 @@ ipmiseld_sel_info_get (ipmiseld_host_data_t *host_data, ipmiseld_sel_info_t *sel
     {
       ipmiseld_err_output (host_data, "fiid_obj_get: 'overflow_flag': %s",
                   fiid_obj_errormsg (obj_cmd_rs));
-      goto cleanup;
+      return (-1);
     }
   sel_info->overflow_flag = val;
 
+  return (0);
+}
+
+static int
+ipmiseld_sel_info_get (ipmiseld_host_data_t *host_data, ipmiseld_sel_info_t *sel_info)
+{
+  fiid_obj_t obj_cmd_rs = NULL;
+  int rv = -1;
+
+  assert (host_data);
+  assert (host_data->host_poll);
+  assert (host_data->host_poll->ipmi_ctx);
+  assert (sel_info);
+
+  if (!(obj_cmd_rs = fiid_obj_create (tmpl_cmd_get_sel_info_rs)))
+    {
+      ipmiseld_err_output (host_data, "fiid_obj_create: %s", strerror (errno));
+      goto cleanup;
+    }
+
+  if (ipmi_cmd_get_sel_info (host_data->host_poll->ipmi_ctx, obj_cmd_rs) < 0)
+    {
+      ipmiseld_err_output (host_data, "ipmi_cmd_get_sel_info: %s",
+                  ipmi_ctx_errormsg (host_data->host_poll->ipmi_ctx));
+      goto cleanup;
+    }
+
+  if (_sel_info_parse (host_data, obj_cmd_rs, sel_info) < 0)
+    goto cleanup;
+
   rv = 0;
  cleanup:
   fiid_obj_destroy (obj_cmd_rs);
@@ -247,6 +298,136 @@ ipmiseld_calc_percent_full (ipmiseld_host_data_t *host_data,
   return (percent);
 }
 
+/* Update the SEL fill rate in now_host_state from the change in
+ * entries since the last poll.  Only entries are counted, SEL
+ * entries are fixed size so free space follows them.
+ */
+static void
+ipmiseld_update_fill_rate (ipmiseld_host_data_t *host_data)
+{
+  ipmiseld_host_state_t *last_host_state;
+  ipmiseld_host_state_t *now_host_state;
+  uint32_t now;
+  uint32_t elapsed;
+  unsigned int added;
+  double sample;
+  double weight;
+  double rate;
+
+  assert (host_data);
+
+  last_host_state = &(host_data->last_host_state);
+  now_host_state = &(host_data->now_host_state);
+
+  now = time (NULL);
+
+  now_host_state->fill_rate = last_host_state->fill_rate;
+  now_host_state->fill_rate_timestamp = last_host_state->fill_rate_timestamp;
+
+  /* no previous sample or the clock went backwards, start over */
+  if (!last_host_state->fill_rate_timestamp
+      || now < last_host_state->fill_rate_timestamp)
+    {
+      now_host_state->fill_rate_timestamp = now;
+      return;
+    }
+
+  if (now == last_host_state->fill_rate_timestamp)
+    return;
+
+  elapsed = now - last_host_state->fill_rate_timestamp;
+
+  /* if the SEL was cleared, everything in it is new */
+  if (now_host_state->sel_info.most_recent_erase_timestamp != last_host_state->sel_info.most_recent_erase_timestamp)
+    added = now_host_state->sel_info.entries;
+  else if (now_host_state->sel_info.entries > last_host_state->sel_info.entries)
+    added = now_host_state->sel_info.entries - last_host_state->sel_info.entries;
+  else
+    added = 0;
+
+  sample = (double)added * 3600 * 1000 / elapsed;
+
+  /* weigh the sample by the time it covers, so the average does not
+   * depend on how often the host is polled
+   */
+  weight = (double)elapsed / (elapsed + IPMISELD_FILL_RATE_TIME_CONSTANT);
+  rate = last_host_state->fill_rate + weight * (sample - last_host_state->fill_rate);
+
+  if (rate > UINT32_MAX)
+    now_host_state->fill_rate = UINT32_MAX;
+  else if (rate < 0)
+    now_host_state->fill_rate = 0;
+  else
+    now_host_state->fill_rate = rate + 0.5;
+  now_host_state->fill_rate_timestamp = now;
+}
+
+/* returns seconds until the SEL is predicted to reach percent full,
+ * UINT_MAX if it is not filling
+ */
+static unsigned int
+ipmiseld_calc_fill_time (ipmiseld_host_data_t *host_data,
+                         ipmiseld_host_state_t *host_state,
+                         unsigned int percent)
+{
+  unsigned int total_entries;
+  unsigned int limit_entries;
+  uint64_t seconds;
+
+  assert (host_data);
+  assert (host_state);
+  assert (percent <= 100);
+
+  total_entries = host_state->sel_info.entries
+    + host_state->sel_info.free_space / IPMI_SEL_RECORD_MAX_RECORD_LENGTH;
+  limit_entries = ((uint64_t)total_entries * percent) / 100;
+
+  if (host_state->sel_info.entries >= limit_entries)
+    return (0);
+
+  if (!host_state->fill_rate)
+    return (UINT_MAX);
+
+  seconds = ((uint64_t)(limit_entries - host_state->sel_info.entries) * 3600 * 1000) / host_state->fill_rate;
+  if (seconds > UINT_MAX)
+    return (UINT_MAX);
+
+  return (seconds);
+}
+
+/* With adaptive polling, poll a host often enough to see its SEL
+ * several times before it is predicted to reach the clear threshold
+ * or fill up, within the min and max poll intervals.
+ */
+static unsigned int
+ipmiseld_calc_poll_interval (ipmiseld_host_data_t *host_data,
+                             ipmiseld_host_state_t *host_state)
+{
+  struct ipmiseld_arguments *args;
+  unsigned int fill_time;
+  unsigned int interval;
+
+  assert (host_data);
+  assert (host_state);
+
+  args = host_data->prog_data->args;
+
+  if (!args->adaptive_poll_interval)
+    return (args->poll_interval);
+
+  fill_time = ipmiseld_calc_fill_time (host_data,
+                                       host_state,
+                                       args->clear_threshold ? args->clear_threshold : 100);
+
+  interval = fill_time / IPMISELD_FILL_RATE_POLLS_MIN;
+  if (interval < args->min_poll_interval)
+    interval = args->min_poll_interval;
+  if (interval > args->max_poll_interval)
+    interval = args->max_poll_interval;
+
+  return (interval);
+}
+
 static int
 ipmiseld_host_state_init (ipmiseld_host_data_t *host_data)
 {
@@ -271,6 +452,9 @@ ipmiseld_host_state_init (ipmiseld_host_data_t *host_data)
   percent = ipmiseld_calc_percent_full (host_data, &(host_data->last_host_state.sel_info));
   host_data->last_host_state.last_percent_full = percent;
 
+  host_data->last_host_state.fill_rate = 0;
+  host_data->last_host_state.fill_rate_timestamp = time (NULL);
+
   host_data->last_host_state.initialized = 1;
   rv = 0;
  cleanup:
@@ -385,7 +569,10 @@ _sel_log_format (ipmiseld_host_data_t *host_data,
 }
 
 static int
-_sel_log_output (ipmiseld_host_data_t *host_data, uint8_t record_type)
+_sel_log_output (ipmiseld_host_data_t *host_data,
+                 const void *sel_record,
+                 unsigned int sel_record_len,
+                 uint8_t record_type)
 {
   char fmtbuf[IPMISELD_FORMAT_BUFLEN + 1];
   char outbuf[IPMISELD_EVENT_OUTPUT_BUFLEN + 1];
@@ -401,8 +588,8 @@ _sel_log_output (ipmiseld_host_data_t *host_data, uint8_t record_type)
   memset (outbuf, '\0', IPMISELD_EVENT_OUTPUT_BUFLEN + 1);
 
   if (ipmi_sel_parse_read_record_id (host_data->host_poll->sel_ctx,
-                                     NULL,
-                                     0,
+                                     sel_record,
+                                     sel_record_len,
                                      &record_id) < 0)
     {
       ipmiseld_err_output (host_data, "ipmi_sel_parse_read_record_id: %s",
@@ -503,8 +690,8 @@ _sel_log_output (ipmiseld_host_data_t *host_data, uint8_t record_type)
 
   if ((outbuf_len = ipmi_sel_parse_read_record_string (host_data->host_poll->sel_ctx,
                                                        fmtbuf,
-                                                       NULL,
-                                                       0,
+                                                       sel_record,
+                                                       sel_record_len,
                                                        outbuf,
                                                        IPMISELD_EVENT_OUTPUT_BUFLEN,
                                                        flags)) < 0)
@@ -515,25 +702,29 @@ _sel_log_output (ipmiseld_host_data_t *host_data, uint8_t record_type)
     }
 
   if (outbuf_len)
-    ipmiseld_syslog (host_data, "%s", outbuf);
+    {
+      ipmiseld_syslog (host_data, "%s", outbuf);
+      ipmiseld_stats_sel_entry_logged ();
+    }
 
   host_data->now_host_state.last_record_id.record_id = record_id;
 
   return (0);
 }
 
+/* If sel_record is NULL, the record currently being parsed by
+ * ipmi_sel_parse() is logged.
+ */
 static int
-_sel_parse_callback (ipmi_sel_ctx_t ctx, void *callback_data)
+_sel_record_log (ipmiseld_host_data_t *host_data,
+                 const void *sel_record,
+                 unsigned int sel_record_len)
 {
-  ipmiseld_host_data_t *host_data;
   uint8_t record_type;
   int record_type_class;
   int rv = -1;
 
-  assert (ctx);
-  assert (callback_data);
-
-  host_data = (ipmiseld_host_data_t *)callback_data;
+  assert (host_data);
 
   if (host_data->prog_data->args->sensor_types_length
       || host_data->prog_data->args->exclude_sensor_types_length)
@@ -542,8 +733,8 @@ _sel_parse_callback (ipmi_sel_ctx_t ctx, void *callback_data)
       int flag;
 
       if (ipmi_sel_parse_read_sensor_type (host_data->host_poll->sel_ctx,
-                                           NULL,
-                                           0,
+                                           sel_record,
+                                           sel_record_len,
                                            &sensor_type) < 0)
         {
           if (_sel_parse_err_handle (host_data, "ipmi_sel_parse_read_record_type") < 0)
@@ -577,8 +768,8 @@ _sel_parse_callback (ipmi_sel_ctx_t ctx, void *callback_data)
     }
 
   if (ipmi_sel_parse_read_record_type (host_data->host_poll->sel_ctx,
-                                       NULL,
-                                       0,
+                                       sel_record,
+                                       sel_record_len,
                                        &record_type) < 0)
     {
       if (_sel_parse_err_handle (host_data, "ipmi_sel_parse_read_record_type") < 0)
@@ -611,22 +802,27 @@ _sel_parse_callback (ipmi_sel_ctx_t ctx, void *callback_data)
 
   if (host_data->prog_data->event_state_filter_mask)
     {
-      char sel_record[IPMI_SEL_RECORD_MAX_RECORD_LENGTH];
-      int sel_record_len;
+      char sel_record_buf[IPMI_SEL_RECORD_MAX_RECORD_LENGTH];
+      const void *interpret_record = sel_record;
+      int interpret_record_len = sel_record_len;
       unsigned int event_state = 0;
 
-      if ((sel_record_len = ipmi_sel_parse_read_record (host_data->host_poll->sel_ctx,
-                                                        sel_record,
-                                                        IPMI_SEL_RECORD_MAX_RECORD_LENGTH)) < 0)
+      if (!interpret_record)
         {
-          if (_sel_parse_err_handle (host_data, "ipmi_sel_parse_read_record_type") < 0)
-            goto cleanup;
-          goto out;
+          if ((interpret_record_len = ipmi_sel_parse_read_record (host_data->host_poll->sel_ctx,
+                                                                  sel_record_buf,
+                                                                  IPMI_SEL_RECORD_MAX_RECORD_LENGTH)) < 0)
+            {
+              if (_sel_parse_err_handle (host_data, "ipmi_sel_parse_read_record_type") < 0)
+                goto cleanup;
+              goto out;
+            }
+          interpret_record = sel_record_buf;
         }
 
       if (ipmi_interpret_sel (host_data->host_poll->interpret_ctx,
-                              sel_record,
-                              sel_record_len,
+                              interpret_record,
+                              interpret_record_len,
                               &event_state) < 0)
         {
           ipmiseld_err_output (host_data, "ipmi_interpret_sel: %s",
@@ -651,7 +847,7 @@ _sel_parse_callback (ipmi_sel_ctx_t ctx, void *callback_data)
         goto out;
     }
 
-  if (_sel_log_output (host_data, record_type) < 0)
+  if (_sel_log_output (host_data, sel_record, sel_record_len, record_type) < 0)
     goto cleanup;
 
  out:
@@ -660,6 +856,15 @@ _sel_parse_callback (ipmi_sel_ctx_t ctx, void *callback_data)
   return (rv);
 }
 
+static int
+_sel_parse_callback (ipmi_sel_ctx_t ctx, void *callback_data)
+{
+  assert (ctx);
+  assert (callback_data);
+
+  return (_sel_record_log ((ipmiseld_host_data_t *)callback_data, NULL, 0));
+}
+
 static int
 ipmiseld_sel_parse_test_run (ipmiseld_host_data_t *host_data)
 {
@@ -716,12 +921,40 @@ _dump_host_state (ipmiseld_host_data_t *host_data,
 
   IPMISELD_HOST_DEBUG (("%s: Last Record ID = %u", prefix, host_state->last_record_id.record_id));
   IPMISELD_HOST_DEBUG (("%s: Last Percent Full = %u", prefix, host_state->last_percent_full));
+  IPMISELD_HOST_DEBUG (("%s: Fill Rate = %u.%03u entries/hour",
+                        prefix,
+                        host_state->fill_rate / 1000,
+                        host_state->fill_rate % 1000));
   _dump_sel_info (host_data, &(host_state->sel_info), prefix);
 }
 
-/* returns 1 to log events, 0 if not, -1 on error */
 static int
-ipmiseld_check_sel_info (ipmiseld_host_data_t *host_data, uint16_t *record_id_start)
+_check_sel_info_last_record_id (ipmiseld_host_data_t *host_data,
+                                ipmiseld_last_record_id_t *last_record_id_read,
+                                ipmiseld_last_record_id_t *last_record_id)
+{
+  assert (host_data);
+  assert (last_record_id);
+
+  if (last_record_id_read)
+    {
+      memcpy (last_record_id, last_record_id_read, sizeof (ipmiseld_last_record_id_t));
+      return (0);
+    }
+
+  return (ipmiseld_get_last_record_id (host_data, last_record_id));
+}
+
+/* If last_record_id_read is non-NULL, it is the last record id
+ * already read by the caller alongside the current SEL info.
+ * Otherwise it is read here as needed.
+ *
+ * returns 1 to log events, 0 if not, -1 on error
+ */
+static int
+ipmiseld_check_sel_info (ipmiseld_host_data_t *host_data,
+                         ipmiseld_last_record_id_t *last_record_id_read,
+                         uint16_t *record_id_start)
 {
   int log_entries_flag = 0;
   int rv = -1;
@@ -774,7 +1007,7 @@ ipmiseld_check_sel_info (ipmiseld_host_data_t *host_data, uint16_t *record_id_st
                */
               ipmiseld_last_record_id_t last_record_id;
 
-              if (ipmiseld_get_last_record_id (host_data, &last_record_id) < 0)
+              if (_check_sel_info_last_record_id (host_data, last_record_id_read, &last_record_id) < 0)
                 goto cleanup;
 
               /* If new last_record_id has changed or there are no
@@ -805,7 +1038,7 @@ ipmiseld_check_sel_info (ipmiseld_host_data_t *host_data, uint16_t *record_id_st
                */
               ipmiseld_last_record_id_t last_record_id;
 
-              if (ipmiseld_get_last_record_id (host_data, &last_record_id) < 0)
+              if (_check_sel_info_last_record_id (host_data, last_record_id_read, &last_record_id) < 0)
                 goto cleanup;
 
               /* If new last_record_id is greater, we assume it's some additional entries
@@ -871,7 +1104,7 @@ ipmiseld_check_sel_info (ipmiseld_host_data_t *host_data, uint16_t *record_id_st
             ipmiseld_syslog_host (host_data, "SEL timestamp error, more entries without addition");
         }
 
-      if (ipmiseld_get_last_record_id (host_data, &last_record_id) < 0)
+      if (_check_sel_info_last_record_id (host_data, last_record_id_read, &last_record_id) < 0)
         goto cleanup;
 
       /* There is a small race chance that the last time we got sel
@@ -962,7 +1195,7 @@ ipmiseld_check_sel_info (ipmiseld_host_data_t *host_data, uint16_t *record_id_st
                */
               ipmiseld_last_record_id_t last_record_id;
 
-              if (ipmiseld_get_last_record_id (host_data, &last_record_id) < 0)
+              if (_check_sel_info_last_record_id (host_data, last_record_id_read, &last_record_id) < 0)
                 goto cleanup;
 
               /* If new last_record_id is greater, we assume it's some additional entries
@@ -1030,6 +1263,8 @@ ipmiseld_check_thresholds (ipmiseld_host_data_t *host_data)
 
   percent = ipmiseld_calc_percent_full (host_data, &(host_data->now_host_state.sel_info));
 
+  ipmiseld_update_fill_rate (host_data);
+
   if (host_data->prog_data->args->warning_threshold)
     {
       if (percent > host_data->prog_data->args->warning_threshold)
@@ -1047,6 +1282,17 @@ ipmiseld_check_thresholds (ipmiseld_host_data_t *host_data)
     {
       if (percent > host_data->prog_data->args->clear_threshold)
         do_clear_flag = 1;
+      else if (host_data->prog_data->args->adaptive_poll_interval)
+        {
+          /* clear early if the SEL would overflow before the next poll */
+          if (ipmiseld_calc_fill_time (host_data, &(host_data->now_host_state), 100)
+              <= ipmiseld_calc_poll_interval (host_data, &(host_data->now_host_state)))
+            {
+              if (host_data->prog_data->args->verbose_count)
+                ipmiseld_syslog_host (host_data, "SEL predicted to be full before next poll");
+              do_clear_flag = 1;
+            }
+        }
     }
 
   host_data->now_host_state.last_percent_full = percent;
@@ -1192,7 +1438,7 @@ ipmiseld_sel_parse_log (ipmiseld_host_data_t *host_data)
   if ((do_clear_flag = ipmiseld_check_thresholds (host_data)) < 0)
     goto cleanup;
 
-  if ((log_entries_flag = ipmiseld_check_sel_info (host_data, &record_id_start)) < 0)
+  if ((log_entries_flag = ipmiseld_check_sel_info (host_data, NULL, &record_id_start)) < 0)
     goto cleanup;
 
   if (do_clear_flag)
@@ -1276,43 +1522,43 @@ ipmiseld_sel_parse (ipmiseld_host_data_t *host_data)
   return (rv);
 }
 
-static int
-_ipmiseld_poll (void *arg)
+static void
+_ipmiseld_host_poll_destroy (ipmiseld_host_data_t *host_data)
 {
-  ipmiseld_host_data_t *host_data;
-  ipmiseld_host_poll_t host_poll;
-  unsigned int sel_flags = 0;
-  unsigned int interpret_flags = 0;
-  int exit_code = EXIT_FAILURE;
-
-  assert (arg);
-
-  host_data = (ipmiseld_host_data_t *)arg;
+  assert (host_data);
 
-  assert (!host_data->host_poll);
+  if (!host_data->host_poll)
+    return;
 
-  if (host_data->prog_data->args->foreground
-      && host_data->prog_data->args->common_args.debug)
-    IPMISELD_DEBUG (("Poll %s", host_data->hostname ? host_data->hostname : "localhost"));
+  ipmiseld_interpret_destroy (host_data);
+  ipmi_sel_ctx_destroy (host_data->host_poll->sel_ctx);
+  ipmi_sdr_ctx_destroy (host_data->host_poll->sdr_ctx);
+  ipmi_ctx_close (host_data->host_poll->ipmi_ctx);
+  ipmi_ctx_destroy (host_data->host_poll->ipmi_ctx);
+  free (host_data->host_poll);
+  host_data->host_poll = NULL;
+}
 
-  memset (&host_poll, '\0', sizeof (ipmiseld_host_poll_t));
-  host_data->host_poll = &host_poll;
+/* The SEL context may be created without an IPMI context, in which
+ * case it can only be used to parse and output records read by the
+ * caller.
+ */
+static int
+_ipmiseld_sel_ctx_setup (ipmiseld_host_data_t *host_data, ipmi_ctx_t ipmi_ctx)
+{
+  unsigned int sel_flags = 0;
 
-  if (ipmiseld_ipmi_setup (host_data) < 0)
-    goto cleanup;
+  assert (host_data);
+  assert (host_data->host_poll);
+  assert (host_data->host_poll->interpret_ctx);
 
-  if (!host_data->prog_data->args->ignore_sdr)
-    {
-      if (ipmiseld_sdr_cache_create_and_load (host_data) < 0)
-        goto cleanup;
-    }
-  else
-    host_data->host_poll->sdr_ctx = NULL;
+  ipmi_sel_ctx_destroy (host_data->host_poll->sel_ctx);
+  host_data->host_poll->sel_ctx = NULL;
 
-  if (!(host_data->host_poll->sel_ctx = ipmi_sel_ctx_create (host_data->host_poll->ipmi_ctx, host_data->host_poll->sdr_ctx)))
+  if (!(host_data->host_poll->sel_ctx = ipmi_sel_ctx_create (ipmi_ctx, host_data->host_poll->sdr_ctx)))
     {
       ipmiseld_err_output (host_data, "ipmi_sel_ctx_create: %s", strerror (errno));
-      goto cleanup;
+      return (-1);
     }
 
   if (host_data->prog_data->args->foreground
@@ -1322,6 +1568,9 @@ _ipmiseld_poll (void *arg)
   if (host_data->prog_data->args->common_args.section_specific_workaround_flags & IPMI_PARSE_SECTION_SPECIFIC_WORKAROUND_FLAGS_ASSUME_SYSTEM_EVENT)
     sel_flags |= IPMI_SEL_FLAGS_ASSUME_SYSTEM_EVENT_RECORDS;
 
+  if (host_data->prog_data->args->speculative_read)
+    sel_flags |= IPMI_SEL_FLAGS_SPECULATIVE_READ;
+
   if (sel_flags)
     {
       /* Don't error out, if this fails we can still continue */
@@ -1339,44 +1588,13 @@ _ipmiseld_poll (void *arg)
                     ipmi_sel_ctx_errormsg (host_data->host_poll->sel_ctx));
     }
 
-  if (!(host_data->host_poll->interpret_ctx = ipmi_interpret_ctx_create ()))
-    {
-      ipmiseld_err_output (host_data, "ipmi_interpret_ctx_create: %s", strerror (errno));
-      goto cleanup;
-    }
-
-  if (ipmi_interpret_load_sel_config (host_data->host_poll->interpret_ctx,
-                                      host_data->prog_data->args->event_state_config_file) < 0)
-    {
-      /* if default file is missing its ok */
-      if (!(!host_data->prog_data->args->event_state_config_file
-            && ipmi_interpret_ctx_errnum (host_data->host_poll->interpret_ctx) == IPMI_INTERPRET_ERR_SEL_CONFIG_FILE_DOES_NOT_EXIST))
-        {
-          ipmiseld_err_output (host_data, "ipmi_interpret_load_sel_config: %s", ipmi_interpret_ctx_errormsg (host_data->host_poll->interpret_ctx));
-          goto cleanup;
-        }
-    }
-
-  if (host_data->prog_data->args->interpret_oem_data)
-    interpret_flags |= IPMI_INTERPRET_FLAGS_INTERPRET_OEM_DATA;
-
-  if (interpret_flags)
-    {
-      if (ipmi_interpret_ctx_set_flags (host_data->host_poll->interpret_ctx, interpret_flags) < 0)
-        {
-          ipmiseld_err_output (host_data, "ipmi_interpret_ctx_set_flags: %s",
-                      ipmi_interpret_ctx_errormsg (host_data->host_poll->interpret_ctx));
-          goto cleanup;
-        }
-    }
-
   if (ipmi_sel_ctx_set_parameter (host_data->host_poll->sel_ctx,
                                   IPMI_SEL_PARAMETER_INTERPRET_CONTEXT,
                                   &(host_data->host_poll->interpret_ctx)) < 0)
     {
       err_output("ipmi_sel_ctx_set_interpret: %s",
                  ipmi_sel_ctx_errormsg (host_data->host_poll->sel_ctx));
-      goto cleanup;
+      return (-1);
     }
 
   if (ipmi_sel_ctx_set_separator (host_data->host_poll->sel_ctx, EVENT_OUTPUT_SEPARATOR) < 0)
@@ -1389,11 +1607,6 @@ _ipmiseld_poll (void *arg)
   if (host_data->prog_data->args->interpret_oem_data
       || host_data->prog_data->args->output_oem_event_strings)
     {
-      if (ipmi_get_oem_data (NULL,
-                             host_data->host_poll->ipmi_ctx,
-                             &host_data->host_poll->oem_data) < 0)
-        return (-1);
-
       if (ipmi_sel_ctx_set_manufacturer_id (host_data->host_poll->sel_ctx,
                                             host_data->host_poll->oem_data.manufacturer_id) < 0)
         {
@@ -1418,67 +1631,355 @@ _ipmiseld_poll (void *arg)
                       ipmi_sel_ctx_errormsg (host_data->host_poll->sel_ctx));
           return (-1);
         }
-
-      if (host_data->prog_data->args->interpret_oem_data)
-        {
-          if (ipmi_interpret_ctx_set_manufacturer_id (host_data->host_poll->interpret_ctx,
-                                                      host_data->host_poll->oem_data.manufacturer_id) < 0)
-            {
-              ipmiseld_err_output (host_data, "ipmi_interpret_ctx_set_manufacturer_id: %s",
-                          ipmi_interpret_ctx_errormsg (host_data->host_poll->interpret_ctx));
-              return (-1);
-            }
-
-          if (ipmi_interpret_ctx_set_product_id (host_data->host_poll->interpret_ctx,
-                                                 host_data->host_poll->oem_data.product_id) < 0)
-            {
-              ipmiseld_err_output (host_data, "ipmi_interpret_ctx_set_product_id: %s",
-                          ipmi_interpret_ctx_errormsg (host_data->host_poll->interpret_ctx));
-              return (-1);
-            }
-        }
     }
 
-  if (ipmiseld_sel_parse (host_data) < 0)
-    goto cleanup;
-
-  exit_code = EXIT_SUCCESS;
- cleanup:
-  ipmi_interpret_ctx_destroy (host_data->host_poll->interpret_ctx);
-  ipmi_sel_ctx_destroy (host_data->host_poll->sel_ctx);
-  ipmi_sdr_ctx_destroy (host_data->host_poll->sdr_ctx);
-  ipmi_ctx_close (host_data->host_poll->ipmi_ctx);
-  ipmi_ctx_destroy (host_data->host_poll->ipmi_ctx);
-  host_data->host_poll = NULL;
-  return (exit_code);
+  return (0);
 }
 
 static int
-_ipmiseld_poll_postprocess (void *arg)
+_ipmiseld_host_poll_setup (ipmiseld_host_data_t *host_data)
 {
-  ipmiseld_host_data_t *host_data;
-  struct timeval tv;
   int rv = -1;
 
-  assert (arg);
-
-  host_data = (ipmiseld_host_data_t *)arg;
-
+  assert (host_data);
   assert (!host_data->host_poll);
 
-  gettimeofday (&tv, NULL);
-  host_data->next_poll_time = tv.tv_sec + host_data->prog_data->args->poll_interval;
-
-  pthread_mutex_lock (&host_data_heap_lock);
-
-  if (!heap_insert (host_data_heap, host_data))
+  if (!(host_data->host_poll = (ipmiseld_host_poll_t *)malloc (sizeof (ipmiseld_host_poll_t))))
     {
-      pthread_mutex_unlock (&host_data_heap_lock);
-      ipmiseld_err_output (host_data, "heap_insert: %s", strerror (errno));
-      goto cleanup;
+      ipmiseld_err_output (host_data, "malloc: %s", strerror (errno));
+      return (-1);
+    }
+  memset (host_data->host_poll, '\0', sizeof (ipmiseld_host_poll_t));
+
+  if (ipmiseld_ipmi_setup (host_data) < 0)
+    goto cleanup;
+
+  if (!host_data->prog_data->args->ignore_sdr)
+    {
+      if (ipmiseld_sdr_cache_create_and_load (host_data) < 0)
+        goto cleanup;
+    }
+  else
+    host_data->host_poll->sdr_ctx = NULL;
+
+  if (host_data->prog_data->args->interpret_oem_data
+      || host_data->prog_data->args->output_oem_event_strings)
+    {
+      if (ipmi_get_oem_data (NULL,
+                             host_data->host_poll->ipmi_ctx,
+                             &host_data->host_poll->oem_data) < 0)
+        goto cleanup;
+    }
+
+  if (ipmiseld_interpret_setup (host_data) < 0)
+    goto cleanup;
+
+  if (_ipmiseld_sel_ctx_setup (host_data, host_data->host_poll->ipmi_ctx) < 0)
+    goto cleanup;
+
+  rv = 0;
+ cleanup:
+  if (rv < 0)
+    _ipmiseld_host_poll_destroy (host_data);
+  return (rv);
+}
+
+/* A host whose session is kept across polls picks up a reloaded
+ * event state configuration here.
+ */
+static int
+_ipmiseld_interpret_refresh (ipmiseld_host_data_t *host_data, ipmi_ctx_t ipmi_ctx)
+{
+  int ret;
+
+  assert (host_data);
+  assert (host_data->host_poll);
+
+  if ((ret = ipmiseld_interpret_setup (host_data)) <= 0)
+    return (ret);
+
+  /* the SEL context holds a copy of the interpret context */
+  if (_ipmiseld_sel_ctx_setup (host_data, ipmi_ctx) < 0)
+    {
+      ipmiseld_interpret_destroy (host_data);
+      return (-1);
+    }
+
+  return (0);
+}
+
+/* The engine polls with its own packets, the SEL is then checked
+ * and logged the same as ipmiseld_sel_parse_log() would.
+ */
+static int
+_engine_sel_info (ipmiseld_host_data_t *host_data, fiid_obj_t obj_cmd_rs)
+{
+  assert (host_data);
+  assert (obj_cmd_rs);
+
+  if (_ipmiseld_interpret_refresh (host_data, NULL) < 0)
+    return (-1);
+
+  if (_sel_info_parse (host_data, obj_cmd_rs, &(host_data->now_host_state.sel_info)) < 0)
+    return (-1);
+
+  if (host_data->prog_data->args->foreground
+      && host_data->prog_data->args->common_args.debug)
+    {
+      _dump_host_state (host_data, &(host_data->last_host_state), "Last State");
+      _dump_sel_info (host_data, &host_data->now_host_state.sel_info, "Current State");
+    }
+
+  /* clear threshold not supported by the engine, ignore clear flag */
+  if (ipmiseld_check_thresholds (host_data) < 0)
+    return (-1);
+
+  /* the last record id is only needed if the SEL changed */
+  if (host_data->now_host_state.sel_info.entries != host_data->last_host_state.sel_info.entries
+      || host_data->now_host_state.sel_info.most_recent_addition_timestamp != host_data->last_host_state.sel_info.most_recent_addition_timestamp
+      || host_data->now_host_state.sel_info.most_recent_erase_timestamp != host_data->last_host_state.sel_info.most_recent_erase_timestamp)
+    return (1);
+
+  return (0);
+}
+
+static int
+_engine_check_sel_info (ipmiseld_host_data_t *host_data,
+                        ipmiseld_last_record_id_t *last_record_id,
+                        uint16_t *record_id_start)
+{
+  assert (host_data);
+  assert (record_id_start);
+
+  return (ipmiseld_check_sel_info (host_data, last_record_id, record_id_start));
+}
+
+static int
+_engine_sel_record (ipmiseld_host_data_t *host_data,
+                    const void *sel_record,
+                    unsigned int sel_record_len)
+{
+  assert (host_data);
+  assert (sel_record);
+  assert (sel_record_len);
+
+  return (_sel_record_log (host_data, sel_record, sel_record_len));
+}
+
+static int
+_engine_finish (ipmiseld_host_data_t *host_data)
+{
+  assert (host_data);
+
+  host_data->now_host_state.initialized = 1;
+
+  return (ipmiseld_save_state (host_data));
+}
+
+static int
+_ipmiseld_poll (void *arg)
+{
+  ipmiseld_host_data_t *host_data;
+  int persistent;
+  int reused = 0;
+  int exit_code = EXIT_FAILURE;
+
+  assert (arg);
+
+  host_data = (ipmiseld_host_data_t *)arg;
+
+  persistent = host_data->prog_data->args->persistent_sessions
+    && !host_data->prog_data->args->test_run;
+
+  host_data->keepalive = 0;
+
+  if (host_data->host_poll)
+    {
+      struct timeval now;
+
+      gettimeofday (&now, NULL);
+
+      /* woken up early to keep the session alive, not to poll */
+      if (timeval_lt (&now, &host_data->next_poll_time))
+        {
+          if (host_data->prog_data->args->foreground
+              && host_data->prog_data->args->common_args.debug)
+            IPMISELD_DEBUG (("Keepalive %s", host_data->hostname ? host_data->hostname : "localhost"));
+
+          host_data->keepalive = 1;
+
+          /* session will be re-established on the next poll */
+          if (ipmiseld_ipmi_keepalive (host_data) < 0)
+            _ipmiseld_host_poll_destroy (host_data);
+
+          return (EXIT_SUCCESS);
+        }
+
+      reused = 1;
+    }
+
+  ipmiseld_stats_poll_start (host_data);
+
+  if (host_data->prog_data->args->foreground
+      && host_data->prog_data->args->common_args.debug)
+    IPMISELD_DEBUG (("Poll %s", host_data->hostname ? host_data->hostname : "localhost"));
+
+  if (!host_data->host_poll)
+    {
+      if (_ipmiseld_host_poll_setup (host_data) < 0)
+        goto cleanup;
+    }
+  else
+    {
+      if (_ipmiseld_interpret_refresh (host_data, host_data->host_poll->ipmi_ctx) < 0)
+        {
+          _ipmiseld_host_poll_destroy (host_data);
+          goto cleanup;
+        }
+    }
+
+  if (ipmiseld_sel_parse (host_data) < 0)
+    {
+      _ipmiseld_host_poll_destroy (host_data);
+
+      /* The BMC may have dropped a session kept open since the last
+       * poll, so try once more with a new session.
+       */
+      if (!reused)
+        goto cleanup;
+
+      if (_ipmiseld_host_poll_setup (host_data) < 0)
+        goto cleanup;
+
+      if (ipmiseld_sel_parse (host_data) < 0)
+        goto cleanup;
+    }
+
+  exit_code = EXIT_SUCCESS;
+
+  /* With the SDR cache loaded and the SEL state known, the host can
+   * be handed over to the async engine for all further polls.  The
+   * engine has its own sessions, so only the IPMI context goes.
+   */
+  if (host_data->prog_data->args->async_threads
+      && !host_data->prog_data->args->test_run
+      && host_data->last_host_state.initialized
+      && !ipmiseld_engine_host_add (host_data))
+    {
+      ipmi_ctx_close (host_data->host_poll->ipmi_ctx);
+      ipmi_ctx_destroy (host_data->host_poll->ipmi_ctx);
+      host_data->host_poll->ipmi_ctx = NULL;
+
+      if (_ipmiseld_sel_ctx_setup (host_data, NULL) < 0)
+        {
+          ipmiseld_engine_host_destroy (host_data);
+          _ipmiseld_host_poll_destroy (host_data);
+        }
+
+      return (exit_code);
+    }
+
+ cleanup:
+  if (!persistent)
+    _ipmiseld_host_poll_destroy (host_data);
+  return (exit_code);
+}
+
+static void
+_scheduler_wakeup (void)
+{
+  char c = '\0';
+
+  if (scheduler_wakeup_fd[1] < 0)
+    return;
+
+  /* ignore potential error, if the pipe is full a wakeup is
+   * already pending
+   */
+  if (write (scheduler_wakeup_fd[1], &c, 1) < 0)
+    return;
+}
+
+static int
+_ipmiseld_poll_postprocess (void *arg)
+{
+  ipmiseld_host_data_t *host_data;
+  struct timeval tv;
+  int rv = -1;
+
+  assert (arg);
+
+  host_data = (ipmiseld_host_data_t *)arg;
+
+  gettimeofday (&tv, NULL);
+
+  /* Schedule from the last scheduled poll rather than from now, so
+   * hosts stay spread across the poll interval.  If the poll took
+   * longer than the interval, poll again right away.
+   */
+  if (!host_data->keepalive)
+    {
+      unsigned int poll_interval;
+
+      ipmiseld_stats_poll_finish (host_data);
+
+      if (host_data->last_host_state.initialized)
+        poll_interval = ipmiseld_calc_poll_interval (host_data, &(host_data->last_host_state));
+      else
+        poll_interval = host_data->prog_data->args->poll_interval;
+
+      if (host_data->prog_data->args->adaptive_poll_interval
+          && host_data->prog_data->args->foreground
+          && host_data->prog_data->args->common_args.debug)
+        IPMISELD_HOST_DEBUG (("Next poll in %u seconds", poll_interval));
+
+      host_data->next_poll_time.tv_sec += poll_interval;
+      if (timeval_lt (&host_data->next_poll_time, &tv))
+        host_data->next_poll_time = tv;
+    }
+
+  host_data->next_wakeup_time = host_data->next_poll_time;
+
+  /* inband communication has no session to keep alive */
+  if ((host_data->engine_host
+       ? ipmiseld_engine_host_session_open (host_data)
+       : host_data->host_poll != NULL)
+      && host_data->hostname
+      && !host_is_localhost (host_data->hostname))
+    {
+      struct timeval keepalive_time;
+      unsigned int session_timeout;
+      unsigned int keepalive_interval;
+
+      /* libfreeipmi also considers a session idle for longer than the
+       * session timeout to be timed out, so stay well within it.
+       */
+      if (host_data->prog_data->args->common_args.session_timeout)
+        session_timeout = host_data->prog_data->args->common_args.session_timeout;
+      else
+        session_timeout = IPMI_SESSION_TIMEOUT_DEFAULT;
+
+      keepalive_interval = session_timeout / 2;
+      if (keepalive_interval > IPMISELD_SESSION_KEEPALIVE_INTERVAL)
+        keepalive_interval = IPMISELD_SESSION_KEEPALIVE_INTERVAL;
+
+      timeval_add_ms (&tv, keepalive_interval, &keepalive_time);
+      if (timeval_lt (&keepalive_time, &host_data->next_wakeup_time))
+        host_data->next_wakeup_time = keepalive_time;
+    }
+
+  pthread_mutex_lock (&host_data_heap_lock);
+
+  if (!heap_insert (host_data_heap, host_data))
+    {
+      pthread_mutex_unlock (&host_data_heap_lock);
+      ipmiseld_err_output (host_data, "heap_insert: %s", strerror (errno));
+      goto cleanup;
     }
 
   pthread_mutex_unlock (&host_data_heap_lock);
+
+  _scheduler_wakeup ();
   rv = 0;
  cleanup:
   return (rv);
@@ -1488,6 +1989,14 @@ static void
 _signal_handler_callback (int sig)
 {
   exit_flag = 0;
+  _scheduler_wakeup ();
+}
+
+static void
+_reload_signal_handler (int sig)
+{
+  ipmiseld_interpret_reload ();
+  ipmiseld_output_reopen ();
 }
 
 static void
@@ -1498,6 +2007,8 @@ _free_host_data (void *x)
   assert (x);
 
   host_data = (ipmiseld_host_data_t *)x;
+  ipmiseld_engine_host_destroy (host_data);
+  _ipmiseld_host_poll_destroy (host_data);
   free (host_data->hostname);
   free (host_data);
 }
@@ -1529,9 +2040,12 @@ _alloc_host_data (ipmiseld_prog_data_t *prog_data, const char *hostname)
   else
     host_data->hostname = NULL;
   host_data->host_poll = NULL;
+  host_data->engine_host = NULL;
   host_data->re_download_sdr_done = 0;
   host_data->clear_sel_done = 0;
-  host_data->next_poll_time = 0; /* 0 will first immediate check first time through */
+  timeval_clear (&host_data->next_poll_time); /* 0 will first immediate check first time through */
+  timeval_clear (&host_data->next_wakeup_time);
+  host_data->keepalive = 0;
   host_data->last_ipmi_errnum = 0;
   host_data->last_ipmi_errnum_count = 0;
 
@@ -1549,13 +2063,205 @@ hostdata_timecmp (void *x, void *y)
   hd1 = (ipmiseld_host_data_t *)x;
   hd2 = (ipmiseld_host_data_t *)y;
 
-  if (hd1->next_poll_time < hd2->next_poll_time)
+  if (timeval_lt (&hd1->next_wakeup_time, &hd2->next_wakeup_time))
     return (1);
-  else if (hd1->next_poll_time > hd2->next_poll_time)
+  else if (timeval_gt (&hd1->next_wakeup_time, &hd2->next_wakeup_time))
     return (-1);
   return (0);
 }
 
+/* Spread the first poll of each host evenly across the poll interval,
+ * so that polls of many hosts do not all occur in bursts.
+ */
+static void
+_schedule_first_poll (ipmiseld_host_data_t *host_data,
+                      unsigned int host_index,
+                      unsigned int hosts_count,
+                      struct timeval *start)
+{
+  uint64_t offset_us;
+
+  assert (host_data);
+  assert (hosts_count);
+  assert (start);
+
+  offset_us = ((uint64_t)host_data->prog_data->args->poll_interval * 1000000 * host_index) / hosts_count;
+
+  host_data->next_poll_time.tv_sec = start->tv_sec + (offset_us / 1000000);
+  host_data->next_poll_time.tv_usec = start->tv_usec + (offset_us % 1000000);
+  if (host_data->next_poll_time.tv_usec >= 1000000)
+    {
+      host_data->next_poll_time.tv_sec++;
+      host_data->next_poll_time.tv_usec -= 1000000;
+    }
+
+  host_data->next_wakeup_time = host_data->next_poll_time;
+}
+
+static int
+_scheduler_setup (void)
+{
+  int i;
+
+  if (pipe (scheduler_wakeup_fd) < 0)
+    {
+      err_output ("pipe: %s", strerror (errno));
+      return (-1);
+    }
+
+  /* neither a wakeup nor draining wakeups should ever block */
+  for (i = 0; i < 2; i++)
+    {
+      int flags;
+
+      if ((flags = fcntl (scheduler_wakeup_fd[i], F_GETFL, 0)) < 0)
+        {
+          err_output ("fcntl: %s", strerror (errno));
+          return (-1);
+        }
+
+      if (fcntl (scheduler_wakeup_fd[i], F_SETFL, flags | O_NONBLOCK) < 0)
+        {
+          err_output ("fcntl: %s", strerror (errno));
+          return (-1);
+        }
+    }
+
+  return (0);
+}
+
+static void
+_scheduler_cleanup (void)
+{
+  int i;
+
+  for (i = 0; i < 2; i++)
+    {
+      if (scheduler_wakeup_fd[i] >= 0)
+        {
+          /* ignore potential error, cleanup path */
+          close (scheduler_wakeup_fd[i]);
+          scheduler_wakeup_fd[i] = -1;
+        }
+    }
+}
+
+/* wait up to timeout milliseconds, -1 to wait until woken up */
+static void
+_scheduler_wait (int timeout)
+{
+  struct pollfd pfd;
+  char buf[IPMISELD_SCHEDULER_BUFLEN];
+
+  pfd.fd = scheduler_wakeup_fd[0];
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  if (poll (&pfd, 1, timeout) < 0)
+    {
+      if (errno != EINTR)
+        err_exit ("poll: %s", strerror (errno));
+      return;
+    }
+
+  if (pfd.revents & POLLIN)
+    {
+      /* drain all pending wakeups */
+      while (read (scheduler_wakeup_fd[0], buf, IPMISELD_SCHEDULER_BUFLEN) > 0)
+        ;
+    }
+}
+
+/* returns milliseconds until the next poll, -1 if no host is waiting
+ * to be polled
+ */
+static int
+_scheduler_dispatch (void)
+{
+  ipmiseld_host_data_t *host_data;
+  struct timeval now;
+  int timeout = -1;
+  int ret;
+
+  gettimeofday (&now, NULL);
+
+  pthread_mutex_lock (&host_data_heap_lock);
+
+  while ((host_data = heap_peek (host_data_heap)))
+    {
+      if (timeval_gt (&host_data->next_wakeup_time, &now))
+        {
+          struct timeval delta;
+
+          timeval_sub (&host_data->next_wakeup_time, &now, &delta);
+          if (delta.tv_sec >= INT_MAX / 1000)
+            timeout = INT_MAX;
+          else
+            {
+              unsigned int ms;
+
+              timeval_millisecond_calc (&delta, &ms);
+              /* round up, so we don't wake up too early */
+              timeout = ms + 1;
+            }
+          break;
+        }
+
+      host_data = heap_pop (host_data_heap);
+
+      if (host_data->engine_host)
+        ret = ipmiseld_engine_queue (host_data);
+      else
+        ret = ipmiseld_threadpool_queue (host_data);
+
+      if (ret < 0)
+        {
+          /* try again next interval instead of spinning */
+          host_data->next_poll_time = now;
+          host_data->next_poll_time.tv_sec += host_data->prog_data->args->poll_interval;
+          host_data->next_wakeup_time = host_data->next_poll_time;
+
+          if (!heap_insert (host_data_heap, host_data))
+            ipmiseld_err_output (host_data, "heap_insert: %s", strerror (errno));
+        }
+    }
+
+  pthread_mutex_unlock (&host_data_heap_lock);
+
+  return (timeout);
+}
+
+/* output statistics if due, returns timeout adjusted to wake up for
+ * the next output
+ */
+static int
+_stats_dispatch (ipmiseld_prog_data_t *prog_data, int timeout)
+{
+  int stats_timeout;
+
+  assert (prog_data);
+
+  if ((stats_timeout = ipmiseld_stats_timeout ()) < 0)
+    return (timeout);
+
+  if (!stats_timeout)
+    {
+      int hosts_waiting;
+
+      pthread_mutex_lock (&host_data_heap_lock);
+      hosts_waiting = heap_count (host_data_heap);
+      pthread_mutex_unlock (&host_data_heap_lock);
+
+      ipmiseld_stats_output (prog_data, hosts_waiting);
+
+      stats_timeout = ipmiseld_stats_timeout ();
+    }
+
+  if (timeout < 0 || stats_timeout < timeout)
+    return (stats_timeout);
+  return (timeout);
+}
+
 static int
 _ipmiseld (ipmiseld_prog_data_t *prog_data)
 {
@@ -1563,6 +2269,8 @@ _ipmiseld (ipmiseld_prog_data_t *prog_data)
   fi_hostlist_t hlist = NULL;
   fi_hostlist_iterator_t hitr = NULL;
   ipmiseld_host_data_t *host_data;
+  struct timeval start;
+  unsigned int host_index = 0;
   char *host = NULL;
   int rv = -1;
   int ret;
@@ -1591,6 +2299,9 @@ _ipmiseld (ipmiseld_prog_data_t *prog_data)
   if (hosts_count < prog_data->args->threadpool_count)
     prog_data->args->threadpool_count = hosts_count;
 
+  if (hosts_count < prog_data->args->async_threads)
+    prog_data->args->async_threads = hosts_count;
+
   if (!(host_data_heap = heap_create (hosts_count,
                                       (HeapCmpF)hostdata_timecmp,
                                       (HeapDelF)_free_host_data)))
@@ -1605,11 +2316,15 @@ _ipmiseld (ipmiseld_prog_data_t *prog_data)
       goto cleanup;
     }
 
+  gettimeofday (&start, NULL);
+
   if (hosts_count == 1)
     {
       if (!(host_data = _alloc_host_data (prog_data, prog_data->args->common_args.hostname)))
         goto cleanup;
 
+      _schedule_first_poll (host_data, 0, 1, &start);
+
       if (!heap_insert (host_data_heap, host_data))
         {
           err_output ("heap_insert: %s", strerror (errno));
@@ -1635,6 +2350,8 @@ _ipmiseld (ipmiseld_prog_data_t *prog_data)
           if (!(host_data = _alloc_host_data (prog_data, host)))
             goto cleanup;
 
+          _schedule_first_poll (host_data, host_index++, hosts_count, &start);
+
           if (!heap_insert (host_data_heap, host_data))
             {
               err_output ("heap_insert: %s", strerror (errno));
@@ -1646,6 +2363,43 @@ _ipmiseld (ipmiseld_prog_data_t *prog_data)
       host = NULL;
     }
 
+  if (ipmiseld_output_init (prog_data) < 0)
+    goto cleanup;
+
+  if (prog_data->args->consolidated_state
+      && !prog_data->args->test_run)
+    {
+      if (ipmiseld_state_db_init (prog_data, hosts_count) < 0)
+        goto cleanup;
+    }
+
+  if (ipmiseld_interpret_init (prog_data) < 0)
+    goto cleanup;
+
+  if (ipmiseld_stats_init (prog_data) < 0)
+    goto cleanup;
+
+  if (!prog_data->args->test_run)
+    {
+      if (_scheduler_setup () < 0)
+        goto cleanup;
+    }
+
+  if (prog_data->args->async_threads
+      && !prog_data->args->test_run)
+    {
+      struct ipmiseld_engine_callbacks callbacks;
+
+      callbacks.sel_info = _engine_sel_info;
+      callbacks.check_sel_info = _engine_check_sel_info;
+      callbacks.sel_record = _engine_sel_record;
+      callbacks.finish = _engine_finish;
+      callbacks.postprocess = _ipmiseld_poll_postprocess;
+
+      if (ipmiseld_engine_init (prog_data, &callbacks) < 0)
+        goto cleanup;
+    }
+
   if (ipmiseld_threadpool_init (prog_data,
                                 _ipmiseld_poll,
                                 _ipmiseld_poll_postprocess) < 0)
@@ -1668,85 +2422,28 @@ _ipmiseld (ipmiseld_prog_data_t *prog_data)
     {
       while (exit_flag)
         {
-          pthread_mutex_lock (&host_data_heap_lock);
-
-          host_data = heap_pop (host_data_heap);
-
-          pthread_mutex_unlock (&host_data_heap_lock);
-
-          /* empty heap, small chance of this happening, but
-           * everything is processing and previous sleeps didn't sleep
-           * long enough.  So we just need to wait until something
-           * else finishes.
-           *
-           * There's no way to know the exact right amount of time, so
-           * we're going to make an estimate.  What we'll do is
-           * estimate 1/5th the time of a IPMI session timeout.  So in
-           * the event the previous poll fully timed out, we will
-           * interrupt and go through this loop only 5 times.
-           */
-          if (!host_data)
-            {
-              unsigned int waittime;
-
-              if (prog_data->args->common_args.session_timeout)
-                waittime = prog_data->args->common_args.session_timeout;
-              else
-                waittime = IPMI_SESSION_TIMEOUT_DEFAULT;
+          int timeout;
 
-              /* session timeout is in milliseconds */
-              waittime /= 1000;
+          timeout = _scheduler_dispatch ();
 
-              /* now take a 5th of it  */
-              waittime /= 5;
-
-              if (!waittime)
-                waittime = 1;
-
-              daemon_sleep (waittime);
-              continue;
-            }
-
-          if (ipmiseld_threadpool_queue (host_data) < 0)
-            {
-              pthread_mutex_lock (&host_data_heap_lock);
-
-              if (!heap_insert (host_data_heap, host_data))
-                ipmiseld_err_output (host_data, "heap_insert: %s", strerror (errno));
-
-              pthread_mutex_unlock (&host_data_heap_lock);
-            }
+          if (!exit_flag)
+            break;
 
-          pthread_mutex_lock (&host_data_heap_lock);
+          timeout = _stats_dispatch (prog_data, timeout);
 
-          host_data = heap_peek (host_data_heap);
-
-          pthread_mutex_unlock (&host_data_heap_lock);
-
-          /* empty heap, everything must be processing, so we'll sleep
-           * for the poll interval, b/c no one should be scheduled
-           * until after this time has passed anyways.
-           */
-          if (!host_data)
-            daemon_sleep (prog_data->args->poll_interval + 1);
-          else
-            {
-              struct timeval tv;
-
-              gettimeofday (&tv, NULL);
-
-              /* If next_poll_time == 0, no sleep, its the first time through */
-              if (host_data->next_poll_time
-                  && (host_data->next_poll_time > tv.tv_sec))
-                daemon_sleep ((host_data->next_poll_time - tv.tv_sec) + 1);
-            }
+          _scheduler_wait (timeout);
         }
     }
 
   rv = 0;
  cleanup:
   ipmiseld_threadpool_destroy ();
+  ipmiseld_engine_destroy ();
+  _scheduler_cleanup ();
   heap_destroy (host_data_heap);
+  ipmiseld_state_db_cleanup ();
+  ipmiseld_output_destroy ();
+  ipmiseld_interpret_cleanup ();
   fi_hostlist_iterator_destroy (hitr);
   fi_hostlist_destroy (hlist);
   free (host);
@@ -1795,6 +2492,12 @@ main (int argc, char **argv)
 
       daemon_signal_handler_setup (_signal_handler_callback);
 
+      /* re-read the event state configuration on the next poll and
+       * reopen the log file, e.g. after log rotation
+       */
+      if (signal (SIGHUP, _reload_signal_handler) == SIG_ERR)
+        err_exit ("signal: %s", strerror (errno));
+
       /* Call after daemonization, since daemonization closes currently
        * open fds
        */
@@ -65,10 +65,17 @@
 
 #define IPMISELD_POLL_INTERVAL_DEFAULT                                  300
 
+/* defaults relative to the poll interval with adaptive polling */
+#define IPMISELD_MIN_POLL_INTERVAL_DIVISOR                              10
+
+#define IPMISELD_MAX_POLL_INTERVAL_MULTIPLIER                           4
+
 #define IPMISELD_THREADPOOL_COUNT                                       8
 
 #define IPMISELD_ERROR_OUTPUT_LIMIT                                     20
 
+#define IPMISELD_LOG_QUEUE_LENGTH_DEFAULT                               4096
+
 enum ipmiseld_argp_option_keys
   {
     IPMISELD_VERBOSE_KEY = 'v',
@@ -97,6 +104,18 @@ enum ipmiseld_argp_option_keys
     IPMISELD_THREADPOOL_COUNT_KEY = 180,
     IPMISELD_TEST_RUN_KEY = 181,
     IPMISELD_FOREGROUND_KEY = 182,
+    IPMISELD_PERSISTENT_SESSIONS_KEY = 183,
+    IPMISELD_ASYNC_THREADS_KEY = 184,
+    IPMISELD_SPECULATIVE_READ_KEY = 185,
+    IPMISELD_LOG_FILE_KEY = 186,
+    IPMISELD_LOG_SOCKET_KEY = 187,
+    IPMISELD_LOG_QUEUE_LENGTH_KEY = 188,
+    IPMISELD_LOG_QUEUE_OVERFLOW_KEY = 189,
+    IPMISELD_ADAPTIVE_POLL_INTERVAL_KEY = 190,
+    IPMISELD_MIN_POLL_INTERVAL_KEY = 191,
+    IPMISELD_MAX_POLL_INTERVAL_KEY = 192,
+    IPMISELD_CONSOLIDATED_STATE_KEY = 193,
+    IPMISELD_STATS_INTERVAL_KEY = 194,
   };
 
 struct ipmiseld_arguments
@@ -121,13 +140,25 @@ struct ipmiseld_arguments
   char *oem_timestamped_event_format_str;
   char *oem_non_timestamped_event_format_str;
   unsigned int poll_interval;
+  int adaptive_poll_interval;
+  unsigned int min_poll_interval;
+  unsigned int max_poll_interval;
   char *log_facility_str;
   char *log_priority_str;
+  char *log_file;
+  char *log_socket;
+  unsigned int log_queue_length;
+  char *log_queue_overflow_str;
   char *cache_directory;
+  int consolidated_state;
   int ignore_sdr;
   int re_download_sdr;
   int clear_sel;
   unsigned int threadpool_count;
+  int persistent_sessions;
+  unsigned int async_threads;
+  int speculative_read;
+  unsigned int stats_interval;
   int test_run;
   int foreground;
 };
@@ -163,18 +194,29 @@ typedef struct ipmiseld_host_state
   ipmiseld_last_record_id_t last_record_id;
   unsigned int last_percent_full;
   ipmiseld_sel_info_t sel_info;
+  /* exponentially weighted SEL fill rate in thousandths of entries
+   * per hour, and the time of the poll it was last updated
+   */
+  uint32_t fill_rate;
+  uint32_t fill_rate_timestamp;
   int initialized;
 } ipmiseld_host_state_t;
 
+struct ipmiseld_interpret;
+
 typedef struct ipmiseld_host_poll
 {
   ipmi_ctx_t ipmi_ctx;
   ipmi_sdr_ctx_t sdr_ctx;
   ipmi_sel_ctx_t sel_ctx;
   ipmi_interpret_ctx_t interpret_ctx;
+  /* shared event state configuration interpret_ctx was created from */
+  struct ipmiseld_interpret *interpret;
   struct ipmi_oem_data oem_data;
 } ipmiseld_host_poll_t;
 
+struct ipmiseld_engine_host;
+
 typedef struct ipmiseld_host_data
 {
   ipmiseld_prog_data_t *prog_data;
@@ -182,9 +224,18 @@ typedef struct ipmiseld_host_data
   ipmiseld_host_state_t last_host_state;
   ipmiseld_host_state_t now_host_state;
   ipmiseld_host_poll_t *host_poll;
+  /* set once the host is polled by the async engine */
+  struct ipmiseld_engine_host *engine_host;
   int re_download_sdr_done;
   int clear_sel_done;
-  time_t next_poll_time;
+  struct timeval next_poll_time;
+  /* next time the host is handed to the threadpool, either for the
+   * next poll or to keep a persistent session alive
+   */
+  struct timeval next_wakeup_time;
+  /* when the current poll actually started, for statistics */
+  struct timeval poll_start_time;
+  int keepalive;
   int last_ipmi_errnum;
   unsigned int last_ipmi_errnum_count;
 } ipmiseld_host_data_t;
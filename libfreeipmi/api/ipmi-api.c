@@ -1881,6 +1881,71 @@ ipmi_cmd_ipmb (ipmi_ctx_t ctx,
   return (rv);
 }
 
+int
+ipmi_cmd_pipelined (ipmi_ctx_t ctx,
+                    uint8_t lun,
+                    uint8_t net_fn,
+                    fiid_obj_t *obj_cmd_rq,
+                    fiid_obj_t *obj_cmd_rs,
+                    unsigned int count)
+{
+  unsigned int i;
+
+  if (!ctx || ctx->magic != IPMI_CTX_MAGIC)
+    {
+      ERR_TRACE (ipmi_ctx_errormsg (ctx), ipmi_ctx_errnum (ctx));
+      return (-1);
+    }
+
+  if (!obj_cmd_rq
+      || !obj_cmd_rs
+      || !count
+      || count > IPMI_CMD_PIPELINED_MAX)
+    {
+      API_SET_ERRNUM (ctx, IPMI_ERR_PARAMETERS);
+      return (-1);
+    }
+
+  /* Bridged requests have to wait on each other in
+   * api_lan_cmd_wrapper_ipmb(), so they aren't pipelined either.
+   */
+  if (ctx->type != IPMI_DEVICE_LAN
+      || ctx->flags & IPMI_FLAGS_NOSESSION
+      || (ctx->target.channel_number_is_set
+          && ctx->target.rs_addr_is_set))
+    {
+      for (i = 0; i < count; i++)
+        {
+          /* errnum set in ipmi_cmd() */
+          if (ipmi_cmd (ctx, lun, net_fn, obj_cmd_rq[i], obj_cmd_rs[i]) < 0)
+            return (-1);
+        }
+      return (0);
+    }
+
+  for (i = 0; i < count; i++)
+    {
+      if (!fiid_obj_valid (obj_cmd_rq[i])
+          || !fiid_obj_valid (obj_cmd_rs[i]))
+        {
+          API_SET_ERRNUM (ctx, IPMI_ERR_PARAMETERS);
+          return (-1);
+        }
+
+      if (FIID_OBJ_PACKET_VALID (obj_cmd_rq[i]) < 0)
+        {
+          API_FIID_OBJECT_ERROR_TO_API_ERRNUM (ctx, obj_cmd_rq[i]);
+          return (-1);
+        }
+    }
+
+  ctx->target.lun = lun;
+  ctx->target.net_fn = net_fn;
+
+  /* errnum set in api_lan_cmd_pipelined() */
+  return (api_lan_cmd_pipelined (ctx, obj_cmd_rq, obj_cmd_rs, count));
+}
+
 int
 ipmi_cmd_raw (ipmi_ctx_t ctx,
               uint8_t lun,
@@ -129,6 +129,46 @@ api_lan_cmd_ipmb (ipmi_ctx_t ctx,
                                     obj_cmd_rs));
 }
 
+int
+api_lan_cmd_pipelined (ipmi_ctx_t ctx,
+                       fiid_obj_t *obj_cmd_rq,
+                       fiid_obj_t *obj_cmd_rs,
+                       unsigned int count)
+{
+  uint8_t authentication_type;
+  unsigned int internal_workaround_flags = 0;
+
+  assert (ctx
+          && ctx->magic == IPMI_CTX_MAGIC
+          && ctx->type == IPMI_DEVICE_LAN
+          && !(ctx->flags & IPMI_FLAGS_NOSESSION)
+          && ctx->io.outofband.sockfd
+          && obj_cmd_rq
+          && obj_cmd_rs
+          && count);
+
+  api_lan_cmd_get_session_parameters (ctx,
+                                      &authentication_type,
+                                      &internal_workaround_flags);
+
+  /* if auth type NONE, still pass password.  Needed for
+   * check_unexpected_authcode workaround
+   */
+  return (api_lan_cmd_wrapper_pipelined (ctx,
+                                         internal_workaround_flags,
+                                         ctx->target.lun,
+                                         ctx->target.net_fn,
+                                         authentication_type,
+                                         &(ctx->io.outofband.session_sequence_number),
+                                         ctx->io.outofband.session_id,
+                                         &(ctx->io.outofband.rq_seq),
+                                         ctx->io.outofband.password,
+                                         IPMI_1_5_MAX_PASSWORD_LENGTH,
+                                         obj_cmd_rq,
+                                         obj_cmd_rs,
+                                         count));
+}
+
 int
 api_lan_cmd_raw (ipmi_ctx_t ctx,
                  const void *buf_rq,
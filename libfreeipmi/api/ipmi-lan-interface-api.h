@@ -31,6 +31,11 @@ int api_lan_cmd_ipmb (ipmi_ctx_t ctx,
                       fiid_obj_t obj_cmd_rq,
                       fiid_obj_t obj_cmd_rs);
 
+int api_lan_cmd_pipelined (ipmi_ctx_t ctx,
+                           fiid_obj_t *obj_cmd_rq,
+                           fiid_obj_t *obj_cmd_rs,
+                           unsigned int count);
+
 int api_lan_cmd_raw (ipmi_ctx_t ctx,
                      const void *buf_rq,
                      unsigned int buf_rq_len,
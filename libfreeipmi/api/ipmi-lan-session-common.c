@@ -1142,6 +1142,244 @@ api_lan_cmd_wrapper (ipmi_ctx_t ctx,
   return (rv);
 }
 
+/* Like api_lan_cmd_wrapper(), but all requests are sent before
+ * waiting for any response.  Responses are matched to their request
+ * by requester sequence number.  On a timeout, all requests still
+ * missing a response are retransmitted.
+ */
+int
+api_lan_cmd_wrapper_pipelined (ipmi_ctx_t ctx,
+                               unsigned int internal_workaround_flags,
+                               uint8_t lun,
+                               uint8_t net_fn,
+                               uint8_t authentication_type,
+                               uint32_t *session_sequence_number,
+                               uint32_t session_id,
+                               uint8_t *rq_seq,
+                               const char *password,
+                               unsigned int password_len,
+                               fiid_obj_t *obj_cmd_rq,
+                               fiid_obj_t *obj_cmd_rs,
+                               unsigned int count)
+{
+  uint8_t rq_seqs[IPMI_CMD_PIPELINED_MAX];
+  int received[IPMI_CMD_PIPELINED_MAX];
+  uint8_t cmd[IPMI_CMD_PIPELINED_MAX];             /* used for debugging */
+  uint8_t group_extension[IPMI_CMD_PIPELINED_MAX]; /* used for debugging */
+  unsigned int pending = count;
+  unsigned int retransmission_count = 0;
+  uint8_t pkt[IPMI_MAX_PKT_LEN];
+  fiid_obj_t obj_rs_scratch = NULL;
+  unsigned int intf_flags = IPMI_INTERFACE_FLAGS_DEFAULT;
+  uint64_t val;
+  int recv_len, ret, rv = -1;
+  unsigned int i;
+
+  assert (ctx
+          && ctx->magic == IPMI_CTX_MAGIC
+          && ctx->type == IPMI_DEVICE_LAN
+          && ctx->io.outofband.sockfd
+          && IPMI_BMC_LUN_VALID (lun)
+          && IPMI_NET_FN_VALID (net_fn)
+          && IPMI_1_5_AUTHENTICATION_TYPE_VALID (authentication_type)
+          && session_sequence_number
+          && rq_seq
+          && !(password && password_len > IPMI_1_5_MAX_PASSWORD_LENGTH)
+          && obj_cmd_rq
+          && obj_cmd_rs
+          && count
+          && count <= IPMI_CMD_PIPELINED_MAX);
+
+  if (ctx->flags & IPMI_FLAGS_NO_LEGAL_CHECK)
+    intf_flags |= IPMI_INTERFACE_FLAGS_NO_LEGAL_CHECK;
+
+  if (!ctx->io.outofband.last_received.tv_sec
+      && !ctx->io.outofband.last_received.tv_usec)
+    {
+      if (gettimeofday (&ctx->io.outofband.last_received, NULL) < 0)
+        {
+          API_ERRNO_TO_API_ERRNUM (ctx, errno);
+          return (-1);
+        }
+    }
+
+  memset (received, '\0', sizeof (received));
+  memset (cmd, '\0', sizeof (cmd));
+  memset (group_extension, '\0', sizeof (group_extension));
+
+  if (ctx->flags & IPMI_FLAGS_DEBUG_DUMP)
+    {
+      for (i = 0; i < count; i++)
+        {
+          /* ignore error, continue on */
+          if (FIID_OBJ_GET (obj_cmd_rq[i],
+                            "cmd",
+                            &val) < 0)
+            API_FIID_OBJECT_ERROR_TO_API_ERRNUM (ctx, obj_cmd_rq[i]);
+          else
+            cmd[i] = val;
+
+          if (IPMI_NET_FN_GROUP_EXTENSION (net_fn))
+            {
+              /* ignore error, continue on */
+              if (FIID_OBJ_GET (obj_cmd_rq[i],
+                                "group_extension_identification",
+                                &val) < 0)
+                API_FIID_OBJECT_ERROR_TO_API_ERRNUM (ctx, obj_cmd_rq[i]);
+              else
+                group_extension[i] = val;
+            }
+        }
+    }
+
+  /* a response is unassembled here first, to find out which request
+   * it belongs to
+   */
+  if (!(obj_rs_scratch = fiid_obj_dup (obj_cmd_rs[0])))
+    {
+      API_FIID_OBJECT_ERROR_TO_API_ERRNUM (ctx, obj_cmd_rs[0]);
+      goto cleanup;
+    }
+
+  while (1)
+    {
+      for (i = 0; i < count; i++)
+        {
+          if (received[i])
+            continue;
+
+          rq_seqs[i] = *rq_seq;
+
+          if (_api_lan_cmd_send (ctx,
+                                 lun,
+                                 net_fn,
+                                 authentication_type,
+                                 *session_sequence_number,
+                                 session_id,
+                                 rq_seqs[i],
+                                 password,
+                                 password_len,
+                                 cmd[i],  /* for debug dumping */
+                                 group_extension[i],  /* for debug dumping */
+                                 obj_cmd_rq[i]) < 0)
+            goto cleanup;
+
+          (*session_sequence_number)++;
+          *rq_seq = ((*rq_seq) + 1) % (IPMI_LAN_REQUESTER_SEQUENCE_NUMBER_MAX + 1);
+        }
+
+      while (pending)
+        {
+          if ((ret = _session_timed_out (ctx)) < 0)
+            goto cleanup;
+
+          if (ret)
+            {
+              API_SET_ERRNUM (ctx, IPMI_ERR_SESSION_TIMEOUT);
+              goto cleanup;
+            }
+
+          if ((recv_len = _api_lan_cmd_recv (ctx,
+                                             pkt,
+                                             IPMI_MAX_PKT_LEN,
+                                             retransmission_count)) < 0)
+            goto cleanup;
+
+          /* retransmit everything still outstanding */
+          if (!recv_len)
+            break;
+
+          if ((ret = unassemble_ipmi_lan_pkt (pkt,
+                                              recv_len,
+                                              ctx->io.outofband.rs.obj_rmcp_hdr,
+                                              ctx->io.outofband.rs.obj_lan_session_hdr,
+                                              ctx->io.outofband.rs.obj_lan_msg_hdr,
+                                              obj_rs_scratch,
+                                              ctx->io.outofband.rs.obj_lan_msg_trlr,
+                                              intf_flags)) < 0)
+            {
+              API_ERRNO_TO_API_ERRNUM (ctx, errno);
+              goto cleanup;
+            }
+
+          if (FIID_OBJ_GET (ctx->io.outofband.rs.obj_lan_msg_hdr,
+                            "rq_seq",
+                            &val) < 0)
+            continue;
+
+          for (i = 0; i < count; i++)
+            {
+              if (!received[i] && rq_seqs[i] == val)
+                break;
+            }
+
+          /* stale response to an earlier transmission */
+          if (i == count)
+            continue;
+
+          /* its ok to use the "request" net_fn, dump code doesn't care */
+          if (ctx->flags & IPMI_FLAGS_DEBUG_DUMP)
+            _api_lan_dump_rs (ctx,
+                              pkt,
+                              recv_len,
+                              cmd[i],
+                              net_fn,
+                              group_extension[i],
+                              obj_cmd_rs[i]);
+
+          if ((ret = unassemble_ipmi_lan_pkt (pkt,
+                                              recv_len,
+                                              ctx->io.outofband.rs.obj_rmcp_hdr,
+                                              ctx->io.outofband.rs.obj_lan_session_hdr,
+                                              ctx->io.outofband.rs.obj_lan_msg_hdr,
+                                              obj_cmd_rs[i],
+                                              ctx->io.outofband.rs.obj_lan_msg_trlr,
+                                              intf_flags)) < 0)
+            {
+              API_ERRNO_TO_API_ERRNUM (ctx, errno);
+              goto cleanup;
+            }
+
+          if (!ret)
+            continue;
+
+          if ((ret = _api_lan_cmd_wrapper_verify_packet (ctx,
+                                                         internal_workaround_flags,
+                                                         authentication_type,
+                                                         1,
+                                                         session_sequence_number,
+                                                         session_id,
+                                                         &rq_seqs[i],
+                                                         password,
+                                                         password_len,
+                                                         obj_cmd_rs[i])) < 0)
+            goto cleanup;
+
+          if (!ret)
+            continue;
+
+          if (gettimeofday (&(ctx->io.outofband.last_received), NULL) < 0)
+            {
+              API_ERRNO_TO_API_ERRNUM (ctx, errno);
+              goto cleanup;
+            }
+
+          received[i]++;
+          pending--;
+        }
+
+      if (!pending)
+        break;
+
+      retransmission_count++;
+    }
+
+  rv = 0;
+ cleanup:
+  fiid_obj_destroy (obj_rs_scratch);
+  return (rv);
+}
+
 /* see workaround _ipmi_check_ipmb_out_of_order() regarding obj_rs & obj_rs_errnum pointer */
 static int
 _ipmi_cmd_send_ipmb (ipmi_ctx_t ctx,
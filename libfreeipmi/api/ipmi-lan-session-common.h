@@ -49,6 +49,20 @@ int api_lan_cmd_wrapper (ipmi_ctx_t ctx,
                          fiid_obj_t obj_cmd_rq,
                          fiid_obj_t obj_cmd_rs);
 
+int api_lan_cmd_wrapper_pipelined (ipmi_ctx_t ctx,
+                                   unsigned int internal_workaround_flags,
+                                   uint8_t lun,
+                                   uint8_t net_fn,
+                                   uint8_t authentication_type,
+                                   uint32_t *session_sequence_number,
+                                   uint32_t session_id,
+                                   uint8_t *rq_seq,
+                                   const char *password,
+                                   unsigned int password_len,
+                                   fiid_obj_t *obj_cmd_rq,
+                                   fiid_obj_t *obj_cmd_rs,
+                                   unsigned int count);
+
 int api_lan_cmd_wrapper_ipmb (ipmi_ctx_t ctx,
                               fiid_obj_t obj_cmd_rq,
                               fiid_obj_t obj_cmd_rs);
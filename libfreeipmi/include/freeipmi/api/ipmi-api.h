@@ -327,6 +327,23 @@ int ipmi_cmd (ipmi_ctx_t ctx,
               fiid_obj_t obj_cmd_rq,
               fiid_obj_t obj_cmd_rs);
 
+/* Perform several IPMI commands at once, the response to
+ * obj_cmd_rq[i] is returned in obj_cmd_rs[i].  Over IPMI 1.5 LAN
+ * sessions all requests are sent before waiting for the responses,
+ * saving round trips to the BMC.  Other interfaces perform the
+ * commands one after another.  As with ipmi_cmd(), completion codes
+ * of the responses are not checked.  count may be at most
+ * IPMI_CMD_PIPELINED_MAX.
+ */
+#define IPMI_CMD_PIPELINED_MAX 8
+
+int ipmi_cmd_pipelined (ipmi_ctx_t ctx,
+                        uint8_t lun,
+                        uint8_t net_fn,
+                        fiid_obj_t *obj_cmd_rq,
+                        fiid_obj_t *obj_cmd_rs,
+                        unsigned int count);
+
 /* convenience function to perform a single bridged IPMI command.
  * Will effectively call ipmi_ctx_set_target(), then ipmi_cmd(), then
  * will set targets back to prior originals.
@@ -55,6 +55,15 @@ typedef struct ipmi_interpret_ctx *ipmi_interpret_ctx_t;
 
 /* Interpret Context Functions */
 ipmi_interpret_ctx_t ipmi_interpret_ctx_create (void);
+/* Create a context using the configuration loaded into shared_ctx
+ * instead of its own copy, so the config files need only be parsed
+ * once for many contexts.  Flags, manufacturer id, and product id are
+ * not shared.  Configuration cannot be loaded into the returned
+ * context.  shared_ctx must not be destroyed or have configuration
+ * loaded into it while contexts sharing it exist.  Contexts sharing
+ * configuration may be used from different threads.
+ */
+ipmi_interpret_ctx_t ipmi_interpret_ctx_create_shared (ipmi_interpret_ctx_t shared_ctx);
 void ipmi_interpret_ctx_destroy (ipmi_interpret_ctx_t ctx);
 int ipmi_interpret_ctx_errnum (ipmi_interpret_ctx_t ctx);
 char * ipmi_interpret_ctx_strerror (int errnum);
@@ -52,6 +52,7 @@ extern "C" {
 #define IPMI_SEL_FLAGS_DEFAULT                              0x0000
 #define IPMI_SEL_FLAGS_DEBUG_DUMP                           0x0001
 #define IPMI_SEL_FLAGS_ASSUME_SYSTEM_EVENT_RECORDS          0x0002
+#define IPMI_SEL_FLAGS_SPECULATIVE_READ                     0x0004
 
 #define IPMI_SEL_PARAMETER_INTERPRET_CONTEXT                0x0001
 #define IPMI_SEL_PARAMETER_UTC_OFFSET                       0x0002
@@ -187,6 +188,10 @@ int ipmi_sel_ctx_clear_reservation_id (ipmi_sel_ctx_t ctx);
 /* ipmi_sel_parse and ipmi_sel_parse_record_ids
  * - callback is called after each SEL entry is parsed
  * - Returns the number of entries parsed
+ * - With IPMI_SEL_FLAGS_SPECULATIVE_READ, ipmi_sel_parse reads
+ *   several entries at once assuming record ids are sequential (see
+ *   ipmi_cmd_pipelined()).  It goes back to following each entry's
+ *   next record id where the guess is wrong.
  */
 int ipmi_sel_parse (ipmi_sel_ctx_t ctx,
                     uint16_t record_id_start,
@@ -200,6 +205,23 @@ int ipmi_sel_parse_record_ids (ipmi_sel_ctx_t ctx,
                                Ipmi_Sel_Parse_Callback callback,
                                void *callback_data);
 
+/* ipmi_sel_parse_records
+ * - parses SEL records saved earlier (e.g. with
+ *   ipmi_sel_parse_read_record()) instead of reading them from the
+ *   BMC, does not require an ipmi_ctx
+ * - sel_records_len must be a multiple of the SEL record length
+ * - record_id_start and record_id_last select records as with
+ *   ipmi_sel_parse()
+ * - Returns the number of entries parsed
+ */
+int ipmi_sel_parse_records (ipmi_sel_ctx_t ctx,
+                            const void *sel_records,
+                            unsigned int sel_records_len,
+                            uint16_t record_id_start,
+                            uint16_t record_id_last,
+                            Ipmi_Sel_Parse_Callback callback,
+                            void *callback_data);
+
 /* SEL data retrieval functions after SEL is parsed
  *
  * seek_record_id moves the iterator to the closest record_id >= record_id
@@ -322,6 +322,9 @@ struct ipmi_interpret_ctx {
 
   ipmi_sel_ctx_t sel_ctx;
 
+  /* set if the configuration below is borrowed from another context */
+  int shared;
+
   struct ipmi_interpret_sel interpret_sel;
   struct ipmi_interpret_sensor interpret_sensor;
 };
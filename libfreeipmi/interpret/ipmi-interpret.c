@@ -116,6 +116,50 @@ ipmi_interpret_ctx_create (void)
   return (NULL);
 }
 
+ipmi_interpret_ctx_t
+ipmi_interpret_ctx_create_shared (ipmi_interpret_ctx_t shared_ctx)
+{
+  struct ipmi_interpret_ctx *ctx = NULL;
+
+  if (!shared_ctx || shared_ctx->magic != IPMI_INTERPRET_CTX_MAGIC)
+    {
+      SET_ERRNO (EINVAL);
+      return (NULL);
+    }
+
+  if (!(ctx = (ipmi_interpret_ctx_t)malloc (sizeof (struct ipmi_interpret_ctx))))
+    {
+      ERRNO_TRACE (errno);
+      return (NULL);
+    }
+  memset (ctx, '\0', sizeof (struct ipmi_interpret_ctx));
+  ctx->magic = IPMI_INTERPRET_CTX_MAGIC;
+  ctx->flags = IPMI_INTERPRET_FLAGS_DEFAULT;
+
+  if (!(ctx->sel_ctx = ipmi_sel_ctx_create (NULL, NULL)))
+    {
+      ERRNO_TRACE (errno);
+      free (ctx);
+      return (NULL);
+    }
+
+  /* The configuration is only read when interpreting, so the tables
+   * can be borrowed as is.  The oem hashes are not locked (hash.c
+   * locking is only compiled into libipmiconsole), but they are read
+   * only after the configuration is loaded.  The shared_ctx must not
+   * load any more configuration while contexts share it.
+   */
+  ctx->shared = 1;
+  memcpy (&ctx->interpret_sel,
+          &shared_ctx->interpret_sel,
+          sizeof (struct ipmi_interpret_sel));
+  memcpy (&ctx->interpret_sensor,
+          &shared_ctx->interpret_sensor,
+          sizeof (struct ipmi_interpret_sensor));
+
+  return (ctx);
+}
+
 void
 ipmi_interpret_ctx_destroy (ipmi_interpret_ctx_t ctx)
 {
@@ -123,8 +167,11 @@ ipmi_interpret_ctx_destroy (ipmi_interpret_ctx_t ctx)
     return;
 
   ipmi_sel_ctx_destroy (ctx->sel_ctx);
-  interpret_sel_destroy (ctx);
-  interpret_sensor_destroy (ctx);
+  if (!ctx->shared)
+    {
+      interpret_sel_destroy (ctx);
+      interpret_sensor_destroy (ctx);
+    }
 
   ctx->magic = ~IPMI_INTERPRET_CTX_MAGIC;
   free (ctx);
@@ -289,6 +336,13 @@ ipmi_interpret_load_sel_config (ipmi_interpret_ctx_t ctx,
       return (-1);
     }
 
+  /* configuration of a shared context is read-only */
+  if (ctx->shared)
+    {
+      INTERPRET_SET_ERRNUM (ctx, IPMI_INTERPRET_ERR_PARAMETERS);
+      return (-1);
+    }
+
   if (sel_config_file)
     {
       if (stat (sel_config_file, &buf) < 0)
@@ -339,6 +393,13 @@ ipmi_interpret_load_sensor_config (ipmi_interpret_ctx_t ctx,
       return (-1);
     }
 
+  /* configuration of a shared context is read-only */
+  if (ctx->shared)
+    {
+      INTERPRET_SET_ERRNUM (ctx, IPMI_INTERPRET_ERR_PARAMETERS);
+      return (-1);
+    }
+
   if (sensor_config_file)
     {
       if (stat (sensor_config_file, &buf) < 0)
@@ -46,7 +46,8 @@
 
 #define IPMI_SEL_FLAGS_MASK                     \
   (IPMI_SEL_FLAGS_DEBUG_DUMP                    \
-   | IPMI_SEL_FLAGS_ASSUME_SYSTEM_EVENT_RECORDS)
+   | IPMI_SEL_FLAGS_ASSUME_SYSTEM_EVENT_RECORDS \
+   | IPMI_SEL_FLAGS_SPECULATIVE_READ)
 
 #define IPMI_SEL_SEPARATOR_STRING     " | "
 
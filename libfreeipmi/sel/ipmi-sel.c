@@ -41,6 +41,8 @@
 #include "freeipmi/record-format/ipmi-sel-record-format.h"
 #include "freeipmi/sdr/ipmi-sdr.h"
 #include "freeipmi/spec/ipmi-comp-code-spec.h"
+#include "freeipmi/spec/ipmi-ipmb-lun-spec.h"
+#include "freeipmi/spec/ipmi-netfn-spec.h"
 #include "freeipmi/util/ipmi-sensor-and-event-code-tables-util.h"
 #include "freeipmi/util/ipmi-timestamp-util.h"
 #include "freeipmi/util/ipmi-util.h"
@@ -901,6 +903,173 @@ _get_sel_entry (ipmi_sel_ctx_t ctx,
   return (rv);
 }
 
+/* Read several entries at once, guessing that the record ids
+ * following record_id are sequential.  Returns the number of leading
+ * responses in obj_cmd_rs that are the entries following the record
+ * id chain would have read.  On 0, the caller should fall back to
+ * reading record_id by itself.
+ */
+static int
+_get_sel_entries_speculative (ipmi_sel_ctx_t ctx,
+                              fiid_obj_t *obj_cmd_rq,
+                              fiid_obj_t *obj_cmd_rs,
+                              uint16_t reservation_id,
+                              uint16_t record_id,
+                              uint16_t record_id_last)
+{
+  unsigned int count = 0;
+  unsigned int i;
+  uint64_t val;
+  int len;
+
+  assert (ctx);
+  assert (ctx->magic == IPMI_SEL_CTX_MAGIC);
+  assert (ctx->ipmi_ctx);
+  assert (obj_cmd_rq);
+  assert (obj_cmd_rs);
+
+  while (count < IPMI_CMD_PIPELINED_MAX
+         && (record_id + count) <= record_id_last
+         && (record_id + count) < IPMI_SEL_GET_RECORD_ID_LAST_ENTRY)
+    {
+      if (fill_cmd_get_sel_entry (reservation_id,
+                                  record_id + count,
+                                  0,
+                                  IPMI_SEL_READ_ENTIRE_RECORD_BYTES_TO_READ,
+                                  obj_cmd_rq[count]) < 0)
+        {
+          SEL_ERRNO_TO_SEL_ERRNUM (ctx, errno);
+          return (-1);
+        }
+      count++;
+    }
+
+  /* nothing to gain over a single read */
+  if (count < 2)
+    return (0);
+
+  if (ipmi_cmd_pipelined (ctx->ipmi_ctx,
+                          IPMI_BMC_IPMB_LUN_BMC,
+                          IPMI_NET_FN_STORAGE_RQ,
+                          obj_cmd_rq,
+                          obj_cmd_rs,
+                          count) < 0)
+    {
+      SEL_SET_ERRNUM (ctx, IPMI_SEL_ERR_IPMI_ERROR);
+      return (-1);
+    }
+
+  /* A bad completion code (e.g. reservation canceled, end of the SEL)
+   * or a gap in the record ids ends the speculation.  The chained walk
+   * takes over from there, with all of its error handling.
+   */
+  for (i = 0; i < count; i++)
+    {
+      struct ipmi_sel_entry tmp_sel_entry;
+      uint16_t tmp_record_id;
+
+      if (ipmi_check_completion_code_success (obj_cmd_rs[i]) != 1)
+        break;
+
+      if ((len = fiid_obj_get_data (obj_cmd_rs[i],
+                                    "record_data",
+                                    tmp_sel_entry.sel_event_record,
+                                    IPMI_SEL_RECORD_LENGTH)) < 0)
+        break;
+
+      tmp_sel_entry.sel_event_record_len = len;
+
+      if (sel_get_record_header_info (ctx,
+                                      &tmp_sel_entry,
+                                      &tmp_record_id,
+                                      NULL) < 0)
+        break;
+
+      if (tmp_record_id != (record_id + i))
+        break;
+
+      if (FIID_OBJ_GET (obj_cmd_rs[i], "next_record_id", &val) < 0)
+        break;
+
+      if (val != (record_id + i + 1))
+        {
+          i++;
+          break;
+        }
+    }
+
+  return (i);
+}
+
+/* store the entry in obj_cmd_rs and return its next record id */
+static int
+_sel_parse_entry (ipmi_sel_ctx_t ctx,
+                  fiid_obj_t obj_cmd_rs,
+                  Ipmi_Sel_Parse_Callback callback,
+                  void *callback_data,
+                  uint16_t *next_record_id)
+{
+  struct ipmi_sel_entry *sel_entry = NULL;
+  uint64_t val;
+  int len;
+  int rv = -1;
+
+  assert (ctx);
+  assert (ctx->magic == IPMI_SEL_CTX_MAGIC);
+  assert (fiid_obj_valid (obj_cmd_rs) == 1);
+  assert (next_record_id);
+
+  if (FIID_OBJ_GET (obj_cmd_rs, "next_record_id", &val) < 0)
+    {
+      SEL_FIID_OBJECT_ERROR_TO_SEL_ERRNUM (ctx, obj_cmd_rs);
+      goto cleanup;
+    }
+  (*next_record_id) = val;
+
+  if (!(sel_entry = (struct ipmi_sel_entry *)malloc (sizeof (struct ipmi_sel_entry))))
+    {
+      SEL_SET_ERRNUM (ctx, IPMI_SEL_ERR_OUT_OF_MEMORY);
+      goto cleanup;
+    }
+
+  if ((len = fiid_obj_get_data (obj_cmd_rs,
+                                "record_data",
+                                sel_entry->sel_event_record,
+                                IPMI_SEL_RECORD_LENGTH)) < 0)
+    {
+      SEL_FIID_OBJECT_ERROR_TO_SEL_ERRNUM (ctx, obj_cmd_rs);
+      goto cleanup;
+    }
+
+  sel_entry->sel_event_record_len = len;
+
+  _sel_entry_dump (ctx, sel_entry);
+
+  /* achu: should come before list_append to avoid having a freed entry on the list */
+  if (callback)
+    {
+      ctx->callback_sel_entry = sel_entry;
+      if ((*callback)(ctx, callback_data) < 0)
+        {
+          SEL_SET_ERRNUM (ctx, IPMI_SEL_ERR_CALLBACK_ERROR);
+          goto cleanup;
+        }
+    }
+
+  if (!list_append (ctx->sel_entries, sel_entry))
+    {
+      SEL_SET_ERRNUM (ctx, IPMI_SEL_ERR_INTERNAL_ERROR);
+      goto cleanup;
+    }
+  sel_entry = NULL;
+
+  rv = 0;
+ cleanup:
+  ctx->callback_sel_entry = NULL;
+  free (sel_entry);
+  return (rv);
+}
+
 int
 ipmi_sel_parse (ipmi_sel_ctx_t ctx,
                 uint16_t record_id_start,
@@ -915,10 +1084,16 @@ ipmi_sel_parse (ipmi_sel_ctx_t ctx,
   uint16_t next_record_id = 0;
   int parsed_atleast_one_entry = 0;
   fiid_obj_t obj_cmd_rs = NULL;
-  uint64_t val;
+  fiid_obj_t obj_cmd_rq_speculative[IPMI_CMD_PIPELINED_MAX];
+  fiid_obj_t obj_cmd_rs_speculative[IPMI_CMD_PIPELINED_MAX];
+  unsigned int i;
+  int count;
   int len;
   int rv = -1;
 
+  memset (obj_cmd_rq_speculative, '\0', sizeof (obj_cmd_rq_speculative));
+  memset (obj_cmd_rs_speculative, '\0', sizeof (obj_cmd_rs_speculative));
+
   if (!ctx || ctx->magic != IPMI_SEL_CTX_MAGIC)
     {
       ERR_TRACE (ipmi_sel_ctx_errormsg (ctx), ipmi_sel_ctx_errnum (ctx));
@@ -945,6 +1120,24 @@ ipmi_sel_parse (ipmi_sel_ctx_t ctx,
       goto cleanup;
     }
 
+  if (ctx->flags & IPMI_SEL_FLAGS_SPECULATIVE_READ)
+    {
+      for (i = 0; i < IPMI_CMD_PIPELINED_MAX; i++)
+        {
+          if (!(obj_cmd_rq_speculative[i] = fiid_obj_create (tmpl_cmd_get_sel_entry_rq)))
+            {
+              SEL_ERRNO_TO_SEL_ERRNUM (ctx, errno);
+              goto cleanup;
+            }
+
+          if (!(obj_cmd_rs_speculative[i] = fiid_obj_create (tmpl_cmd_get_sel_entry_rs)))
+            {
+              SEL_ERRNO_TO_SEL_ERRNUM (ctx, errno);
+              goto cleanup;
+            }
+        }
+    }
+
   /* if caller requests a range, get last record_id and check against
    * input so we don't spin
    */
@@ -1053,6 +1246,40 @@ ipmi_sel_parse (ipmi_sel_ctx_t ctx,
        record_id <= record_id_last && record_id != IPMI_SEL_GET_RECORD_ID_LAST_ENTRY;
        record_id = next_record_id)
     {
+      /* The first entry is always read by itself, its record id isn't
+       * known until then.
+       */
+      if (ctx->flags & IPMI_SEL_FLAGS_SPECULATIVE_READ
+          && reservation_id_initialized
+          && record_id != IPMI_SEL_GET_RECORD_ID_FIRST_ENTRY)
+        {
+          if ((count = _get_sel_entries_speculative (ctx,
+                                                     obj_cmd_rq_speculative,
+                                                     obj_cmd_rs_speculative,
+                                                     reservation_id,
+                                                     record_id,
+                                                     record_id_last)) < 0)
+            goto cleanup;
+
+          if (count)
+            {
+              if (!parsed_atleast_one_entry)
+                parsed_atleast_one_entry++;
+
+              for (i = 0; i < count; i++)
+                {
+                  if (_sel_parse_entry (ctx,
+                                        obj_cmd_rs_speculative[i],
+                                        callback,
+                                        callback_data,
+                                        &next_record_id) < 0)
+                    goto cleanup;
+                }
+
+              continue;
+            }
+        }
+
       if (_get_sel_entry (ctx,
                           obj_cmd_rs,
                           &reservation_id,
@@ -1084,49 +1311,12 @@ ipmi_sel_parse (ipmi_sel_ctx_t ctx,
       if (!parsed_atleast_one_entry)
         parsed_atleast_one_entry++;
 
-      if (FIID_OBJ_GET (obj_cmd_rs, "next_record_id", &val) < 0)
-        {
-          SEL_FIID_OBJECT_ERROR_TO_SEL_ERRNUM (ctx, obj_cmd_rs);
-          goto cleanup;
-        }
-      next_record_id = val;
-
-      if (!(sel_entry = (struct ipmi_sel_entry *)malloc (sizeof (struct ipmi_sel_entry))))
-        {
-          SEL_SET_ERRNUM (ctx, IPMI_SEL_ERR_OUT_OF_MEMORY);
-          goto cleanup;
-        }
-
-      if ((len = fiid_obj_get_data (obj_cmd_rs,
-                                    "record_data",
-                                    sel_entry->sel_event_record,
-                                    IPMI_SEL_RECORD_LENGTH)) < 0)
-        {
-          SEL_FIID_OBJECT_ERROR_TO_SEL_ERRNUM (ctx, obj_cmd_rs);
-          goto cleanup;
-        }
-
-      sel_entry->sel_event_record_len = len;
-
-      _sel_entry_dump (ctx, sel_entry);
-
-      /* achu: should come before list_append to avoid having a freed entry on the list */
-      if (callback)
-        {
-          ctx->callback_sel_entry = sel_entry;
-          if ((*callback)(ctx, callback_data) < 0)
-            {
-              SEL_SET_ERRNUM (ctx, IPMI_SEL_ERR_CALLBACK_ERROR);
-              goto cleanup;
-            }
-        }
-
-      if (!list_append (ctx->sel_entries, sel_entry))
-        {
-          SEL_SET_ERRNUM (ctx, IPMI_SEL_ERR_INTERNAL_ERROR);
-          goto cleanup;
-        }
-      sel_entry = NULL;
+      if (_sel_parse_entry (ctx,
+                            obj_cmd_rs,
+                            callback,
+                            callback_data,
+                            &next_record_id) < 0)
+        goto cleanup;
     }
 
  out:
@@ -1147,6 +1337,11 @@ ipmi_sel_parse (ipmi_sel_ctx_t ctx,
   ctx->callback_sel_entry = NULL;
   free (sel_entry);
   fiid_obj_destroy (obj_cmd_rs);
+  for (i = 0; i < IPMI_CMD_PIPELINED_MAX; i++)
+    {
+      fiid_obj_destroy (obj_cmd_rq_speculative[i]);
+      fiid_obj_destroy (obj_cmd_rs_speculative[i]);
+    }
   return (rv);
 }
 
@@ -1267,6 +1462,117 @@ ipmi_sel_parse_record_ids (ipmi_sel_ctx_t ctx,
   return (rv);
 }
 
+int
+ipmi_sel_parse_records (ipmi_sel_ctx_t ctx,
+                        const void *sel_records,
+                        unsigned int sel_records_len,
+                        uint16_t record_id_start,
+                        uint16_t record_id_last,
+                        Ipmi_Sel_Parse_Callback callback,
+                        void *callback_data)
+{
+  struct ipmi_sel_entry *sel_entry = NULL;
+  const uint8_t *sel_records_ptr;
+  unsigned int sel_records_count;
+  unsigned int i;
+  int rv = -1;
+
+  if (!ctx || ctx->magic != IPMI_SEL_CTX_MAGIC)
+    {
+      ERR_TRACE (ipmi_sel_ctx_errormsg (ctx), ipmi_sel_ctx_errnum (ctx));
+      return (-1);
+    }
+
+  if ((!sel_records && sel_records_len)
+      || (sel_records_len % IPMI_SEL_RECORD_LENGTH)
+      || record_id_start > record_id_last)
+    {
+      SEL_SET_ERRNUM (ctx, IPMI_SEL_ERR_PARAMETERS);
+      return (-1);
+    }
+
+  _sel_entries_clear (ctx);
+
+  sel_records_ptr = (const uint8_t *)sel_records;
+  sel_records_count = sel_records_len / IPMI_SEL_RECORD_LENGTH;
+
+  /* special case, need only the last record */
+  if (record_id_start == IPMI_SEL_GET_RECORD_ID_LAST_ENTRY
+      && sel_records_count)
+    {
+      sel_records_ptr += (sel_records_count - 1) * IPMI_SEL_RECORD_LENGTH;
+      sel_records_count = 1;
+    }
+
+  for (i = 0; i < sel_records_count; i++)
+    {
+      uint16_t record_id;
+
+      if (!(sel_entry = (struct ipmi_sel_entry *)malloc (sizeof (struct ipmi_sel_entry))))
+        {
+          SEL_SET_ERRNUM (ctx, IPMI_SEL_ERR_OUT_OF_MEMORY);
+          goto cleanup;
+        }
+
+      memcpy (sel_entry->sel_event_record,
+              sel_records_ptr + (i * IPMI_SEL_RECORD_LENGTH),
+              IPMI_SEL_RECORD_LENGTH);
+      sel_entry->sel_event_record_len = IPMI_SEL_RECORD_LENGTH;
+
+      if (sel_get_record_header_info (ctx,
+                                      sel_entry,
+                                      &record_id,
+                                      NULL) < 0)
+        goto cleanup;
+
+      if (record_id_start != IPMI_SEL_GET_RECORD_ID_LAST_ENTRY
+          && (record_id < record_id_start
+              || record_id > record_id_last))
+        {
+          free (sel_entry);
+          sel_entry = NULL;
+          continue;
+        }
+
+      _sel_entry_dump (ctx, sel_entry);
+
+      /* achu: should come before list_append to avoid having a freed entry on the list */
+      if (callback)
+        {
+          ctx->callback_sel_entry = sel_entry;
+          if ((*callback)(ctx, callback_data) < 0)
+            {
+              SEL_SET_ERRNUM (ctx, IPMI_SEL_ERR_CALLBACK_ERROR);
+              goto cleanup;
+            }
+        }
+
+      if (!list_append (ctx->sel_entries, sel_entry))
+        {
+          SEL_SET_ERRNUM (ctx, IPMI_SEL_ERR_INTERNAL_ERROR);
+          goto cleanup;
+        }
+      sel_entry = NULL;
+    }
+
+  if ((rv = list_count (ctx->sel_entries)) > 0)
+    {
+      if (!(ctx->sel_entries_itr = list_iterator_create (ctx->sel_entries)))
+        {
+          SEL_SET_ERRNUM (ctx, IPMI_SEL_ERR_INTERNAL_ERROR);
+          goto cleanup;
+        }
+      ctx->current_sel_entry = list_next (ctx->sel_entries_itr);
+    }
+  ctx->sel_entries_loaded = 1;
+
+  ctx->errnum = IPMI_SEL_ERR_SUCCESS;
+ cleanup:
+  ctx->callback_sel_entry = NULL;
+  free (sel_entry);
+  return (rv);
+}
+
 int
 ipmi_sel_parse_first (ipmi_sel_ctx_t ctx)
 {
@@ -79,7 +79,7 @@ ipmi_lan_check_session_id (fiid_obj_t obj_lan_session_hdr, uint32_t session_id)
   uint32_t session_id_recv;
   uint64_t val;
 
-  if (fiid_obj_valid (obj_lan_session_hdr))
+  if (!fiid_obj_valid (obj_lan_session_hdr))
     {
       SET_ERRNO (EINVAL);
       return (-1);
@@ -199,7 +199,14 @@ ipmi_lan_check_session_authentication_code (fiid_obj_t obj_lan_session_hdr_rs,
     }
 
   if (authentication_type == IPMI_AUTHENTICATION_TYPE_STRAIGHT_PASSWORD_KEY)
-    memcpy (authentication_code_calc, authentication_code_data, authentication_code_data_len);
+    {
+      /* Must zero extend password, the received code is always
+       * IPMI_1_5_MAX_PASSWORD_LENGTH bytes
+       */
+      memset (authentication_code_calc, '\0', IPMI_1_5_MAX_PASSWORD_LENGTH);
+      if (authentication_code_data)
+        memcpy (authentication_code_calc, authentication_code_data, authentication_code_data_len);
+    }
   else if (authentication_type == IPMI_AUTHENTICATION_TYPE_MD2
            || authentication_type == IPMI_AUTHENTICATION_TYPE_MD5)
     {
@@ -495,6 +502,10 @@ ipmi_lan_check_packet_session_authentication_code (const void *pkt,
   else /* authentication_type == IPMI_AUTHENTICATION_TYPE_STRAIGHT_PASSWORD_KEY
       || authentication_type == IPMI_AUTHENTICATION_TYPE_OEM_PROP */
     {
+      /* Must zero extend password, the received code is always
+       * IPMI_1_5_MAX_PASSWORD_LENGTH bytes
+       */
+      memset (authentication_code_buf, '\0', IPMI_1_5_MAX_PASSWORD_LENGTH);
       if (authentication_code_data)
         memcpy (authentication_code_buf, authentication_code_data, authentication_code_data_len);
     }
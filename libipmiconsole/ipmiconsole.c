@@ -73,6 +73,7 @@
 #include "network.h"
 #include "parse-common.h"
 #include "secure.h"
+#include "timeval.h"
 
 /*
  * ipmi console errmsgs
@@ -120,6 +121,9 @@ static char *ipmiconsole_errmsgs[] =
 #define IPMICONSOLE_ENGINE_LOCK_MEMORY_STR                "lockmemory"
 #define IPMICONSOLE_ENGINE_SERIAL_KEEPALIVE_STR           "serialkeepalive"
 #define IPMICONSOLE_ENGINE_SERIAL_KEEPALIVE_EMPTY_STR     "serialkeepaliveempty"
+#define IPMICONSOLE_ENGINE_ADAPTIVE_RETRANSMISSION_STR    "adaptiveretransmission"
+#define IPMICONSOLE_ENGINE_COALESCE_INPUT_STR             "coalesceinput"
+#define IPMICONSOLE_ENGINE_THROUGHPUT_STR                 "throughput"
 
 #define IPMICONSOLE_BEHAVIOR_ERROR_ON_SOL_INUSE_STR       "erroronsolinuse"
 #define IPMICONSOLE_BEHAVIOR_DEACTIVATE_ONLY_STR          "deactivateonly"
@@ -160,6 +164,33 @@ _config_file_unsigned_int_positive (conffile_t cf,
   return (0);
 }
 
+static int
+_config_file_unsigned_int (conffile_t cf,
+                           struct conffile_data *data,
+                           char *optionname,
+                           int option_type,
+                           void *option_ptr,
+                           int option_data,
+                           void *app_ptr,
+                           int app_data)
+{
+  unsigned int *value;
+
+  assert (data);
+  assert (option_ptr);
+
+  value = (unsigned int *)option_ptr;
+
+  if (data->intval < 0)
+    {
+      IPMICONSOLE_DEBUG (("libipmiconsole config file %s invalid", optionname));
+      return (0);
+    }
+
+  *value = (unsigned int)data->intval;
+  return (0);
+}
+
 static int
 _config_file_username (conffile_t cf,
                        struct conffile_data *data,
@@ -382,6 +413,12 @@ _config_file_engine_flags (conffile_t cf,
         engine_flags |= IPMICONSOLE_ENGINE_SERIAL_KEEPALIVE;
       else if (!strcasecmp (data->stringlist[i], IPMICONSOLE_ENGINE_SERIAL_KEEPALIVE_EMPTY_STR))
         engine_flags |= IPMICONSOLE_ENGINE_SERIAL_KEEPALIVE_EMPTY;
+      else if (!strcasecmp (data->stringlist[i], IPMICONSOLE_ENGINE_ADAPTIVE_RETRANSMISSION_STR))
+        engine_flags |= IPMICONSOLE_ENGINE_ADAPTIVE_RETRANSMISSION;
+      else if (!strcasecmp (data->stringlist[i], IPMICONSOLE_ENGINE_COALESCE_INPUT_STR))
+        engine_flags |= IPMICONSOLE_ENGINE_COALESCE_INPUT;
+      else if (!strcasecmp (data->stringlist[i], IPMICONSOLE_ENGINE_THROUGHPUT_STR))
+        engine_flags |= IPMICONSOLE_ENGINE_THROUGHPUT;
       else
         IPMICONSOLE_DEBUG (("libipmiconsole config file engine flag invalid"));
     }
@@ -507,7 +544,11 @@ _ipmiconsole_defaults_setup (void)
     libipmiconsole_context_engine_flags_count = 0,
     libipmiconsole_context_behavior_flags_count = 0,
     libipmiconsole_context_debug_flags_count = 0,
-    libipmiconsole_context_sol_payload_instance_count = 0;
+    libipmiconsole_context_sol_payload_instance_count = 0,
+    libipmiconsole_engine_handshakes_max_count = 0,
+    libipmiconsole_engine_subnet_handshake_rate_count = 0;
+  unsigned int handshakes_max = IPMICONSOLE_HANDSHAKES_MAX_DEFAULT;
+  unsigned int subnet_handshake_rate = IPMICONSOLE_SUBNET_HANDSHAKE_RATE_DEFAULT;
 
   struct conffile_option libipmiconsole_options[] =
     {
@@ -698,6 +739,28 @@ _ipmiconsole_defaults_setup (void)
         &(default_config.sol_payload_instance),
         0
       },
+      {
+        "libipmiconsole-engine-handshakes-max",
+        CONFFILE_OPTION_INT,
+        -1,
+        _config_file_unsigned_int,
+        1,
+        0,
+        &libipmiconsole_engine_handshakes_max_count,
+        &handshakes_max,
+        0
+      },
+      {
+        "libipmiconsole-engine-subnet-handshake-rate",
+        CONFFILE_OPTION_INT,
+        -1,
+        _config_file_unsigned_int,
+        1,
+        0,
+        &libipmiconsole_engine_subnet_handshake_rate_count,
+        &subnet_handshake_rate,
+        0
+      },
     };
 
   conffile_t cf = NULL;
@@ -748,6 +811,8 @@ _ipmiconsole_defaults_setup (void)
     }
 
  out:
+  if (ipmiconsole_engine_set_handshake_limits (handshakes_max, subnet_handshake_rate) < 0)
+    goto cleanup;
   rv = 0;
  cleanup:
   conffile_handle_destroy (cf);
@@ -838,12 +903,9 @@ ipmiconsole_engine_submit (ipmiconsole_ctx_t c,
                                           callback_arg) < 0)
     goto cleanup;
 
-  /* session setup required before connection setup, so
-   * connection knows if IPv4 or IPv6 used
+  /* Hostname resolution, session setup, and the IPMI connection
+   * setup are done in the engine, so submission is quick.
    */
-  if (ipmiconsole_ctx_session_setup (c) < 0)
-    goto cleanup;
-
   if (ipmiconsole_ctx_connection_setup (c) < 0)
     goto cleanup;
 
@@ -1073,12 +1135,9 @@ ipmiconsole_engine_submit_block (ipmiconsole_ctx_t c)
   /* Set to success, so we know if an IPMI error occurred later */
   ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
 
-  /* session setup required before connection setup, so
-   * connection knows if IPv4 or IPv6 used
+  /* Hostname resolution, session setup, and the IPMI connection
+   * setup are done in the engine, so submission is quick.
    */
-  if (ipmiconsole_ctx_session_setup (c) < 0)
-    goto cleanup;
-
   if (ipmiconsole_ctx_connection_setup (c) < 0)
     goto cleanup;
 
@@ -1147,6 +1206,37 @@ ipmiconsole_engine_submit_block (ipmiconsole_ctx_t c)
   return (-1);
 }
 
+int
+ipmiconsole_engine_handshake_limits (unsigned int handshakes_max,
+                                     unsigned int subnet_handshake_rate)
+{
+  if (!ipmiconsole_engine_is_setup ())
+    {
+      errno = EAGAIN;
+      return (-1);
+    }
+
+  return (ipmiconsole_engine_set_handshake_limits (handshakes_max, subnet_handshake_rate));
+}
+
+int
+ipmiconsole_engine_stats (struct ipmiconsole_engine_stats *stats)
+{
+  if (!stats)
+    {
+      errno = EINVAL;
+      return (-1);
+    }
+
+  if (!ipmiconsole_engine_is_setup ())
+    {
+      errno = EAGAIN;
+      return (-1);
+    }
+
+  return (ipmiconsole_engine_get_stats (stats));
+}
+
 void
 ipmiconsole_engine_teardown (int cleanup_sol_sessions)
 {
@@ -1332,7 +1422,8 @@ ipmiconsole_ctx_set_config (ipmiconsole_ctx_t c,
       || c->api_magic != IPMICONSOLE_CTX_API_MAGIC)
     return (-1);
 
-  if ((config_option != IPMICONSOLE_CTX_CONFIG_OPTION_SOL_PAYLOAD_INSTANCE)
+  if ((config_option != IPMICONSOLE_CTX_CONFIG_OPTION_SOL_PAYLOAD_INSTANCE
+       && config_option != IPMICONSOLE_CTX_CONFIG_OPTION_HISTORY_SIZE)
       || !config_option_value)
     {
       ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_PARAMETERS);
@@ -1356,6 +1447,16 @@ ipmiconsole_ctx_set_config (ipmiconsole_ctx_t c,
         }
       c->config.sol_payload_instance = *(tmpptr);
       break;
+    case IPMICONSOLE_CTX_CONFIG_OPTION_HISTORY_SIZE:
+      tmpptr = (unsigned int *)config_option_value;
+      if (*tmpptr > IPMICONSOLE_HISTORY_SIZE_MAX)
+        {
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_PARAMETERS);
+          return (-1);
+        }
+      if (ipmiconsole_ctx_history_alloc (c, *tmpptr) < 0)
+        return (-1);
+      break;
     default:
       ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
       return (-1);
@@ -1377,7 +1478,8 @@ ipmiconsole_ctx_get_config (ipmiconsole_ctx_t c,
       || c->api_magic != IPMICONSOLE_CTX_API_MAGIC)
     return (-1);
 
-  if ((config_option != IPMICONSOLE_CTX_CONFIG_OPTION_SOL_PAYLOAD_INSTANCE)
+  if ((config_option != IPMICONSOLE_CTX_CONFIG_OPTION_SOL_PAYLOAD_INSTANCE
+       && config_option != IPMICONSOLE_CTX_CONFIG_OPTION_HISTORY_SIZE)
       || !config_option_value)
     {
       ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_PARAMETERS);
@@ -1390,6 +1492,10 @@ ipmiconsole_ctx_get_config (ipmiconsole_ctx_t c,
       tmpptr = (unsigned int *)config_option_value;
       (*tmpptr) = c->config.sol_payload_instance;
       break;
+    case IPMICONSOLE_CTX_CONFIG_OPTION_HISTORY_SIZE:
+      tmpptr = (unsigned int *)config_option_value;
+      (*tmpptr) = c->history.size;
+      break;
     default:
       ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
       return (-1);
@@ -1399,6 +1505,70 @@ ipmiconsole_ctx_get_config (ipmiconsole_ctx_t c,
   return (0);
 }
 
+int
+ipmiconsole_ctx_set_data_callback (ipmiconsole_ctx_t c,
+                                   Ipmiconsole_data_callback callback,
+                                   void *callback_arg)
+{
+  int secure_malloc_flag;
+  int perr;
+
+  if (!c
+      || c->magic != IPMICONSOLE_CTX_MAGIC
+      || c->api_magic != IPMICONSOLE_CTX_API_MAGIC)
+    return (-1);
+
+  if (!callback)
+    {
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_PARAMETERS);
+      return (-1);
+    }
+
+  if (c->session_submitted)
+    {
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_CTX_IS_SUBMITTED);
+      return (-1);
+    }
+
+  if (!c->fds.user_input)
+    {
+      secure_malloc_flag = (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY) ? 1 : 0;
+
+      if (!(c->fds.user_input = scbuf_create (CONSOLE_REMOTE_CONSOLE_TO_BMC_BUF_MIN, CONSOLE_REMOTE_CONSOLE_TO_BMC_BUF_MAX, secure_malloc_flag)))
+        {
+          IPMICONSOLE_DEBUG (("scbuf_create: %s", strerror (errno)));
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_OUT_OF_MEMORY);
+          return (-1);
+        }
+
+      /* Input the user cannot fit is reported back to the user, not lost */
+      if (scbuf_opt_set (c->fds.user_input, SCBUF_OPT_OVERWRITE, SCBUF_NO_DROP) < 0)
+        {
+          IPMICONSOLE_DEBUG (("scbuf_opt_set: %s", strerror (errno)));
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+          scbuf_destroy (c->fds.user_input, secure_malloc_flag);
+          c->fds.user_input = NULL;
+          return (-1);
+        }
+
+      if ((perr = pthread_mutex_init (&(c->fds.user_input_mutex), NULL)) != 0)
+        {
+          IPMICONSOLE_DEBUG (("pthread_mutex_init: %s", strerror (perr)));
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+          scbuf_destroy (c->fds.user_input, secure_malloc_flag);
+          c->fds.user_input = NULL;
+          return (-1);
+        }
+      c->fds.user_input_notified = 0;
+    }
+
+  c->config.data_callback = callback;
+  c->config.data_callback_arg = callback_arg;
+
+  ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
+  return (0);
+}
+
 int
 ipmiconsole_ctx_errnum (ipmiconsole_ctx_t c)
 {
@@ -1462,6 +1632,58 @@ ipmiconsole_ctx_status (ipmiconsole_ctx_t c)
   return (status);
 }
 
+int
+ipmiconsole_ctx_stats (ipmiconsole_ctx_t c,
+                       struct ipmiconsole_ctx_stats *stats)
+{
+  struct timeval last_ipmi_packet_received, current, delta;
+  int perr;
+
+  if (!c
+      || c->magic != IPMICONSOLE_CTX_MAGIC
+      || c->api_magic != IPMICONSOLE_CTX_API_MAGIC)
+    return (-1);
+
+  if (!stats)
+    {
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_PARAMETERS);
+      return (-1);
+    }
+
+  if ((perr = pthread_mutex_lock (&(c->signal.stats_mutex))) != 0)
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  memcpy (stats, &(c->signal.stats), sizeof (struct ipmiconsole_ctx_stats));
+  last_ipmi_packet_received = c->signal.stats_last_ipmi_packet_received;
+
+  if ((perr = pthread_mutex_unlock (&(c->signal.stats_mutex))) != 0)
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  if (gettimeofday (&current, NULL) < 0)
+    {
+      IPMICONSOLE_DEBUG (("gettimeofday: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+      return (-1);
+    }
+
+  if (timeval_gt (&current, &last_ipmi_packet_received))
+    {
+      timeval_sub (&current, &last_ipmi_packet_received, &delta);
+      timeval_millisecond_calc (&delta, &stats->last_ipmi_packet_received_ms);
+    }
+
+  ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
+  return (0);
+}
+
 int
 ipmiconsole_ctx_fd (ipmiconsole_ctx_t c)
 {
@@ -1476,11 +1698,161 @@ ipmiconsole_ctx_fd (ipmiconsole_ctx_t c)
       return (-1);
     }
 
+  if (c->config.data_callback)
+    {
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_PARAMETERS);
+      return (-1);
+    }
+
   ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
   c->fds.user_fd_retrieved++;
   return (c->fds.user_fd);
 }
 
+int
+ipmiconsole_ctx_write (ipmiconsole_ctx_t c,
+                       const void *buf,
+                       unsigned int buflen)
+{
+  int secure_malloc_flag;
+  int notify = 0;
+  int n, perr;
+
+  if (!c
+      || c->magic != IPMICONSOLE_CTX_MAGIC
+      || c->api_magic != IPMICONSOLE_CTX_API_MAGIC)
+    return (-1);
+
+  if (!buf
+      || buflen > INT_MAX
+      || !c->config.data_callback)
+    {
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_PARAMETERS);
+      return (-1);
+    }
+
+  if (!c->session_submitted)
+    {
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_CTX_NOT_SUBMITTED);
+      return (-1);
+    }
+
+  if (!buflen)
+    {
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
+      return (0);
+    }
+
+  secure_malloc_flag = (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY) ? 1 : 0;
+
+  if ((perr = pthread_mutex_lock (&(c->fds.user_input_mutex))) != 0)
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  if ((n = scbuf_write (c->fds.user_input, (void *)buf, buflen, NULL, secure_malloc_flag)) < 0)
+    {
+      if (errno == ENOSPC)
+        n = 0;
+      else
+        {
+          IPMICONSOLE_DEBUG (("scbuf_write: %s", strerror (errno)));
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+          goto cleanup;
+        }
+    }
+
+  /* Only one wakeup is needed until the engine drains the buffer */
+  if (n && !c->fds.user_input_notified)
+    {
+      c->fds.user_input_notified++;
+      notify++;
+    }
+
+ cleanup:
+  if ((perr = pthread_mutex_unlock (&(c->fds.user_input_mutex))) != 0)
+    IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+
+  if (n < 0)
+    return (-1);
+
+  if (notify)
+    {
+      uint8_t tmpbyte = IPMICONSOLE_PIPE_CONSOLE_DATA_CODE;
+
+      if (write (c->fds.asynccomm[1], &tmpbyte, 1) < 0)
+        {
+          IPMICONSOLE_DEBUG (("write: %s", strerror (errno)));
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+          return (-1);
+        }
+    }
+
+  ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
+  return (n);
+}
+
+static int
+_ipmiconsole_ctx_history (ipmiconsole_ctx_t c,
+                          int last,
+                          uint64_t sequence,
+                          void *buf,
+                          unsigned int buflen,
+                          uint64_t *next_sequence)
+{
+  int n;
+
+  if (!c
+      || c->magic != IPMICONSOLE_CTX_MAGIC
+      || c->api_magic != IPMICONSOLE_CTX_API_MAGIC)
+    return (-1);
+
+  if (!buf
+      || buflen > INT_MAX)
+    {
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_PARAMETERS);
+      return (-1);
+    }
+
+  if (!c->session_submitted)
+    {
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_CTX_NOT_SUBMITTED);
+      return (-1);
+    }
+
+  if ((n = ipmiconsole_ctx_history_read (c,
+                                         last,
+                                         sequence,
+                                         buf,
+                                         buflen,
+                                         next_sequence)) < 0)
+    return (-1);
+
+  ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
+  return (n);
+}
+
+int
+ipmiconsole_ctx_history_last (ipmiconsole_ctx_t c,
+                              void *buf,
+                              unsigned int buflen,
+                              uint64_t *next_sequence)
+{
+  return (_ipmiconsole_ctx_history (c, 1, 0, buf, buflen, next_sequence));
+}
+
+int
+ipmiconsole_ctx_history_since (ipmiconsole_ctx_t c,
+                               uint64_t sequence,
+                               void *buf,
+                               unsigned int buflen,
+                               uint64_t *next_sequence)
+{
+  return (_ipmiconsole_ctx_history (c, 0, sequence, buf, buflen, next_sequence));
+}
+
 int
 ipmiconsole_ctx_generate_break (ipmiconsole_ctx_t c)
 {
@@ -65,6 +65,7 @@
 
 #include "ipmiconsole_ctx.h"
 #include "ipmiconsole_debug.h"
+#include "ipmiconsole_engine.h"
 #include "ipmiconsole_util.h"
 #include "scbuf.h"
 
@@ -97,6 +98,13 @@ ipmiconsole_ctx_setup (ipmiconsole_ctx_t c)
       return (-1);
     }
 
+  if ((perr = pthread_mutex_init (&(c->history.mutex), NULL)) != 0)
+    {
+      pthread_mutex_destroy (&(c->errnum_mutex));
+      errno = perr;
+      return (-1);
+    }
+
   ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
 
   return (0);
@@ -108,6 +116,19 @@ ipmiconsole_ctx_cleanup (ipmiconsole_ctx_t c)
   assert (c);
   assert (c->magic == IPMICONSOLE_CTX_MAGIC);
 
+  /* Shared by the API and the engine, so cannot be destroyed until
+   * both are done with the context.
+   */
+  if (c->fds.user_input)
+    {
+      scbuf_destroy (c->fds.user_input, (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY) ? 1 : 0);
+      c->fds.user_input = NULL;
+      pthread_mutex_destroy (&(c->fds.user_input_mutex));
+    }
+
+  ipmiconsole_ctx_history_free (c);
+  pthread_mutex_destroy (&(c->history.mutex));
+
   /* don't call ctx_set_errnum after the mutex_destroy */
   ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_CTX_INVALID);
   pthread_mutex_destroy (&(c->errnum_mutex));
@@ -444,6 +465,15 @@ ipmiconsole_ctx_signal_setup (ipmiconsole_ctx_t c)
     }
   c->signal.ctx_state = IPMICONSOLE_CTX_STATE_INIT;
 
+  if ((perr = pthread_mutex_init (&c->signal.stats_mutex, NULL)) != 0)
+    {
+      errno = perr;
+      return (-1);
+    }
+  memset (&c->signal.stats, '\0', sizeof (struct ipmiconsole_ctx_stats));
+  if (gettimeofday (&c->signal.stats_last_ipmi_packet_received, NULL) < 0)
+    return (-1);
+
   return (0);
 }
 
@@ -455,6 +485,7 @@ ipmiconsole_ctx_signal_cleanup (ipmiconsole_ctx_t c)
 
   pthread_mutex_destroy (&(c->signal.status_mutex));
   pthread_mutex_destroy (&(c->signal.mutex_ctx_state));
+  pthread_mutex_destroy (&(c->signal.stats_mutex));
 }
 
 int
@@ -504,21 +535,12 @@ ipmiconsole_ctx_blocking_cleanup (ipmiconsole_ctx_t c)
 int
 ipmiconsole_ctx_connection_setup (ipmiconsole_ctx_t c)
 {
-  struct sockaddr *srcaddr;
-  socklen_t srcaddr_len;
-  struct sockaddr_in srcaddr4;
-  struct sockaddr_in6 srcaddr6;
-  int domain;
   int sv[2];
-  int secure_malloc_flag;
 
   assert (c);
   assert (c->magic == IPMICONSOLE_CTX_MAGIC);
   assert (!(c->session_submitted));
 
-  /* session info must be setup first so we know how to setup IPv4 vs IPv6 */
-  assert (c->session.session_info_setup);
-
   memset (&(c->connection), '\0', sizeof (struct ipmiconsole_ctx_connection));
   c->connection.user_fd = -1;
   c->connection.ipmiconsole_fd = -1;
@@ -526,34 +548,95 @@ ipmiconsole_ctx_connection_setup (ipmiconsole_ctx_t c)
   c->connection.asynccomm[0] = -1;
   c->connection.asynccomm[1] = -1;
 
-  /* File Descriptor User Interface */
+  /* File Descriptor User Interface
+   *
+   * Not needed if console data is passed through a data callback and
+   * ipmiconsole_ctx_write().
+   */
+
+  if (!c->config.data_callback)
+    {
+      if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+        {
+          IPMICONSOLE_DEBUG (("socketpair: %s", strerror (errno)));
+          if (errno == EMFILE)
+            ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_TOO_MANY_OPEN_FILES);
+          else
+            ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+          goto cleanup;
+        }
+      c->connection.user_fd = sv[0];
+      c->connection.ipmiconsole_fd = sv[1];
+
+      if (ipmiconsole_set_closeonexec (c, c->connection.user_fd) < 0)
+        {
+          IPMICONSOLE_DEBUG (("closeonexec error"));
+          goto cleanup;
+        }
+      if (ipmiconsole_set_closeonexec (c, c->connection.ipmiconsole_fd) < 0)
+        {
+          IPMICONSOLE_DEBUG (("closeonexec error"));
+          goto cleanup;
+        }
 
-  if (socketpair (AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+      /* Copy for API level */
+      c->fds.user_fd = c->connection.user_fd;
+      c->fds.user_fd_retrieved = 0;
+    }
+
+  /* Pipe for non-fd communication */
+  if (pipe (c->connection.asynccomm) < 0)
     {
-      IPMICONSOLE_DEBUG (("socketpair: %s", strerror (errno)));
+      IPMICONSOLE_DEBUG (("pipe: %s", strerror (errno)));
       if (errno == EMFILE)
         ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_TOO_MANY_OPEN_FILES);
       else
         ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
       goto cleanup;
     }
-  c->connection.user_fd = sv[0];
-  c->connection.ipmiconsole_fd = sv[1];
 
-  if (ipmiconsole_set_closeonexec (c, c->connection.user_fd) < 0)
+  if (ipmiconsole_set_closeonexec (c, c->connection.asynccomm[0]) < 0)
     {
       IPMICONSOLE_DEBUG (("closeonexec error"));
       goto cleanup;
     }
-  if (ipmiconsole_set_closeonexec (c, c->connection.ipmiconsole_fd) < 0)
+
+  if (ipmiconsole_set_closeonexec (c, c->connection.asynccomm[1]) < 0)
     {
       IPMICONSOLE_DEBUG (("closeonexec error"));
       goto cleanup;
     }
 
   /* Copy for API level */
-  c->fds.user_fd = c->connection.user_fd;
-  c->fds.user_fd_retrieved = 0;
+  c->fds.asynccomm[0] = c->connection.asynccomm[0];
+  c->fds.asynccomm[1] = c->connection.asynccomm[1];
+
+  return (0);
+
+ cleanup:
+  /* Previously called here, but this is now supposed to be handled in API land */
+  /* ipmiconsole_ctx_connection_cleanup(c) */
+  /* _ipmiconsole_ctx_fds_cleanup(c); */
+  /* _ipmiconsole_ctx_fds_setup(c); */
+  return (-1);
+}
+
+int
+ipmiconsole_ctx_connection_ipmi_setup (ipmiconsole_ctx_t c)
+{
+  struct sockaddr *srcaddr;
+  socklen_t srcaddr_len;
+  struct sockaddr_in srcaddr4;
+  struct sockaddr_in6 srcaddr6;
+  int domain;
+  int console_bmc_to_remote_console_buf_max;
+  int secure_malloc_flag;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  /* session info must be setup first so we know how to setup IPv4 vs IPv6 */
+  assert (c->session.session_info_setup);
 
   secure_malloc_flag = (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY) ? 1 : 0;
 
@@ -564,11 +647,20 @@ ipmiconsole_ctx_connection_setup (ipmiconsole_ctx_t c)
       goto cleanup;
     }
 
-  if (!(c->connection.console_bmc_to_remote_console = scbuf_create (CONSOLE_BMC_TO_REMOTE_CONSOLE_BUF_MIN, CONSOLE_BMC_TO_REMOTE_CONSOLE_BUF_MAX, secure_malloc_flag)))
+  /* Console output is passed directly to the data callback if set */
+  if (!c->config.data_callback)
     {
-      IPMICONSOLE_DEBUG (("scbuf_create: %s", strerror (errno)));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_OUT_OF_MEMORY);
-      goto cleanup;
+      if (c->config.engine_flags & IPMICONSOLE_ENGINE_THROUGHPUT)
+        console_bmc_to_remote_console_buf_max = CONSOLE_BMC_TO_REMOTE_CONSOLE_BUF_MAX_THROUGHPUT;
+      else
+        console_bmc_to_remote_console_buf_max = CONSOLE_BMC_TO_REMOTE_CONSOLE_BUF_MAX;
+
+      if (!(c->connection.console_bmc_to_remote_console = scbuf_create (CONSOLE_BMC_TO_REMOTE_CONSOLE_BUF_MIN, console_bmc_to_remote_console_buf_max, secure_malloc_flag)))
+        {
+          IPMICONSOLE_DEBUG (("scbuf_create: %s", strerror (errno)));
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_OUT_OF_MEMORY);
+          goto cleanup;
+        }
     }
 
   /* Connection Data */
@@ -629,33 +721,6 @@ ipmiconsole_ctx_connection_setup (ipmiconsole_ctx_t c)
       goto cleanup;
     }
 
-  /* Pipe for non-fd communication */
-  if (pipe (c->connection.asynccomm) < 0)
-    {
-      IPMICONSOLE_DEBUG (("pipe: %s", strerror (errno)));
-      if (errno == EMFILE)
-        ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_TOO_MANY_OPEN_FILES);
-      else
-        ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
-      goto cleanup;
-    }
-
-  if (ipmiconsole_set_closeonexec (c, c->connection.asynccomm[0]) < 0)
-    {
-      IPMICONSOLE_DEBUG (("closeonexec error"));
-      goto cleanup;
-    }
-
-  if (ipmiconsole_set_closeonexec (c, c->connection.asynccomm[1]) < 0)
-    {
-      IPMICONSOLE_DEBUG (("closeonexec error"));
-      goto cleanup;
-    }
-
-  /* Copy for API level */
-  c->fds.asynccomm[0] = c->connection.asynccomm[0];
-  c->fds.asynccomm[1] = c->connection.asynccomm[1];
-
   /* Fiid Objects */
 
   if (!(c->connection.obj_rmcp_hdr_rq = fiid_obj_create (tmpl_rmcp_hdr)))
@@ -948,6 +1013,11 @@ __ipmiconsole_ctx_connection_cleanup (ipmiconsole_ctx_t c, int session_submitted
       && c->non_blocking.callback)
     (*(c->non_blocking.callback))(c->non_blocking.callback_arg);
 
+  /* Let the data callback know no more console data is coming */
+  if (session_submitted
+      && c->config.data_callback)
+    (*(c->config.data_callback))(NULL, 0, c->config.data_callback_arg);
+
   /* Under default circumstances, close only the ipmiconsole_fd so
    * that an error will be detected by the user via a EOF on a read()
    * or EPIPE on a write() when reading/writing on their file
@@ -1087,6 +1157,9 @@ __ipmiconsole_ctx_connection_cleanup (ipmiconsole_ctx_t c, int session_submitted
   if (!session_submitted)
     return;
 
+  /* Session may have ended before SOL was established */
+  ipmiconsole_engine_handshake_release (c);
+
   /* Be careful, if the user requested to destroy the context, we can
    * destroy it here.  But if we destroy it, there is no mutex to
    * unlock.
@@ -1202,6 +1275,11 @@ ipmiconsole_ctx_session_setup (ipmiconsole_ctx_t c)
       goto cleanup;
     }
 
+  c->session.srtt = 0;
+  c->session.rttvar = 0;
+  c->session.rto = 0;
+  c->session.rtt_sample_count = 0;
+
   memset (port_str, '\0', MAXPORTBUFLEN + 1);
   snprintf (port_str, MAXPORTBUFLEN, "%d", c->session.console_port);
   memset (&ai_hints, 0, sizeof (struct addrinfo));
@@ -1337,7 +1415,9 @@ ipmiconsole_ctx_session_setup (ipmiconsole_ctx_t c)
   /* SOL Input (remote console to BMC) */
   c->session.sol_input_waiting_for_ack = 0;
   c->session.sol_input_waiting_for_break_ack = 0;
+  c->session.sol_input_retransmitted = 0;
   timeval_clear (&(c->session.last_sol_input_packet_sent));
+  timeval_clear (&(c->session.sol_input_coalesce_start));
   c->session.sol_input_packet_sequence_number = 0; /* 0, so initial increment puts it at 1 */
   memset (c->session.sol_input_character_data, '\0', IPMICONSOLE_MAX_CHARACTER_DATA+1);
   c->session.sol_input_character_data_len = 0;
@@ -1354,6 +1434,178 @@ ipmiconsole_ctx_session_setup (ipmiconsole_ctx_t c)
   return (rv);
 }
 
+int
+ipmiconsole_ctx_history_alloc (ipmiconsole_ctx_t c, unsigned int size)
+{
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+  assert (!(c->session_submitted));
+  assert (size <= IPMICONSOLE_HISTORY_SIZE_MAX);
+
+  ipmiconsole_ctx_history_free (c);
+
+  if (!size)
+    return (0);
+
+  if (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY)
+    c->history.buf = (uint8_t *)secure_malloc (size);
+  else
+    c->history.buf = (uint8_t *)malloc (size);
+
+  if (!c->history.buf)
+    {
+      IPMICONSOLE_DEBUG (("malloc: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_OUT_OF_MEMORY);
+      return (-1);
+    }
+
+  c->history.size = size;
+  return (0);
+}
+
+void
+ipmiconsole_ctx_history_free (ipmiconsole_ctx_t c)
+{
+  assert (c);
+
+  if (!c->history.buf)
+    return;
+
+  if (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY)
+    secure_free (c->history.buf, c->history.size);
+  else
+    free (c->history.buf);
+
+  c->history.buf = NULL;
+  c->history.size = 0;
+  c->history.sequence = 0;
+}
+
+void
+ipmiconsole_ctx_history_write (ipmiconsole_ctx_t c, const void *buf, unsigned int buflen)
+{
+  const uint8_t *ptr = buf;
+  unsigned int offset, len;
+  int perr;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+  assert (buf);
+
+  if (!c->history.buf)
+    return;
+
+  /* Only the most recent output fits, so skip the rest */
+  if (buflen > c->history.size)
+    {
+      ptr += buflen - c->history.size;
+      len = c->history.size;
+    }
+  else
+    len = buflen;
+
+  /* The history is only informational, so locking errors are not fatal */
+  if ((perr = pthread_mutex_lock (&(c->history.mutex))) != 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_lock: %s", strerror (perr)));
+      return;
+    }
+
+  c->history.sequence += buflen - len;
+
+  while (len)
+    {
+      unsigned int n;
+
+      offset = c->history.sequence % c->history.size;
+      n = c->history.size - offset;
+      if (n > len)
+        n = len;
+
+      memcpy (c->history.buf + offset, ptr, n);
+      ptr += n;
+      len -= n;
+      c->history.sequence += n;
+    }
+
+  if ((perr = pthread_mutex_unlock (&(c->history.mutex))) != 0)
+    IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_unlock: %s", strerror (perr)));
+}
+
+int
+ipmiconsole_ctx_history_read (ipmiconsole_ctx_t c,
+                              int last,
+                              uint64_t sequence,
+                              void *buf,
+                              unsigned int buflen,
+                              uint64_t *next_sequence)
+{
+  uint8_t *ptr = buf;
+  uint64_t oldest;
+  unsigned int count, len;
+  int perr;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+  assert (buf);
+
+  if ((perr = pthread_mutex_lock (&(c->history.mutex))) != 0)
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  if (c->history.sequence > c->history.size)
+    oldest = c->history.sequence - c->history.size;
+  else
+    oldest = 0;
+
+  if (last)
+    {
+      if (c->history.sequence - oldest > buflen)
+        sequence = c->history.sequence - buflen;
+      else
+        sequence = oldest;
+    }
+  else
+    {
+      if (sequence < oldest)
+        sequence = oldest;
+      else if (sequence > c->history.sequence)
+        sequence = c->history.sequence;
+    }
+
+  if (c->history.sequence - sequence > buflen)
+    count = buflen;
+  else
+    count = c->history.sequence - sequence;
+
+  len = count;
+  while (len)
+    {
+      unsigned int offset, n;
+
+      offset = sequence % c->history.size;
+      n = c->history.size - offset;
+      if (n > len)
+        n = len;
+
+      memcpy (ptr, c->history.buf + offset, n);
+      ptr += n;
+      len -= n;
+      sequence += n;
+    }
+
+  if (next_sequence)
+    *next_sequence = sequence;
+
+  if ((perr = pthread_mutex_unlock (&(c->history.mutex))) != 0)
+    IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+
+  return (count);
+}
+
 void
 ipmiconsole_ctx_fds_setup (ipmiconsole_ctx_t c)
 {
@@ -1365,6 +1617,8 @@ ipmiconsole_ctx_fds_setup (ipmiconsole_ctx_t c)
   c->fds.user_fd_retrieved = 0;
   c->fds.asynccomm[0] = -1;
   c->fds.asynccomm[1] = -1;
+  c->fds.user_input = NULL;
+  c->fds.user_input_notified = 0;
 }
 
 void
@@ -61,14 +61,39 @@ int ipmiconsole_ctx_blocking_setup (ipmiconsole_ctx_t c);
 
 void ipmiconsole_ctx_blocking_cleanup (ipmiconsole_ctx_t c);
 
+/* Sets up the user and asynccomm file descriptors, the remainder of
+ * the connection is setup by the engine via
+ * ipmiconsole_ctx_connection_ipmi_setup().
+ */
 int ipmiconsole_ctx_connection_setup (ipmiconsole_ctx_t c);
 
+int ipmiconsole_ctx_connection_ipmi_setup (ipmiconsole_ctx_t c);
+
 void ipmiconsole_ctx_connection_cleanup_session_submitted (ipmiconsole_ctx_t c);
 
 void ipmiconsole_ctx_connection_cleanup_session_not_submitted (ipmiconsole_ctx_t c);
 
 int ipmiconsole_ctx_session_setup (ipmiconsole_ctx_t c);
 
+/* Must be called before the context is submitted, a size of 0
+ * disables the history.
+ */
+int ipmiconsole_ctx_history_alloc (ipmiconsole_ctx_t c, unsigned int size);
+
+void ipmiconsole_ctx_history_free (ipmiconsole_ctx_t c);
+
+void ipmiconsole_ctx_history_write (ipmiconsole_ctx_t c, const void *buf, unsigned int buflen);
+
+/* If last is set, reads the last buflen bytes, otherwise reads from
+ * sequence.  Returns bytes read or -1 on error.
+ */
+int ipmiconsole_ctx_history_read (ipmiconsole_ctx_t c,
+                                  int last,
+                                  uint64_t sequence,
+                                  void *buf,
+                                  unsigned int buflen,
+                                  uint64_t *next_sequence);
+
 void ipmiconsole_ctx_fds_setup (ipmiconsole_ctx_t c);
 
 void ipmiconsole_ctx_fds_cleanup (ipmiconsole_ctx_t c);
@@ -151,6 +151,22 @@ typedef enum
 #define IPMICONSOLE_RETRANSMISSION_KEEPALIVE_TIMEOUT_LENGTH_DEFAULT 5000
 #define IPMICONSOLE_ACCEPTABLE_PACKET_ERRORS_COUNT_DEFAULT          16
 #define IPMICONSOLE_MAXIMUM_RETRANSMISSION_COUNT_DEFAULT            16
+
+/* Lower bound on retransmission timeout w/ IPMICONSOLE_ENGINE_ADAPTIVE_RETRANSMISSION */
+#define IPMICONSOLE_ADAPTIVE_RETRANSMISSION_TIMEOUT_MIN             50
+
+/* Time character data may be buffered w/ IPMICONSOLE_ENGINE_COALESCE_INPUT */
+#define IPMICONSOLE_COALESCE_INPUT_TIMEOUT_LENGTH                   100
+
+/* Engine wide session establishment admission control, see
+ * ipmiconsole_engine_handshake_admit().  A subnet handshake rate of 0
+ * disables per subnet pacing.
+ */
+#define IPMICONSOLE_HANDSHAKES_MAX_DEFAULT                          64
+#define IPMICONSOLE_SUBNET_HANDSHAKE_RATE_DEFAULT                   0
+/* How often a context waiting for admission tries again */
+#define IPMICONSOLE_HANDSHAKE_RETRY_LENGTH                          50
+#define IPMICONSOLE_SUBNET_PACING_BUCKETS                           1024
 #define IPMI_PRIVILEGE_LEVEL_DEFAULT                                IPMI_PRIVILEGE_LEVEL_ADMIN
 #define IPMI_CIPHER_SUITE_ID_DEFAULT                                3
 #define IPMI_PAYLOAD_INSTANCE_DEFAULT                               1
@@ -160,6 +176,8 @@ typedef enum
 
 #define CONSOLE_BMC_TO_REMOTE_CONSOLE_BUF_MIN                 (1024*4)
 #define CONSOLE_BMC_TO_REMOTE_CONSOLE_BUF_MAX                 (1024*16)
+/* w/ IPMICONSOLE_ENGINE_THROUGHPUT, grows from BUF_MIN as needed */
+#define CONSOLE_BMC_TO_REMOTE_CONSOLE_BUF_MAX_THROUGHPUT      (1024*1024)
 
 #define IPMI_FROM_BMC_BUF_MIN                                 (1024*4)
 #define IPMI_FROM_BMC_BUF_MAX                                 (1024*16)
@@ -194,6 +212,13 @@ typedef enum
 #define IPMICONSOLE_MAX_CHARACTER_DATA        255
 
 #define IPMICONSOLE_PIPE_GENERATE_BREAK_CODE  0x01
+#define IPMICONSOLE_PIPE_CONSOLE_DATA_CODE    0x02
+
+/* File descriptors each context registers with its engine thread */
+#define IPMICONSOLE_ENGINE_FD_IPMI            0
+#define IPMICONSOLE_ENGINE_FD_ASYNCCOMM       1
+#define IPMICONSOLE_ENGINE_FD_CONSOLE         2
+#define IPMICONSOLE_ENGINE_FDS                3
 
 #define IPMICONSOLE_DEBUG_MASK         \
   (IPMICONSOLE_DEBUG_STDOUT            \
@@ -222,7 +247,10 @@ typedef enum
    | IPMICONSOLE_ENGINE_OUTPUT_ON_SOL_ESTABLISHED  \
    | IPMICONSOLE_ENGINE_LOCK_MEMORY                \
    | IPMICONSOLE_ENGINE_SERIAL_KEEPALIVE           \
-   | IPMICONSOLE_ENGINE_SERIAL_KEEPALIVE_EMPTY)
+   | IPMICONSOLE_ENGINE_SERIAL_KEEPALIVE_EMPTY     \
+   | IPMICONSOLE_ENGINE_ADAPTIVE_RETRANSMISSION    \
+   | IPMICONSOLE_ENGINE_COALESCE_INPUT             \
+   | IPMICONSOLE_ENGINE_THROUGHPUT)
 
 #define IPMICONSOLE_BEHAVIOR_MASK           \
   (IPMICONSOLE_BEHAVIOR_ERROR_ON_SOL_INUSE  \
@@ -263,6 +291,8 @@ struct ipmiconsole_ctx_config {
 
   /* advanced config */
   unsigned int sol_payload_instance;
+  Ipmiconsole_data_callback data_callback;
+  void *data_callback_arg;
 
   /* Data based on Configuration Parameters */
   uint8_t authentication_algorithm;
@@ -353,6 +383,12 @@ struct ipmiconsole_ctx_session {
   /* Serial keepalive timeout maintenance */
   struct timeval last_sol_packet_received;
 
+  /* Adaptive retransmission timeout maintenance, all in milliseconds */
+  unsigned int srtt;
+  unsigned int rttvar;
+  unsigned int rto;
+  unsigned int rtt_sample_count;
+
   /*
    * Protocol State Machine Variables
    */
@@ -412,7 +448,9 @@ struct ipmiconsole_ctx_session {
   /* SOL Input (remote console to BMC) */
   int sol_input_waiting_for_ack;
   int sol_input_waiting_for_break_ack;
+  int sol_input_retransmitted;
   struct timeval last_sol_input_packet_sent;
+  struct timeval sol_input_coalesce_start;
   uint8_t sol_input_packet_sequence_number;
   uint8_t sol_input_character_data[IPMICONSOLE_MAX_CHARACTER_DATA+1];
   unsigned int sol_input_character_data_len;
@@ -425,6 +463,40 @@ struct ipmiconsole_ctx_session {
   int session_info_setup;
 };
 
+/* Engine bookkeeping, only touched by the engine thread the context
+ * was submitted to.
+ */
+struct ipmiconsole_ctx_engine_fd {
+  struct ipmiconsole_ctx *c;
+  int fd;
+  /* events currently registered, 0 if not registered */
+  unsigned int events;
+};
+
+struct ipmiconsole_ctx_engine {
+  struct ipmiconsole_ctx_engine_fd fds[IPMICONSOLE_ENGINE_FDS];
+
+  /* When the context must next be processed, regardless of fd
+   * activity, i.e. the earliest session, retransmission, or
+   * keepalive timeout.
+   */
+  struct timeval timeout;
+  unsigned int timer_index;
+  int timer_queued;
+
+  /* Contexts with fd activity or an expired timeout */
+  int ready;
+  struct ipmiconsole_ctx *ready_next;
+
+  /* Times processed since the engine thread last balanced its load */
+  unsigned int activity;
+
+  /* Context holds one of the engine's handshake slots */
+  int handshake_admitted;
+  /* Context is waiting for admission */
+  int handshake_deferred;
+};
+
 /* Context debug stuff */
 struct ipmiconsole_ctx_debug {
   int debug_fd;
@@ -473,6 +545,12 @@ struct ipmiconsole_ctx_signal {
    */
   pthread_mutex_t mutex_ctx_state;
   ipmiconsole_ctx_state ctx_state;
+
+  /* Updated by the engine, read by the API via ipmiconsole_ctx_stats() */
+  pthread_mutex_t stats_mutex;
+  struct ipmiconsole_ctx_stats stats;
+  /* last_ipmi_packet_received_ms is calculated from this */
+  struct timeval stats_last_ipmi_packet_received;
 };
 
 /* non-blocking potential parameters */
@@ -528,6 +606,29 @@ struct ipmiconsole_ctx_fds {
   int user_fd;
   int user_fd_retrieved;        /* if user ever grabbed it */
   int asynccomm[2];
+
+  /* Console input written via ipmiconsole_ctx_write() when a data
+   * callback is used instead of the file descriptor.  Moved into
+   * console_remote_console_to_bmc by the engine.  user_input_notified
+   * indicates a wakeup is pending on asynccomm, so the user does not
+   * write a byte to the pipe for every ipmiconsole_ctx_write().
+   */
+  scbuf_t user_input;
+  pthread_mutex_t user_input_mutex;
+  int user_input_notified;
+};
+
+/* Console output history, written by the engine and read by the API.
+ * The ring is allocated before the context is submitted and is only
+ * freed with the context, so the user can read it after the SOL
+ * session has closed.
+ */
+struct ipmiconsole_ctx_history {
+  pthread_mutex_t mutex;
+  uint8_t *buf;
+  unsigned int size;
+  /* bytes of console output ever written, i.e. the next sequence number */
+  uint64_t sequence;
 };
 
 struct ipmiconsole_ctx {
@@ -557,6 +658,10 @@ struct ipmiconsole_ctx {
 
   struct ipmiconsole_ctx_fds fds;
 
+  struct ipmiconsole_ctx_history history;
+
+  struct ipmiconsole_ctx_engine engine;
+
   /* session_submitted - flag indicates context submitted to engine
    * successfully.  Does not indicate any state of success/failure for
    * either blocking or non-blocking submissions.  Primary used as a
@@ -41,6 +41,9 @@
 #endif /* HAVE_UNISTD_H */
 #include <sys/types.h>
 #include <sys/poll.h>
+#if HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif /* HAVE_SYS_EPOLL_H */
 #include <signal.h>
 #include <limits.h>
 #include <assert.h>
@@ -61,6 +64,7 @@
 #include "freeipmi-portability.h"
 #include "list.h"
 #include "secure.h"
+#include "timeval.h"
 
 /*
  * Locking notes:
@@ -83,6 +87,11 @@ static List console_engine_ctxs[IPMICONSOLE_THREAD_COUNT_MAX];
 static unsigned int console_engine_ctxs_count[IPMICONSOLE_THREAD_COUNT_MAX];
 static pthread_mutex_t console_engine_ctxs_mutex[IPMICONSOLE_THREAD_COUNT_MAX];
 
+/* Per thread statistics, protected by the ctxs mutex, see
+ * ipmiconsole_engine_get_stats().
+ */
+static struct ipmiconsole_engine_thread_stats console_engine_stats[IPMICONSOLE_THREAD_COUNT_MAX];
+
 /* In the core engine code, the poll() may sit for a large number of
  * seconds, waiting for the next event to happen.  In the meantime, a
  * user may have submitted a new context or wants to close the engine.
@@ -95,6 +104,40 @@ static pthread_mutex_t console_engine_ctxs_mutex[IPMICONSOLE_THREAD_COUNT_MAX];
 static int console_engine_ctxs_notifier[IPMICONSOLE_THREAD_COUNT_MAX][2];
 static unsigned int console_engine_ctxs_notifier_num = 0;
 
+#if HAVE_SYS_EPOLL_H
+/* Each engine thread waits on its own epoll instance, where the fds
+ * of its contexts and the read end of its notifier are registered.
+ * Submitted contexts are queued on console_engine_ctxs_new until the
+ * engine thread registers them.
+ */
+static int console_engine_epoll_fd[IPMICONSOLE_THREAD_COUNT_MAX];
+static List console_engine_ctxs_new[IPMICONSOLE_THREAD_COUNT_MAX];
+
+/* The number of times each engine thread processed its contexts
+ * during its last balance interval, protected by the ctxs mutex.  A
+ * thread busier than its peers migrates a busy context to the least
+ * loaded thread, so a few flooding consoles do not delay the
+ * interactive consoles sharing their thread.  See _engine_balance().
+ */
+static unsigned int console_engine_load[IPMICONSOLE_THREAD_COUNT_MAX];
+#endif /* HAVE_SYS_EPOLL_H */
+
+/* Engine wide admission control for session establishment, see
+ * ipmiconsole_engine_handshake_admit().  Protected by
+ * console_engine_handshakes_mutex, which is never held while another
+ * mutex is locked.
+ */
+struct _ipmiconsole_subnet_pacing {
+  struct timeval window_start;
+  unsigned int starts;
+};
+
+static unsigned int console_engine_handshakes = 0;
+static unsigned int console_engine_handshakes_max = IPMICONSOLE_HANDSHAKES_MAX_DEFAULT;
+static unsigned int console_engine_subnet_handshake_rate = IPMICONSOLE_SUBNET_HANDSHAKE_RATE_DEFAULT;
+static struct _ipmiconsole_subnet_pacing console_engine_subnet_pacing[IPMICONSOLE_SUBNET_PACING_BUCKETS];
+static pthread_mutex_t console_engine_handshakes_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /*
  * The engine is capable of "being finished" with a context before the
  * user has called ipmiconsole_ctx_destroy().  So we need to stick the
@@ -115,17 +158,31 @@ extern pthread_cond_t garbage_collector_active_cond;
 /* See comments below in _poll_setup(). */
 static int dummy_fd = -1;
 
+#if !HAVE_SYS_EPOLL_H
 struct _ipmiconsole_poll_data {
   struct pollfd *pfds;
   ipmiconsole_ctx_t *pfds_ctxs;
   unsigned int ctxs_len;
   unsigned int pfds_index;
 };
+#endif /* !HAVE_SYS_EPOLL_H */
 
 #define IPMICONSOLE_SPIN_WAIT_TIME 250000
 
 #define IPMICONSOLE_PIPE_BUFLEN 1024
 
+#define IPMICONSOLE_EPOLL_EVENTS_MAX     256
+
+#define IPMICONSOLE_TIMER_HEAP_SIZE_INIT 64
+
+/* in milliseconds */
+#define IPMICONSOLE_ENGINE_BALANCE_INTERVAL 1000
+
+/* Below this many context processings per balance interval, a thread
+ * is not busy enough to bother migrating contexts.
+ */
+#define IPMICONSOLE_ENGINE_BALANCE_LOAD_MIN 100
+
 static int
 _ipmiconsole_garbage_collector_create (void)
 {
@@ -217,10 +274,16 @@ ipmiconsole_engine_setup (unsigned int thread_count)
   memset (console_engine_ctxs, '\0', IPMICONSOLE_THREAD_COUNT_MAX * sizeof (List));
   memset (console_engine_ctxs_count, '\0', IPMICONSOLE_THREAD_COUNT_MAX * sizeof (unsigned int));
   memset (console_engine_ctxs_mutex, '\0', IPMICONSOLE_THREAD_COUNT_MAX * sizeof (pthread_mutex_t));
+  memset (console_engine_stats, '\0', IPMICONSOLE_THREAD_COUNT_MAX * sizeof (struct ipmiconsole_engine_thread_stats));
   for (i = 0; i < IPMICONSOLE_THREAD_COUNT_MAX; i++)
     {
       console_engine_ctxs_notifier[i][0] = -1;
       console_engine_ctxs_notifier[i][1] = -1;
+#if HAVE_SYS_EPOLL_H
+      console_engine_epoll_fd[i] = -1;
+      console_engine_ctxs_new[i] = NULL;
+      console_engine_load[i] = 0;
+#endif /* HAVE_SYS_EPOLL_H */
     }
   garbage_collector_notifier[0] = -1;
   garbage_collector_notifier[1] = -1;
@@ -247,6 +310,14 @@ ipmiconsole_engine_setup (unsigned int thread_count)
           IPMICONSOLE_DEBUG (("pthread_mutex_init: %s", strerror (perr)));
           goto cleanup;
         }
+#if HAVE_SYS_EPOLL_H
+      /* No delete function, contexts are owned by console_engine_ctxs */
+      if (!(console_engine_ctxs_new[i] = list_create (NULL)))
+        {
+          IPMICONSOLE_DEBUG (("list_create: %s", strerror (errno)));
+          goto cleanup;
+        }
+#endif /* HAVE_SYS_EPOLL_H */
     }
 
   /* Don't create fds for all ctxs_notifier to limit fd creation */
@@ -270,6 +341,38 @@ ipmiconsole_engine_setup (unsigned int thread_count)
           IPMICONSOLE_DEBUG (("closeonexec error"));
           goto cleanup;
         }
+
+#if HAVE_SYS_EPOLL_H
+      {
+        struct epoll_event ev;
+
+        if ((console_engine_epoll_fd[i] = epoll_create (IPMICONSOLE_EPOLL_EVENTS_MAX)) < 0)
+          {
+            IPMICONSOLE_DEBUG (("epoll_create: %s", strerror (errno)));
+            goto cleanup;
+          }
+
+        if (ipmiconsole_set_closeonexec (NULL, console_engine_epoll_fd[i]) < 0)
+          {
+            IPMICONSOLE_DEBUG (("closeonexec error"));
+            goto cleanup;
+          }
+
+        /* NULL data distinguishes the notifier from context fds */
+        memset (&ev, '\0', sizeof (struct epoll_event));
+        ev.events = EPOLLIN;
+        ev.data.ptr = NULL;
+
+        if (epoll_ctl (console_engine_epoll_fd[i],
+                       EPOLL_CTL_ADD,
+                       console_engine_ctxs_notifier[i][0],
+                       &ev) < 0)
+          {
+            IPMICONSOLE_DEBUG (("epoll_ctl: %s", strerror (errno)));
+            goto cleanup;
+          }
+      }
+#endif /* HAVE_SYS_EPOLL_H */
     }
 
   if (pipe (garbage_collector_notifier) < 0)
@@ -331,6 +434,14 @@ ipmiconsole_engine_setup (unsigned int thread_count)
       close (console_engine_ctxs_notifier[i][0]);
       /* ignore potential error, cleanup path */
       close (console_engine_ctxs_notifier[i][1]);
+#if HAVE_SYS_EPOLL_H
+      if (console_engine_ctxs_new[i])
+        list_destroy (console_engine_ctxs_new[i]);
+      console_engine_ctxs_new[i] = NULL;
+      /* ignore potential error, cleanup path */
+      close (console_engine_epoll_fd[i]);
+      console_engine_epoll_fd[i] = -1;
+#endif /* HAVE_SYS_EPOLL_H */
     }
   if (console_engine_ctxs_to_destroy)
     list_destroy (console_engine_ctxs_to_destroy);
@@ -394,488 +505,1860 @@ ipmiconsole_engine_thread_count (void)
   return (thread_count);
 }
 
-static int
-_teardown_initiate (void *x, void *arg)
+int
+ipmiconsole_engine_set_handshake_limits (unsigned int handshakes_max,
+                                         unsigned int subnet_handshake_rate)
 {
-  ipmiconsole_ctx_t c;
-
-  assert (x);
+  int perr;
 
-  c = (ipmiconsole_ctx_t)x;
+  if ((perr = pthread_mutex_lock (&console_engine_handshakes_mutex)))
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+      errno = perr;
+      return (-1);
+    }
 
-  assert (c);
-  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+  console_engine_handshakes_max = handshakes_max;
+  console_engine_subnet_handshake_rate = subnet_handshake_rate;
 
-  if (!c->session.close_session_flag)
-    c->session.close_session_flag++;
+  if ((perr = pthread_mutex_unlock (&console_engine_handshakes_mutex)))
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+      errno = perr;
+      return (-1);
+    }
 
   return (0);
 }
 
-static int
-_poll_setup (void *x, void *arg)
+/* Subnets hashing to the same bucket share a handshake rate */
+static unsigned int
+_subnet_pacing_bucket (ipmiconsole_ctx_t c)
 {
-  ipmiconsole_ctx_t c;
-  struct _ipmiconsole_poll_data *poll_data;
-
-  assert (x);
-  assert (arg);
-
-  c = (ipmiconsole_ctx_t)x;
+  uint32_t key = 0;
 
   assert (c);
   assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+  assert (c->session.addr);
 
-  poll_data = (struct _ipmiconsole_poll_data *)arg;
-
-  poll_data->pfds[poll_data->pfds_index*3].fd = c->connection.ipmi_fd;
-  poll_data->pfds[poll_data->pfds_index*3].events = 0;
-  poll_data->pfds[poll_data->pfds_index*3].revents = 0;
-  poll_data->pfds[poll_data->pfds_index*3].events |= POLLIN;
-  if (!scbuf_is_empty (c->connection.ipmi_to_bmc))
-    poll_data->pfds[poll_data->pfds_index*3].events |= POLLOUT;
-
-  /* If the session is being torn down, don't bother settings flags on
-   * these fds.  However, to avoid spinning due to an invalid fd or a
-   * closed fd (i.e. get a POLLINVAL or POLLHUP), use the dummy_fd.
-   */
-  if (!c->session.close_session_flag)
-    {
-      poll_data->pfds[poll_data->pfds_index*3 + 1].fd = c->connection.asynccomm[0];
-      poll_data->pfds[poll_data->pfds_index*3 + 1].events = 0;
-      poll_data->pfds[poll_data->pfds_index*3 + 1].revents = 0;
-      poll_data->pfds[poll_data->pfds_index*3 + 1].events |= POLLIN;
-
-      poll_data->pfds[poll_data->pfds_index*3 + 2].fd = c->connection.ipmiconsole_fd;
-      poll_data->pfds[poll_data->pfds_index*3 + 2].events = 0;
-      poll_data->pfds[poll_data->pfds_index*3 + 2].revents = 0;
-      poll_data->pfds[poll_data->pfds_index*3 + 2].events |= POLLIN;
-      if (!scbuf_is_empty (c->connection.console_bmc_to_remote_console))
-        poll_data->pfds[poll_data->pfds_index*3 + 2].events |= POLLOUT;
-    }
+  if (c->session.addr->sa_family == AF_INET)
+    key = ntohl (c->session.addr4.sin_addr.s_addr) >> 8;
   else
     {
-      poll_data->pfds[poll_data->pfds_index*3 + 1].fd = dummy_fd;
-      poll_data->pfds[poll_data->pfds_index*3 + 1].events = 0;
-      poll_data->pfds[poll_data->pfds_index*3 + 1].revents = 0;
+      unsigned int i;
 
-      poll_data->pfds[poll_data->pfds_index*3 + 2].fd = dummy_fd;
-      poll_data->pfds[poll_data->pfds_index*3 + 2].events = 0;
-      poll_data->pfds[poll_data->pfds_index*3 + 2].revents = 0;
+      /* fold the /64 prefix */
+      for (i = 0; i < 8; i++)
+        key = key * 31 + c->session.addr6.sin6_addr.s6_addr[i];
     }
 
-  poll_data->pfds_ctxs[poll_data->pfds_index] = c;
-
-  poll_data->pfds_index++;
-  return (0);
+  return (key % IPMICONSOLE_SUBNET_PACING_BUCKETS);
 }
 
 /*
- * Return 0 on success
- * Return -1 on fatal error
+ * When a large number of contexts are submitted at once, every engine
+ * thread would otherwise begin the IPMI 2.0 handshake with every BMC
+ * at the same time.  BMCs behind the same management switch drop
+ * packets under the burst and the resulting retransmissions bring
+ * all of the consoles up later than if the handshakes had been spread
+ * out.
+ *
+ * So only console_engine_handshakes_max contexts may be between the
+ * START and SOL_SESSION protocol states at once, and if
+ * console_engine_subnet_handshake_rate is non-zero, only that many
+ * handshakes per second may begin with BMCs in the same subnet (/24
+ * for IPv4, /64 for IPv6).  A limit of 0 handshakes disables the
+ * concurrency limit.
+ *
+ * Contexts submitted via ipmiconsole_engine_submit_block() have a
+ * user waiting on them, so they are always admitted.  They still
+ * hold a slot and count against their subnet.
+ *
+ * Returns 1 if admitted, 0 if the context should try again later, -1
+ * on error.
  */
-static int
-_ipmi_recvfrom (ipmiconsole_ctx_t c)
+int
+ipmiconsole_engine_handshake_admit (ipmiconsole_ctx_t c)
 {
-  char buffer[IPMICONSOLE_PACKET_BUFLEN];
-  struct sockaddr_in6 from6;
-  struct sockaddr *from = (struct sockaddr *)&from6;
-  unsigned int fromlen = sizeof (struct sockaddr_in6);
-  ssize_t len;
-  int n, dropped = 0;
-  int secure_malloc_flag;
+  struct _ipmiconsole_subnet_pacing *pacing = NULL;
+  struct timeval current;
+  int interactive, perr, rv = -1;
 
   assert (c);
   assert (c->magic == IPMICONSOLE_CTX_MAGIC);
 
-  secure_malloc_flag = (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY) ? 1 : 0;
-
-  do
-    {
-      /* For receive side, ipmi_lan_recvfrom and
-       * ipmi_rmcpplus_recvfrom are identical.  So we just use
-       * ipmi_lan_recvfrom for both.
-       *
-       * In event of future change, should use util functions
-       * ipmi_is_ipmi_1_5_packet or ipmi_is_ipmi_2_0_packet
-       * appropriately.
-       */
-      len = ipmi_lan_recvfrom (c->connection.ipmi_fd,
-                               buffer,
-                               IPMICONSOLE_PACKET_BUFLEN,
-                               0,
-                               from,
-                               &fromlen);
-    } while (len < 0 && errno == EINTR);
+  if (c->engine.handshake_admitted)
+    return (1);
 
-  /* achu & hliebig:
-   *
-   * Premise from ipmitool (http://ipmitool.sourceforge.net/)
-   *
-   * On some OSes (it seems Unixes), the behavior is to not return
-   * port denied errors up to the client for UDP responses (i.e. you
-   * need to timeout).  But on some OSes (it seems Windows), the
-   * behavior is to return port denied errors up to the user for UDP
-   * responses via ECONNRESET or ECONNREFUSED.
-   *
-   * If this were just the case, we could return or handle errors
-   * properly and move on.  However, it's not the case.
-   *
-   * According to Ipmitool, on some motherboards, both the OS and the
-   * BMC are capable of responding to an IPMI request.  That means you
-   * can get an ECONNRESET or ECONNREFUSED, then later on, get your
-   * real IPMI response.
-   *
-   * Our solution is copied from Ipmitool, we'll ignore some specific
-   * errors and try to read again.
-   *
-   * If the ECONNREFUSED or ECONNRESET is from the OS, but we will get
-   * an IPMI response later, the recvfrom later on gets the packet we
-   * want.
-   *
-   * If the ECONNREFUSED or ECONNRESET is from the OS but there is no
-   * BMC (or IPMI disabled, etc.), just do the recvfrom again to
-   * eventually get a timeout, which is the behavior we'd like.
-   */
-  if (len < 0
-      && (errno == ECONNRESET
-          || errno == ECONNREFUSED))
+  if (gettimeofday (&current, NULL) < 0)
     {
-      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_lan_recvfrom: connection refused: %s", strerror (errno)));
-      return (0);
+      IPMICONSOLE_CTX_DEBUG (c, ("gettimeofday: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+      return (-1);
     }
 
-  if (len < 0)
+  if ((perr = pthread_mutex_lock (&(c->blocking.blocking_mutex))) != 0)
     {
-      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_lan_recvfrom: %s", strerror (errno)));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+      IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_lock: %s", strerror (perr)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
       return (-1);
     }
 
-  if (!len)
+  interactive = c->blocking.blocking_submit_requested;
+
+  if ((perr = pthread_mutex_unlock (&(c->blocking.blocking_mutex))) != 0)
     {
-      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_lan_recvfrom: no data", strerror (errno)));
-      /* Note: Not a fatal error, just return*/
-      return (0);
+      IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_unlock: %s", strerror (perr)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
     }
 
-  /* Sanity Check */
-  if (from6.sin6_family == AF_INET6)
+  if ((perr = pthread_mutex_lock (&console_engine_handshakes_mutex)))
     {
-      if (memcmp (&from6.sin6_addr,
-                  &(c->session.addr6.sin6_addr),
-                  sizeof (from6.sin6_addr)))
-        {
-          IPMICONSOLE_CTX_DEBUG (c, ("received from invalid address"));
-          /* Note: Not a fatal error, just return */
-          return (0);
-        }
+      IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_lock: %s", strerror (perr)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
     }
-  else
+
+  if (console_engine_subnet_handshake_rate)
     {
-      /* memcpy hacks to avoid warnings, i.e.
-       * warning: dereferencing pointer 'X' does break strict-aliasing rules
-       */
-      struct sockaddr_in from4;
+      struct timeval window_end;
 
-      memcpy (&from4, from, fromlen);
+      pacing = &console_engine_subnet_pacing[_subnet_pacing_bucket (c)];
 
-      if (from4.sin_addr.s_addr != c->session.addr4.sin_addr.s_addr)
+      timeval_add_ms (&pacing->window_start, 1000, &window_end);
+      if (timeval_gt (&current, &window_end)
+          || timeval_lt (&current, &pacing->window_start))
         {
-          IPMICONSOLE_CTX_DEBUG (c, ("received from invalid address"));
-          /* Note: Not a fatal error, just return */
-          return (0);
+          pacing->window_start = current;
+          pacing->starts = 0;
         }
     }
 
-  /* Empty the scbuf if it's not empty */
-  if (!scbuf_is_empty (c->connection.ipmi_from_bmc))
-    {
-      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_from_bmc not empty, draining"));
-      do {
-        char tempbuf[IPMICONSOLE_PACKET_BUFLEN];
-        if (scbuf_read (c->connection.ipmi_from_bmc, tempbuf, IPMICONSOLE_PACKET_BUFLEN) < 0)
-          {
-            IPMICONSOLE_CTX_DEBUG (c, ("scbuf_read: %s", strerror (errno)));
-            break;
-          }
-      } while(!scbuf_is_empty (c->connection.ipmi_from_bmc));
-    }
-
-  if ((n = scbuf_write (c->connection.ipmi_from_bmc, buffer, len, &dropped, secure_malloc_flag)) < 0)
+  if (!interactive)
     {
-      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: %s", strerror (errno)));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-      return (-1);
+      if ((console_engine_handshakes_max
+           && console_engine_handshakes >= console_engine_handshakes_max)
+          || (pacing
+              && pacing->starts >= console_engine_subnet_handshake_rate))
+        {
+          if (!c->engine.handshake_deferred)
+            {
+              IPMICONSOLE_CTX_DEBUG (c, ("session establishment deferred: handshakes = %u",
+                                         console_engine_handshakes));
+              c->engine.handshake_deferred++;
+            }
+          rv = 0;
+          goto unlock;
+        }
     }
 
-  if (n != len)
-    {
-      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: invalid bytes written; n=%d; len=%d", n, len));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-      return (-1);
-    }
+  console_engine_handshakes++;
+  if (pacing)
+    pacing->starts++;
+  c->engine.handshake_admitted++;
+  rv = 1;
 
-  if (dropped)
+ unlock:
+  if ((perr = pthread_mutex_unlock (&console_engine_handshakes_mutex)))
     {
-      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: dropped data: dropped=%d", dropped));
+      IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_unlock: %s", strerror (perr)));
       ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
       return (-1);
     }
 
-  return (0);
+  return (rv);
 }
 
-/*
- * Return 0 on success
- * Return -1 on fatal error
- */
-static int
-_ipmi_sendto (ipmiconsole_ctx_t c)
+void
+ipmiconsole_engine_handshake_release (ipmiconsole_ctx_t c)
 {
-  char buffer[IPMICONSOLE_PACKET_BUFLEN];
-  ssize_t len;
-  int n;
+  int perr;
 
   assert (c);
   assert (c->magic == IPMICONSOLE_CTX_MAGIC);
 
-  if ((n = scbuf_read (c->connection.ipmi_to_bmc, buffer, IPMICONSOLE_PACKET_BUFLEN)) < 0)
+  if (!c->engine.handshake_admitted)
+    return;
+
+  if ((perr = pthread_mutex_lock (&console_engine_handshakes_mutex)))
     {
-      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_read: %s", strerror (errno)));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-      return (-1);
+      IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_lock: %s", strerror (perr)));
+      return;
     }
 
-  if (ipmi_is_ipmi_1_5_packet (buffer, n))
-    {
-      do
-        {
-          len = ipmi_lan_sendto (c->connection.ipmi_fd,
-                                 buffer,
-                                 n,
-                                 0,
-                                 c->session.addr,
-                                 c->session.addr_len);
-        } while (len < 0 && errno == EINTR);
+  assert (console_engine_handshakes);
+  console_engine_handshakes--;
+  c->engine.handshake_admitted = 0;
+
+  if ((perr = pthread_mutex_unlock (&console_engine_handshakes_mutex)))
+    IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_unlock: %s", strerror (perr)));
+}
+
+int
+ipmiconsole_engine_get_stats (struct ipmiconsole_engine_stats *stats)
+{
+  unsigned int i;
+  int perr, rv = -1;
+
+  assert (stats);
+
+  memset (stats, '\0', sizeof (struct ipmiconsole_engine_stats));
+
+  if ((perr = pthread_mutex_lock (&console_engine_thread_count_mutex)))
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+      errno = perr;
+      return (-1);
+    }
+
+  stats->thread_count = console_engine_thread_count;
+
+  for (i = 0; i < console_engine_thread_count; i++)
+    {
+      if ((perr = pthread_mutex_lock (&console_engine_ctxs_mutex[i])))
+        {
+          IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+          errno = perr;
+          goto cleanup;
+        }
+
+      memcpy (&stats->threads[i],
+              &console_engine_stats[i],
+              sizeof (struct ipmiconsole_engine_thread_stats));
+      stats->threads[i].ctxs = console_engine_ctxs_count[i];
+
+      if ((perr = pthread_mutex_unlock (&console_engine_ctxs_mutex[i])))
+        {
+          IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+          errno = perr;
+          goto cleanup;
+        }
+    }
+
+  if ((perr = pthread_mutex_lock (&console_engine_handshakes_mutex)))
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+      errno = perr;
+      goto cleanup;
+    }
+
+  stats->handshakes = console_engine_handshakes;
+
+  if ((perr = pthread_mutex_unlock (&console_engine_handshakes_mutex)))
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+      errno = perr;
+      goto cleanup;
+    }
+
+  rv = 0;
+ cleanup:
+  if ((perr = pthread_mutex_unlock (&console_engine_thread_count_mutex)))
+    IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+  return (rv);
+}
+
+/* Must be called with the thread's ctxs mutex locked */
+static void
+_engine_stats_update (unsigned int index,
+                      unsigned int ctxs_processed,
+                      struct timeval *process_start,
+                      struct timeval *process_end)
+{
+  struct timeval delta;
+
+  assert (index < IPMICONSOLE_THREAD_COUNT_MAX);
+  assert (process_start);
+  assert (process_end);
+
+  console_engine_stats[index].iterations++;
+  console_engine_stats[index].ctxs_processed += ctxs_processed;
+
+  if (timeval_gt (process_end, process_start))
+    {
+      timeval_sub (process_end, process_start, &delta);
+      console_engine_stats[index].process_time += (uint64_t)delta.tv_sec * 1000000 + delta.tv_usec;
+    }
+}
+
+/* Statistics are only informational, so locking errors are not fatal */
+static void
+_stats_ipmi_packet (ipmiconsole_ctx_t c, unsigned int bytes, int received)
+{
+  int perr;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  if ((perr = pthread_mutex_lock (&(c->signal.stats_mutex))) != 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_lock: %s", strerror (perr)));
+      return;
+    }
+
+  if (received)
+    {
+      c->signal.stats.ipmi_packets_received++;
+      c->signal.stats.ipmi_bytes_received += bytes;
+      if (gettimeofday (&c->signal.stats_last_ipmi_packet_received, NULL) < 0)
+        IPMICONSOLE_CTX_DEBUG (c, ("gettimeofday: %s", strerror (errno)));
     }
   else
     {
-      do
+      c->signal.stats.ipmi_packets_sent++;
+      c->signal.stats.ipmi_bytes_sent += bytes;
+    }
+
+  if ((perr = pthread_mutex_unlock (&(c->signal.stats_mutex))) != 0)
+    IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_unlock: %s", strerror (perr)));
+}
+
+#if HAVE_SYS_EPOLL_H
+/*
+ * Each engine thread keeps the fds of its contexts registered with a
+ * persistent epoll instance and the timeouts of its contexts in a
+ * min-heap.  An iteration of the engine only processes contexts that
+ * had fd activity or whose session, retransmission, or keepalive
+ * timeout expired.  With a large number of mostly idle consoles, this
+ * is far cheaper than building a pollfd array and processing every
+ * context on every iteration.
+ *
+ * The heap is kept here rather than using the heap in miscutil, b/c
+ * a context's timeout changes every time it is processed, so entries
+ * must be removable/updatable in place.
+ */
+struct _ipmiconsole_timer_heap {
+  ipmiconsole_ctx_t *ctxs;
+  unsigned int count;
+  unsigned int size;
+};
+
+static void
+_timer_heap_swap (struct _ipmiconsole_timer_heap *timers, unsigned int i, unsigned int j)
+{
+  ipmiconsole_ctx_t tmp;
+
+  tmp = timers->ctxs[i];
+  timers->ctxs[i] = timers->ctxs[j];
+  timers->ctxs[j] = tmp;
+  timers->ctxs[i]->engine.timer_index = i;
+  timers->ctxs[j]->engine.timer_index = j;
+}
+
+static void
+_timer_heap_sift_up (struct _ipmiconsole_timer_heap *timers, unsigned int i)
+{
+  while (i)
+    {
+      unsigned int parent = (i - 1) / 2;
+
+      if (!timeval_lt (&timers->ctxs[i]->engine.timeout,
+                       &timers->ctxs[parent]->engine.timeout))
+        break;
+
+      _timer_heap_swap (timers, i, parent);
+      i = parent;
+    }
+}
+
+static void
+_timer_heap_sift_down (struct _ipmiconsole_timer_heap *timers, unsigned int i)
+{
+  while (1)
+    {
+      unsigned int left = (2 * i) + 1;
+      unsigned int right = left + 1;
+      unsigned int min = i;
+
+      if (left < timers->count
+          && timeval_lt (&timers->ctxs[left]->engine.timeout,
+                         &timers->ctxs[min]->engine.timeout))
+        min = left;
+
+      if (right < timers->count
+          && timeval_lt (&timers->ctxs[right]->engine.timeout,
+                         &timers->ctxs[min]->engine.timeout))
+        min = right;
+
+      if (min == i)
+        break;
+
+      _timer_heap_swap (timers, i, min);
+      i = min;
+    }
+}
+
+static void
+_timer_heap_remove (struct _ipmiconsole_timer_heap *timers, ipmiconsole_ctx_t c)
+{
+  unsigned int i;
+
+  assert (timers);
+  assert (c);
+
+  if (!c->engine.timer_queued)
+    return;
+
+  i = c->engine.timer_index;
+
+  assert (i < timers->count);
+  assert (timers->ctxs[i] == c);
+
+  timers->count--;
+  if (i != timers->count)
+    {
+      timers->ctxs[i] = timers->ctxs[timers->count];
+      timers->ctxs[i]->engine.timer_index = i;
+      _timer_heap_sift_down (timers, i);
+      _timer_heap_sift_up (timers, i);
+    }
+
+  c->engine.timer_queued = 0;
+}
+
+/* (Re-)queue the context with its current engine timeout */
+static int
+_timer_heap_update (struct _ipmiconsole_timer_heap *timers, ipmiconsole_ctx_t c)
+{
+  assert (timers);
+  assert (c);
+
+  _timer_heap_remove (timers, c);
+
+  if (timers->count == timers->size)
+    {
+      ipmiconsole_ctx_t *tmp;
+      unsigned int size;
+
+      size = timers->size ? (timers->size * 2) : IPMICONSOLE_TIMER_HEAP_SIZE_INIT;
+
+      if (!(tmp = (ipmiconsole_ctx_t *)realloc (timers->ctxs, size * sizeof (ipmiconsole_ctx_t))))
         {
-          len = ipmi_rmcpplus_sendto (c->connection.ipmi_fd,
-                                      buffer,
-                                      n,
-                                      0,
-                                      c->session.addr,
-                                      c->session.addr_len);
-        } while (len < 0 && errno == EINTR);
+          IPMICONSOLE_CTX_DEBUG (c, ("realloc: %s", strerror (errno)));
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_OUT_OF_MEMORY);
+          return (-1);
+        }
+
+      timers->ctxs = tmp;
+      timers->size = size;
     }
 
-  if (len < 0)
+  timers->ctxs[timers->count] = c;
+  c->engine.timer_index = timers->count;
+  c->engine.timer_queued = 1;
+  timers->count++;
+
+  _timer_heap_sift_up (timers, c->engine.timer_index);
+  return (0);
+}
+
+/* Returns milliseconds until the earliest timeout, -1 if none */
+static int
+_timer_heap_timeout (struct _ipmiconsole_timer_heap *timers)
+{
+  struct timeval current;
+  struct timeval delta;
+  unsigned int ms;
+
+  assert (timers);
+
+  if (!timers->count)
+    return (-1);
+
+  if (gettimeofday (&current, NULL) < 0)
     {
-      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_lan_sendto: %s", strerror (errno)));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
-      return (-1);
+      IPMICONSOLE_DEBUG (("gettimeofday: %s", strerror (errno)));
+      return (0);
     }
 
-#if 0
-  /* don't check, let bad packet timeout */
-  if (len != n)
+  if (!timeval_gt (&timers->ctxs[0]->engine.timeout, &current))
+    return (0);
+
+  timeval_sub (&timers->ctxs[0]->engine.timeout, &current, &delta);
+  timeval_millisecond_calc (&delta, &ms);
+
+  if (ms > INT_MAX)
+    return (INT_MAX);
+
+  return (ms);
+}
+
+static void
+_ready_push (ipmiconsole_ctx_t *ready, ipmiconsole_ctx_t c)
+{
+  assert (ready);
+  assert (c);
+
+  if (c->engine.ready)
+    return;
+
+  c->engine.ready = 1;
+  c->engine.ready_next = *ready;
+  *ready = c;
+}
+
+static void
+_timer_heap_expire (struct _ipmiconsole_timer_heap *timers, ipmiconsole_ctx_t *ready)
+{
+  struct timeval current;
+
+  assert (timers);
+  assert (ready);
+
+  if (gettimeofday (&current, NULL) < 0)
     {
-      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_lan_sendto: invalid bytes written; n=%d; len=%d", n, len));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+      IPMICONSOLE_DEBUG (("gettimeofday: %s", strerror (errno)));
+      return;
+    }
+
+  while (timers->count
+         && !timeval_gt (&timers->ctxs[0]->engine.timeout, &current))
+    {
+      ipmiconsole_ctx_t c = timers->ctxs[0];
+
+      _timer_heap_remove (timers, c);
+      _ready_push (ready, c);
+    }
+}
+
+static int
+_epoll_ctl_fd (int epfd, struct ipmiconsole_ctx_engine_fd *efd, unsigned int events)
+{
+  struct epoll_event ev;
+  int op;
+
+  assert (efd);
+
+  if (efd->events == events)
+    return (0);
+
+  assert (efd->fd >= 0);
+
+  if (!events)
+    op = EPOLL_CTL_DEL;
+  else if (!efd->events)
+    op = EPOLL_CTL_ADD;
+  else
+    op = EPOLL_CTL_MOD;
+
+  memset (&ev, '\0', sizeof (struct epoll_event));
+  ev.events = events;
+  ev.data.ptr = efd;
+
+  if (epoll_ctl (epfd, op, efd->fd, &ev) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (efd->c, ("epoll_ctl: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (efd->c, IPMICONSOLE_ERR_SYSTEM_ERROR);
       return (-1);
     }
-#endif
 
-  /* scbuf should be empty now */
+  efd->events = events;
+  return (0);
+}
+
+static int
+_epoll_update (int epfd, ipmiconsole_ctx_t c)
+{
+  unsigned int ipmi_events = EPOLLIN;
+  unsigned int asynccomm_events = 0;
+  unsigned int console_events = 0;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  /* The ipmi fd is created by the engine on the context's first
+   * processing, see ipmiconsole_ctx_connection_ipmi_setup().
+   */
+  c->engine.fds[IPMICONSOLE_ENGINE_FD_IPMI].fd = c->connection.ipmi_fd;
+
   if (!scbuf_is_empty (c->connection.ipmi_to_bmc))
+    ipmi_events |= EPOLLOUT;
+
+  /* If the session is being torn down, stop listening on the user's
+   * fds.  They may be closed at any time.
+   */
+  if (!c->session.close_session_flag)
     {
-      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_to_bmc not empty"));
-      /* Note: Not a fatal error, just return*/
-      return (0);
+      asynccomm_events = EPOLLIN;
+      /* No console fd if the user passes data via a data callback */
+      if (c->connection.ipmiconsole_fd >= 0)
+        {
+          console_events = EPOLLIN;
+          if (!scbuf_is_empty (c->connection.console_bmc_to_remote_console))
+            console_events |= EPOLLOUT;
+        }
     }
 
+  if (_epoll_ctl_fd (epfd, &c->engine.fds[IPMICONSOLE_ENGINE_FD_IPMI], ipmi_events) < 0)
+    return (-1);
+
+  if (_epoll_ctl_fd (epfd, &c->engine.fds[IPMICONSOLE_ENGINE_FD_ASYNCCOMM], asynccomm_events) < 0)
+    return (-1);
+
+  if (_epoll_ctl_fd (epfd, &c->engine.fds[IPMICONSOLE_ENGINE_FD_CONSOLE], console_events) < 0)
+    return (-1);
+
   return (0);
 }
 
-/*
- * Return 0 on success
- * Return -1 on fatal error
- */
 static int
-_asynccomm (ipmiconsole_ctx_t c)
+_epoll_register (ipmiconsole_ctx_t c)
 {
-  uint8_t tmpbyte;
-  ssize_t len;
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  c->engine.fds[IPMICONSOLE_ENGINE_FD_CONSOLE].fd = c->connection.ipmiconsole_fd;
+
+  /* The user closes the asynccomm pipe on ipmiconsole_ctx_destroy().
+   * poll() reports this as POLLNVAL, but epoll silently forgets about
+   * closed fds.  So listen on a duplicate, which sees POLLHUP when
+   * the write end of the pipe is closed.
+   */
+  if ((c->engine.fds[IPMICONSOLE_ENGINE_FD_ASYNCCOMM].fd = dup (c->connection.asynccomm[0])) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("dup: %s", strerror (errno)));
+      /* The user already destroyed the context, which is ok */
+      if (errno == EBADF)
+        ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
+      else
+        ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+      return (-1);
+    }
+
+  if (ipmiconsole_set_closeonexec (c, c->engine.fds[IPMICONSOLE_ENGINE_FD_ASYNCCOMM].fd) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("closeonexec error"));
+      return (-1);
+    }
+
+  /* fds are registered after the context is first processed */
+  return (0);
+}
+
+static void
+_epoll_unregister (int epfd, ipmiconsole_ctx_t c)
+{
+  unsigned int i;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  for (i = 0; i < IPMICONSOLE_ENGINE_FDS; i++)
+    {
+      if (c->engine.fds[i].events)
+        {
+          /* ignore potential error, cleanup path */
+          epoll_ctl (epfd, EPOLL_CTL_DEL, c->engine.fds[i].fd, NULL);
+          c->engine.fds[i].events = 0;
+        }
+    }
+
+  if (c->engine.fds[IPMICONSOLE_ENGINE_FD_ASYNCCOMM].fd >= 0)
+    {
+      /* ignore potential error, cleanup path */
+      close (c->engine.fds[IPMICONSOLE_ENGINE_FD_ASYNCCOMM].fd);
+      c->engine.fds[IPMICONSOLE_ENGINE_FD_ASYNCCOMM].fd = -1;
+    }
+}
+
+static int
+_epoll_unregister_ctx (void *x, void *arg)
+{
+  ipmiconsole_ctx_t c;
+
+  assert (x);
+  assert (arg);
+
+  c = (ipmiconsole_ctx_t)x;
+
+  _epoll_unregister (*((int *)arg), c);
+  return (0);
+}
+
+static short
+_epoll_revents (uint32_t events)
+{
+  short revents = 0;
+
+  if (events & EPOLLIN)
+    revents |= POLLIN;
+  if (events & EPOLLOUT)
+    revents |= POLLOUT;
+  if (events & EPOLLERR)
+    revents |= POLLERR;
+  if (events & EPOLLHUP)
+    revents |= POLLHUP;
+
+  return (revents);
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
+static int
+_teardown_initiate (void *x, void *arg)
+{
+  ipmiconsole_ctx_t c;
+
+  assert (x);
+
+  c = (ipmiconsole_ctx_t)x;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  if (!c->session.close_session_flag)
+    c->session.close_session_flag++;
+
+#if HAVE_SYS_EPOLL_H
+  /* Process the context now, not when it next times out */
+  assert (arg);
+  _ready_push ((ipmiconsole_ctx_t *)arg, c);
+#endif /* HAVE_SYS_EPOLL_H */
+
+  return (0);
+}
+
+#if !HAVE_SYS_EPOLL_H
+static int _ipmi_sendto (ipmiconsole_ctx_t c);
+
+static int
+_poll_setup (void *x, void *arg)
+{
+  ipmiconsole_ctx_t c;
+  struct _ipmiconsole_poll_data *poll_data;
+
+  assert (x);
+  assert (arg);
+
+  c = (ipmiconsole_ctx_t)x;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  poll_data = (struct _ipmiconsole_poll_data *)arg;
+
+  /* See comments in _engine_process_ready() */
+  if (c->config.engine_flags & IPMICONSOLE_ENGINE_THROUGHPUT
+      && !c->session.close_session_flag
+      && !scbuf_is_empty (c->connection.ipmi_to_bmc))
+    {
+      if (_ipmi_sendto (c) < 0)
+        c->session.close_session_flag++;
+    }
+
+  poll_data->pfds[poll_data->pfds_index*3].fd = c->connection.ipmi_fd;
+  poll_data->pfds[poll_data->pfds_index*3].events = 0;
+  poll_data->pfds[poll_data->pfds_index*3].revents = 0;
+  poll_data->pfds[poll_data->pfds_index*3].events |= POLLIN;
+  if (!scbuf_is_empty (c->connection.ipmi_to_bmc))
+    poll_data->pfds[poll_data->pfds_index*3].events |= POLLOUT;
+
+  /* If the session is being torn down, don't bother settings flags on
+   * these fds.  However, to avoid spinning due to an invalid fd or a
+   * closed fd (i.e. get a POLLINVAL or POLLHUP), use the dummy_fd.
+   */
+  if (!c->session.close_session_flag)
+    {
+      poll_data->pfds[poll_data->pfds_index*3 + 1].fd = c->connection.asynccomm[0];
+      poll_data->pfds[poll_data->pfds_index*3 + 1].events = 0;
+      poll_data->pfds[poll_data->pfds_index*3 + 1].revents = 0;
+      poll_data->pfds[poll_data->pfds_index*3 + 1].events |= POLLIN;
+
+      poll_data->pfds[poll_data->pfds_index*3 + 2].fd = c->connection.ipmiconsole_fd;
+      poll_data->pfds[poll_data->pfds_index*3 + 2].events = 0;
+      poll_data->pfds[poll_data->pfds_index*3 + 2].revents = 0;
+      /* poll() ignores the fd if -1, i.e. a data callback is used */
+      if (c->connection.ipmiconsole_fd >= 0)
+        {
+          poll_data->pfds[poll_data->pfds_index*3 + 2].events |= POLLIN;
+          if (!scbuf_is_empty (c->connection.console_bmc_to_remote_console))
+            poll_data->pfds[poll_data->pfds_index*3 + 2].events |= POLLOUT;
+        }
+    }
+  else
+    {
+      poll_data->pfds[poll_data->pfds_index*3 + 1].fd = dummy_fd;
+      poll_data->pfds[poll_data->pfds_index*3 + 1].events = 0;
+      poll_data->pfds[poll_data->pfds_index*3 + 1].revents = 0;
+
+      poll_data->pfds[poll_data->pfds_index*3 + 2].fd = dummy_fd;
+      poll_data->pfds[poll_data->pfds_index*3 + 2].events = 0;
+      poll_data->pfds[poll_data->pfds_index*3 + 2].revents = 0;
+    }
+
+  poll_data->pfds_ctxs[poll_data->pfds_index] = c;
+
+  poll_data->pfds_index++;
+  return (0);
+}
+#endif /* !HAVE_SYS_EPOLL_H */
+
+/*
+ * Return 0 on success
+ * Return -1 on fatal error
+ */
+static int
+_ipmi_recvfrom (ipmiconsole_ctx_t c)
+{
+  char buffer[IPMICONSOLE_PACKET_BUFLEN];
+  struct sockaddr_in6 from6;
+  struct sockaddr *from = (struct sockaddr *)&from6;
+  unsigned int fromlen = sizeof (struct sockaddr_in6);
+  ssize_t len;
+  int n, dropped = 0;
+  int secure_malloc_flag;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  secure_malloc_flag = (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY) ? 1 : 0;
+
+  do
+    {
+      /* For receive side, ipmi_lan_recvfrom and
+       * ipmi_rmcpplus_recvfrom are identical.  So we just use
+       * ipmi_lan_recvfrom for both.
+       *
+       * In event of future change, should use util functions
+       * ipmi_is_ipmi_1_5_packet or ipmi_is_ipmi_2_0_packet
+       * appropriately.
+       */
+      len = ipmi_lan_recvfrom (c->connection.ipmi_fd,
+                               buffer,
+                               IPMICONSOLE_PACKET_BUFLEN,
+                               0,
+                               from,
+                               &fromlen);
+    } while (len < 0 && errno == EINTR);
+
+  /* achu & hliebig:
+   *
+   * Premise from ipmitool (http://ipmitool.sourceforge.net/)
+   *
+   * On some OSes (it seems Unixes), the behavior is to not return
+   * port denied errors up to the client for UDP responses (i.e. you
+   * need to timeout).  But on some OSes (it seems Windows), the
+   * behavior is to return port denied errors up to the user for UDP
+   * responses via ECONNRESET or ECONNREFUSED.
+   *
+   * If this were just the case, we could return or handle errors
+   * properly and move on.  However, it's not the case.
+   *
+   * According to Ipmitool, on some motherboards, both the OS and the
+   * BMC are capable of responding to an IPMI request.  That means you
+   * can get an ECONNRESET or ECONNREFUSED, then later on, get your
+   * real IPMI response.
+   *
+   * Our solution is copied from Ipmitool, we'll ignore some specific
+   * errors and try to read again.
+   *
+   * If the ECONNREFUSED or ECONNRESET is from the OS, but we will get
+   * an IPMI response later, the recvfrom later on gets the packet we
+   * want.
+   *
+   * If the ECONNREFUSED or ECONNRESET is from the OS but there is no
+   * BMC (or IPMI disabled, etc.), just do the recvfrom again to
+   * eventually get a timeout, which is the behavior we'd like.
+   */
+  if (len < 0
+      && (errno == ECONNRESET
+          || errno == ECONNREFUSED))
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_lan_recvfrom: connection refused: %s", strerror (errno)));
+      return (0);
+    }
+
+  if (len < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_lan_recvfrom: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+      return (-1);
+    }
+
+  if (!len)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_lan_recvfrom: no data", strerror (errno)));
+      /* Note: Not a fatal error, just return*/
+      return (0);
+    }
+
+  /* Sanity Check */
+  if (from6.sin6_family == AF_INET6)
+    {
+      if (memcmp (&from6.sin6_addr,
+                  &(c->session.addr6.sin6_addr),
+                  sizeof (from6.sin6_addr)))
+        {
+          IPMICONSOLE_CTX_DEBUG (c, ("received from invalid address"));
+          /* Note: Not a fatal error, just return */
+          return (0);
+        }
+    }
+  else
+    {
+      /* memcpy hacks to avoid warnings, i.e.
+       * warning: dereferencing pointer 'X' does break strict-aliasing rules
+       */
+      struct sockaddr_in from4;
+
+      memcpy (&from4, from, fromlen);
+
+      if (from4.sin_addr.s_addr != c->session.addr4.sin_addr.s_addr)
+        {
+          IPMICONSOLE_CTX_DEBUG (c, ("received from invalid address"));
+          /* Note: Not a fatal error, just return */
+          return (0);
+        }
+    }
+
+  _stats_ipmi_packet (c, len, 1);
+
+  /* Empty the scbuf if it's not empty */
+  if (!scbuf_is_empty (c->connection.ipmi_from_bmc))
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_from_bmc not empty, draining"));
+      do {
+        char tempbuf[IPMICONSOLE_PACKET_BUFLEN];
+        if (scbuf_read (c->connection.ipmi_from_bmc, tempbuf, IPMICONSOLE_PACKET_BUFLEN) < 0)
+          {
+            IPMICONSOLE_CTX_DEBUG (c, ("scbuf_read: %s", strerror (errno)));
+            break;
+          }
+      } while(!scbuf_is_empty (c->connection.ipmi_from_bmc));
+    }
+
+  if ((n = scbuf_write (c->connection.ipmi_from_bmc, buffer, len, &dropped, secure_malloc_flag)) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  if (n != len)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: invalid bytes written; n=%d; len=%d", n, len));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  if (dropped)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: dropped data: dropped=%d", dropped));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  return (0);
+}
+
+/*
+ * Return 0 on success
+ * Return -1 on fatal error
+ */
+static int
+_ipmi_sendto (ipmiconsole_ctx_t c)
+{
+  char buffer[IPMICONSOLE_PACKET_BUFLEN];
+  ssize_t len;
+  int n;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  if ((n = scbuf_read (c->connection.ipmi_to_bmc, buffer, IPMICONSOLE_PACKET_BUFLEN)) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_read: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  if (ipmi_is_ipmi_1_5_packet (buffer, n))
+    {
+      do
+        {
+          len = ipmi_lan_sendto (c->connection.ipmi_fd,
+                                 buffer,
+                                 n,
+                                 0,
+                                 c->session.addr,
+                                 c->session.addr_len);
+        } while (len < 0 && errno == EINTR);
+    }
+  else
+    {
+      do
+        {
+          len = ipmi_rmcpplus_sendto (c->connection.ipmi_fd,
+                                      buffer,
+                                      n,
+                                      0,
+                                      c->session.addr,
+                                      c->session.addr_len);
+        } while (len < 0 && errno == EINTR);
+    }
+
+  if (len < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_lan_sendto: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+      return (-1);
+    }
+
+  _stats_ipmi_packet (c, len, 0);
+
+#if 0
+  /* don't check, let bad packet timeout */
+  if (len != n)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_lan_sendto: invalid bytes written; n=%d; len=%d", n, len));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+      return (-1);
+    }
+#endif
+
+  /* scbuf should be empty now */
+  if (!scbuf_is_empty (c->connection.ipmi_to_bmc))
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("ipmi_to_bmc not empty"));
+      /* Note: Not a fatal error, just return*/
+      return (0);
+    }
+
+  return (0);
+}
+
+/*
+ * Return 0 on success
+ * Return -1 on fatal error
+ */
+static int
+_asynccomm (ipmiconsole_ctx_t c)
+{
+  uint8_t tmpbyte;
+  ssize_t len;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  if ((len = read (c->connection.asynccomm[0], (void *)&tmpbyte, 1)) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("read: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+      return (-1);
+    }
+
+  if (!len)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("asynccomm closed"));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  /* Input written via ipmiconsole_ctx_write() before a break must be
+   * sent before the break, so move it in either case.
+   */
+  if (tmpbyte == IPMICONSOLE_PIPE_CONSOLE_DATA_CODE
+      || tmpbyte == IPMICONSOLE_PIPE_GENERATE_BREAK_CODE)
+    {
+      if (ipmiconsole_process_user_input (c) < 0)
+        return (-1);
+    }
+
+  /* User may have requested several break conditions in a
+   * row quickly.  We assume it means just one
+   */
+  if (tmpbyte == IPMICONSOLE_PIPE_GENERATE_BREAK_CODE)
+    {
+      if (!(c->session.break_requested))
+        {
+          int bytes_before_break;
+
+          c->session.break_requested++;
+
+          if ((bytes_before_break = scbuf_used (c->connection.console_remote_console_to_bmc)) < 0)
+            {
+              IPMICONSOLE_CTX_DEBUG (c, ("scbuf_used: %s", strerror (errno)));
+              ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+              return (-1);
+            }
+          c->session.console_remote_console_to_bmc_bytes_before_break = bytes_before_break;
+        }
+    }
+
+  return (0);
+}
+
+/*
+ * Return 0 on success
+ * Return -1 on fatal error
+ */
+static int
+_console_read (ipmiconsole_ctx_t c)
+{
+  char buffer[IPMICONSOLE_PACKET_BUFLEN];
+  ssize_t len;
+  int n, dropped = 0;
+  int secure_malloc_flag;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+  assert (!c->session.close_session_flag);
+
+  secure_malloc_flag = (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY) ? 1 : 0;
+
+  if ((len = read (c->connection.ipmiconsole_fd,
+                   buffer,
+                   IPMICONSOLE_PACKET_BUFLEN)) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("read: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+      return (-1);
+    }
+
+  if (!len)
+    {
+      /* Returning -1 closes the session, but really this error is ok
+       * since the user is allowed to close the session
+       */
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
+      return (-1);
+    }
+
+  if ((n = scbuf_write (c->connection.console_remote_console_to_bmc, buffer, len, &dropped, secure_malloc_flag)) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  if (n != len)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: invalid bytes written; n=%d; len=%d", n, len));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  if (dropped)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: dropped data: dropped=%d", dropped));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  return (0);
+}
+
+/*
+ * Return 0 on success
+ * Return -1 on fatal error
+ */
+static int
+_console_write (ipmiconsole_ctx_t c)
+{
+  char buffer[IPMICONSOLE_PACKET_BUFLEN];
+  ssize_t len;
+  int n;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+  assert (!c->session.close_session_flag);
+
+  /*
+   * XXX: Shouldn't assume user will read data fast enough?  I could
+   * overrun buffers?
+   *
+   * Deal with it later.
+   */
+
+  if ((n = scbuf_read (c->connection.console_bmc_to_remote_console, buffer, IPMICONSOLE_PACKET_BUFLEN)) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_read: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  if ((len = write (c->connection.ipmiconsole_fd,
+                    buffer,
+                    n)) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("write: %s", strerror (errno)));
+
+      if (errno == EPIPE)
+        {
+          /* This error is ok since the user is allowed to close the
+           * session
+           */
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
+        }
+      else
+        ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+      return (-1);
+    }
+
+  if (len != n)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("write: invalid bytes written; n=%d; len=%d", n, len));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  /* scbuf should be empty now */
+  if (!scbuf_is_empty (c->connection.console_bmc_to_remote_console))
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("console_bmc_to_remote_console not empty"));
+      /* Note: Not a fatal error, just return*/
+      return (0);
+    }
+
+  return (0);
+}
+
+/* Handle fd activity on a context, revents as returned by poll() */
+static void
+_ctx_handle_revents (ipmiconsole_ctx_t c,
+                     short ipmi_revents,
+                     short asynccomm_revents,
+                     short console_revents)
+{
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  if (ipmi_revents & POLLERR)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("POLLERR"));
+      /* See comments in _ipmi_recvfrom() regarding ECONNRESET/ECONNREFUSED */
+      if (_ipmi_recvfrom (c) < 0)
+        {
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+          c->session.close_session_flag++;
+          return;
+        }
+    }
+  if (!c->session.close_session_flag)
+    {
+      /* This indicates the user closed the asynccomm file descriptors
+       * which is ok.  With epoll, the engine listens on a duplicate
+       * of the read end and sees POLLHUP instead of POLLNVAL.
+       */
+      if (asynccomm_revents & (POLLNVAL | POLLHUP))
+        {
+          IPMICONSOLE_CTX_DEBUG (c, ((asynccomm_revents & POLLNVAL) ? "POLLNVAL" : "POLLHUP"));
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
+          c->session.close_session_flag++;
+          return;
+        }
+      if (console_revents & POLLHUP)
+        {
+          /* This indicates the user closed the other end of
+           * the socketpair so it's ok.
+           */
+          IPMICONSOLE_CTX_DEBUG (c, ("POLLHUP"));
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
+          c->session.close_session_flag++;
+          return;
+        }
+      if (asynccomm_revents & POLLERR)
+        {
+          IPMICONSOLE_CTX_DEBUG (c, ("POLLERR"));
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+          c->session.close_session_flag++;
+          return;
+        }
+      if (console_revents & POLLERR)
+        {
+          IPMICONSOLE_CTX_DEBUG (c, ("POLLERR"));
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+          c->session.close_session_flag++;
+          return;
+        }
+    }
+  if (ipmi_revents & POLLIN)
+    {
+      if (_ipmi_recvfrom (c) < 0)
+        {
+          c->session.close_session_flag++;
+          return;
+        }
+    }
+  if (ipmi_revents & POLLOUT)
+    {
+      if (_ipmi_sendto (c) < 0)
+        {
+          c->session.close_session_flag++;
+          return;
+        }
+    }
+  if (asynccomm_revents & POLLIN)
+    {
+      if (_asynccomm (c) < 0)
+        {
+          c->session.close_session_flag++;
+          return;
+        }
+    }
+  if (!c->session.close_session_flag)
+    {
+      if (console_revents & POLLIN)
+        {
+          if (_console_read (c) < 0)
+            {
+              c->session.close_session_flag++;
+              return;
+            }
+        }
+      if (console_revents & POLLOUT)
+        {
+          if (_console_write (c) < 0)
+            {
+              c->session.close_session_flag++;
+              return;
+            }
+        }
+    }
+}
+
+#if HAVE_SYS_EPOLL_H
+static int
+_ctx_find (void *x, void *key)
+{
+  return (x == key);
+}
+
+static void
+_engine_ctx_remove (unsigned int index,
+                    struct _ipmiconsole_timer_heap *timers,
+                    ipmiconsole_ctx_t c)
+{
+  int perr;
+
+  _timer_heap_remove (timers, c);
+  _epoll_unregister (console_engine_epoll_fd[index], c);
+
+  /* We have to cleanup, so in general continue on even if locking fails */
+  if ((perr = pthread_mutex_lock (&console_engine_ctxs_mutex[index])))
+    IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+
+  /* On delete, function to cleanup ctx session will be done.
+   * Error will be seen by the user via a EOF on a read() or
+   * EPIPE on a write().
+   */
+  if (list_delete_all (console_engine_ctxs[index], _ctx_find, c) != 1)
+    IPMICONSOLE_DEBUG (("list_delete_all: %s", strerror (errno)));
+  else
+    console_engine_ctxs_count[index]--;
+
+  if ((perr = pthread_mutex_unlock (&console_engine_ctxs_mutex[index])))
+    IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+}
+
+/* Contexts are only processed by the engine thread they were
+ * submitted to, so the ctxs mutex is only needed to modify the list
+ * of contexts, not to process them.  This keeps
+ * ipmiconsole_engine_submit() from waiting on the engine.
+ */
+/* Returns the number of contexts processed */
+static unsigned int
+_engine_process_ready (unsigned int index,
+                       struct _ipmiconsole_timer_heap *timers,
+                       ipmiconsole_ctx_t *ready)
+{
+  ipmiconsole_ctx_t c;
+  unsigned int processed = 0;
+
+  while ((c = *ready))
+    {
+      struct timeval current;
+      unsigned int timeout;
+
+      *ready = c->engine.ready_next;
+      c->engine.ready = 0;
+      c->engine.ready_next = NULL;
+      processed++;
+
+      /* Newly submitted context */
+      if (c->engine.fds[IPMICONSOLE_ENGINE_FD_ASYNCCOMM].fd < 0
+          && _epoll_register (c) < 0)
+        {
+          _engine_ctx_remove (index, timers, c);
+          continue;
+        }
+
+      c->engine.activity++;
+
+      if (ipmiconsole_process_ctx (c, &timeout) < 0)
+        {
+          _engine_ctx_remove (index, timers, c);
+          continue;
+        }
+
+      /* In throughput mode, send SOL ACKs now rather than after the
+       * next epoll_wait() reports the socket writable, so the BMC can
+       * send more console output sooner.
+       */
+      if (c->config.engine_flags & IPMICONSOLE_ENGINE_THROUGHPUT
+          && !c->session.close_session_flag
+          && !scbuf_is_empty (c->connection.ipmi_to_bmc))
+        {
+          if (_ipmi_sendto (c) < 0)
+            {
+              c->session.close_session_flag++;
+              _ready_push (ready, c);
+              continue;
+            }
+        }
+
+      if (_epoll_update (console_engine_epoll_fd[index], c) < 0)
+        {
+          _engine_ctx_remove (index, timers, c);
+          continue;
+        }
+
+      if (gettimeofday (&current, NULL) < 0)
+        {
+          IPMICONSOLE_CTX_DEBUG (c, ("gettimeofday: %s", strerror (errno)));
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+          _engine_ctx_remove (index, timers, c);
+          continue;
+        }
+
+      timeval_add_ms (&current, timeout, &c->engine.timeout);
+
+      if (_timer_heap_update (timers, c) < 0)
+        {
+          _engine_ctx_remove (index, timers, c);
+          continue;
+        }
+    }
+
+  return (processed);
+}
+
+/* Migrate the busiest context that can be moved to the least loaded
+ * engine thread without making that thread busier than this one.  A
+ * thread whose load is a single flooding context will not migrate it,
+ * so contexts do not bounce between threads.  At most one context is
+ * migrated per balance interval, so loads can be remeasured first.
+ *
+ * Must be called with no contexts ready, i.e. not while a migrated
+ * context could still be processed by this thread.
+ */
+static void
+_engine_balance (unsigned int index, struct _ipmiconsole_timer_heap *timers)
+{
+  ListIterator itr = NULL;
+  ipmiconsole_ctx_t c, migrate = NULL;
+  unsigned int thread_count;
+  unsigned int load = 0;
+  unsigned int dst_load = UINT_MAX;
+  unsigned int dst = index;
+  unsigned int activity = 0;
+  unsigned int i;
+  int perr;
+
+  if ((perr = pthread_mutex_lock (&console_engine_thread_count_mutex)))
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+      return;
+    }
+
+  thread_count = console_engine_thread_count;
+
+  if ((perr = pthread_mutex_unlock (&console_engine_thread_count_mutex)))
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+      return;
+    }
+
+  if ((perr = pthread_mutex_lock (&console_engine_ctxs_mutex[index])))
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+      return;
+    }
+
+  if (!(itr = list_iterator_create (console_engine_ctxs[index])))
+    {
+      IPMICONSOLE_DEBUG (("list_iterator_create: %s", strerror (errno)));
+      goto unlock;
+    }
+
+  while ((c = (ipmiconsole_ctx_t)list_next (itr)))
+    load += c->engine.activity;
+
+  console_engine_load[index] = load;
+
+  if ((perr = pthread_mutex_unlock (&console_engine_ctxs_mutex[index])))
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+      goto cleanup;
+    }
+
+  if (load >= IPMICONSOLE_ENGINE_BALANCE_LOAD_MIN)
+    {
+      /* Only one ctxs mutex is held at a time, so engine threads
+       * balancing at the same time cannot deadlock.
+       */
+      for (i = 0; i < thread_count; i++)
+        {
+          if (i == index)
+            continue;
+
+          if ((perr = pthread_mutex_lock (&console_engine_ctxs_mutex[i])))
+            {
+              IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+              goto cleanup;
+            }
+
+          if (console_engine_load[i] < dst_load)
+            {
+              dst_load = console_engine_load[i];
+              dst = i;
+            }
+
+          if ((perr = pthread_mutex_unlock (&console_engine_ctxs_mutex[i])))
+            {
+              IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+              goto cleanup;
+            }
+        }
+    }
+
+  if ((perr = pthread_mutex_lock (&console_engine_ctxs_mutex[index])))
+    {
+      IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+      goto cleanup;
+    }
+
+  /* Newly submitted contexts and contexts being torn down have no
+   * activity worth moving, and may still be queued to be processed
+   * by this thread.
+   */
+  list_iterator_reset (itr);
+  while ((c = (ipmiconsole_ctx_t)list_next (itr)))
+    {
+      if (dst != index
+          && c->engine.activity
+          && c->engine.activity > activity
+          && dst_load + c->engine.activity < load
+          && c->engine.fds[IPMICONSOLE_ENGINE_FD_ASYNCCOMM].fd >= 0
+          && !c->session.close_session_flag)
+        {
+          migrate = c;
+          activity = c->engine.activity;
+        }
+      c->engine.activity = 0;
+    }
+
+  if (migrate)
+    {
+      list_iterator_reset (itr);
+      if (!list_find (itr, _ctx_find, migrate))
+        {
+          IPMICONSOLE_DEBUG (("list_find: %s", strerror (errno)));
+          migrate = NULL;
+        }
+      else
+        {
+          /* Removed, not deleted, the context is not done */
+          list_remove (itr);
+          console_engine_ctxs_count[index]--;
+          console_engine_load[index] -= activity;
+        }
+    }
+
+ unlock:
+  if ((perr = pthread_mutex_unlock (&console_engine_ctxs_mutex[index])))
+    IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+
+  if (!migrate)
+    goto cleanup;
+
+  /* This thread must stop listening on the context before another
+   * thread begins processing it.  The new thread registers the
+   * context again just like a newly submitted one.
+   */
+  _timer_heap_remove (timers, migrate);
+  _epoll_unregister (console_engine_epoll_fd[index], migrate);
+
+  IPMICONSOLE_CTX_DEBUG (migrate, ("migrating to engine thread %u: activity=%u; load=%u; thread load=%u",
+                                   dst, activity, dst_load, load));
+
+  /* We have to move the context, so in general continue on even if
+   * locking fails.  If the other thread exited for an engine
+   * teardown, the context is cleaned up with its list.
+   */
+  if ((perr = pthread_mutex_lock (&console_engine_ctxs_mutex[dst])))
+    IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+
+  if (!list_append (console_engine_ctxs_new[dst], migrate))
+    {
+      IPMICONSOLE_DEBUG (("list_append: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (migrate, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      goto cleanup_migrate;
+    }
+
+  if (!list_append (console_engine_ctxs[dst], migrate))
+    {
+      IPMICONSOLE_DEBUG (("list_append: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (migrate, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      list_delete_all (console_engine_ctxs_new[dst], _ctx_find, migrate);
+      goto cleanup_migrate;
+    }
+
+  console_engine_ctxs_count[dst]++;
+
+  /* So other threads see the new load before it is remeasured */
+  console_engine_load[dst] += activity;
+  migrate = NULL;
+
+ cleanup_migrate:
+  if ((perr = pthread_mutex_unlock (&console_engine_ctxs_mutex[dst])))
+    IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+
+  /* The context is in no list, so clean it up as its list would have */
+  if (migrate)
+    {
+      ipmiconsole_ctx_connection_cleanup_session_submitted (migrate);
+      goto cleanup;
+    }
+
+  if (write (console_engine_ctxs_notifier[dst][1], "1", 1) < 0)
+    IPMICONSOLE_DEBUG (("write: %s", strerror (errno)));
+
+ cleanup:
+  if (itr)
+    list_iterator_destroy (itr);
+}
+
+static void *
+_ipmiconsole_engine (void *arg)
+{
+  struct _ipmiconsole_timer_heap timers;
+  struct epoll_event events[IPMICONSOLE_EPOLL_EVENTS_MAX];
+  struct timeval balance_time;
+  ipmiconsole_ctx_t ready = NULL;
+  int perr, ctxs_count = 0;
+  unsigned int load = 0;
+  unsigned int processed;
+  unsigned int index;
+  unsigned int teardown_flag = 0;
+  unsigned int teardown_initiated = 0;
+  int epfd;
+
+  assert (arg);
+
+  index = *((unsigned int *)arg);
+
+  assert (index < IPMICONSOLE_THREAD_COUNT_MAX);
+
+  free (arg);
+
+  /* No need to exit on failure, probability is low we'll SIGPIPE anyways */
+  if (signal (SIGPIPE, SIG_IGN) == SIG_ERR)
+    IPMICONSOLE_DEBUG (("signal: %s", strerror (errno)));
+
+  epfd = console_engine_epoll_fd[index];
+  memset (&timers, '\0', sizeof (struct _ipmiconsole_timer_heap));
+  timeval_clear (&balance_time);
+
+  while (!teardown_flag || ctxs_count)
+    {
+      ipmiconsole_ctx_t c;
+      struct timeval process_start, process_end;
+      char buf[IPMICONSOLE_PIPE_BUFLEN];
+      int timeout;
+      int nfds;
+      int i;
+
+      if ((perr = pthread_mutex_lock (&console_engine_teardown_mutex)))
+        {
+          /* This is one of the only truly "fatal" conditions */
+          IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+          teardown_flag = 1;
+        }
 
-  assert (c);
-  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+      if (console_engine_teardown_immediate)
+        {
+          if ((perr = pthread_mutex_unlock (&console_engine_teardown_mutex)))
+            IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+          break;
+        }
 
-  if ((len = read (c->connection.asynccomm[0], (void *)&tmpbyte, 1)) < 0)
-    {
-      IPMICONSOLE_CTX_DEBUG (c, ("read: %s", strerror (errno)));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
-      return (-1);
-    }
+      if (console_engine_teardown)
+        teardown_flag = 1;
 
-  if (!len)
-    {
-      IPMICONSOLE_CTX_DEBUG (c, ("asynccomm closed"));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-      return (-1);
-    }
+      if ((perr = pthread_mutex_unlock (&console_engine_teardown_mutex)))
+        {
+          /* This is one of the only truly "fatal" conditions */
+          IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+          teardown_flag = 1;
+        }
 
-  /* User may have requested several break conditions in a
-   * row quickly.  We assume it means just one
-   */
-  if (tmpbyte == IPMICONSOLE_PIPE_GENERATE_BREAK_CODE)
-    {
-      if (!(c->session.break_requested))
+      if ((perr = pthread_mutex_lock (&console_engine_ctxs_mutex[index])))
         {
-          int bytes_before_break;
+          /* This is one of the only truly "fatal" conditions */
+          IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+          teardown_flag = 1;
+        }
 
-          c->session.break_requested++;
+      /* Newly submitted contexts are registered when first processed.
+       * Contexts migrated from another thread after this thread began
+       * its teardown must be torn down too.
+       */
+      while ((c = (ipmiconsole_ctx_t)list_pop (console_engine_ctxs_new[index])))
+        {
+          if (teardown_initiated)
+            _teardown_initiate (c, &ready);
+          else
+            _ready_push (&ready, c);
+        }
 
-          if ((bytes_before_break = scbuf_used (c->connection.console_remote_console_to_bmc)) < 0)
+      /* Note: Set close_session_flag in the contexts before processing,
+       * so the initiation of the closing down will begin now rather
+       * than the next iteration of the loop.
+       */
+      if (teardown_flag && !teardown_initiated)
+        {
+          /* XXX: Umm, if this fails, we may not be able to teardown
+           * cleanly.  Break out of the loop I guess.
+           */
+          if (list_for_each (console_engine_ctxs[index], _teardown_initiate, &ready) < 0)
             {
-              IPMICONSOLE_CTX_DEBUG (c, ("scbuf_used: %s", strerror (errno)));
-              ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-              return (-1);
+              IPMICONSOLE_DEBUG (("list_for_each: %s", strerror (errno)));
+              if ((perr = pthread_mutex_unlock (&console_engine_ctxs_mutex[index])))
+                IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+              break;
             }
-          c->session.console_remote_console_to_bmc_bytes_before_break = bytes_before_break;
+          teardown_initiated++;
         }
-    }
 
-  return (0);
-}
+      if ((perr = pthread_mutex_unlock (&console_engine_ctxs_mutex[index])))
+        {
+          /* This is one of the only truly "fatal" conditions */
+          IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+          teardown_flag = 1;
+        }
 
-/*
- * Return 0 on success
- * Return -1 on fatal error
- */
-static int
-_console_read (ipmiconsole_ctx_t c)
-{
-  char buffer[IPMICONSOLE_PACKET_BUFLEN];
-  ssize_t len;
-  int n, dropped = 0;
-  int secure_malloc_flag;
+      if (gettimeofday (&process_start, NULL) < 0)
+        {
+          IPMICONSOLE_DEBUG (("gettimeofday: %s", strerror (errno)));
+          timeval_clear (&process_start);
+        }
 
-  assert (c);
-  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
-  assert (!c->session.close_session_flag);
+      processed = _engine_process_ready (index, &timers, &ready);
 
-  secure_malloc_flag = (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY) ? 1 : 0;
+      if (gettimeofday (&process_end, NULL) < 0)
+        {
+          IPMICONSOLE_DEBUG (("gettimeofday: %s", strerror (errno)));
+          timeval_clear (&process_end);
+        }
 
-  if ((len = read (c->connection.ipmiconsole_fd,
-                   buffer,
-                   IPMICONSOLE_PACKET_BUFLEN)) < 0)
-    {
-      IPMICONSOLE_CTX_DEBUG (c, ("read: %s", strerror (errno)));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
-      return (-1);
-    }
+      if (!teardown_flag && !timeval_lt (&process_end, &balance_time))
+        {
+          _engine_balance (index, &timers);
+          timeval_add_ms (&process_end, IPMICONSOLE_ENGINE_BALANCE_INTERVAL, &balance_time);
+        }
 
-  if (!len)
-    {
-      /* Returning -1 closes the session, but really this error is ok
-       * since the user is allowed to close the session
+      /* Only this thread removes contexts from the list, so the count
+       * can only grow before the next iteration.  A submission
+       * interrupts epoll_wait() via the notifier.
        */
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
-      return (-1);
-    }
+      if ((perr = pthread_mutex_lock (&console_engine_ctxs_mutex[index])))
+        {
+          /* This is one of the only truly "fatal" conditions */
+          IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+          teardown_flag = 1;
+        }
 
-  if ((n = scbuf_write (c->connection.console_remote_console_to_bmc, buffer, len, &dropped, secure_malloc_flag)) < 0)
-    {
-      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: %s", strerror (errno)));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-      return (-1);
-    }
+      ctxs_count = list_count (console_engine_ctxs[index]);
+      load = console_engine_load[index];
+      _engine_stats_update (index, processed, &process_start, &process_end);
 
-  if (n != len)
-    {
-      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: invalid bytes written; n=%d; len=%d", n, len));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-      return (-1);
-    }
+      if ((perr = pthread_mutex_unlock (&console_engine_ctxs_mutex[index])))
+        {
+          /* This is one of the only truly "fatal" conditions */
+          IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+          teardown_flag = 1;
+        }
 
-  if (dropped)
-    {
-      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: dropped data: dropped=%d", dropped));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-      return (-1);
-    }
+      timeout = _timer_heap_timeout (&timers);
 
-  return (0);
-}
+      /* Wake up to remeasure the load if the contexts are busy, an
+       * idle thread's load of 0 stays valid while it sleeps.
+       */
+      if (timeout < 0 || timeout > IPMICONSOLE_ENGINE_BALANCE_INTERVAL)
+        {
+          if (load)
+            timeout = IPMICONSOLE_ENGINE_BALANCE_INTERVAL;
+        }
 
-/*
- * Return 0 on success
- * Return -1 on fatal error
- */
-static int
-_console_write (ipmiconsole_ctx_t c)
-{
-  char buffer[IPMICONSOLE_PACKET_BUFLEN];
-  ssize_t len;
-  int n;
+      if (!ctxs_count && teardown_flag)
+        continue;
 
-  assert (c);
-  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
-  assert (!c->session.close_session_flag);
+      /* If no contexts are stored, sleep until the notifier says
+       * otherwise.
+       */
+      if ((nfds = epoll_wait (epfd, events, IPMICONSOLE_EPOLL_EVENTS_MAX, timeout)) < 0)
+        {
+          if (errno != EINTR)
+            IPMICONSOLE_DEBUG (("epoll_wait: %s", strerror (errno)));
+          continue;
+        }
 
-  /*
-   * XXX: Shouldn't assume user will read data fast enough?  I could
-   * overrun buffers?
-   *
-   * Deal with it later.
-   */
+      for (i = 0; i < nfds; i++)
+        {
+          struct ipmiconsole_ctx_engine_fd *efd;
+          short revents;
 
-  if ((n = scbuf_read (c->connection.console_bmc_to_remote_console, buffer, IPMICONSOLE_PACKET_BUFLEN)) < 0)
-    {
-      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_read: %s", strerror (errno)));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-      return (-1);
-    }
+          /* We don't care what's read, just get it off the fd */
+          if (!(efd = (struct ipmiconsole_ctx_engine_fd *)events[i].data.ptr))
+            {
+              if (read (console_engine_ctxs_notifier[index][0], buf, IPMICONSOLE_PIPE_BUFLEN) < 0)
+                IPMICONSOLE_DEBUG (("read: %s", strerror (errno)));
+              continue;
+            }
 
-  if ((len = write (c->connection.ipmiconsole_fd,
-                    buffer,
-                    n)) < 0)
-    {
-      IPMICONSOLE_CTX_DEBUG (c, ("write: %s", strerror (errno)));
+          c = efd->c;
+          revents = _epoll_revents (events[i].events);
 
-      if (errno == EPIPE)
-        {
-          /* This error is ok since the user is allowed to close the
-           * session
-           */
-          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SUCCESS);
+          if (efd == &c->engine.fds[IPMICONSOLE_ENGINE_FD_IPMI])
+            _ctx_handle_revents (c, revents, 0, 0);
+          else if (efd == &c->engine.fds[IPMICONSOLE_ENGINE_FD_ASYNCCOMM])
+            _ctx_handle_revents (c, 0, revents, 0);
+          else
+            _ctx_handle_revents (c, 0, 0, revents);
+
+          _ready_push (&ready, c);
         }
-      else
-        ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
-      return (-1);
-    }
 
-  if (len != n)
-    {
-      IPMICONSOLE_CTX_DEBUG (c, ("write: invalid bytes written; n=%d; len=%d", n, len));
-      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-      return (-1);
+      _timer_heap_expire (&timers, &ready);
     }
 
-  /* scbuf should be empty now */
-  if (!scbuf_is_empty (c->connection.console_bmc_to_remote_console))
-    {
-      IPMICONSOLE_CTX_DEBUG (c, ("console_bmc_to_remote_console not empty"));
-      /* Note: Not a fatal error, just return*/
-      return (0);
-    }
+  /* Contexts remaining after an immediate teardown are destroyed in
+   * ipmiconsole_engine_cleanup(), just stop listening on their fds.
+   */
+  if ((perr = pthread_mutex_lock (&console_engine_ctxs_mutex[index])))
+    IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
 
-  return (0);
-}
+  if (list_for_each (console_engine_ctxs[index], _epoll_unregister_ctx, &epfd) < 0)
+    IPMICONSOLE_DEBUG (("list_for_each: %s", strerror (errno)));
+
+  if ((perr = pthread_mutex_unlock (&console_engine_ctxs_mutex[index])))
+    IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
+
+  free (timers.ctxs);
+
+  /* No way to return error, so just continue on even if there is a failure */
+  if ((perr = pthread_mutex_lock (&console_engine_thread_count_mutex)))
+    IPMICONSOLE_DEBUG (("pthread_mutex_lock: %s", strerror (perr)));
+
+  console_engine_thread_count--;
+
+  if ((perr = pthread_mutex_unlock (&console_engine_thread_count_mutex)))
+    IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
 
+  return (NULL);
+}
+#else /* !HAVE_SYS_EPOLL_H */
 static int
 _ipmiconsole_poll (struct pollfd *ufds, unsigned int nfds, int timeout)
 {
@@ -955,6 +2438,7 @@ _ipmiconsole_engine (void *arg)
   while (!teardown_flag || ctxs_count)
     {
       struct _ipmiconsole_poll_data poll_data;
+      struct timeval process_start, process_end;
       int count;
       unsigned int timeout_len;
       unsigned int i;
@@ -1022,9 +2506,27 @@ _ipmiconsole_engine (void *arg)
           teardown_initiated++;
         }
 
+      if (gettimeofday (&process_start, NULL) < 0)
+        {
+          IPMICONSOLE_DEBUG (("gettimeofday: %s", strerror (errno)));
+          timeval_clear (&process_start);
+        }
+
       if ((ctxs_count = ipmiconsole_process_ctxs (console_engine_ctxs[index], &timeout_len)) < 0)
         goto continue_loop;
 
+      if (gettimeofday (&process_end, NULL) < 0)
+        {
+          IPMICONSOLE_DEBUG (("gettimeofday: %s", strerror (errno)));
+          timeval_clear (&process_end);
+        }
+
+      /* Every context is processed on every iteration */
+      _engine_stats_update (index, ctxs_count, &process_start, &process_end);
+
+      /* Finished contexts were deleted, so submissions see the count */
+      console_engine_ctxs_count[index] = ctxs_count;
+
       if (!ctxs_count && teardown_flag)
         continue;
 
@@ -1100,99 +2602,10 @@ _ipmiconsole_engine (void *arg)
         }
 
       for (i = 0; i < poll_data.ctxs_len; i++)
-        {
-          if (poll_data.pfds[i*3].revents & POLLERR)
-            {
-              IPMICONSOLE_CTX_DEBUG (poll_data.pfds_ctxs[i], ("POLLERR"));
-              /* See comments in _ipmi_recvfrom() regarding ECONNRESET/ECONNREFUSED */
-              if (_ipmi_recvfrom (poll_data.pfds_ctxs[i]) < 0)
-                {
-                  ipmiconsole_ctx_set_errnum (poll_data.pfds_ctxs[i], IPMICONSOLE_ERR_SYSTEM_ERROR);
-                  poll_data.pfds_ctxs[i]->session.close_session_flag++;
-                  continue;
-                }
-            }
-          if (!poll_data.pfds_ctxs[i]->session.close_session_flag)
-            {
-              if (poll_data.pfds[i*3+1].revents & POLLNVAL)
-                {
-                  /* This indicates the user closed the asynccomm file descriptors
-                   * which is ok.
-                   */
-                  IPMICONSOLE_CTX_DEBUG (poll_data.pfds_ctxs[i], ("POLLNVAL"));
-                  ipmiconsole_ctx_set_errnum (poll_data.pfds_ctxs[i], IPMICONSOLE_ERR_SUCCESS);
-                  poll_data.pfds_ctxs[i]->session.close_session_flag++;
-                  continue;
-                }
-              if (poll_data.pfds[i*3+2].revents & POLLHUP)
-                {
-                  /* This indicates the user closed the other end of
-                   * the socketpair so it's ok.
-                   */
-                  IPMICONSOLE_CTX_DEBUG (poll_data.pfds_ctxs[i], ("POLLHUP"));
-                  ipmiconsole_ctx_set_errnum (poll_data.pfds_ctxs[i], IPMICONSOLE_ERR_SUCCESS);
-                  poll_data.pfds_ctxs[i]->session.close_session_flag++;
-                  continue;
-                }
-              if (poll_data.pfds[i*3+1].revents & POLLERR)
-                {
-                  IPMICONSOLE_CTX_DEBUG (poll_data.pfds_ctxs[i], ("POLLERR"));
-                  ipmiconsole_ctx_set_errnum (poll_data.pfds_ctxs[i], IPMICONSOLE_ERR_INTERNAL_ERROR);
-                  poll_data.pfds_ctxs[i]->session.close_session_flag++;
-                  continue;
-                }
-              if (poll_data.pfds[i*3+2].revents & POLLERR)
-                {
-                  IPMICONSOLE_CTX_DEBUG (poll_data.pfds_ctxs[i], ("POLLERR"));
-                  ipmiconsole_ctx_set_errnum (poll_data.pfds_ctxs[i], IPMICONSOLE_ERR_INTERNAL_ERROR);
-                  poll_data.pfds_ctxs[i]->session.close_session_flag++;
-                  continue;
-                }
-            }
-          if (poll_data.pfds[i*3].revents & POLLIN)
-            {
-              if (_ipmi_recvfrom (poll_data.pfds_ctxs[i]) < 0)
-                {
-                  poll_data.pfds_ctxs[i]->session.close_session_flag++;
-                  continue;
-                }
-            }
-          if (poll_data.pfds[i*3].revents & POLLOUT)
-            {
-              if (_ipmi_sendto (poll_data.pfds_ctxs[i]) < 0)
-                {
-                  poll_data.pfds_ctxs[i]->session.close_session_flag++;
-                  continue;
-                }
-            }
-          if (poll_data.pfds[i*3 + 1].revents & POLLIN)
-            {
-              if (_asynccomm (poll_data.pfds_ctxs[i]) < 0)
-                {
-                  poll_data.pfds_ctxs[i]->session.close_session_flag++;
-                  continue;
-                }
-            }
-          if (!poll_data.pfds_ctxs[i]->session.close_session_flag)
-            {
-              if (poll_data.pfds[i*3+2].revents & POLLIN)
-                {
-                  if (_console_read (poll_data.pfds_ctxs[i]) < 0)
-                    {
-                      poll_data.pfds_ctxs[i]->session.close_session_flag++;
-                      continue;
-                    }
-                }
-              if (poll_data.pfds[i*3+2].revents & POLLOUT)
-                {
-                  if (_console_write (poll_data.pfds_ctxs[i]) < 0)
-                    {
-                      poll_data.pfds_ctxs[i]->session.close_session_flag++;
-                      continue;
-                    }
-                }
-            }
-        }
+        _ctx_handle_revents (poll_data.pfds_ctxs[i],
+                             poll_data.pfds[i*3].revents,
+                             poll_data.pfds[i*3 + 1].revents,
+                             poll_data.pfds[i*3 + 2].revents);
 
       /* We don't care what's read, just get it off the fd */
       if (poll_data.pfds[(poll_data.ctxs_len * 3)].revents & POLLIN)
@@ -1235,6 +2648,7 @@ _ipmiconsole_engine (void *arg)
 
   return (NULL);
 }
+#endif /* !HAVE_SYS_EPOLL_H */
 
 /* Notes: On an error, it is the responsibility of the caller to call
  * ipmiconsole_engine_cleanup() to destroy all previously created
@@ -1356,6 +2770,27 @@ ipmiconsole_engine_submit_ctx (ipmiconsole_ctx_t c)
       goto cleanup_thread_count;
     }
 
+#if HAVE_SYS_EPOLL_H
+  c->engine.fds[IPMICONSOLE_ENGINE_FD_IPMI].fd = -1;
+  c->engine.fds[IPMICONSOLE_ENGINE_FD_ASYNCCOMM].fd = -1;
+  c->engine.fds[IPMICONSOLE_ENGINE_FD_CONSOLE].fd = -1;
+  for (i = 0; i < IPMICONSOLE_ENGINE_FDS; i++)
+    {
+      c->engine.fds[i].c = c;
+      c->engine.fds[i].events = 0;
+    }
+  c->engine.timer_queued = 0;
+  c->engine.ready = 0;
+  c->engine.ready_next = NULL;
+
+  if (!(ptr = list_append (console_engine_ctxs_new[index], c)))
+    {
+      IPMICONSOLE_DEBUG (("list_append: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      goto cleanup_ctxs;
+    }
+#endif /* HAVE_SYS_EPOLL_H */
+
   if (!(ptr = list_append (console_engine_ctxs[index], c)))
     {
       /* Note: Don't do a CTX debug, this is more of a global debug */
@@ -1396,6 +2831,11 @@ ipmiconsole_engine_submit_ctx (ipmiconsole_ctx_t c)
     IPMICONSOLE_DEBUG (("write: %s", strerror (errno)));
 
  cleanup_ctxs:
+#if HAVE_SYS_EPOLL_H
+  /* No delete function on this list, the context is the user's on failure */
+  if (ret < 0)
+    list_delete_all (console_engine_ctxs_new[index], _ctx_find, c);
+#endif /* HAVE_SYS_EPOLL_H */
   if ((perr = pthread_mutex_unlock (&console_engine_ctxs_mutex[index])))
     {
       IPMICONSOLE_DEBUG (("pthread_mutex_unlock: %s", strerror (perr)));
@@ -1537,6 +2977,14 @@ ipmiconsole_engine_cleanup (int cleanup_sol_sessions)
       close (console_engine_ctxs_notifier[i][0]);
       /* ignore potential error, cleanup path */
       close (console_engine_ctxs_notifier[i][1]);
+#if HAVE_SYS_EPOLL_H
+      if (console_engine_ctxs_new[i])
+        list_destroy (console_engine_ctxs_new[i]);
+      console_engine_ctxs_new[i] = NULL;
+      /* ignore potential error, cleanup path */
+      close (console_engine_epoll_fd[i]);
+      console_engine_epoll_fd[i] = -1;
+#endif /* HAVE_SYS_EPOLL_H */
     }
   /* ignore potential error, cleanup path */
   close (garbage_collector_notifier[0]);
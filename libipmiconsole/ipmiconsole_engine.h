@@ -39,6 +39,15 @@ int ipmiconsole_engine_thread_create (void);
 
 int ipmiconsole_engine_submit_ctx (ipmiconsole_ctx_t c);
 
+int ipmiconsole_engine_set_handshake_limits (unsigned int handshakes_max,
+                                             unsigned int subnet_handshake_rate);
+
+int ipmiconsole_engine_handshake_admit (ipmiconsole_ctx_t c);
+
+void ipmiconsole_engine_handshake_release (ipmiconsole_ctx_t c);
+
+int ipmiconsole_engine_get_stats (struct ipmiconsole_engine_stats *stats);
+
 int ipmiconsole_engine_cleanup (int cleanup_sol_sessions);
 
 #endif /* IPMICONSOLE_ENGINE_H */
@@ -74,6 +74,141 @@
 #include "secure.h"
 #include "timeval.h"
 
+/* Statistics are only informational, so locking errors are not fatal */
+static void
+_stats_sol_input (ipmiconsole_ctx_t c,
+                  unsigned int bytes,
+                  unsigned int packets,
+                  unsigned int retransmissions,
+                  unsigned int buffered)
+{
+  int perr;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  if ((perr = pthread_mutex_lock (&(c->signal.stats_mutex))) != 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_lock: %s", strerror (perr)));
+      return;
+    }
+
+  c->signal.stats.sol_input_bytes += bytes;
+  c->signal.stats.sol_input_packets += packets;
+  c->signal.stats.sol_input_retransmissions += retransmissions;
+  if (buffered > c->signal.stats.sol_input_buffered_max)
+    c->signal.stats.sol_input_buffered_max = buffered;
+
+  if ((perr = pthread_mutex_unlock (&(c->signal.stats_mutex))) != 0)
+    IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_unlock: %s", strerror (perr)));
+}
+
+static void
+_stats_sol_output (ipmiconsole_ctx_t c,
+                   unsigned int bytes,
+                   int is_retransmission,
+                   unsigned int buffered)
+{
+  int perr;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  if ((perr = pthread_mutex_lock (&(c->signal.stats_mutex))) != 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_lock: %s", strerror (perr)));
+      return;
+    }
+
+  c->signal.stats.sol_output_bytes += bytes;
+  if (is_retransmission)
+    c->signal.stats.sol_output_retransmissions++;
+  else
+    c->signal.stats.sol_output_packets++;
+  if (buffered > c->signal.stats.sol_output_buffered_max)
+    c->signal.stats.sol_output_buffered_max = buffered;
+
+  if ((perr = pthread_mutex_unlock (&(c->signal.stats_mutex))) != 0)
+    IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_unlock: %s", strerror (perr)));
+}
+
+static void
+_stats_ipmi (ipmiconsole_ctx_t c,
+             unsigned int retransmissions,
+             unsigned int keepalives)
+{
+  int perr;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  if ((perr = pthread_mutex_lock (&(c->signal.stats_mutex))) != 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_lock: %s", strerror (perr)));
+      return;
+    }
+
+  c->signal.stats.ipmi_retransmissions += retransmissions;
+  c->signal.stats.keepalives += keepalives;
+
+  if ((perr = pthread_mutex_unlock (&(c->signal.stats_mutex))) != 0)
+    IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_unlock: %s", strerror (perr)));
+}
+
+/*
+ * Hand console output to the user, via the data callback if set,
+ * otherwise buffered for the user's file descriptor.
+ *
+ * Returns 0 on success
+ * Returns -1 on error
+ */
+static int
+_console_output (ipmiconsole_ctx_t c, const void *buf, unsigned int buflen)
+{
+  int n, dropped = 0;
+  int secure_malloc_flag;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+  assert (buf);
+  assert (buflen);
+
+  if (c->config.data_callback)
+    {
+      (*(c->config.data_callback))(buf, buflen, c->config.data_callback_arg);
+      return (0);
+    }
+
+  secure_malloc_flag = (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY) ? 1 : 0;
+
+  if ((n = scbuf_write (c->connection.console_bmc_to_remote_console,
+                        (void *)buf,
+                        buflen,
+                        &dropped,
+                        secure_malloc_flag)) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  if (n != buflen)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: invalid bytes written; n=%d; buflen=%u", n, buflen));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  if (dropped)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: dropped data: dropped=%d", dropped));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  return (0);
+}
+
 /*
  * Returns 0 on success
  * Returns -1 on error
@@ -158,7 +293,10 @@ _send_ipmi_packet (ipmiconsole_ctx_t c, ipmiconsole_packet_type_t p)
   if (p != IPMICONSOLE_PACKET_TYPE_GET_CHANNEL_PAYLOAD_VERSION_RQ)
     t = &(c->session.last_ipmi_packet_sent);
   else
-    t = &(c->session.last_keepalive_packet_sent);
+    {
+      t = &(c->session.last_keepalive_packet_sent);
+      _stats_ipmi (c, 0, 1);
+    }
 
   if (gettimeofday (t, NULL) < 0)
     {
@@ -211,6 +349,8 @@ _send_sol_packet_with_character_data (ipmiconsole_ctx_t c,
         /* Sequence number 0 is special, so start at 1 */
         c->session.sol_input_packet_sequence_number = 1;
 
+      timeval_clear (&(c->session.sol_input_coalesce_start));
+
       if (!scbuf_is_empty (c->connection.console_remote_console_to_bmc))
         {
           /*
@@ -285,6 +425,13 @@ _send_sol_packet_with_character_data (ipmiconsole_ctx_t c,
       goto cleanup;
     }
 
+  if (is_retransmission)
+    _stats_sol_input (c, 0, 0, 1, 0);
+  else if (c->session.sol_input_character_data_len)
+    _stats_sol_input (c, 0, 1, 0, 0);
+
+  c->session.sol_input_retransmitted = is_retransmission;
+
   if (gettimeofday (&(c->session.last_sol_input_packet_sent), NULL) < 0)
     {
       IPMICONSOLE_CTX_DEBUG (c, ("gettimeofday: %s", strerror (errno)));
@@ -447,6 +594,11 @@ _send_sol_packet_generate_break (ipmiconsole_ctx_t c,
       return (-1);
     }
 
+  if (is_retransmission)
+    _stats_sol_input (c, 0, 0, 1, 0);
+
+  c->session.sol_input_retransmitted = is_retransmission;
+
   if (gettimeofday (&(c->session.last_sol_input_packet_sent), NULL) < 0)
     {
       IPMICONSOLE_CTX_DEBUG (c, ("gettimeofday: %s", strerror (errno)));
@@ -459,6 +611,80 @@ _send_sol_packet_generate_break (ipmiconsole_ctx_t c,
   return (0);
 }
 
+/*
+ * Update round trip time estimates as described in RFC 6298, using
+ * a packet sent at 'sent' that was just responded to.
+ *
+ * Returns 0 on success
+ * Returns -1 on error
+ */
+static int
+_update_rtt (ipmiconsole_ctx_t c, struct timeval *sent)
+{
+  struct timeval current;
+  struct timeval delta;
+  unsigned int rtt;
+  unsigned int rto;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+  assert (sent);
+
+  if (!(c->config.engine_flags & IPMICONSOLE_ENGINE_ADAPTIVE_RETRANSMISSION))
+    return (0);
+
+  if (gettimeofday (&current, NULL) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("gettimeofday: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+      return (-1);
+    }
+
+  timeval_sub (&current, sent, &delta);
+  timeval_millisecond_calc (&delta, &rtt);
+
+  if (!c->session.rtt_sample_count)
+    {
+      c->session.srtt = rtt;
+      c->session.rttvar = rtt / 2;
+    }
+  else
+    {
+      unsigned int err;
+
+      err = (c->session.srtt > rtt) ? (c->session.srtt - rtt) : (rtt - c->session.srtt);
+      c->session.rttvar = (3 * c->session.rttvar + err) / 4;
+      c->session.srtt = (7 * c->session.srtt + rtt) / 8;
+    }
+
+  /* clock granularity is 1 millisecond */
+  rto = c->session.srtt + ((4 * c->session.rttvar) > 1 ? (4 * c->session.rttvar) : 1);
+  if (rto < IPMICONSOLE_ADAPTIVE_RETRANSMISSION_TIMEOUT_MIN)
+    rto = IPMICONSOLE_ADAPTIVE_RETRANSMISSION_TIMEOUT_MIN;
+  if (rto > c->config.session_timeout_len)
+    rto = c->config.session_timeout_len;
+  c->session.rto = rto;
+  c->session.rtt_sample_count++;
+
+  return (0);
+}
+
+/*
+ * Returns the retransmission timeout length before any backoff
+ */
+static unsigned int
+_retransmission_timeout_len (ipmiconsole_ctx_t c)
+{
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  if (c->config.engine_flags & IPMICONSOLE_ENGINE_ADAPTIVE_RETRANSMISSION
+      && c->session.rtt_sample_count)
+    return (c->session.rto);
+
+  return (c->config.retransmission_timeout_len);
+}
+
 /*
  * Returns 0 on success
  * Returns -1 on error
@@ -1327,6 +1553,13 @@ _receive_packet (ipmiconsole_ctx_t c, ipmiconsole_packet_type_t *p)
     }
   else
     {
+      /* Karn's algorithm - don't sample responses to retransmitted packets */
+      if (!c->session.retransmission_count)
+        {
+          if (_update_rtt (c, &(c->session.last_ipmi_packet_sent)) < 0)
+            goto cleanup;
+        }
+
       if (_receive_ipmi_packet_data_reset (c) < 0)
         goto cleanup;
     }
@@ -1470,7 +1703,7 @@ _ipmi_retransmission_timeout (ipmiconsole_ctx_t c)
     retransmission_timeout_multiplier = (c->session.retransmission_count / c->config.retransmission_backoff_count) + 1;
   else
     retransmission_timeout_multiplier = 1;
-  retransmission_timeout_len = c->config.retransmission_timeout_len * retransmission_timeout_multiplier;
+  retransmission_timeout_len = _retransmission_timeout_len (c) * retransmission_timeout_multiplier;
 
   timeval_add_ms (&(c->session.last_ipmi_packet_sent), retransmission_timeout_len, &timeout);
 
@@ -1494,6 +1727,8 @@ _ipmi_retransmission_timeout (ipmiconsole_ctx_t c)
         ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_EXCESS_RETRANSMISSIONS_SENT);
       return (-1);
     }
+
+  _stats_ipmi (c, 1, 0);
 #if 0
   IPMICONSOLE_CTX_DEBUG (c, ("retransmission: retransmission_count = %d; maximum_retransmission_count = %d; protocol_state = %d", c->session.retransmission_count, c->config.maximum_retransmission_count, c->session.protocol_state));
 #endif
@@ -1612,7 +1847,7 @@ _sol_retransmission_timeout (ipmiconsole_ctx_t c, int *dont_deactivate_flag)
 
   (*dont_deactivate_flag) = 0;
 
-  timeval_add_ms (&(c->session.last_sol_input_packet_sent), c->config.retransmission_timeout_len, &timeout);
+  timeval_add_ms (&(c->session.last_sol_input_packet_sent), _retransmission_timeout_len (c), &timeout);
   if (gettimeofday (&current, NULL) < 0)
     {
       IPMICONSOLE_CTX_DEBUG (c, ("gettimeofday: %s", strerror (errno)));
@@ -2537,8 +2772,7 @@ _sol_bmc_to_remote_console_packet (ipmiconsole_ctx_t c, int *sol_deactivating_fl
   uint8_t sol_deactivating;
   uint8_t nack;
   uint64_t val;
-  int n, dropped, rv = -1;
-  int secure_malloc_flag;
+  int n, buffered, rv = -1;
 
   assert (c);
   assert (c->magic == IPMICONSOLE_CTX_MAGIC);
@@ -2547,8 +2781,6 @@ _sol_bmc_to_remote_console_packet (ipmiconsole_ctx_t c, int *sol_deactivating_fl
 
   (*sol_deactivating_flag) = 0;
 
-  secure_malloc_flag = (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY) ? 1 : 0;
-
   /*
    * The packet is either an ACK to a packet we sent, or
    * output from the console.
@@ -2661,6 +2893,13 @@ _sol_bmc_to_remote_console_packet (ipmiconsole_ctx_t c, int *sol_deactivating_fl
       && c->session.sol_input_waiting_for_ack
       && c->session.sol_input_packet_sequence_number == packet_ack_nack_sequence_number)
     {
+      /* Karn's algorithm - don't sample responses to retransmitted packets */
+      if (!c->session.sol_input_retransmitted)
+        {
+          if (_update_rtt (c, &(c->session.last_sol_input_packet_sent)) < 0)
+            goto cleanup;
+        }
+
       if (!c->session.sol_input_waiting_for_break_ack)
         {
           /* It's ok if it's a NACK, but we'll log for debugging anyways */
@@ -2679,6 +2918,14 @@ _sol_bmc_to_remote_console_packet (ipmiconsole_ctx_t c, int *sol_deactivating_fl
               accepted_character_count = c->session.sol_input_character_data_len;
             }
 
+          /* Input is buffered most just before it is acknowledged */
+          if ((buffered = scbuf_used (c->connection.console_remote_console_to_bmc)) < 0)
+            {
+              IPMICONSOLE_CTX_DEBUG (c, ("scbuf_used: %s", strerror (errno)));
+              ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+              goto cleanup;
+            }
+
           if ((n = scbuf_drop (c->connection.console_remote_console_to_bmc, accepted_character_count)) < 0)
             {
               IPMICONSOLE_CTX_DEBUG (c, ("scbuf_drop: %s", strerror (errno)));
@@ -2695,6 +2942,9 @@ _sol_bmc_to_remote_console_packet (ipmiconsole_ctx_t c, int *sol_deactivating_fl
                 }
               c->session.console_remote_console_to_bmc_bytes_before_break -= accepted_character_count;
             }
+
+          _stats_sol_input (c, accepted_character_count, 0, 0, buffered);
+
           c->session.sol_input_waiting_for_ack = 0;
           c->session.sol_input_character_data_len = 0;
         }
@@ -2737,6 +2987,8 @@ _sol_bmc_to_remote_console_packet (ipmiconsole_ctx_t c, int *sol_deactivating_fl
       int character_data_len = 0;
       unsigned int character_data_len_to_write = 0;
       unsigned int character_data_index = 0;
+      int is_retransmission = 0;
+      int buffered;
 
       if ((character_data_len = fiid_obj_get_data (c->connection.obj_sol_payload_data_rs,
                                                    "character_data",
@@ -2753,6 +3005,7 @@ _sol_bmc_to_remote_console_packet (ipmiconsole_ctx_t c, int *sol_deactivating_fl
       if (c->session.last_sol_output_packet_sequence_number == packet_sequence_number)
         {
           /* Retransmission from the BMC */
+          is_retransmission++;
 
           /* The BMC elected to transfer additional data with the
            * retransmission.  We will give the user only the new information,
@@ -2769,34 +3022,21 @@ _sol_bmc_to_remote_console_packet (ipmiconsole_ctx_t c, int *sol_deactivating_fl
 
       if (character_data_len_to_write)
         {
-          n = scbuf_write (c->connection.console_bmc_to_remote_console,
-                           character_data + character_data_index,
-                           character_data_len_to_write,
-                           &dropped,
-                           secure_malloc_flag);
-
-          if (n < 0)
-            {
-              IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: %s", strerror (errno)));
-              ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-              goto cleanup;
-            }
-
-          if (n != character_data_len_to_write)
-            {
-              IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: invalid bytes written; n=%d; character_data_len_to_write=%d", n, character_data_len_to_write));
-              ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-              goto cleanup;
-            }
+          ipmiconsole_ctx_history_write (c,
+                                         character_data + character_data_index,
+                                         character_data_len_to_write);
 
-          if (dropped)
-            {
-              IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: dropped data: dropped=%d", dropped));
-              ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-              goto cleanup;
-            }
+          if (_console_output (c,
+                               character_data + character_data_index,
+                               character_data_len_to_write) < 0)
+            goto cleanup;
         }
 
+      if (!c->connection.console_bmc_to_remote_console
+          || (buffered = scbuf_used (c->connection.console_bmc_to_remote_console)) < 0)
+        buffered = 0;
+      _stats_sol_output (c, character_data_len_to_write, is_retransmission, buffered);
+
       c->session.last_sol_output_packet_sequence_number = packet_sequence_number;
       c->session.last_sol_output_accepted_character_count = character_data_len;
 
@@ -2839,6 +3079,91 @@ _sol_bmc_to_remote_console_packet (ipmiconsole_ctx_t c, int *sol_deactivating_fl
   return (rv);
 }
 
+/* Under IPMICONSOLE_ENGINE_COALESCE_INPUT, character data is held
+ * back for up to IPMICONSOLE_COALESCE_INPUT_TIMEOUT_LENGTH
+ * milliseconds so more of it can go into a single SOL packet.  Data
+ * is not held once it fills a packet, if it contains a control
+ * character, or if a break is pending.  Data buffered while waiting
+ * for an ACK is sent as soon as the ACK arrives by
+ * _sol_bmc_to_remote_console_packet(), so it is never held here.
+ *
+ * Returns 1 if character data should be held, 0 if not, -1 on error
+ */
+static int
+_sol_input_coalesce (ipmiconsole_ctx_t c)
+{
+  uint8_t buf[IPMICONSOLE_MAX_CHARACTER_DATA];
+  struct timeval current;
+  struct timeval coalesce_timeout;
+  int used;
+  int i;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+  assert (c->session.protocol_state == IPMICONSOLE_PROTOCOL_STATE_SOL_SESSION);
+
+  if (!(c->config.engine_flags & IPMICONSOLE_ENGINE_COALESCE_INPUT)
+      || c->session.break_requested)
+    return (0);
+
+  if ((used = scbuf_used (c->connection.console_remote_console_to_bmc)) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_used: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  if (!used)
+    {
+      timeval_clear (&(c->session.sol_input_coalesce_start));
+      return (0);
+    }
+
+  if (used >= c->session.max_sol_character_send_size)
+    return (0);
+
+  if ((used = scbuf_peek (c->connection.console_remote_console_to_bmc,
+                          buf,
+                          used)) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_peek: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  for (i = 0; i < used; i++)
+    {
+      if (buf[i] < 0x20 || buf[i] == 0x7F)
+        {
+          secure_memset (buf, '\0', IPMICONSOLE_MAX_CHARACTER_DATA);
+          return (0);
+        }
+    }
+  secure_memset (buf, '\0', IPMICONSOLE_MAX_CHARACTER_DATA);
+
+  if (gettimeofday (&current, NULL) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("gettimeofday: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+      return (-1);
+    }
+
+  if (!c->session.sol_input_coalesce_start.tv_sec
+      && !c->session.sol_input_coalesce_start.tv_usec)
+    {
+      c->session.sol_input_coalesce_start = current;
+      return (1);
+    }
+
+  timeval_add_ms (&(c->session.sol_input_coalesce_start),
+                  IPMICONSOLE_COALESCE_INPUT_TIMEOUT_LENGTH,
+                  &coalesce_timeout);
+  if (timeval_gt (&current, &coalesce_timeout))
+    return (0);
+
+  return (1);
+}
+
 /*
  * Returns 0 on success
  * Returns -1 on error
@@ -2859,11 +3184,14 @@ _calculate_timeout (ipmiconsole_ctx_t c, unsigned int *timeout)
       struct timeval sol_retransmission_timeout_val;
       struct timeval keepalive_timeout;
       struct timeval keepalive_timeout_val;
+      struct timeval coalesce_timeout;
+      struct timeval coalesce_timeout_val;
       unsigned int session_timeout_ms;
       unsigned int sol_retransmission_timeout_len;
       unsigned int sol_retransmission_timeout_multiplier;
       unsigned int sol_retransmission_timeout_ms;
       unsigned int keepalive_timeout_ms;
+      unsigned int coalesce_timeout_ms;
       int rv;
 
       if (gettimeofday (&current, NULL) < 0)
@@ -2885,7 +3213,7 @@ _calculate_timeout (ipmiconsole_ctx_t c, unsigned int *timeout)
           else
             sol_retransmission_timeout_multiplier = 1;
 
-          sol_retransmission_timeout_len = c->config.retransmission_timeout_len * sol_retransmission_timeout_multiplier;
+          sol_retransmission_timeout_len = _retransmission_timeout_len (c) * sol_retransmission_timeout_multiplier;
 
           timeval_add_ms (&c->session.last_sol_input_packet_sent, sol_retransmission_timeout_len, &sol_retransmission_timeout);
           timeval_sub (&sol_retransmission_timeout, &current, &sol_retransmission_timeout_val);
@@ -2894,6 +3222,19 @@ _calculate_timeout (ipmiconsole_ctx_t c, unsigned int *timeout)
             *timeout = sol_retransmission_timeout_ms;
         }
 
+      /* Time when held character data must be sent */
+      if (c->config.engine_flags & IPMICONSOLE_ENGINE_COALESCE_INPUT
+          && !c->session.sol_input_waiting_for_ack
+          && (c->session.sol_input_coalesce_start.tv_sec
+              || c->session.sol_input_coalesce_start.tv_usec))
+        {
+          timeval_add_ms (&c->session.sol_input_coalesce_start, IPMICONSOLE_COALESCE_INPUT_TIMEOUT_LENGTH, &coalesce_timeout);
+          timeval_sub (&coalesce_timeout, &current, &coalesce_timeout_val);
+          timeval_millisecond_calc (&coalesce_timeout_val, &coalesce_timeout_ms);
+          if (coalesce_timeout_ms < *timeout)
+            *timeout = coalesce_timeout_ms;
+        }
+
       if ((rv = _keepalive_is_necessary (c)) < 0)
         return (-1);
 
@@ -2944,7 +3285,7 @@ _calculate_timeout (ipmiconsole_ctx_t c, unsigned int *timeout)
       else
         retransmission_timeout_multiplier = 1;
 
-      retransmission_timeout_len = c->config.retransmission_timeout_len * retransmission_timeout_multiplier;
+      retransmission_timeout_len = _retransmission_timeout_len (c) * retransmission_timeout_multiplier;
 
       timeval_add_ms (&c->session.last_ipmi_packet_sent, retransmission_timeout_len, &retransmission_timeout);
       timeval_sub (&retransmission_timeout, &current, &retransmission_timeout_val);
@@ -3528,51 +3869,13 @@ _process_protocol_state_activate_payload_sent (ipmiconsole_ctx_t c)
 
   c->session.protocol_state = IPMICONSOLE_PROTOCOL_STATE_SOL_SESSION;
 
+  /* Let the next context waiting for admission begin its handshake */
+  ipmiconsole_engine_handshake_release (c);
+
   if (c->config.engine_flags & IPMICONSOLE_ENGINE_OUTPUT_ON_SOL_ESTABLISHED)
     {
-      int n;
-      int dropped;
-      int secure_malloc_flag;
-
-      secure_malloc_flag = (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY) ? 1 : 0;
-
-      n = scbuf_write (c->connection.console_bmc_to_remote_console,
-                       "\0",
-                       1,
-                       &dropped,
-                       secure_malloc_flag);
-
-      if (n < 0)
+      if (_console_output (c, "\0", 1) < 0)
         {
-          IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: %s", strerror (errno)));
-          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-
-          /* Attempt to close the session cleanly */
-          c->session.close_session_flag++;
-          if (_send_ipmi_packet (c, IPMICONSOLE_PACKET_TYPE_DEACTIVATE_PAYLOAD_RQ) < 0)
-            return (-1);
-          c->session.protocol_state = IPMICONSOLE_PROTOCOL_STATE_DEACTIVATE_PAYLOAD_SENT;
-          return (0);
-        }
-
-      if (n != 1)
-        {
-          IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: invalid bytes written; n=%d", n));
-          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-
-          /* Attempt to close the session cleanly */
-          c->session.close_session_flag++;
-          if (_send_ipmi_packet (c, IPMICONSOLE_PACKET_TYPE_DEACTIVATE_PAYLOAD_RQ) < 0)
-            return (-1);
-          c->session.protocol_state = IPMICONSOLE_PROTOCOL_STATE_DEACTIVATE_PAYLOAD_SENT;
-          return (0);
-        }
-
-      if (dropped)
-        {
-          IPMICONSOLE_CTX_DEBUG (c, ("scbuf_write: dropped data: dropped=%d", dropped));
-          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
-
           /* Attempt to close the session cleanly */
           c->session.close_session_flag++;
           if (_send_ipmi_packet (c, IPMICONSOLE_PACKET_TYPE_DEACTIVATE_PAYLOAD_RQ) < 0)
@@ -3646,10 +3949,16 @@ _process_protocol_state_sol_session_send (ipmiconsole_ctx_t c)
     }
   else
     {
-      if ((ret = _send_sol_character_data_or_break (c)) < 0)
+      if ((ret = _sol_input_coalesce (c)) < 0)
         return (-1);
-      if (ret)
-        return (1);
+
+      if (!ret)
+        {
+          if ((ret = _send_sol_character_data_or_break (c)) < 0)
+            return (-1);
+          if (ret)
+            return (1);
+        }
     }
 
   /* Will handle retransmits too */
@@ -3953,6 +4262,68 @@ _process_protocol_state_close_session_sent (ipmiconsole_ctx_t c)
   return (-1);
 }
 
+/*
+ * Move console input written via ipmiconsole_ctx_write() into the
+ * buffer of data to be sent to the BMC, as much as will fit.
+ *
+ * Returns 0 on success
+ * Returns -1 on error
+ */
+static int
+_process_user_input (ipmiconsole_ctx_t c)
+{
+  int used, n, perr, rv = -1;
+  int secure_malloc_flag;
+
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  if (!c->fds.user_input
+      || !c->connection.console_remote_console_to_bmc)
+    return (0);
+
+  secure_malloc_flag = (c->config.engine_flags & IPMICONSOLE_ENGINE_LOCK_MEMORY) ? 1 : 0;
+
+  if ((perr = pthread_mutex_lock (&(c->fds.user_input_mutex))) != 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_lock: %s", strerror (perr)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      return (-1);
+    }
+
+  if ((used = scbuf_used (c->connection.console_remote_console_to_bmc)) < 0)
+    {
+      IPMICONSOLE_CTX_DEBUG (c, ("scbuf_used: %s", strerror (errno)));
+      ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+      goto cleanup;
+    }
+
+  /* Data that does not fit is left for the user to retry, not dropped */
+  if (used < CONSOLE_REMOTE_CONSOLE_TO_BMC_BUF_MAX)
+    {
+      if ((n = scbuf_move (c->fds.user_input,
+                           c->connection.console_remote_console_to_bmc,
+                           CONSOLE_REMOTE_CONSOLE_TO_BMC_BUF_MAX - used,
+                           NULL,
+                           secure_malloc_flag)) < 0)
+        {
+          IPMICONSOLE_CTX_DEBUG (c, ("scbuf_move: %s", strerror (errno)));
+          ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_INTERNAL_ERROR);
+          goto cleanup;
+        }
+    }
+
+  /* The user must notify the engine again for new data */
+  if (scbuf_is_empty (c->fds.user_input))
+    c->fds.user_input_notified = 0;
+
+  rv = 0;
+ cleanup:
+  if ((perr = pthread_mutex_unlock (&(c->fds.user_input_mutex))) != 0)
+    IPMICONSOLE_CTX_DEBUG (c, ("pthread_mutex_unlock: %s", strerror (perr)));
+  return (rv);
+}
+
 /*
  * This is the primary state machine for IPMI/SOL
  *
@@ -3984,11 +4355,54 @@ _process_ctx (ipmiconsole_ctx_t c, unsigned int *timeout)
    */
   if (c->session.protocol_state == IPMICONSOLE_PROTOCOL_STATE_START)
     {
+      /* Setup deferred from ipmiconsole_engine_submit(), so hostname
+       * resolution, socket creation, etc. do not serialize the
+       * submission of many contexts.  Errors are reported to the user
+       * through the context status, callback, and file descriptor
+       * like any other session establishment error.
+       *
+       * session setup required before connection setup, so
+       * connection knows if IPv4 or IPv6 used
+       */
+      if (!c->session.session_info_setup)
+        {
+          if (ipmiconsole_ctx_session_setup (c) < 0)
+            goto close_session;
+
+          if (ipmiconsole_ctx_connection_ipmi_setup (c) < 0)
+            goto close_session;
+        }
+
+      if ((ret = ipmiconsole_engine_handshake_admit (c)) < 0)
+        goto close_session;
+
+      if (!ret)
+        {
+          *timeout = IPMICONSOLE_HANDSHAKE_RETRY_LENGTH;
+          return (0);
+        }
+
+      /* Time waiting for admission does not count against the session */
+      if (c->engine.handshake_deferred)
+        {
+          if (gettimeofday (&(c->session.last_ipmi_packet_received), NULL) < 0
+              || gettimeofday (&(c->session.last_sol_packet_received), NULL) < 0)
+            {
+              IPMICONSOLE_CTX_DEBUG (c, ("gettimeofday: %s", strerror (errno)));
+              ipmiconsole_ctx_set_errnum (c, IPMICONSOLE_ERR_SYSTEM_ERROR);
+              goto close_session;
+            }
+          c->engine.handshake_deferred = 0;
+        }
+
       if (_process_protocol_state_start (c) < 0)
         goto close_session;
       goto calculate_timeout;
     }
 
+  if (_process_user_input (c) < 0)
+    goto close_session;
+
   if ((ret = _session_timeout (c)) < 0)
     goto close_session;
 
@@ -4196,6 +4610,25 @@ _process_ctx (ipmiconsole_ctx_t c, unsigned int *timeout)
   return (rv);
 }
 
+int
+ipmiconsole_process_ctx (ipmiconsole_ctx_t c, unsigned int *timeout)
+{
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+  assert (timeout);
+
+  return (_process_ctx (c, timeout));
+}
+
+int
+ipmiconsole_process_user_input (ipmiconsole_ctx_t c)
+{
+  assert (c);
+  assert (c->magic == IPMICONSOLE_CTX_MAGIC);
+
+  return (_process_user_input (c));
+}
+
 int
 ipmiconsole_process_ctxs (List console_engine_ctxs, unsigned int *timeout)
 {
@@ -31,6 +31,17 @@
 
 #include "list.h"
 
+/* Returns -1 if the context is finished and should be removed,
+ * otherwise timeout is set to the milliseconds until the context must
+ * be processed again.
+ */
+int ipmiconsole_process_ctx (ipmiconsole_ctx_t c, unsigned int *timeout);
+
+/* Returns -1 on error, moves console input from ipmiconsole_ctx_write()
+ * towards the BMC.
+ */
+int ipmiconsole_process_user_input (ipmiconsole_ctx_t c);
+
 int ipmiconsole_process_ctxs (List console_engine_ctxs, unsigned int *timeout);
 
 #endif /* IPMICONSOLE_PROCESSING_H */
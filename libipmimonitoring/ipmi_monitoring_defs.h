@@ -103,7 +103,8 @@
    | IPMI_MONITORING_SEL_FLAGS_INTERPRET_OEM_DATA         \
    | IPMI_MONITORING_SEL_FLAGS_ASSUME_SYSTEM_EVENT_RECORD \
    | IPMI_MONITORING_SEL_FLAGS_ENTITY_SENSOR_NAMES        \
-   | IPMI_MONITORING_SEL_FLAGS_ASSUME_MAX_SDR_RECORD_COUNT)
+   | IPMI_MONITORING_SEL_FLAGS_ASSUME_MAX_SDR_RECORD_COUNT \
+   | IPMI_MONITORING_SEL_FLAGS_SPECULATIVE_READ)
 
 
 #define IPMI_MONITORING_SENSOR_READING_FLAGS_MASK                          \
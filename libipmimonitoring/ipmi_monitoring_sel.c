@@ -884,6 +884,17 @@ ipmi_monitoring_get_sel (ipmi_monitoring_ctx_t c,
   spd.c = c;
   spd.sel_flags = sel_flags;
 
+  if (sel_flags & IPMI_MONITORING_SEL_FLAGS_SPECULATIVE_READ)
+    {
+      if (ipmi_sel_ctx_set_flags (c->sel_parse_ctx, IPMI_SEL_FLAGS_SPECULATIVE_READ) < 0)
+        {
+          IPMI_MONITORING_DEBUG (("ipmi_sel_ctx_set_flags: %s",
+                                  ipmi_sel_ctx_errormsg (c->sel_parse_ctx)));
+          _sel_parse_ctx_error_convert (c);
+          goto cleanup;
+        }
+    }
+
   if (record_ids
       && record_ids_len)
     {